@@ -0,0 +1,140 @@
+#include "FrustumCulling.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_USE_AVX 1
+#define FRUSTUM_USE_SSE 0
+#elif defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define FRUSTUM_USE_AVX 0
+#define FRUSTUM_USE_SSE 1
+#else
+#define FRUSTUM_USE_AVX 0
+#define FRUSTUM_USE_SSE 0
+#endif
+
+using namespace DirectX;
+
+FrustumCuller::FrustumCuller()
+	: m_CulledCount(0)
+{
+}
+
+FrustumPlanes XM_CALLCONV FrustumCuller::ExtractPlanes(FXMMATRIX viewProj)
+{
+	// 行向量右乘矩阵，裁剪坐标的各分量为点与矩阵各列的点积，转置后各列变为各行
+	XMMATRIX M = XMMatrixTranspose(viewProj);
+	XMVECTOR planes[6] = {
+		M.r[3] + M.r[0],	// 左  -w <= x
+		M.r[3] - M.r[0],	// 右  x <= w
+		M.r[3] + M.r[1],	// 下  -w <= y
+		M.r[3] - M.r[1],	// 上  y <= w
+		M.r[2],				// 近  0 <= z
+		M.r[3] - M.r[2]		// 远  z <= w
+	};
+
+	FrustumPlanes frustum;
+	for (int i = 0; i < 6; ++i)
+		XMStoreFloat4(&frustum.planes[i], XMPlaneNormalize(planes[i]));
+	return frustum;
+}
+
+void FrustumCuller::Cull(const FrustumPlanes& frustum, const float* centerX, const float* centerY,
+	const float* centerZ, const float* radius, uint32_t count)
+{
+	m_VisibleIndices.resize(count);
+	uint32_t* pOut = m_VisibleIndices.data();
+	uint32_t visibleCount = 0;
+	const XMFLOAT4* P = frustum.planes;
+
+#if FRUSTUM_USE_AVX
+	__m256 nx[6], ny[6], nz[6], d[6];
+	for (int p = 0; p < 6; ++p)
+	{
+		nx[p] = _mm256_set1_ps(P[p].x);
+		ny[p] = _mm256_set1_ps(P[p].y);
+		nz[p] = _mm256_set1_ps(P[p].z);
+		d[p] = _mm256_set1_ps(P[p].w);
+	}
+	const __m256 zero = _mm256_setzero_ps();
+	for (uint32_t i = 0; i < count; i += 8)
+	{
+		__m256 cx = _mm256_loadu_ps(centerX + i);
+		__m256 cy = _mm256_loadu_ps(centerY + i);
+		__m256 cz = _mm256_loadu_ps(centerZ + i);
+		__m256 negR = _mm256_sub_ps(zero, _mm256_loadu_ps(radius + i));
+		// 球心到每个平面的有向距离不小于-r才可能可见
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; ++p)
+		{
+			__m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx[p], cx), _mm256_mul_ps(ny[p], cy)),
+				_mm256_add_ps(_mm256_mul_ps(nz[p], cz), d[p]));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(dist, negR, _CMP_GE_OQ));
+		}
+		int mask = _mm256_movemask_ps(inside);
+		for (uint32_t k = 0; mask != 0; ++k, mask >>= 1)
+		{
+			if ((mask & 1) && i + k < count)
+				pOut[visibleCount++] = i + k;
+		}
+	}
+#elif FRUSTUM_USE_SSE
+	__m128 nx[6], ny[6], nz[6], d[6];
+	for (int p = 0; p < 6; ++p)
+	{
+		nx[p] = _mm_set1_ps(P[p].x);
+		ny[p] = _mm_set1_ps(P[p].y);
+		nz[p] = _mm_set1_ps(P[p].z);
+		d[p] = _mm_set1_ps(P[p].w);
+	}
+	const __m128 zero = _mm_setzero_ps();
+	for (uint32_t i = 0; i < count; i += 4)
+	{
+		__m128 cx = _mm_loadu_ps(centerX + i);
+		__m128 cy = _mm_loadu_ps(centerY + i);
+		__m128 cz = _mm_loadu_ps(centerZ + i);
+		__m128 negR = _mm_sub_ps(zero, _mm_loadu_ps(radius + i));
+		// 球心到每个平面的有向距离不小于-r才可能可见
+		__m128 inside = _mm_cmpeq_ps(zero, zero);
+		for (int p = 0; p < 6; ++p)
+		{
+			__m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)),
+				_mm_add_ps(_mm_mul_ps(nz[p], cz), d[p]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, negR));
+		}
+		int mask = _mm_movemask_ps(inside);
+		for (uint32_t k = 0; mask != 0; ++k, mask >>= 1)
+		{
+			if ((mask & 1) && i + k < count)
+				pOut[visibleCount++] = i + k;
+		}
+	}
+#else
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; ++p)
+			inside = P[p].x * centerX[i] + P[p].y * centerY[i] + P[p].z * centerZ[i] + P[p].w >= -radius[i];
+		if (inside)
+			pOut[visibleCount++] = i;
+	}
+#endif
+
+	m_VisibleIndices.resize(visibleCount);
+	m_CulledCount = count - visibleCount;
+}
+
+const std::vector<uint32_t>& FrustumCuller::GetVisibleIndices() const
+{
+	return m_VisibleIndices;
+}
+
+uint32_t FrustumCuller::GetVisibleCount() const
+{
+	return (uint32_t)m_VisibleIndices.size();
+}
+
+uint32_t FrustumCuller::GetCulledCount() const
+{
+	return m_CulledCount;
+}
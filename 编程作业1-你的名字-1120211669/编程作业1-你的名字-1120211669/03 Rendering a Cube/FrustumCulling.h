@@ -0,0 +1,37 @@
+#ifndef FRUSTUMCULLING_H
+#define FRUSTUMCULLING_H
+
+#include <vector>
+#include <cstdint>
+#include "PortableMath.h"
+
+// 视锥体的6个平面，平面方程为dot(n, p) + d = 0，(x, y, z)为单位法线并指向视锥体内部，w为d
+struct FrustumPlanes
+{
+	DirectX::XMFLOAT4 planes[6];	// 左、右、下、上、近、远
+};
+
+// 视锥体剔除。包围球按分量分开存放(SoA)，AVX下一次测试8个，否则SSE一次测试4个
+class FrustumCuller
+{
+public:
+	FrustumCuller();
+
+	// 从未转置的(view * proj)中提取视锥体平面(D3D的裁剪空间，z范围[0, w])
+	static FrustumPlanes XM_CALLCONV ExtractPlanes(DirectX::FXMMATRIX viewProj);
+
+	// 剔除count个包围球，可见的下标按从小到大存入GetVisibleIndices()
+	// 各数组长度需补齐为8的倍数，补齐部分的半径应为负以保证被剔除
+	void Cull(const FrustumPlanes& frustum, const float* centerX, const float* centerY,
+		const float* centerZ, const float* radius, uint32_t count);
+
+	const std::vector<uint32_t>& GetVisibleIndices() const;
+	uint32_t GetVisibleCount() const;
+	uint32_t GetCulledCount() const;		// 上一次Cull中被剔除的数目
+
+private:
+	std::vector<uint32_t> m_VisibleIndices;	// 可见的下标
+	uint32_t m_CulledCount;					// 被剔除的数目
+};
+
+#endif
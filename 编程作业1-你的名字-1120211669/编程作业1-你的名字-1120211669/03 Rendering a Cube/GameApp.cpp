@@ -9,7 +9,7 @@ const D3D11_INPUT_ELEMENT_DESC GameApp::VertexPosColor::inputLayout[2] = {
 };
 
 GameApp::GameApp(HINSTANCE hInstance)
-	: D3DApp(hInstance), m_CBuffer()
+	: D3DApp(hInstance)
 {
 }
 
@@ -34,6 +34,7 @@ bool GameApp::Init()
 void GameApp::OnResize()
 {
 	D3DApp::OnResize();
+	m_Camera.SetAspect(AspectRatio());
 }
 
 void GameApp::UpdateScene(float dt)
@@ -41,12 +42,16 @@ void GameApp::UpdateScene(float dt)
 
 	static float phi = 0.0f, theta = 0.0f;
 	phi += 0.0001f, theta += 0.00015f;
-	m_CBuffer.world = XMMatrixTranspose(XMMatrixRotationX(phi) * XMMatrixRotationY(theta));
+	m_CBPerObject.data.world = XMMatrixTranspose(XMMatrixRotationX(phi) * XMMatrixRotationY(theta));
 	// 更新常量缓冲区，让立方体转起来
-	D3D11_MAPPED_SUBRESOURCE mappedData;
-	HR(m_pd3dImmediateContext->Map(m_pConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData));
-	memcpy_s(mappedData.pData, sizeof(m_CBuffer), &m_CBuffer, sizeof(m_CBuffer));
-	m_pd3dImmediateContext->Unmap(m_pConstantBuffer.Get(), 0);
+	HR(m_CBPerObject.Upload(m_pd3dImmediateContext.Get()));
+	// 摄像机固定不动，观察和投影矩阵只在窗口大小变化后重新上传
+	if (m_CBPerFrame.NeedsUpload(m_Camera.GetVersion()))
+	{
+		m_CBPerFrame.data.view = XMMatrixTranspose(m_Camera.GetView());
+		m_CBPerFrame.data.proj = XMMatrixTranspose(m_Camera.GetProj());
+		HR(m_CBPerFrame.Upload(m_pd3dImmediateContext.Get(), m_Camera.GetVersion()));
+	}
 }
 
 void GameApp::DrawScene()
@@ -1713,25 +1718,16 @@ bool GameApp::InitResource()
 
 
 	// ******************
-	// 设置常量缓冲区描述
-	//
-	D3D11_BUFFER_DESC cbd;
-	ZeroMemory(&cbd, sizeof(cbd));
-	cbd.Usage = D3D11_USAGE_DYNAMIC;
-	cbd.ByteWidth = sizeof(ConstantBuffer);
-	cbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	cbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 	// 新建常量缓冲区，不使用初始数据
-	HR(m_pd3dDevice->CreateBuffer(&cbd, nullptr, m_pConstantBuffer.GetAddressOf()));
+	//
+	HR(m_CBPerObject.Create(m_pd3dDevice.Get()));
+	HR(m_CBPerFrame.Create(m_pd3dDevice.Get()));
 
 	// 初始化常量缓冲区的值
-	m_CBuffer.world = XMMatrixIdentity();	// 单位矩阵的转置是它本身
-	m_CBuffer.view = XMMatrixTranspose(XMMatrixLookAtLH(
-		XMVectorSet(0.0f, 0.0f, -5.0f, 0.0f),
-		XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f),
-		XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)
-	));
-	m_CBuffer.proj = XMMatrixTranspose(XMMatrixPerspectiveFovLH(XM_PIDIV2, AspectRatio(), 1.0f, 1000.0f));
+	m_CBPerObject.data.world = XMMatrixIdentity();	// 单位矩阵的转置是它本身
+	// 观察和投影矩阵在第一次更新时由摄像机写入
+	m_Camera.SetLens(XM_PIDIV2, AspectRatio(), 1.0f, 1000.0f);
+	m_Camera.LookAt(XMFLOAT3(0.0f, 0.0f, -5.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f));
 
 
 	// ******************
@@ -1748,8 +1744,9 @@ bool GameApp::InitResource()
 	m_pd3dImmediateContext->IASetInputLayout(m_pVertexLayout.Get());
 	// 将着色器绑定到渲染管线
 	m_pd3dImmediateContext->VSSetShader(m_pVertexShader.Get(), nullptr, 0);
-	// 将更新好的常量缓冲区绑定到顶点着色器
-	m_pd3dImmediateContext->VSSetConstantBuffers(0, 1, m_pConstantBuffer.GetAddressOf());
+	// 将常量缓冲区绑定到顶点着色器，b0为每个物体的，b1为每帧的
+	m_pd3dImmediateContext->VSSetConstantBuffers(0, 1, m_CBPerObject.GetAddressOf());
+	m_pd3dImmediateContext->VSSetConstantBuffers(1, 1, m_CBPerFrame.GetAddressOf());
 
 	m_pd3dImmediateContext->PSSetShader(m_pPixelShader.Get(), nullptr, 0);
 
@@ -1759,7 +1756,8 @@ bool GameApp::InitResource()
 	D3D11SetDebugObjectName(m_pVertexLayout.Get(), "VertexPosColorLayout");
 	D3D11SetDebugObjectName(m_pVertexBuffer.Get(), "VertexBuffer");
 	D3D11SetDebugObjectName(m_pIndexBuffer.Get(), "IndexBuffer");
-	D3D11SetDebugObjectName(m_pConstantBuffer.Get(), "ConstantBuffer");
+	D3D11SetDebugObjectName(m_CBPerObject.Get(), "CBPerObject");
+	D3D11SetDebugObjectName(m_CBPerFrame.Get(), "CBPerFrame");
 	D3D11SetDebugObjectName(m_pVertexShader.Get(), "Cube_VS");
 	D3D11SetDebugObjectName(m_pPixelShader.Get(), "Cube_PS");
 
@@ -2,6 +2,8 @@
 #define GAMEAPP_H
 
 #include "d3dApp.h"
+#include "ConstantBuffers.h"
+#include "Camera.h"
 
 class GameApp : public D3DApp
 {
@@ -13,9 +15,14 @@ public:
 		static const D3D11_INPUT_ELEMENT_DESC inputLayout[2];
 	};
 
-	struct ConstantBuffer
+	// 常量缓冲区按更新频率拆分，对应HLSL中的b0、b1
+	struct CBPerObject
 	{
 		DirectX::XMMATRIX world;
+	};
+
+	struct CBPerFrame
+	{
 		DirectX::XMMATRIX view;
 		DirectX::XMMATRIX proj;
 	};
@@ -40,11 +47,12 @@ private:
 	ComPtr<ID3D11InputLayout> m_pVertexLayout;	    // 顶点输入布局
 	ComPtr<ID3D11Buffer> m_pVertexBuffer;			// 顶点缓冲区
 	ComPtr<ID3D11Buffer> m_pIndexBuffer;			// 索引缓冲区
-	ComPtr<ID3D11Buffer> m_pConstantBuffer;		    // 常量缓冲区
 
 	ComPtr<ID3D11VertexShader> m_pVertexShader;	    // 顶点着色器
 	ComPtr<ID3D11PixelShader> m_pPixelShader;		// 像素着色器
-	ConstantBuffer m_CBuffer;	                    // 用于修改GPU常量缓冲区的变量
+	CBufferObject<CBPerObject> m_CBPerObject;		// 每个物体更新的常量缓冲区
+	CBufferObject<CBPerFrame> m_CBPerFrame;			// 观察和投影矩阵变化时才更新的常量缓冲区
+	Camera m_Camera;								// 注视原点的固定摄像机
 };
 
 
@@ -2,6 +2,7 @@
 #include<time.h>
 #include<cstdlib>
 #include<sstream>
+#include"CounterRng.h"
 using namespace std;
 #define rep(i,a,n) for(int i=a;i<=n;i++)
 #define per(i,a,n) for(int i=n;i>=a;i--)
@@ -13,23 +14,28 @@ typedef pair<int,int> pii;
 typedef double db;
 stringstream s;
 typedef long long ll;
+// 随机数由(编号, 用途, 序号)决定：stream 0~2为顶点颜色的rgb，3为mknum，4为str，编号为第几次调用
+CounterRng rng;
 ll mknum(int wei){
+	static uint32_t call=0;
 	ll now=0;
 	for(int i=1;i<=wei;i++){
-		now=10ll*now+rand()%10;
+		now=10ll*now+rng.Range(call,3,i,0,10);
 	}
+	++call;
 	return now;
 }
 void str(int len){
+	static uint32_t call=0;
 	for(int i=1;i<=len;i++){
-		putchar('a'+rand()%3);
+		putchar('a'+rng.Range(call,4,i,0,3));
 	}putchar('\n');
+	++call;
 }
 double x[8]={0,0,1,1,0,0,1,1};
 double y[8]={0,1,1,0,0,1,1,0};
 double z[8]={-1,-1,-1,-1,1,1,1,1};
 //三个维度坐标变化
-mt19937 rd(time(0));
 int ans[36] = {0,1,2,2,3,0,4,5,1,1,0,4,1,5,6,6,2,1,7,6,5,5,4,7,3,2,6,6,7,3,4,0,3,3,7,4};
 //构建一个立方体所需要的边
 vector<pair<double, double> > a;
@@ -61,14 +67,13 @@ double change(){
 	}
 }
 int main(int argc,char *argv[]){
-	int random;
+	int random = 0;
 	if(argc>1){
 		s.clear();
 		s<<argv[1];
 		s>>random;
 	}
-	srand(random);
-	std::mt19937 rd(random);
+	rng = CounterRng(random);// 颜色由(顶点编号, 通道)决定，与求值顺序无关
 	//以上是初始化随机内容
 	string s[8];
 	s[0] = "), XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f) },\n";
@@ -109,7 +114,7 @@ int main(int argc,char *argv[]){
 			cout << "{XMFLOAT3(";
 			printf("%.4ff, %.4ff, %.4ff", a[i].first + 2 * step * x[j],a[i].second + 2 * step * y[j],step * z[j]);
 //			cout << s[j];
-			printf("), XMFLOAT4(%.3ff, %.3ff, %.3ff, %.3ff) }", rd() % 1000 * 0.001,rd() % 1000 * 0.001,rd() % 1000 * 0.001,1.000); //随机生成颜色
+			printf("), XMFLOAT4(%.3ff, %.3ff, %.3ff, %.3ff) }", rng.Range(i * 8 + j, 0, 0, 0, 1000) * 0.001,rng.Range(i * 8 + j, 1, 0, 0, 1000) * 0.001,rng.Range(i * 8 + j, 2, 0, 0, 1000) * 0.001,1.000); //随机生成颜色
 			if(j != 7) cout << ",\n";
 		}
 		if(i == a.size() - 1){
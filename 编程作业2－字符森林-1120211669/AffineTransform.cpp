@@ -0,0 +1,359 @@
+#include "AffineTransform.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#if defined(__AVX__) && !defined(_XM_NO_INTRINSICS_)
+#include <immintrin.h>
+#define AFFINE_USE_AVX 1
+#else
+#define AFFINE_USE_AVX 0
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	// 4个元素按分量存放的结果m[行][列]，每行转置后即为4个元素的这一行
+	inline void StoreAffine4(AffineTransform* pDest, XMVECTOR m[3][4])
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			XMMATRIX T = XMMatrixTranspose(XMMATRIX(m[i][0], m[i][1], m[i][2], m[i][3]));
+			for (int k = 0; k < 4; ++k)
+				XMStoreFloat4(&pDest[k].r[i], T.r[k]);
+		}
+	}
+
+	inline XMVECTOR LoadOrZero4(const float* p, uint32_t i)
+	{
+		return p ? XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(p + i)) : XMVectorZero();
+	}
+
+	inline float LoadOrZero(const float* p, uint32_t i)
+	{
+		return p ? p[i] : 0.0f;
+	}
+
+	// 世界变换与逆转置变换的线性部分只差在缩放：前者乘s，后者除以s
+	template<typename V, typename Mul, typename Add, typename Sub>
+	inline void ComposeSRT(V sx, V sy, V sz, V ox, V oy, V oz, V sinX, V cosX, V sinY, V cosY, V px, V py, V pz, V zero,
+		V m[3][4], Mul mul, Add add, Sub sub)
+	{
+		V sxsy = mul(sinX, sinY), sxcy = mul(sinX, cosY), cxsy = mul(cosX, sinY), cxcy = mul(cosX, cosY);
+		m[0][0] = mul(sx, cosY);
+		m[0][1] = mul(sy, sxsy);
+		m[0][2] = mul(sz, cxsy);
+		m[0][3] = add(add(px, mul(ox, cosY)), add(mul(oy, sxsy), mul(oz, cxsy)));
+		m[1][0] = zero;
+		m[1][1] = mul(sy, cosX);
+		m[1][2] = sub(zero, mul(sz, sinX));
+		m[1][3] = sub(add(py, mul(oy, cosX)), mul(oz, sinX));
+		m[2][0] = sub(zero, mul(sx, sinY));
+		m[2][1] = mul(sy, sxcy);
+		m[2][2] = mul(sz, cxcy);
+		m[2][3] = add(sub(pz, mul(ox, sinY)), add(mul(oy, sxcy), mul(oz, cxcy)));
+	}
+
+	void ComposeSRT4(const SRTArrays& in, uint32_t i, AffineTransform* pWorld, AffineTransform* pInvTranspose)
+	{
+		auto mul = [](FXMVECTOR a, FXMVECTOR b) { return XMVectorMultiply(a, b); };
+		auto add = [](FXMVECTOR a, FXMVECTOR b) { return XMVectorAdd(a, b); };
+		auto sub = [](FXMVECTOR a, FXMVECTOR b) { return XMVectorSubtract(a, b); };
+		XMVECTOR sx = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(in.scaleX + i));
+		XMVECTOR sy = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(in.scaleY + i));
+		XMVECTOR sz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(in.scaleZ + i));
+		XMVECTOR sinX, cosX, sinY, cosY;
+		XMVectorSinCos(&sinX, &cosX, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(in.rotX + i)));
+		XMVectorSinCos(&sinY, &cosY, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(in.rotY + i)));
+		XMVECTOR ox = LoadOrZero4(in.offsetX, i), oy = LoadOrZero4(in.offsetY, i), oz = LoadOrZero4(in.offsetZ, i);
+		XMVECTOR px = LoadOrZero4(in.posX, i), py = LoadOrZero4(in.posY, i), pz = LoadOrZero4(in.posZ, i);
+
+		XMVECTOR zero = XMVectorZero();
+		XMVECTOR m[3][4];
+		ComposeSRT<XMVECTOR>(sx, sy, sz, ox, oy, oz, sinX, cosX, sinY, cosY, px, py, pz, zero, m, mul, add, sub);
+		StoreAffine4(pWorld + i, m);
+		if (pInvTranspose)
+		{
+			ComposeSRT<XMVECTOR>(XMVectorReciprocal(sx), XMVectorReciprocal(sy), XMVectorReciprocal(sz), zero, zero, zero,
+				sinX, cosX, sinY, cosY, zero, zero, zero, zero, m, mul, add, sub);
+			StoreAffine4(pInvTranspose + i, m);
+		}
+	}
+
+	void ComposeSRT1(const SRTArrays& in, uint32_t i, AffineTransform* pWorld, AffineTransform* pInvTranspose)
+	{
+		auto mul = [](float a, float b) { return a * b; };
+		auto add = [](float a, float b) { return a + b; };
+		auto sub = [](float a, float b) { return a - b; };
+		float sinX, cosX, sinY, cosY;
+		XMScalarSinCos(&sinX, &cosX, in.rotX[i]);
+		XMScalarSinCos(&sinY, &cosY, in.rotY[i]);
+
+		float m[3][4];
+		ComposeSRT<float>(in.scaleX[i], in.scaleY[i], in.scaleZ[i],
+			LoadOrZero(in.offsetX, i), LoadOrZero(in.offsetY, i), LoadOrZero(in.offsetZ, i),
+			sinX, cosX, sinY, cosY, LoadOrZero(in.posX, i), LoadOrZero(in.posY, i), LoadOrZero(in.posZ, i), 0.0f, m, mul, add, sub);
+		for (int r = 0; r < 3; ++r)
+			pWorld[i].r[r] = XMFLOAT4(m[r][0], m[r][1], m[r][2], m[r][3]);
+		if (pInvTranspose)
+		{
+			ComposeSRT<float>(1.0f / in.scaleX[i], 1.0f / in.scaleY[i], 1.0f / in.scaleZ[i], 0.0f, 0.0f, 0.0f,
+				sinX, cosX, sinY, cosY, 0.0f, 0.0f, 0.0f, 0.0f, m, mul, add, sub);
+			for (int r = 0; r < 3; ++r)
+				pInvTranspose[i].r[r] = XMFLOAT4(m[r][0], m[r][1], m[r][2], m[r][3]);
+		}
+	}
+
+#if AFFINE_USE_AVX
+	// 与XMScalarSinCos相同的多项式逼近：先把角度映射到[-pi, pi]，再利用对称性映射到[-pi/2, pi/2]
+	inline void SinCos8(__m256 x, __m256& s, __m256& c)
+	{
+		const __m256 signBit = _mm256_set1_ps(-0.0f);
+		__m256 quotient = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(XM_1DIV2PI)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		__m256 y = _mm256_sub_ps(x, _mm256_mul_ps(quotient, _mm256_set1_ps(XM_2PI)));
+		__m256 pi = _mm256_or_ps(_mm256_set1_ps(XM_PI), _mm256_and_ps(y, signBit));
+		__m256 reflect = _mm256_cmp_ps(_mm256_andnot_ps(signBit, y), _mm256_set1_ps(XM_PIDIV2), _CMP_GT_OQ);
+		y = _mm256_blendv_ps(y, _mm256_sub_ps(pi, y), reflect);
+		__m256 y2 = _mm256_mul_ps(y, y);
+
+		__m256 ps = _mm256_set1_ps(-2.3889859e-08f);
+		ps = _mm256_add_ps(_mm256_mul_ps(ps, y2), _mm256_set1_ps(2.7525562e-06f));
+		ps = _mm256_add_ps(_mm256_mul_ps(ps, y2), _mm256_set1_ps(-0.00019840874f));
+		ps = _mm256_add_ps(_mm256_mul_ps(ps, y2), _mm256_set1_ps(0.0083333310f));
+		ps = _mm256_add_ps(_mm256_mul_ps(ps, y2), _mm256_set1_ps(-0.16666667f));
+		ps = _mm256_add_ps(_mm256_mul_ps(ps, y2), _mm256_set1_ps(1.0f));
+		s = _mm256_mul_ps(ps, y);
+
+		__m256 pc = _mm256_set1_ps(-2.6051615e-07f);
+		pc = _mm256_add_ps(_mm256_mul_ps(pc, y2), _mm256_set1_ps(2.4760495e-05f));
+		pc = _mm256_add_ps(_mm256_mul_ps(pc, y2), _mm256_set1_ps(-0.0013888378f));
+		pc = _mm256_add_ps(_mm256_mul_ps(pc, y2), _mm256_set1_ps(0.041666638f));
+		pc = _mm256_add_ps(_mm256_mul_ps(pc, y2), _mm256_set1_ps(-0.5f));
+		pc = _mm256_add_ps(_mm256_mul_ps(pc, y2), _mm256_set1_ps(1.0f));
+		// 映射过的角度cos变号
+		c = _mm256_xor_ps(pc, _mm256_and_ps(reflect, signBit));
+	}
+
+	inline __m256 LoadOrZero8(const float* p, uint32_t i)
+	{
+		return p ? _mm256_loadu_ps(p + i) : _mm256_setzero_ps();
+	}
+
+	// 8个元素的结果先按分量写入临时数组，再逐个元素拼成行
+	inline void StoreAffine8(AffineTransform* pDest, __m256 m[3][4])
+	{
+		alignas(32) float lanes[4][8];
+		for (int r = 0; r < 3; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+				_mm256_store_ps(lanes[c], m[r][c]);
+			for (int k = 0; k < 8; ++k)
+				pDest[k].r[r] = XMFLOAT4(lanes[0][k], lanes[1][k], lanes[2][k], lanes[3][k]);
+		}
+	}
+
+	void ComposeSRT8(const SRTArrays& in, uint32_t i, AffineTransform* pWorld, AffineTransform* pInvTranspose)
+	{
+		auto mul = [](__m256 a, __m256 b) { return _mm256_mul_ps(a, b); };
+		auto add = [](__m256 a, __m256 b) { return _mm256_add_ps(a, b); };
+		auto sub = [](__m256 a, __m256 b) { return _mm256_sub_ps(a, b); };
+		__m256 sx = _mm256_loadu_ps(in.scaleX + i);
+		__m256 sy = _mm256_loadu_ps(in.scaleY + i);
+		__m256 sz = _mm256_loadu_ps(in.scaleZ + i);
+		__m256 sinX, cosX, sinY, cosY;
+		SinCos8(_mm256_loadu_ps(in.rotX + i), sinX, cosX);
+		SinCos8(_mm256_loadu_ps(in.rotY + i), sinY, cosY);
+		__m256 ox = LoadOrZero8(in.offsetX, i), oy = LoadOrZero8(in.offsetY, i), oz = LoadOrZero8(in.offsetZ, i);
+		__m256 px = LoadOrZero8(in.posX, i), py = LoadOrZero8(in.posY, i), pz = LoadOrZero8(in.posZ, i);
+
+		const __m256 zero = _mm256_setzero_ps();
+		__m256 m[3][4];
+		ComposeSRT<__m256>(sx, sy, sz, ox, oy, oz, sinX, cosX, sinY, cosY, px, py, pz, zero, m, mul, add, sub);
+		StoreAffine8(pWorld + i, m);
+		if (pInvTranspose)
+		{
+			const __m256 one = _mm256_set1_ps(1.0f);
+			ComposeSRT<__m256>(_mm256_div_ps(one, sx), _mm256_div_ps(one, sy), _mm256_div_ps(one, sz), zero, zero, zero,
+				sinX, cosX, sinY, cosY, zero, zero, zero, zero, m, mul, add, sub);
+			StoreAffine8(pInvTranspose + i, m);
+		}
+	}
+#endif
+
+	template<typename Func>
+	double BestMilliseconds(int repeats, Func func)
+	{
+		double best = 1e30;
+		for (int r = 0; r < repeats; ++r)
+		{
+			auto start = std::chrono::steady_clock::now();
+			func();
+			auto stop = std::chrono::steady_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>(stop - start).count());
+		}
+		return best;
+	}
+
+	// 两个转置后矩阵前三行的最大误差
+	float MaxError(const XMFLOAT4X4& m, const AffineTransform& a)
+	{
+		float err = 0.0f;
+		for (int i = 0; i < 3; ++i)
+		{
+			err = std::max(err, std::fabs(m.m[i][0] - a.r[i].x));
+			err = std::max(err, std::fabs(m.m[i][1] - a.r[i].y));
+			err = std::max(err, std::fabs(m.m[i][2] - a.r[i].z));
+			err = std::max(err, std::fabs(m.m[i][3] - a.r[i].w));
+		}
+		return err;
+	}
+}
+
+void AffineComposeSRTBatch(const SRTArrays& in, uint32_t count, AffineTransform* pWorld, AffineTransform* pInvTranspose)
+{
+	uint32_t i = 0;
+#if AFFINE_USE_AVX
+	for (; i + 8 <= count; i += 8)
+		ComposeSRT8(in, i, pWorld, pInvTranspose);
+#endif
+	for (; i + 4 <= count; i += 4)
+		ComposeSRT4(in, i, pWorld, pInvTranspose);
+	for (; i < count; ++i)
+		ComposeSRT1(in, i, pWorld, pInvTranspose);
+}
+
+void BenchmarkAffineTransforms(std::ostream& os, uint32_t count)
+{
+	// 随机的SRT参数，缩放是非均匀的
+	std::minstd_rand rng(1);
+	std::uniform_real_distribution<float> scaleDist(0.2f, 3.0f), angleDist(-XM_2PI, XM_2PI), posDist(-100.0f, 100.0f);
+	std::vector<float> soa[8];
+	for (std::vector<float>& v : soa)
+		v.resize(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		for (int k = 0; k < 3; ++k)
+			soa[k][i] = scaleDist(rng);
+		soa[3][i] = angleDist(rng);
+		soa[4][i] = angleDist(rng);
+		for (int k = 5; k < 8; ++k)
+			soa[k][i] = posDist(rng);
+	}
+	SRTArrays in = { soa[0].data(), soa[1].data(), soa[2].data(), nullptr, nullptr, nullptr,
+		soa[3].data(), soa[4].data(), soa[5].data(), soa[6].data(), soa[7].data() };
+
+	std::vector<XMFLOAT4X4> matrices(count), matrices2(count);
+	std::vector<AffineTransform> affines(count), affines2(count), affines3(count);
+	const int repeats = 5;
+	os << "affine transforms  count " << count << (AFFINE_USE_AVX ? "  (AVX 8-wide)" : "  (4-wide)") << "\n";
+	os << "kernel\tns/transform\tspeedup\tmax error\n";
+	auto report = [&](const char* name, double ms, double baseMs, float err)
+	{
+		os << name << "\t" << ms * 1e6 / count << "\t" << baseMs / ms << "\t" << err << "\n";
+	};
+
+	// 1. 组合SRT：DirectXMath的矩阵链(转置后才能上传)对比直接写出
+	double chainMs = BestMilliseconds(repeats, [&]()
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			XMMATRIX M = XMMatrixScaling(soa[0][i], soa[1][i], soa[2][i]) * XMMatrixRotationX(soa[3][i]) *
+				XMMatrixRotationY(soa[4][i]) * XMMatrixTranslation(soa[5][i], soa[6][i], soa[7][i]);
+			XMStoreFloat4x4(&matrices[i], XMMatrixTranspose(M));
+		}
+	});
+	double scalarMs = BestMilliseconds(repeats, [&]()
+	{
+		for (uint32_t i = 0; i < count; ++i)
+			affines[i] = AffineComposeSRT(XMFLOAT3(soa[0][i], soa[1][i], soa[2][i]), soa[3][i], soa[4][i], XMFLOAT3(soa[5][i], soa[6][i], soa[7][i]));
+	});
+	float scalarErr = 0.0f;
+	for (uint32_t i = 0; i < count; ++i)
+		scalarErr = std::max(scalarErr, MaxError(matrices[i], affines[i]));
+	double batchMs = BestMilliseconds(repeats, [&]() { AffineComposeSRTBatch(in, count, affines2.data()); });
+	float batchErr = 0.0f;
+	for (uint32_t i = 0; i < count; ++i)
+		batchErr = std::max(batchErr, MaxError(matrices[i], affines2[i]));
+	report("XMMatrix S*Rx*Ry*T", chainMs, chainMs, 0.0f);
+	report("AffineComposeSRT", scalarMs, chainMs, scalarErr);
+	report("AffineComposeSRTBatch", batchMs, chainMs, batchErr);
+
+	// 2. 组合两个变换：4x4乘法对比3x4乘法
+	double mulMs = BestMilliseconds(repeats, [&]()
+	{
+		for (uint32_t i = 0; i + 1 < count; ++i)
+			XMStoreFloat4x4(&matrices2[i], XMMatrixMultiply(XMLoadFloat4x4(&matrices[i]), XMLoadFloat4x4(&matrices[i + 1])));
+	});
+	double affineMulMs = BestMilliseconds(repeats, [&]()
+	{
+		for (uint32_t i = 0; i + 1 < count; ++i)
+			affines3[i] = AffineMultiply(affines[i + 1], affines[i]);	// matrices中是转置后的矩阵，两者都是M[i + 1] * M[i]
+	});
+	float mulErr = 0.0f;
+	for (uint32_t i = 0; i + 1 < count; ++i)
+	{
+		// 相对误差：平移可达上百，乘积的量级更大
+		XMFLOAT4X4 ref = matrices2[i];
+		float scale = 0.0f;
+		for (int r = 0; r < 3; ++r)
+			for (int c = 0; c < 4; ++c)
+				scale = std::max(scale, std::fabs(ref.m[r][c]));
+		mulErr = std::max(mulErr, MaxError(ref, affines3[i]) / std::max(scale, 1.0f));
+	}
+	report("XMMatrixMultiply", mulMs, mulMs, 0.0f);
+	report("AffineMultiply(rel)", affineMulMs, mulMs, mulErr);
+
+	// 3. 法线用的逆转置：A4中的做法是XMMatrixInverse(W)，写入常量缓冲区时两次转置抵消
+	double inverseMs = BestMilliseconds(repeats, [&]()
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			XMMATRIX W = XMMatrixTranspose(XMLoadFloat4x4(&matrices[i]));
+			XMStoreFloat4x4(&matrices2[i], XMMatrixInverse(nullptr, W));
+		}
+	});
+	double generalMs = BestMilliseconds(repeats, [&]()
+	{
+		for (uint32_t i = 0; i < count; ++i)
+			affines3[i] = AffineInverseTranspose(affines[i]);
+	});
+	auto linearError = [&](const AffineTransform& a, const XMFLOAT4X4& m)
+	{
+		float err = 0.0f;
+		for (int r = 0; r < 3; ++r)
+		{
+			err = std::max(err, std::fabs(m.m[r][0] - a.r[r].x));
+			err = std::max(err, std::fabs(m.m[r][1] - a.r[r].y));
+			err = std::max(err, std::fabs(m.m[r][2] - a.r[r].z));
+		}
+		return err;
+	};
+	float generalErr = 0.0f, batchInvErr = 0.0f;
+	for (uint32_t i = 0; i < count; ++i)
+		generalErr = std::max(generalErr, linearError(affines3[i], matrices2[i]));
+	double batchInvMs = BestMilliseconds(repeats, [&]() { AffineComposeSRTBatch(in, count, affines2.data(), affines3.data()); });
+	for (uint32_t i = 0; i < count; ++i)
+		batchInvErr = std::max(batchInvErr, linearError(affines3[i], matrices2[i]));
+	report("XMMatrixInverse", inverseMs, inverseMs, 0.0f);
+	report("AffineInverseTranspose", generalMs, inverseMs, generalErr);
+	report("Batch world+invT", batchInvMs, inverseMs + chainMs, batchInvErr);
+
+	// 均匀缩放时逆转置只需除以s^2
+	for (uint32_t i = 0; i < count; ++i)
+		affines[i] = AffineComposeSRT(XMFLOAT3(soa[0][i], soa[0][i], soa[0][i]), soa[3][i], soa[4][i], XMFLOAT3(soa[5][i], soa[6][i], soa[7][i]));
+	for (uint32_t i = 0; i < count; ++i)
+		XMStoreFloat4x4(&matrices2[i], XMMatrixInverse(nullptr, AffineToMatrix(affines[i])));
+	double uniformMs = BestMilliseconds(repeats, [&]()
+	{
+		for (uint32_t i = 0; i < count; ++i)
+			affines3[i] = AffineInverseTransposeUniform(affines[i]);
+	});
+	float uniformErr = 0.0f;
+	for (uint32_t i = 0; i < count; ++i)
+		uniformErr = std::max(uniformErr, linearError(affines3[i], matrices2[i]));
+	report("AffineInvTransposeUniform", uniformMs, inverseMs, uniformErr);
+	os << "\n";
+}
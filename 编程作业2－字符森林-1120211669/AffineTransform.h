@@ -0,0 +1,170 @@
+#ifndef AFFINETRANSFORM_H
+#define AFFINETRANSFORM_H
+
+#include <cstdint>
+#include <ostream>
+#include "PortableMath.h"
+
+// 3x4仿射变换。存放的是行向量约定下4x4矩阵转置后的前三行：
+// r[i]的xyz为线性部分的第i列，w为平移的第i个分量，变换后的点为(dot(r[0], p), dot(r[1], p), dot(r[2], p))，p.w = 1。
+// 与常量缓冲区和实例缓冲区中转置后的矩阵布局相同，上传时不需要再转置
+struct AffineTransform
+{
+	DirectX::XMFLOAT4 r[3];
+};
+
+// 一批按分量分开存放(SoA)的SRT参数，各数组长度至少为count
+// world = Scaling(scale) * Translation(offset) * RotationX(rotX) * RotationY(rotY) * Translation(pos)
+// offset在旋转之前平移，用于绕父节点旋转的物体；offset和pos的数组可以为空，视为0
+struct SRTArrays
+{
+	const float* scaleX;
+	const float* scaleY;
+	const float* scaleZ;
+	const float* offsetX;
+	const float* offsetY;
+	const float* offsetZ;
+	const float* rotX;
+	const float* rotY;
+	const float* posX;
+	const float* posY;
+	const float* posZ;
+};
+
+inline AffineTransform AffineIdentity()
+{
+	AffineTransform a;
+	a.r[0] = DirectX::XMFLOAT4(1.0f, 0.0f, 0.0f, 0.0f);
+	a.r[1] = DirectX::XMFLOAT4(0.0f, 1.0f, 0.0f, 0.0f);
+	a.r[2] = DirectX::XMFLOAT4(0.0f, 0.0f, 1.0f, 0.0f);
+	return a;
+}
+
+// 由未转置的矩阵得到仿射变换，M的最后一列应为(0, 0, 0, 1)
+inline AffineTransform XM_CALLCONV AffineFromMatrix(DirectX::FXMMATRIX M)
+{
+	DirectX::XMMATRIX T = DirectX::XMMatrixTranspose(M);
+	AffineTransform a;
+	for (int i = 0; i < 3; ++i)
+		DirectX::XMStoreFloat4(&a.r[i], T.r[i]);
+	return a;
+}
+
+// 转置后的4x4矩阵，可以直接写入常量缓冲区
+inline DirectX::XMMATRIX XM_CALLCONV AffineToMatrixTransposed(const AffineTransform& a)
+{
+	return DirectX::XMMATRIX(DirectX::XMLoadFloat4(&a.r[0]), DirectX::XMLoadFloat4(&a.r[1]),
+		DirectX::XMLoadFloat4(&a.r[2]), DirectX::g_XMIdentityR3);
+}
+
+// 未转置的4x4矩阵
+inline DirectX::XMMATRIX XM_CALLCONV AffineToMatrix(const AffineTransform& a)
+{
+	return DirectX::XMMatrixTranspose(AffineToMatrixTransposed(a));
+}
+
+// 以转置后的形式写入4x4矩阵，与InstanceData::world的约定一致
+inline void AffineStoreTransposed(DirectX::XMFLOAT4X4* pDest, const AffineTransform& a)
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		pDest->m[i][0] = a.r[i].x;
+		pDest->m[i][1] = a.r[i].y;
+		pDest->m[i][2] = a.r[i].z;
+		pDest->m[i][3] = a.r[i].w;
+	}
+	pDest->m[3][0] = 0.0f;
+	pDest->m[3][1] = 0.0f;
+	pDest->m[3][2] = 0.0f;
+	pDest->m[3][3] = 1.0f;
+}
+
+// 直接写出Scaling(scale) * Translation(offset) * RotationX(rotX) * RotationY(rotY) * Translation(pos)，不做矩阵乘法
+inline AffineTransform AffineComposeSRT(const DirectX::XMFLOAT3& scale, float rotX, float rotY, const DirectX::XMFLOAT3& pos,
+	const DirectX::XMFLOAT3& offset = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f))
+{
+	float sinX, cosX, sinY, cosY;
+	DirectX::XMScalarSinCos(&sinX, &cosX, rotX);
+	DirectX::XMScalarSinCos(&sinY, &cosY, rotY);
+	// RotationX * RotationY的三行为(cy, 0, -sy)、(sx*sy, cx, sx*cy)、(cx*sy, -sx, cx*cy)，缩放作用于各行
+	float sxsy = sinX * sinY, sxcy = sinX * cosY, cxsy = cosX * sinY, cxcy = cosX * cosY;
+	AffineTransform a;
+	a.r[0] = DirectX::XMFLOAT4(scale.x * cosY, scale.y * sxsy, scale.z * cxsy,
+		pos.x + offset.x * cosY + offset.y * sxsy + offset.z * cxsy);
+	a.r[1] = DirectX::XMFLOAT4(0.0f, scale.y * cosX, -scale.z * sinX,
+		pos.y + offset.y * cosX - offset.z * sinX);
+	a.r[2] = DirectX::XMFLOAT4(-scale.x * sinY, scale.y * sxcy, scale.z * cxcy,
+		pos.z - offset.x * sinY + offset.y * sxcy + offset.z * cxcy);
+	return a;
+}
+
+// 先变换a再变换b，与XMMatrixMultiply(A, B)相同。转置后为B^T * A^T，只需27次乘法
+inline AffineTransform AffineMultiply(const AffineTransform& a, const AffineTransform& b)
+{
+	using namespace DirectX;
+	XMVECTOR a0 = XMLoadFloat4(&a.r[0]);
+	XMVECTOR a1 = XMLoadFloat4(&a.r[1]);
+	XMVECTOR a2 = XMLoadFloat4(&a.r[2]);
+	AffineTransform c;
+	for (int i = 0; i < 3; ++i)
+	{
+		XMVECTOR bi = XMLoadFloat4(&b.r[i]);
+		// b的平移只加到w分量上
+		XMVECTOR ci = XMVectorAndInt(bi, g_XMMaskW);
+		ci = XMVectorMultiplyAdd(XMVectorSplatX(bi), a0, ci);
+		ci = XMVectorMultiplyAdd(XMVectorSplatY(bi), a1, ci);
+		ci = XMVectorMultiplyAdd(XMVectorSplatZ(bi), a2, ci);
+		XMStoreFloat4(&c.r[i], ci);
+	}
+	return c;
+}
+
+inline DirectX::XMVECTOR XM_CALLCONV AffineTransformPoint(const AffineTransform& a, DirectX::FXMVECTOR p)
+{
+	using namespace DirectX;
+	XMVECTOR p1 = XMVectorSetW(p, 1.0f);
+	return XMVectorSet(
+		XMVectorGetX(XMVector4Dot(XMLoadFloat4(&a.r[0]), p1)),
+		XMVectorGetX(XMVector4Dot(XMLoadFloat4(&a.r[1]), p1)),
+		XMVectorGetX(XMVector4Dot(XMLoadFloat4(&a.r[2]), p1)),
+		1.0f);
+}
+
+// 线性部分为旋转乘均匀缩放s时，逆转置矩阵为线性部分除以s^2，平移为0。结果按同样的约定存放，用于变换法线
+inline AffineTransform AffineInverseTransposeUniform(const AffineTransform& a)
+{
+	float scaleSq = a.r[0].x * a.r[0].x + a.r[0].y * a.r[0].y + a.r[0].z * a.r[0].z;
+	float inv = 1.0f / scaleSq;
+	AffineTransform n;
+	for (int i = 0; i < 3; ++i)
+		n.r[i] = DirectX::XMFLOAT4(a.r[i].x * inv, a.r[i].y * inv, a.r[i].z * inv, 0.0f);
+	return n;
+}
+
+// 任意可逆线性部分(包括非均匀缩放)的逆转置矩阵：按存放的约定即为各行两两叉积(余子式矩阵)除以行列式，平移为0
+inline AffineTransform AffineInverseTranspose(const AffineTransform& a)
+{
+	using namespace DirectX;
+	XMVECTOR a0 = XMLoadFloat4(&a.r[0]);
+	XMVECTOR a1 = XMLoadFloat4(&a.r[1]);
+	XMVECTOR a2 = XMLoadFloat4(&a.r[2]);
+	XMVECTOR c0 = XMVector3Cross(a1, a2);
+	XMVECTOR c1 = XMVector3Cross(a2, a0);
+	XMVECTOR c2 = XMVector3Cross(a0, a1);
+	XMVECTOR invDet = XMVectorReciprocal(XMVector3Dot(a0, c0));
+	AffineTransform n;
+	XMStoreFloat4(&n.r[0], XMVectorAndInt(XMVectorMultiply(c0, invDet), g_XMMask3));
+	XMStoreFloat4(&n.r[1], XMVectorAndInt(XMVectorMultiply(c1, invDet), g_XMMask3));
+	XMStoreFloat4(&n.r[2], XMVectorAndInt(XMVectorMultiply(c2, invDet), g_XMMask3));
+	return n;
+}
+
+// 批量生成count个SRT变换，AVX下一次8个，否则一次4个
+// [Out]pWorld			世界变换
+// [Out]pInvTranspose	用于法线的逆转置变换，为空则不生成。由SRT参数直接写出，不需要求逆
+void AffineComposeSRTBatch(const SRTArrays& in, uint32_t count, AffineTransform* pWorld, AffineTransform* pInvTranspose = nullptr);
+
+// 与DirectXMath的矩阵链对比各个函数的耗时和误差，结果写入os
+void BenchmarkAffineTransforms(std::ostream& os, uint32_t count);
+
+#endif
@@ -0,0 +1,69 @@
+#include "CBufferRing.h"
+#include <cassert>
+
+CBufferRing::CBufferRing(uint32_t capacity)
+	: m_pMapped(nullptr), m_Capacity(0), m_Head(0)
+{
+	SetCapacity(capacity);
+}
+
+void CBufferRing::SetCapacity(uint32_t capacity)
+{
+	m_Capacity = capacity / kAlignment * kAlignment;
+	m_Head = 0;
+}
+
+uint32_t CBufferRing::GetCapacity() const
+{
+	return m_Capacity;
+}
+
+void CBufferRing::Begin(void* pMapped)
+{
+	assert(pMapped);
+	m_pMapped = static_cast<uint8_t*>(pMapped);
+	m_Head = 0;
+}
+
+uint32_t CBufferRing::End()
+{
+	m_pMapped = nullptr;
+	return m_Head;
+}
+
+void* CBufferRing::Allocate(uint32_t size, uint32_t& offset)
+{
+	assert(m_pMapped);
+	uint32_t alignedSize = AlignSize(size);
+	if (alignedSize > m_Capacity - m_Head)
+		return nullptr;
+	offset = m_Head;
+	m_Head += alignedSize;
+	return m_pMapped + offset;
+}
+
+uint32_t CBufferRing::GetRemainingSlots(uint32_t size) const
+{
+	return (m_Capacity - m_Head) / AlignSize(size);
+}
+
+uint32_t CBufferRing::GetUsedBytes() const
+{
+	return m_Head;
+}
+
+uint32_t CBufferRing::ToFirstConstant(uint32_t offset)
+{
+	return offset / kConstantSize;
+}
+
+uint32_t CBufferRing::ToNumConstants(uint32_t size)
+{
+	// NumConstants也必须是16的倍数
+	return AlignSize(size) / kConstantSize;
+}
+
+uint32_t CBufferRing::AlignSize(uint32_t size)
+{
+	return (size + kAlignment - 1) & ~(kAlignment - 1);
+}
@@ -0,0 +1,60 @@
+#ifndef CBUFFERRINGDRAW_H
+#define CBUFFERRINGDRAW_H
+
+#ifdef _WIN32
+#include <d3d11_1.h>
+#else
+#include "PlatformTypes.h"
+#endif
+#include <cstdint>
+#include <vector>
+#include "CBufferRing.h"
+#include "ConstantBuffers.h"
+
+// 用环形缓冲区逐个绘制count个物体，每个物体一份类型为T的常量，绑定到常量缓冲区槽slot。
+// fill(k, cb)填写第k个物体的常量。一次Map写入尽可能多的物体，环形缓冲区写满后先绘制这一批再重新Map，
+// 每次绘制前用VSSetConstantBuffers1按偏移绑定。offsets为调用方持有的临时数组，避免每帧分配。
+// 上下文为模板参数，只要求提供与ID3D11DeviceContext1签名相同的Map/Unmap/VSSetConstantBuffers1/DrawIndexed，
+// 因此可以在Linux上用记录调用的替身上下文测试。返回后槽slot仍绑定着环形缓冲区，由调用方恢复
+template<class T, class Context, class Buffer, class Fill>
+HRESULT DrawWithCBufferRing(Context* pContext, Buffer* pRingBuffer, CBufferRing& ring, std::vector<uint32_t>& offsets,
+	UINT slot, uint32_t count, Fill fill, UINT indexCount, UINT startIndex, INT baseVertex)
+{
+	UINT numConstants = CBufferRing::ToNumConstants(sizeof(T));
+	uint32_t k = 0;
+	while (k < count)
+	{
+		D3D11_MAPPED_SUBRESOURCE mappedData;
+		HRESULT hr = pContext->Map(pRingBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
+		if (FAILED(hr))
+			return hr;
+		ring.Begin(mappedData.pData);
+		offsets.clear();
+		uint32_t batchBegin = k;
+		T cb;
+		uint32_t ringOffset;
+		for (; k < count; ++k)
+		{
+			fill(k, cb);
+			if (!ring.Push(cb, ringOffset))
+				break;
+			offsets.push_back(ringOffset);
+		}
+		ring.End();
+		pContext->Unmap(pRingBuffer, 0);
+		// 容量连一个物体都放不下
+		if (k == batchBegin)
+			return E_OUTOFMEMORY;
+		CBufferStats::Record((uint32_t)((k - batchBegin) * sizeof(T)));
+
+		for (uint32_t slotOffset : offsets)
+		{
+			UINT firstConstant = CBufferRing::ToFirstConstant(slotOffset);
+			pContext->VSSetConstantBuffers1(slot, 1, &pRingBuffer, &firstConstant, &numConstants);
+			pContext->DrawIndexed(indexCount, startIndex, baseVertex);
+		}
+	}
+	return S_OK;
+}
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef COUNTERRNG_H
+#define COUNTERRNG_H
+
+#include <cstdint>
+
+// 无状态的计数器随机数发生器(Philox4x32-10)。
+// 结果只取决于种子和计数器(id, stream, index)，与调用顺序和线程数无关，不修改任何全局状态。
+// 64位种子的低、高32位即Philox的两个密钥字，轮函数与Random123相同，可以用其已知答案向量检查。
+// 只用到32位乘法和异或，4路数据可以直接用SSE2的_mm_mul_epu32并行计算
+class CounterRng
+{
+public:
+	explicit CounterRng(uint64_t seed = 0) : m_Seed(seed) {}
+
+	uint64_t GetSeed() const { return m_Seed; }
+
+	// Philox4x32-10本身：计数器ctr、密钥(k0, k1)
+	static void Philox4x32(const uint32_t ctr[4], uint32_t k0, uint32_t k1, uint32_t out[4])
+	{
+		uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+		for (int round = 0; round < 10; ++round)
+		{
+			uint64_t p0 = (uint64_t)0xD2511F53u * c0;
+			uint64_t p1 = (uint64_t)0xCD9E8D57u * c2;
+			uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+			uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+			c1 = (uint32_t)p1;
+			c3 = (uint32_t)p0;
+			c0 = n0;
+			c2 = n2;
+			k0 += 0x9E3779B9u;
+			k1 += 0xBB67AE85u;
+		}
+		out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+	}
+
+	// 以(id, stream, index)为计数器生成4个32位随机数
+	// [In]id		对象编号，如第几棵树、第几个顶点
+	// [In]stream	用途编号，同一对象的不同用途互不相关
+	// [In]index	同一用途内的序号
+	void Generate4(uint32_t id, uint32_t stream, uint32_t index, uint32_t out[4]) const
+	{
+		const uint32_t ctr[4] = { id, stream, index, 0 };
+		Philox4x32(ctr, (uint32_t)m_Seed, (uint32_t)(m_Seed >> 32), out);
+	}
+
+	// 32位随机整数
+	uint32_t UInt(uint32_t id, uint32_t stream, uint32_t index = 0) const
+	{
+		uint32_t out[4];
+		Generate4(id, stream, index, out);
+		return out[0];
+	}
+
+	// [0, 1)内的随机浮点数
+	float Float(uint32_t id, uint32_t stream, uint32_t index = 0) const
+	{
+		return ToFloat(UInt(id, stream, index));
+	}
+
+	// [lo, hi)内的随机整数
+	int Range(uint32_t id, uint32_t stream, uint32_t index, int lo, int hi) const
+	{
+		return lo + (int)(((uint64_t)UInt(id, stream, index) * (uint32_t)(hi - lo)) >> 32);
+	}
+
+	// 将32位随机整数映射到[0, 1)
+	static float ToFloat(uint32_t x)
+	{
+		return (x >> 8) * (1.0f / 16777216.0f);
+	}
+
+private:
+	uint64_t m_Seed;
+};
+
+#endif
@@ -0,0 +1,308 @@
+#include "ForestLOD.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// 立方体8个顶点相对最小角点的偏移(以边长为单位)，与NameVertices中的顺序一致
+	const int s_CornerOffset[8][3] = {
+		{ 0, 0, 0 }, { 0, 1, 0 }, { 1, 1, 0 }, { 1, 0, 0 },
+		{ 0, 0, 1 }, { 0, 1, 1 }, { 1, 1, 1 }, { 1, 0, 1 }
+	};
+
+	// 6个面的朝向及其两个三角形的顶点，绕序与NameVertices相同
+	struct CubeFace
+	{
+		int normal[3];
+		uint16_t corners[6];
+	};
+	const CubeFace s_CubeFaces[6] = {
+		{ {  0,  0, -1 }, { 0, 1, 2, 2, 3, 0 } },	// 前
+		{ { -1,  0,  0 }, { 4, 5, 1, 1, 0, 4 } },	// 左
+		{ {  0,  1,  0 }, { 1, 5, 6, 6, 2, 1 } },	// 上
+		{ {  0,  0,  1 }, { 7, 6, 5, 5, 4, 7 } },	// 后
+		{ {  1,  0,  0 }, { 3, 2, 6, 6, 7, 3 } },	// 右
+		{ {  0, -1,  0 }, { 4, 0, 3, 3, 7, 4 } }	// 下
+	};
+
+	// 合并后的一个大格子
+	struct CoarseCell
+	{
+		bool occupied;
+		XMFLOAT4 color[8];		// 每个角点的颜色
+		float bestDist[8];		// 取得该颜色的原顶点到角点的距离平方
+	};
+}
+
+bool BuildCubeLodMesh(const XMFLOAT3* pPositions, const XMFLOAT4* pColors, uint32_t stride,
+	uint32_t vertexCount, float cellSize, uint32_t factor, LodMesh& mesh)
+{
+	mesh.vertices.clear();
+	mesh.indices.clear();
+	if (factor == 0 || vertexCount < 8)
+		return false;
+
+	const char* pPosBytes = reinterpret_cast<const char*>(pPositions);
+	const char* pColorBytes = reinterpret_cast<const char*>(pColors);
+	auto position = [&](uint32_t i) { return *reinterpret_cast<const XMFLOAT3*>(pPosBytes + (size_t)i * stride); };
+	auto color = [&](uint32_t i) { return *reinterpret_cast<const XMFLOAT4*>(pColorBytes + (size_t)i * stride); };
+
+	// 与VoxelGrid相同，以所有立方体的最小角点作为网格原点
+	XMFLOAT3 origin(FLT_MAX, FLT_MAX, FLT_MAX);
+	for (uint32_t i = 0; i < vertexCount; ++i)
+	{
+		XMFLOAT3 p = position(i);
+		origin.x = std::min(origin.x, p.x);
+		origin.y = std::min(origin.y, p.y);
+		origin.z = std::min(origin.z, p.z);
+	}
+
+	uint32_t cubeCount = vertexCount / 8;
+	std::vector<XMINT3> cells(cubeCount);
+	int dim[3] = { 0, 0, 0 };
+	for (uint32_t c = 0; c < cubeCount; ++c)
+	{
+		XMFLOAT3 minCorner = position(c * 8);
+		for (uint32_t j = 1; j < 8; ++j)
+		{
+			XMFLOAT3 p = position(c * 8 + j);
+			minCorner.x = std::min(minCorner.x, p.x);
+			minCorner.y = std::min(minCorner.y, p.y);
+			minCorner.z = std::min(minCorner.z, p.z);
+		}
+		cells[c] = XMINT3(
+			(int)std::floor((minCorner.x - origin.x) / cellSize + 0.5f) / (int)factor,
+			(int)std::floor((minCorner.y - origin.y) / cellSize + 0.5f) / (int)factor,
+			(int)std::floor((minCorner.z - origin.z) / cellSize + 0.5f) / (int)factor);
+		dim[0] = std::max(dim[0], cells[c].x + 1);
+		dim[1] = std::max(dim[1], cells[c].y + 1);
+		dim[2] = std::max(dim[2], cells[c].z + 1);
+	}
+
+	// 原立方体的每个顶点把颜色交给所在大格子的同一角点，距离角点最近的胜出
+	float coarseSize = cellSize * factor;
+	std::vector<CoarseCell> grid((size_t)dim[0] * dim[1] * dim[2]);
+	for (CoarseCell& cell : grid)
+	{
+		cell.occupied = false;
+		std::fill(cell.bestDist, cell.bestDist + 8, FLT_MAX);
+	}
+	auto cellIndex = [&](int x, int y, int z) { return ((size_t)z * dim[1] + y) * dim[0] + x; };
+	for (uint32_t c = 0; c < cubeCount; ++c)
+	{
+		CoarseCell& cell = grid[cellIndex(cells[c].x, cells[c].y, cells[c].z)];
+		cell.occupied = true;
+		for (uint32_t j = 0; j < 8; ++j)
+		{
+			XMFLOAT3 p = position(c * 8 + j);
+			float cx = origin.x + (cells[c].x + s_CornerOffset[j][0]) * coarseSize;
+			float cy = origin.y + (cells[c].y + s_CornerOffset[j][1]) * coarseSize;
+			float cz = origin.z + (cells[c].z + s_CornerOffset[j][2]) * coarseSize;
+			float dist = (p.x - cx) * (p.x - cx) + (p.y - cy) * (p.y - cy) + (p.z - cz) * (p.z - cz);
+			if (dist < cell.bestDist[j])
+			{
+				cell.bestDist[j] = dist;
+				cell.color[j] = color(c * 8 + j);
+			}
+		}
+	}
+
+	auto isOccupied = [&](int x, int y, int z)
+	{
+		if (x < 0 || y < 0 || z < 0 || x >= dim[0] || y >= dim[1] || z >= dim[2])
+			return false;
+		return grid[cellIndex(x, y, z)].occupied;
+	};
+
+	// 只生成至少有一个面可见的大立方体，看不见的面不生成索引
+	for (int z = 0; z < dim[2]; ++z)
+	{
+		for (int y = 0; y < dim[1]; ++y)
+		{
+			for (int x = 0; x < dim[0]; ++x)
+			{
+				const CoarseCell& cell = grid[cellIndex(x, y, z)];
+				if (!cell.occupied)
+					continue;
+
+				size_t firstIndex = mesh.indices.size();
+				uint32_t base = (uint32_t)mesh.vertices.size();
+				for (const CubeFace& face : s_CubeFaces)
+				{
+					if (isOccupied(x + face.normal[0], y + face.normal[1], z + face.normal[2]))
+						continue;
+					for (uint16_t corner : face.corners)
+						mesh.indices.push_back((uint16_t)(base + corner));
+				}
+				if (mesh.indices.size() == firstIndex)
+					continue;
+				if (base + 8 > 0x10000)
+				{
+					mesh.vertices.clear();
+					mesh.indices.clear();
+					return false;
+				}
+
+				for (uint32_t j = 0; j < 8; ++j)
+				{
+					LodVertex v;
+					v.pos = XMFLOAT3(
+						origin.x + (x + s_CornerOffset[j][0]) * coarseSize,
+						origin.y + (y + s_CornerOffset[j][1]) * coarseSize,
+						origin.z + (z + s_CornerOffset[j][2]) * coarseSize);
+					v.color = cell.color[j];
+					mesh.vertices.push_back(v);
+				}
+			}
+		}
+	}
+	return true;
+}
+
+const uint8_t ForestLOD::kUnassigned;
+const uint8_t ForestLOD::kDropped;
+
+ForestLOD::ForestLOD()
+	: m_Hysteresis(0.0f),
+	m_ChildCullPixels(0.0f),
+	m_DroppedCount(0),
+	m_SwitchCount(0),
+	m_TrianglesDrawn(0),
+	m_TrianglesFull(0)
+{
+	SetLevels({ { 0, 0.0f } });
+}
+
+void ForestLOD::SetLevels(const std::vector<Level>& levels)
+{
+	assert(!levels.empty() && levels.size() < kDropped);
+	m_Levels = levels;
+	m_Groups.assign(levels.size(), std::vector<uint32_t>());
+	// 级别的含义变了，之前记住的级别作废
+	std::fill(m_Current.begin(), m_Current.end(), kUnassigned);
+}
+
+void ForestLOD::SetHysteresis(float ratio)
+{
+	m_Hysteresis = std::min(std::max(ratio, 0.0f), 0.9f);
+}
+
+void ForestLOD::SetChildCullPixels(float pixels)
+{
+	m_ChildCullPixels = pixels;
+}
+
+void ForestLOD::Reset(uint32_t instanceCount)
+{
+	m_Current.assign(instanceCount, kUnassigned);
+}
+
+float ForestLOD::ComputePixelScale(float fovY, float viewportHeight)
+{
+	// 距离为d处的视锥体高度为2 * d * tan(fovY / 2)，对应viewportHeight个像素
+	return viewportHeight / (2.0f * std::tan(fovY * 0.5f));
+}
+
+void ForestLOD::Select(const ForestInstances::BoundingSpheres& spheres, const uint32_t* pIndices, uint32_t count,
+	uint32_t treeCount, const XMFLOAT3& eye, float pixelScale)
+{
+	if (m_Current.size() != spheres.radius.size())
+		Reset((uint32_t)spheres.radius.size());
+	for (std::vector<uint32_t>& group : m_Groups)
+		group.clear();
+	m_DroppedCount = 0;
+	m_SwitchCount = 0;
+	m_TrianglesDrawn = 0;
+	m_TrianglesFull = 0;
+
+	const uint8_t levelCount = (uint8_t)m_Levels.size();
+	const float coarser = 1.0f - m_Hysteresis;
+	const float finer = 1.0f + m_Hysteresis;
+	for (uint32_t k = 0; k < count; ++k)
+	{
+		uint32_t i = pIndices ? pIndices[k] : k;
+		float dx = spheres.centerX[i] - eye.x;
+		float dy = spheres.centerY[i] - eye.y;
+		float dz = spheres.centerZ[i] - eye.z;
+		float dist = std::sqrt(dx * dx + dy * dy + dz * dz);
+		float radius = spheres.radius[i];
+		// 视点在包围球内时视为无穷大
+		float pixels = dist > radius ? 2.0f * radius * pixelScale / dist : FLT_MAX;
+
+		uint8_t prev = m_Current[i];
+		uint8_t cur = prev;
+		m_TrianglesFull += m_Levels[0].triangleCount;
+
+		if (i >= treeCount && m_ChildCullPixels > 0.0f)
+		{
+			float limit = m_ChildCullPixels * (prev == kDropped ? finer : coarser);
+			if (pixels < limit)
+			{
+				if (prev != kDropped && prev != kUnassigned)
+					++m_SwitchCount;
+				m_Current[i] = kDropped;
+				++m_DroppedCount;
+				continue;
+			}
+		}
+		if (cur == kDropped || cur >= levelCount)
+		{
+			// 第一次出现或刚恢复绘制，直接按阈值选择
+			cur = 0;
+			while (cur + 1 < levelCount && pixels < m_Levels[cur].minPixels)
+				++cur;
+		}
+		else
+		{
+			while (cur + 1 < levelCount && pixels < m_Levels[cur].minPixels * coarser)
+				++cur;
+			while (cur > 0 && pixels >= m_Levels[cur - 1].minPixels * finer)
+				--cur;
+		}
+
+		if (prev != kUnassigned && prev != cur)
+			++m_SwitchCount;
+		m_Current[i] = cur;
+		m_Groups[cur].push_back(i);
+		m_TrianglesDrawn += m_Levels[cur].triangleCount;
+	}
+}
+
+uint32_t ForestLOD::GetLevelCount() const
+{
+	return (uint32_t)m_Levels.size();
+}
+
+const std::vector<uint32_t>& ForestLOD::GetGroup(uint32_t level) const
+{
+	return m_Groups[level];
+}
+
+uint32_t ForestLOD::GetDroppedCount() const
+{
+	return m_DroppedCount;
+}
+
+uint32_t ForestLOD::GetSwitchCount() const
+{
+	return m_SwitchCount;
+}
+
+uint64_t ForestLOD::GetTrianglesDrawn() const
+{
+	return m_TrianglesDrawn;
+}
+
+uint64_t ForestLOD::GetTrianglesFull() const
+{
+	return m_TrianglesFull;
+}
+
+uint64_t ForestLOD::GetTrianglesSaved() const
+{
+	return m_TrianglesFull - m_TrianglesDrawn;
+}
@@ -2,6 +2,8 @@
 #include "d3dUtil.h"
 #include "DXTrace.h"
 #include "NameVertices.h"
+#include <cfloat>
+#include <sstream>
 using namespace DirectX;
 
 const D3D11_INPUT_ELEMENT_DESC GameApp::VertexPosColor::inputLayout[2] = {
@@ -9,9 +11,21 @@ const D3D11_INPUT_ELEMENT_DESC GameApp::VertexPosColor::inputLayout[2] = {
 	{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 }
 };
 
+const D3D11_INPUT_ELEMENT_DESC GameApp::VertexPosColor::instancedLayout[6] = {
+	{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "World", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "World", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "World", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "World", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 }
+};
+
 GameApp::GameApp(HINSTANCE hInstance)
-	: D3DApp(hInstance), m_CBuffer(),
-	name(nullptr)// 初始化变量，置空、、、、、、、、、、、、、、、、、、、、、
+	: D3DApp(hInstance),
+	m_CBRingSupported(false),
+	name(nullptr),// 初始化变量，置空、、、、、、、、、、、、、、、、、、、、、
+	m_Forest(70),
+	m_UseInstancing(true)
 {
 }
 
@@ -37,6 +51,7 @@ bool GameApp::Init()
 void GameApp::OnResize()
 {
 	D3DApp::OnResize();
+	m_Camera.SetAspect(AspectRatio());
 }
 
 void GameApp::UpdateScene(float dt)
@@ -53,43 +68,95 @@ void GameApp::DrawScene()
 	m_pd3dImmediateContext->ClearRenderTargetView(m_pRenderTargetView.Get(), reinterpret_cast<const float*>(&black));
 	m_pd3dImmediateContext->ClearDepthStencilView(m_pDepthStencilView.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
 
-	int n = 70;
-	for (int i = 1; i <= n; i++)
+	// 摄像机固定不动，观察和投影矩阵只在窗口大小变化后重新上传
+	if (m_CBPerFrame.NeedsUpload(m_Camera.GetVersion()))
 	{
-		for (int j = 1; j <= n; j++)
-		{
-			float scale = (sinf(angle * 3.0f + i * j * 0.2f) + 1.3f) * 0.00015f * (rand() % 600 + 300);//对于每个点，随机生成其尺寸大小
-			DirectX::XMMATRIX mScale = XMMatrixScaling(scale, scale, scale);
-			DirectX::XMMATRIX mRotate = XMMatrixRotationX(angle) * XMMatrixRotationY(angle);
-			DirectX::XMMATRIX mTranslate = XMMatrixTranslation((i - 5.5f) * 4.5f, 0, (j - 5.5f) * 4.5f);
-			m_CBuffer.world = XMMatrixTranspose(mScale * mRotate * mTranslate); // mul(vec, mat) 中为行向量，矩阵右乘，顺序SRT, 参考https://www.cnblogs.com/X-Jun/p/9808727.html#_lab2_1_1
-			// 更新常量缓冲区，让立方体转起来
-			D3D11_MAPPED_SUBRESOURCE mappedData;
-			HR(m_pd3dImmediateContext->Map(m_pConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData));
-			memcpy_s(mappedData.pData, sizeof(m_CBuffer), &m_CBuffer, sizeof(m_CBuffer));
-			m_pd3dImmediateContext->Unmap(m_pConstantBuffer.Get(), 0);
-			m_pd3dImmediateContext->DrawIndexed(name->GetIndexCount(), 0, 0);// 通过对象获取索引个数、、、、、、、、、、、、、、、、、
-
-			srand(i * j + 1);
-			DirectX::XMMATRIX mScaleChild = XMMatrixScaling(0.2f, 0.2f, 0.2f);//Child的大小
-			DirectX::XMMATRIX mTranslateChild = XMMatrixTranslation(18.0f, 0, 0);
-			for (int k = 1; k <= 1 + rand() % 3; k++)
-			{
-				DirectX::XMMATRIX mRotateChild = XMMatrixRotationX(rand() + angle) * XMMatrixRotationY(rand() + angle) * XMMatrixRotationY(rand() + angle);
-				m_CBuffer.world = XMMatrixTranspose(mScaleChild * mTranslateChild * mScale * mRotateChild * mTranslate);
-
-				D3D11_MAPPED_SUBRESOURCE mappedData;
-				HR(m_pd3dImmediateContext->Map(m_pConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData));
-				memcpy_s(mappedData.pData, sizeof(m_CBuffer), &m_CBuffer, sizeof(m_CBuffer));
-				m_pd3dImmediateContext->Unmap(m_pConstantBuffer.Get(), 0);
-				m_pd3dImmediateContext->DrawIndexed(name->GetIndexCount(), 0, 0);// 通过对象获取索引个数、、、、、、、、、、、、、、、、、
-			}
-		}
+		m_CBPerFrame.data.view = XMMatrixTranspose(m_Camera.GetView());
+		m_CBPerFrame.data.proj = XMMatrixTranspose(m_Camera.GetProj());
+		HR(m_CBPerFrame.Upload(m_pd3dImmediateContext.Get(), m_Camera.GetVersion()));
+	}
+
+	// 生成这一帧所有实例的世界矩阵
+	m_Forest.Build(angle, &m_Jobs);
+	// 按投影到屏幕上的大小为每个实例选择LOD，同一级的实例一起提交
+	m_ForestLOD.Select(m_Forest.GetBoundingSpheres(), nullptr, m_Forest.GetInstanceCount(), m_Forest.GetTreeCount(),
+		m_Camera.GetPosition(), ForestLOD::ComputePixelScale(m_Camera.GetFovY(), (float)m_ClientHeight));
+	std::wostringstream outs;
+	outs << L"Rendering a Cube    LOD: ";
+	for (uint32_t level = 0; level < m_ForestLOD.GetLevelCount(); ++level)
+		outs << (level ? L"/" : L"") << m_ForestLOD.GetGroup(level).size();
+	outs << L" 丢弃: " << m_ForestLOD.GetDroppedCount()
+		<< L" 三角形: " << m_ForestLOD.GetTrianglesDrawn() << L"/" << m_ForestLOD.GetTrianglesFull();
+	m_MainWndCaption = outs.str();
+	if (m_UseInstancing)
+		DrawForestInstanced();
+	else
+	{
+		for (uint32_t level = 0; level < m_ForestLOD.GetLevelCount(); ++level)
+			DrawForestPerObject(m_ForestLOD.GetGroup(level), level);
 	}
 
 	HR(m_pSwapChain->Present(0, 0));
 }
 
+void GameApp::DrawForestInstanced()
+{
+	// 槽0为顶点数据，槽1为实例数据
+	ID3D11Buffer* buffers[2] = { m_pVertexBuffer.Get(), m_pInstancedBuffer.Get() };
+	UINT strides[2] = { sizeof(VertexPosColor), sizeof(ForestInstances::InstanceData) };
+	UINT offsets[2] = { 0, 0 };
+	m_pd3dImmediateContext->IASetVertexBuffers(0, 2, buffers, strides, offsets);
+	m_pd3dImmediateContext->IASetInputLayout(m_pInstancedLayout.Get());
+	m_pd3dImmediateContext->VSSetShader(m_pInstancedVertexShader.Get(), nullptr, 0);
+
+	// 观察和投影矩阵已在m_CBPerFrame中，只需把各级的实例依次写入实例缓冲区，每一级一次绘制
+	uint32_t levelCount = m_ForestLOD.GetLevelCount();
+	m_InstanceGroups.resize(levelCount);
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		const std::vector<uint32_t>& indices = m_ForestLOD.GetGroup(level);
+		const LodDraw& draw = m_LodDraws[level];
+		InstanceGroup group = { indices.data(), (uint32_t)indices.size(), draw.indexCount, draw.startIndex, draw.baseVertex };
+		m_InstanceGroups[level] = group;
+	}
+	HR(DrawInstanceGroups(m_pd3dImmediateContext.Get(), m_pInstancedBuffer.Get(), m_Forest.GetInstances().data(),
+		m_InstanceGroups.data(), levelCount));
+}
+
+void GameApp::DrawForestPerObject(const std::vector<uint32_t>& indices, uint32_t level)
+{
+	if (indices.empty())
+		return;
+
+	UINT stride = sizeof(VertexPosColor);
+	UINT offset = 0;
+	m_pd3dImmediateContext->IASetVertexBuffers(0, 1, m_pVertexBuffer.GetAddressOf(), &stride, &offset);
+	m_pd3dImmediateContext->IASetInputLayout(m_pVertexLayout.Get());
+	m_pd3dImmediateContext->VSSetShader(m_pVertexShader.Get(), nullptr, 0);
+
+	const std::vector<ForestInstances::InstanceData>& instances = m_Forest.GetInstances();
+	const LodDraw& draw = m_LodDraws[level];
+	uint32_t count = (uint32_t)indices.size();
+	if (!m_CBRingSupported)
+	{
+		for (uint32_t k = 0; k < count; ++k)
+		{
+			// 每次绘制只上传世界矩阵
+			m_CBPerObject.data.world = XMLoadFloat4x4(&instances[indices[k]].world);	// 实例数据中已经是转置后的矩阵
+			HR(m_CBPerObject.Upload(m_pd3dImmediateContext.Get()));
+			m_pd3dImmediateContext->DrawIndexed(draw.indexCount, draw.startIndex, draw.baseVertex);
+		}
+		return;
+	}
+
+	// 一次Map写入尽可能多的物体的常量，按偏移绑定后逐个绘制
+	HR(DrawWithCBufferRing<CBPerObject>(m_pd3dImmediateContext1.Get(), m_pCBRingBuffer.Get(), m_CBRing, m_CBRingOffsets, 0, count,
+		[&](uint32_t k, CBPerObject& cb) { cb.world = XMLoadFloat4x4(&instances[indices[k]].world); },
+		draw.indexCount, draw.startIndex, draw.baseVertex));
+
+	// 恢复b0为普通的逐物体常量缓冲区
+	m_pd3dImmediateContext->VSSetConstantBuffers(0, 1, m_CBPerObject.GetAddressOf());
+}
 
 bool GameApp::InitEffect()
 {
@@ -102,6 +169,12 @@ bool GameApp::InitEffect()
 	HR(m_pd3dDevice->CreateInputLayout(VertexPosColor::inputLayout, ARRAYSIZE(VertexPosColor::inputLayout),
 		blob->GetBufferPointer(), blob->GetBufferSize(), m_pVertexLayout.GetAddressOf()));
 
+	// 创建实例化顶点着色器及其顶点布局
+	HR(CreateShaderFromFile(L"HLSL\\Cube_Instance_VS.cso", L"HLSL\\Cube_Instance_VS.hlsl", "VS", "vs_5_0", blob.ReleaseAndGetAddressOf()));
+	HR(m_pd3dDevice->CreateVertexShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, m_pInstancedVertexShader.GetAddressOf()));
+	HR(m_pd3dDevice->CreateInputLayout(VertexPosColor::instancedLayout, ARRAYSIZE(VertexPosColor::instancedLayout),
+		blob->GetBufferPointer(), blob->GetBufferSize(), m_pInstancedLayout.GetAddressOf()));
+
 	// 创建像素着色器
 	HR(CreateShaderFromFile(L"HLSL\\Cube_PS.cso", L"HLSL\\Cube_PS.hlsl", "PS", "ps_5_0", blob.ReleaseAndGetAddressOf()));
 	HR(m_pd3dDevice->CreatePixelShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, m_pPixelShader.GetAddressOf()));
@@ -115,57 +188,120 @@ bool GameApp::InitResource()
 	name = new NameVertices(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 	// 设置三角形顶点
 	VertexPosColor* vertices = name->GetNameVertices(); // 通过对象获取顶点、、、、、、、、、、、、、、、、、、、、、
+	WORD* indices = name->GetNameIndices(); // 通过对象获取索引、、、、、、、、、、、、、、、、、、、、、
+
+	// ******************
+	// 生成各级LOD网格，与原网格依次存入同一个顶点/索引缓冲区。
+	// 第1级只去掉立方体之间看不见的面，之后每级把2x2x2个格子合并为一个
+	//
+	static_assert(sizeof(LodVertex) == sizeof(VertexPosColor), "LodVertex must match VertexPosColor");
+	std::vector<VertexPosColor> lodVertices(vertices, vertices + name->GetVerticesCount());
+	std::vector<WORD> lodIndices(indices, indices + name->GetIndexCount());
+	std::vector<ForestLOD::Level> lodLevels;
+	m_LodDraws.assign(1, { name->GetIndexCount(), 0, 0 });
+	lodLevels.push_back({ name->GetIndexCount() / 3, 200.0f });
+	const uint32_t lodFactors[3] = { 1, 2, 4 };
+	const float lodMinPixels[3] = { 80.0f, 30.0f, 0.0f };	// 投影直径(像素)不小于该值时使用这一级
+	for (int i = 0; i < 3; ++i)
+	{
+		LodMesh mesh;
+		if (!BuildCubeLodMesh(&vertices->pos, &vertices->color, sizeof(VertexPosColor), name->GetVerticesCount(), 1.0f, lodFactors[i], mesh))
+			break;
+		m_LodDraws.push_back({ (UINT)mesh.indices.size(), (UINT)lodIndices.size(), (INT)lodVertices.size() });
+		lodLevels.push_back({ mesh.GetTriangleCount(), lodMinPixels[i] });
+		for (const LodVertex& v : mesh.vertices)
+			lodVertices.push_back({ v.pos, v.color });
+		lodIndices.insert(lodIndices.end(), mesh.indices.begin(), mesh.indices.end());
+	}
+	lodLevels.back().minPixels = 0.0f;	// 最后一级总是可用
+	m_ForestLOD.SetLevels(lodLevels);
+	m_ForestLOD.SetHysteresis(0.15f);
+	m_ForestLOD.SetChildCullPixels(6.0f);
+
+	// 名字的包围球用于按投影大小选择LOD
+	XMVECTOR minPoint = XMVectorReplicate(FLT_MAX), maxPoint = XMVectorReplicate(-FLT_MAX);
+	for (UINT i = 0; i < name->GetVerticesCount(); ++i)
+	{
+		minPoint = XMVectorMin(minPoint, XMLoadFloat3(&vertices[i].pos));
+		maxPoint = XMVectorMax(maxPoint, XMLoadFloat3(&vertices[i].pos));
+	}
+	XMFLOAT3 localCenter;
+	XMStoreFloat3(&localCenter, (minPoint + maxPoint) * 0.5f);
+	m_Forest.SetLocalBounds(localCenter, XMVectorGetX(XMVector3Length(maxPoint - minPoint)) * 0.5f);
+
 	// 设置顶点缓冲区描述
 	D3D11_BUFFER_DESC vbd;
 	ZeroMemory(&vbd, sizeof(vbd));
 	vbd.Usage = D3D11_USAGE_IMMUTABLE;
-	vbd.ByteWidth = (sizeof * vertices) * name->GetVerticesCount(); // 计算位宽、、、、、、、、、、、、、、、、、、、、、、、、、
+	vbd.ByteWidth = (UINT)(sizeof(VertexPosColor) * lodVertices.size()); // 计算位宽、、、、、、、、、、、、、、、、、、、、、、、、、
 	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 	vbd.CPUAccessFlags = 0;
 	// 新建顶点缓冲区
 	D3D11_SUBRESOURCE_DATA InitData;
 	ZeroMemory(&InitData, sizeof(InitData));
-	InitData.pSysMem = vertices;
+	InitData.pSysMem = lodVertices.data();
 	HR(m_pd3dDevice->CreateBuffer(&vbd, &InitData, m_pVertexBuffer.GetAddressOf()));
 
+	// ******************
+	// 设置实例缓冲区描述，实例数在ForestInstances构造时已确定，每帧整体更新
+	//
+	D3D11_BUFFER_DESC instbd;
+	ZeroMemory(&instbd, sizeof(instbd));
+	instbd.Usage = D3D11_USAGE_DYNAMIC;
+	instbd.ByteWidth = sizeof(ForestInstances::InstanceData) * m_Forest.GetInstanceCount();
+	instbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	instbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	// 新建实例缓冲区，不使用初始数据
+	HR(m_pd3dDevice->CreateBuffer(&instbd, nullptr, m_pInstancedBuffer.GetAddressOf()));
+
 	// ******************
 	// 索引数组
 	//
-	WORD* indices = name->GetNameIndices(); // 通过对象获取索引、、、、、、、、、、、、、、、、、、、、、
 	// 设置索引缓冲区描述
 	D3D11_BUFFER_DESC ibd;
 	ZeroMemory(&ibd, sizeof(ibd));
 	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = (sizeof * indices) * name->GetIndexCount(); // 计算位宽、、、、、、、、、、、、、、、、、、、、、、、、、
+	ibd.ByteWidth = (UINT)(sizeof(WORD) * lodIndices.size()); // 计算位宽、、、、、、、、、、、、、、、、、、、、、、、、、
 	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
 	ibd.CPUAccessFlags = 0;
 	// 新建索引缓冲区
-	InitData.pSysMem = indices;
+	InitData.pSysMem = lodIndices.data();
 	HR(m_pd3dDevice->CreateBuffer(&ibd, &InitData, m_pIndexBuffer.GetAddressOf()));
 	// 输入装配阶段的索引缓冲区设置
 	m_pd3dImmediateContext->IASetIndexBuffer(m_pIndexBuffer.Get(), DXGI_FORMAT_R16_UINT, 0);
 
 
 	// ******************
-	// 设置常量缓冲区描述
-	//
-	D3D11_BUFFER_DESC cbd;
-	ZeroMemory(&cbd, sizeof(cbd));
-	cbd.Usage = D3D11_USAGE_DYNAMIC;
-	cbd.ByteWidth = sizeof(ConstantBuffer);
-	cbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	cbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 	// 新建常量缓冲区，不使用初始数据
-	HR(m_pd3dDevice->CreateBuffer(&cbd, nullptr, m_pConstantBuffer.GetAddressOf()));
+	//
+	HR(m_CBPerObject.Create(m_pd3dDevice.Get()));
+	HR(m_CBPerFrame.Create(m_pd3dDevice.Get()));
 
 	// 初始化常量缓冲区的值
-	m_CBuffer.world = XMMatrixIdentity();	// 单位矩阵的转置是它本身
-	m_CBuffer.view = XMMatrixTranspose(XMMatrixLookAtLH(
-		XMVectorSet(-30.0f, 30.0f, -25.0f, 0.0f),
-		XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f),
-		XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)
-	));
-	m_CBuffer.proj = XMMatrixTranspose(XMMatrixPerspectiveFovLH(XM_PIDIV2, AspectRatio(), 1.0f, 1000.0f));
+	m_CBPerObject.data.world = XMMatrixIdentity();	// 单位矩阵的转置是它本身
+	HR(m_CBPerObject.Upload(m_pd3dImmediateContext.Get()));
+	// 观察和投影矩阵在第一次绘制时由摄像机写入
+	m_Camera.SetLens(XM_PIDIV2, AspectRatio(), 1.0f, 1000.0f);
+	m_Camera.LookAt(XMFLOAT3(-30.0f, 30.0f, -25.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f));
+
+	// 常量缓冲区偏移绑定需要D3D11.1，且驱动支持ConstantBufferOffsetting
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	m_CBRingSupported = m_pd3dImmediateContext1 != nullptr &&
+		SUCCEEDED(m_pd3dDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) &&
+		options.ConstantBufferOffsetting;
+	if (m_CBRingSupported)
+	{
+		// 每个物体占256字节，一次Map最多容纳4096个物体
+		m_CBRing.SetCapacity(4096 * CBufferRing::kAlignment);
+		D3D11_BUFFER_DESC cbd;
+		ZeroMemory(&cbd, sizeof(cbd));
+		cbd.Usage = D3D11_USAGE_DYNAMIC;
+		cbd.ByteWidth = m_CBRing.GetCapacity();
+		cbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		cbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		HR(m_pd3dDevice->CreateBuffer(&cbd, nullptr, m_pCBRingBuffer.GetAddressOf()));
+		m_CBRingOffsets.reserve(4096);
+	}
 
 
 	// ******************
@@ -182,8 +318,9 @@ bool GameApp::InitResource()
 	m_pd3dImmediateContext->IASetInputLayout(m_pVertexLayout.Get());
 	// 将着色器绑定到渲染管线
 	m_pd3dImmediateContext->VSSetShader(m_pVertexShader.Get(), nullptr, 0);
-	// 将更新好的常量缓冲区绑定到顶点着色器
-	m_pd3dImmediateContext->VSSetConstantBuffers(0, 1, m_pConstantBuffer.GetAddressOf());
+	// 将常量缓冲区绑定到顶点着色器，b0为每个物体的，b1为每帧的
+	m_pd3dImmediateContext->VSSetConstantBuffers(0, 1, m_CBPerObject.GetAddressOf());
+	m_pd3dImmediateContext->VSSetConstantBuffers(1, 1, m_CBPerFrame.GetAddressOf());
 
 	m_pd3dImmediateContext->PSSetShader(m_pPixelShader.Get(), nullptr, 0);
 
@@ -193,8 +330,14 @@ bool GameApp::InitResource()
 	D3D11SetDebugObjectName(m_pVertexLayout.Get(), "VertexPosColorLayout");
 	D3D11SetDebugObjectName(m_pVertexBuffer.Get(), "VertexBuffer");
 	D3D11SetDebugObjectName(m_pIndexBuffer.Get(), "IndexBuffer");
-	D3D11SetDebugObjectName(m_pConstantBuffer.Get(), "ConstantBuffer");
+	D3D11SetDebugObjectName(m_CBPerObject.Get(), "CBPerObject");
+	D3D11SetDebugObjectName(m_CBPerFrame.Get(), "CBPerFrame");
+	if (m_pCBRingBuffer)
+		D3D11SetDebugObjectName(m_pCBRingBuffer.Get(), "CBRingBuffer");
+	D3D11SetDebugObjectName(m_pInstancedLayout.Get(), "InstancedLayout");
+	D3D11SetDebugObjectName(m_pInstancedBuffer.Get(), "InstancedBuffer");
 	D3D11SetDebugObjectName(m_pVertexShader.Get(), "Cube_VS");
+	D3D11SetDebugObjectName(m_pInstancedVertexShader.Get(), "Cube_Instance_VS");
 	D3D11SetDebugObjectName(m_pPixelShader.Get(), "Cube_PS");
 
 	return true;
@@ -2,6 +2,14 @@
 #define GAMEAPP_H
 
 #include "d3dApp.h"
+#include "ForestInstances.h"
+#include "InstancedDraw.h"
+#include "JobSystem.h"
+#include "ConstantBuffers.h"
+#include "CBufferRing.h"
+#include "CBufferRingDraw.h"
+#include "ForestLOD.h"
+#include "Camera.h"
 
 class NameVertices;// 声明类， 避免头文件与类之间的相互依赖、、、、、、、、、、、、、、、、、、、、、、、、
 
@@ -13,15 +21,29 @@ public:
 		DirectX::XMFLOAT3 pos;
 		DirectX::XMFLOAT4 color;
 		static const D3D11_INPUT_ELEMENT_DESC inputLayout[2];
+		static const D3D11_INPUT_ELEMENT_DESC instancedLayout[6];	// 槽1为逐实例的世界矩阵
 	};
 
-	struct ConstantBuffer
+	// 常量缓冲区按更新频率拆分，对应HLSL中的b0、b1
+	struct CBPerObject
 	{
 		DirectX::XMMATRIX world;
+	};
+
+	struct CBPerFrame
+	{
 		DirectX::XMMATRIX view;
 		DirectX::XMMATRIX proj;
 	};
 
+	// 一级LOD网格在合并后的顶点/索引缓冲区中的位置
+	struct LodDraw
+	{
+		UINT indexCount;
+		UINT startIndex;
+		INT baseVertex;
+	};
+
 public:
 	GameApp(HINSTANCE hInstance);
 	~GameApp();
@@ -35,21 +57,37 @@ public:
 private:
 	bool InitEffect();
 	bool InitResource();
-
+	void DrawForestInstanced();				// 按LOD分组写入实例缓冲区，每一级一次DrawIndexedInstanced
+	// 用第level级LOD网格逐个更新常量缓冲区并绘制，支持时常量一次写入环形缓冲区再按偏移绑定
+	void DrawForestPerObject(const std::vector<uint32_t>& indices, uint32_t level);
 
 
 private:
 	ComPtr<ID3D11InputLayout> m_pVertexLayout;	    // 顶点输入布局
-	ComPtr<ID3D11Buffer> m_pVertexBuffer;			// 顶点缓冲区
-	ComPtr<ID3D11Buffer> m_pIndexBuffer;			// 索引缓冲区
-	ComPtr<ID3D11Buffer> m_pConstantBuffer;		    // 常量缓冲区
+	ComPtr<ID3D11Buffer> m_pVertexBuffer;			// 顶点缓冲区，依次存放各级LOD网格
+	ComPtr<ID3D11Buffer> m_pIndexBuffer;			// 索引缓冲区，依次存放各级LOD网格
+	std::vector<LodDraw> m_LodDraws;				// 各级LOD网格的绘制参数，第0级为原网格
+	ComPtr<ID3D11InputLayout> m_pInstancedLayout;	// 实例化输入布局
+	ComPtr<ID3D11Buffer> m_pInstancedBuffer;		// 实例缓冲区
+	std::vector<InstanceGroup> m_InstanceGroups;	// 实例化绘制时各级LOD的实例
 
 	ComPtr<ID3D11VertexShader> m_pVertexShader;	    // 顶点着色器
+	ComPtr<ID3D11VertexShader> m_pInstancedVertexShader;	// 实例化顶点着色器
 	ComPtr<ID3D11PixelShader> m_pPixelShader;		// 像素着色器
-	ConstantBuffer m_CBuffer;	                    // 用于修改GPU常量缓冲区的变量
+	CBufferObject<CBPerObject> m_CBPerObject;		// 每个物体更新的常量缓冲区
+	CBufferObject<CBPerFrame> m_CBPerFrame;			// 观察和投影矩阵变化时才更新的常量缓冲区
+	ComPtr<ID3D11Buffer> m_pCBRingBuffer;			// 逐物体常量的环形缓冲区，需要D3D11.1的偏移绑定
+	CBufferRing m_CBRing;							// 环形缓冲区的分配器
+	std::vector<uint32_t> m_CBRingOffsets;			// 这一批绘制在环形缓冲区中的偏移
+	bool m_CBRingSupported;							// 设备是否支持常量缓冲区偏移绑定
 
 	NameVertices* name;// 存储绘制名字的顶点、类型、、、、、、、、、、、、、、、、、、、、、、
 	float angle = 0.0f;
+	ForestInstances m_Forest;	// 每帧所有树及子物体的世界矩阵
+	JobSystem m_Jobs;			// 并行生成实例的任务系统
+	bool m_UseInstancing;		// 是否使用硬件实例化绘制
+	ForestLOD m_ForestLOD;		// 按投影大小为每个实例选择LOD，过小的子物体不绘制
+	Camera m_Camera;			// 注视原点的固定摄像机
 };
 
 
@@ -1,9 +1,14 @@
 
-cbuffer ConstantBuffer : register(b0)
+// Ƶʲ֣ÿλֻϴg_World
+cbuffer CBPerObject : register(b0)
 {
     matrix g_World; // matrixfloat4x4row_major£ĬΪ
-    matrix g_View;  // ǰrow_majorʾ
-    matrix g_Proj;  // ý̳ʹĬϵ󣬵ҪC++ԤȽתá
+}                   // ǰrow_majorʾ
+
+cbuffer CBPerFrame : register(b1)
+{
+    matrix g_View;  // ý̳ʹĬϵ󣬵ҪC++ԤȽתá
+    matrix g_Proj;
 }
 
 
@@ -13,6 +18,13 @@ struct VertexIn
 	float4 color : COLOR;
 };
 
+struct InstanceIn
+{
+	float3 posL : POSITION;
+	float4 color : COLOR;
+	matrix world : World;  // ʵ(C++ת)
+};
+
 struct VertexOut
 {
 	float4 posH : SV_POSITION;
@@ -0,0 +1,12 @@
+#include "Cube.hlsli"
+
+// ʵƣʵеg_Worldʹ
+VertexOut VS(InstanceIn vIn)
+{
+    VertexOut vOut;
+    vOut.posH = mul(float4(vIn.posL, 1.0f), vIn.world);
+    vOut.posH = mul(vOut.posH, g_View);
+    vOut.posH = mul(vOut.posH, g_Proj);
+    vOut.color = vIn.color;
+    return vOut;
+}
\ No newline at end of file
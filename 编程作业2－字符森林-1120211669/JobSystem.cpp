@@ -0,0 +1,121 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+JobSystem::JobSystem(uint32_t threadCount)
+	: m_QueuedCount(0), m_PendingCount(0), m_Quit(false)
+{
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	for (uint32_t i = 0; i < threadCount; ++i)
+		m_Queues.emplace_back(new WorkQueue);
+	for (uint32_t i = 1; i < threadCount; ++i)
+		m_Threads.emplace_back(&JobSystem::WorkerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_WakeMutex);
+		m_Quit = true;
+	}
+	m_WakeCondition.notify_all();
+	for (std::thread& th : m_Threads)
+		th.join();
+}
+
+uint32_t JobSystem::GetThreadCount() const
+{
+	return (uint32_t)m_Queues.size();
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t grain, const RangeFunc& func)
+{
+	if (count == 0)
+		return;
+	grain = std::max(1u, grain);
+
+	// 只有一个线程或只有一个任务时直接执行
+	uint32_t jobCount = (count + grain - 1) / grain;
+	if (m_Queues.size() == 1 || jobCount == 1)
+	{
+		func(0, count);
+		return;
+	}
+
+	// 任务轮流分配到各线程的队列
+	m_PendingCount += jobCount;
+	for (uint32_t k = 0; k < jobCount; ++k)
+	{
+		Job job = { &func, k * grain, std::min(count, (k + 1) * grain) };
+		WorkQueue& queue = *m_Queues[k % m_Queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(job);
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_WakeMutex);
+		m_QueuedCount += jobCount;
+	}
+	m_WakeCondition.notify_all();
+
+	// 调用线程同样参与执行，直到所有任务完成
+	Job job;
+	while (m_PendingCount.load() > 0)
+	{
+		if (GetJob(0, job))
+			RunJob(job);
+		else
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::WorkerLoop(uint32_t index)
+{
+	Job job;
+	for (;;)
+	{
+		if (GetJob(index, job))
+		{
+			RunJob(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_WakeMutex);
+		m_WakeCondition.wait(lock, [this]() { return m_Quit || m_QueuedCount.load() > 0; });
+		if (m_Quit)
+			return;
+	}
+}
+
+bool JobSystem::GetJob(uint32_t index, Job& job)
+{
+	uint32_t queueCount = (uint32_t)m_Queues.size();
+	for (uint32_t k = 0; k < queueCount; ++k)
+	{
+		WorkQueue& queue = *m_Queues[(index + k) % queueCount];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.jobs.empty())
+			continue;
+
+		// 自己的任务从队尾取，窃取他人的任务从队头取
+		if (k == 0)
+		{
+			job = queue.jobs.back();
+			queue.jobs.pop_back();
+		}
+		else
+		{
+			job = queue.jobs.front();
+			queue.jobs.pop_front();
+		}
+		--m_QueuedCount;
+		return true;
+	}
+	return false;
+}
+
+void JobSystem::RunJob(const Job& job)
+{
+	(*job.func)(job.begin, job.end);
+	--m_PendingCount;
+}
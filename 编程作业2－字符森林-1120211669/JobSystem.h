@@ -0,0 +1,65 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 简单的工作窃取任务系统。每个线程有自己的任务队列，从队尾取自己的任务，
+// 自己的队列为空时从其它线程的队头窃取任务
+class JobSystem
+{
+public:
+	// 处理[begin, end)范围的任务
+	typedef std::function<void(uint32_t begin, uint32_t end)> RangeFunc;
+
+public:
+	// [In]threadCount	参与计算的线程数(包含调用ParallelFor的线程)，为0则使用硬件线程数
+	explicit JobSystem(uint32_t threadCount = 0);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	uint32_t GetThreadCount() const;
+
+	// 将[0, count)按grain大小切分为若干任务并行执行，全部完成后返回
+	// 调用线程也会执行任务。不能在任务内部嵌套调用
+	void ParallelFor(uint32_t count, uint32_t grain, const RangeFunc& func);
+
+private:
+	struct Job
+	{
+		const RangeFunc* func;
+		uint32_t begin;
+		uint32_t end;
+	};
+
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	void WorkerLoop(uint32_t index);
+	// 先从自己的队列取任务，没有则窃取，返回是否取到
+	bool GetJob(uint32_t index, Job& job);
+	void RunJob(const Job& job);
+
+private:
+	std::vector<std::unique_ptr<WorkQueue>> m_Queues;	// 每个线程一个队列，0号为调用线程
+	std::vector<std::thread> m_Threads;					// 工作线程
+	std::mutex m_WakeMutex;
+	std::condition_variable m_WakeCondition;			// 没有任务时工作线程在此等待
+	std::atomic<uint32_t> m_QueuedCount;				// 队列中尚未取走的任务数
+	std::atomic<uint32_t> m_PendingCount;				// 尚未完成的任务数
+	bool m_Quit;
+};
+
+#endif
@@ -1601,7 +1601,7 @@ NameVertices::NameVertices(D3D11_PRIMITIVE_TOPOLOGY type)
 		596, 592, 595,
 		595, 599, 596
 	};
-	indexCount = 3000;
+	indexCount = 2700;
 
 	// 处理顶点颜色
 	for (UINT i = 0; i < verticesCount; i++)
@@ -0,0 +1,57 @@
+#ifndef CBUFFERRING_H
+#define CBUFFERRING_H
+
+#include <cstdint>
+
+// 常量缓冲区的环形分配器，与图形API无关。
+// 一帧内大量绘制的常量数据先全部写入一次Map得到的内存，每块按256字节对齐，
+// 绘制时再按偏移绑定(D3D11.1的VSSetConstantBuffers1)，避免每次绘制都WRITE_DISCARD重命名缓冲区。
+// 容量不足时Allocate返回nullptr，调用方提交已分配的部分后重新Begin
+class CBufferRing
+{
+public:
+	static const uint32_t kAlignment = 256;		// 常量缓冲区偏移绑定要求的对齐(16个常量)
+	static const uint32_t kConstantSize = 16;	// 一个常量(float4)的字节数
+
+public:
+	// [In]capacity	环形缓冲区总字节数，向下取整为kAlignment的倍数
+	explicit CBufferRing(uint32_t capacity = 0);
+
+	void SetCapacity(uint32_t capacity);
+	uint32_t GetCapacity() const;
+
+	// 开始写入一段新映射的内存，之前分配的偏移全部作废
+	// [In]pMapped	Map得到的起始地址，大小至少为容量
+	void Begin(void* pMapped);
+	// 结束写入，返回这一段实际用到的字节数
+	uint32_t End();
+
+	// 分配size字节，返回写入地址，偏移存入offset；容量不足返回nullptr
+	void* Allocate(uint32_t size, uint32_t& offset);
+	// 分配并复制一份数据
+	template<class T>
+	bool Push(const T& data, uint32_t& offset)
+	{
+		void* pDest = Allocate(sizeof(T), offset);
+		if (!pDest)
+			return false;
+		*static_cast<T*>(pDest) = data;
+		return true;
+	}
+
+	// 剩余空间还能放下几块size字节的数据
+	uint32_t GetRemainingSlots(uint32_t size) const;
+	uint32_t GetUsedBytes() const;
+
+	// 偏移和大小换算为以常量为单位的FirstConstant和NumConstants
+	static uint32_t ToFirstConstant(uint32_t offset);
+	static uint32_t ToNumConstants(uint32_t size);
+	static uint32_t AlignSize(uint32_t size);
+
+private:
+	uint8_t* m_pMapped;		// 这一段映射的起始地址，未映射时为空
+	uint32_t m_Capacity;	// 总字节数
+	uint32_t m_Head;		// 下一次分配的偏移
+};
+
+#endif
@@ -0,0 +1,295 @@
+#include "Camera.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// 先绕X轴(俯仰)，再绕Z轴(滚转)，最后绕Y轴(偏航)，即RotX * RotZ * RotY
+	XMVECTOR XM_CALLCONV OrientationFromEuler(const XMFLOAT3& angles)
+	{
+		XMVECTOR pitch = XMQuaternionRotationNormal(g_XMIdentityR0.v, angles.x);
+		XMVECTOR yaw = XMQuaternionRotationNormal(g_XMIdentityR1.v, angles.y);
+		XMVECTOR roll = XMQuaternionRotationNormal(g_XMIdentityR2.v, angles.z);
+		return XMQuaternionNormalize(XMQuaternionMultiply(XMQuaternionMultiply(pitch, roll), yaw));
+	}
+
+	bool Equal(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+
+	bool Equal(const XMFLOAT4& a, const XMFLOAT4& b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+	}
+}
+
+Camera::Camera()
+	: m_Mode(CameraMode_FirstPerson),
+	m_Position(0.0f, 0.0f, 0.0f),
+	m_Orientation(0.0f, 0.0f, 0.0f, 1.0f),
+	m_EulerAngles(0.0f, 0.0f, 0.0f),
+	m_Target(0.0f, 0.0f, 1.0f),
+	m_Distance(1.0f),
+	m_FovY(XM_PIDIV2),
+	m_Aspect(1.0f),
+	m_NearZ(1.0f),
+	m_FarZ(1000.0f),
+	m_Frustum(),
+	m_ViewDirty(true),
+	m_ProjDirty(true),
+	m_ViewProjDirty(true),
+	m_FrustumDirty(true),
+	m_Version(1)
+{
+}
+
+void Camera::SetLens(float fovY, float aspect, float nearZ, float farZ)
+{
+	if (fovY == m_FovY && aspect == m_Aspect && nearZ == m_NearZ && farZ == m_FarZ)
+		return;
+	m_FovY = fovY;
+	m_Aspect = aspect;
+	m_NearZ = nearZ;
+	m_FarZ = farZ;
+	MarkProjChanged();
+}
+
+void Camera::SetAspect(float aspect)
+{
+	SetLens(m_FovY, aspect, m_NearZ, m_FarZ);
+}
+
+void Camera::SetFirstPerson(const XMFLOAT3& position, const XMFLOAT3& angles)
+{
+	m_Mode = CameraMode_FirstPerson;
+	m_EulerAngles = angles;
+	SetPose(XMLoadFloat3(&position), OrientationFromEuler(angles));
+}
+
+void Camera::SetEulerAngles(const XMFLOAT3& angles)
+{
+	if (m_Mode == CameraMode_Orbit)
+	{
+		m_EulerAngles = angles;
+		UpdateOrbitPose();
+		return;
+	}
+	SetFirstPerson(m_Position, angles);
+}
+
+void Camera::SetPosition(const XMFLOAT3& position)
+{
+	// 环绕和注视模式下目标点随之平移，朝向不变
+	XMVECTOR newPos = XMLoadFloat3(&position);
+	XMVECTOR offset = newPos - XMLoadFloat3(&m_Position);
+	XMStoreFloat3(&m_Target, XMLoadFloat3(&m_Target) + offset);
+	SetPose(newPos, XMLoadFloat4(&m_Orientation));
+}
+
+void Camera::SetOrientation(const XMFLOAT4& quaternion)
+{
+	m_Mode = CameraMode_FirstPerson;
+	SetPose(XMLoadFloat3(&m_Position), XMQuaternionNormalize(XMLoadFloat4(&quaternion)));
+}
+
+void Camera::MoveLocal(const XMFLOAT3& offset)
+{
+	if (offset.x == 0.0f && offset.y == 0.0f && offset.z == 0.0f)
+		return;
+	XMVECTOR worldOffset = XMVector3Rotate(XMLoadFloat3(&offset), XMLoadFloat4(&m_Orientation));
+	XMFLOAT3 position;
+	XMStoreFloat3(&position, XMLoadFloat3(&m_Position) + worldOffset);
+	SetPosition(position);
+}
+
+void Camera::SetOrbit(const XMFLOAT3& target, float distance, float pitch, float yaw)
+{
+	m_Mode = CameraMode_Orbit;
+	m_Target = target;
+	m_Distance = distance;
+	m_EulerAngles = XMFLOAT3(pitch, yaw, 0.0f);
+	UpdateOrbitPose();
+}
+
+void Camera::Orbit(float deltaPitch, float deltaYaw)
+{
+	const float maxPitch = XM_PIDIV2 - 0.01f;
+	float pitch = m_EulerAngles.x + deltaPitch;
+	if (pitch > maxPitch) pitch = maxPitch;
+	else if (pitch < -maxPitch) pitch = -maxPitch;
+	m_EulerAngles.x = pitch;
+	m_EulerAngles.y += deltaYaw;
+	UpdateOrbitPose();
+}
+
+void Camera::Zoom(float deltaDistance)
+{
+	float distance = m_Distance + deltaDistance;
+	m_Distance = distance < m_NearZ ? m_NearZ : distance;
+	UpdateOrbitPose();
+}
+
+void Camera::LookAt(const XMFLOAT3& eye, const XMFLOAT3& target, const XMFLOAT3& up)
+{
+	m_Mode = CameraMode_LookAt;
+	m_Target = target;
+	XMVECTOR eyePos = XMLoadFloat3(&eye);
+	XMVECTOR targetPos = XMLoadFloat3(&target);
+	m_Distance = XMVectorGetX(XMVector3Length(targetPos - eyePos));
+
+	// 观察矩阵的3x3部分是世界空间到摄像机空间的旋转，转置后即为摄像机的朝向
+	XMMATRIX V = XMMatrixLookAtLH(eyePos, targetPos, XMLoadFloat3(&up));
+	V.r[3] = g_XMIdentityR3.v;
+	SetPose(eyePos, XMQuaternionNormalize(XMQuaternionRotationMatrix(XMMatrixTranspose(V))));
+}
+
+CameraMode Camera::GetMode() const
+{
+	return m_Mode;
+}
+
+const XMFLOAT3& Camera::GetPosition() const
+{
+	return m_Position;
+}
+
+const XMFLOAT4& Camera::GetOrientation() const
+{
+	return m_Orientation;
+}
+
+const XMFLOAT3& Camera::GetEulerAngles() const
+{
+	return m_EulerAngles;
+}
+
+const XMFLOAT3& Camera::GetTarget() const
+{
+	return m_Target;
+}
+
+float Camera::GetDistance() const
+{
+	return m_Distance;
+}
+
+float Camera::GetFovY() const
+{
+	return m_FovY;
+}
+
+float Camera::GetAspect() const
+{
+	return m_Aspect;
+}
+
+float Camera::GetNearZ() const
+{
+	return m_NearZ;
+}
+
+float Camera::GetFarZ() const
+{
+	return m_FarZ;
+}
+
+XMVECTOR XM_CALLCONV Camera::GetRight() const
+{
+	return XMVector3Rotate(g_XMIdentityR0.v, XMLoadFloat4(&m_Orientation));
+}
+
+XMVECTOR XM_CALLCONV Camera::GetUp() const
+{
+	return XMVector3Rotate(g_XMIdentityR1.v, XMLoadFloat4(&m_Orientation));
+}
+
+XMVECTOR XM_CALLCONV Camera::GetLook() const
+{
+	return XMVector3Rotate(g_XMIdentityR2.v, XMLoadFloat4(&m_Orientation));
+}
+
+XMMATRIX XM_CALLCONV Camera::GetView() const
+{
+	if (m_ViewDirty)
+	{
+		// 旋转部分为朝向的逆(转置)，平移部分为-position乘以该旋转
+		XMMATRIX V = XMMatrixTranspose(XMMatrixRotationQuaternion(XMLoadFloat4(&m_Orientation)));
+		XMVECTOR eyeInView = XMVector3TransformNormal(XMLoadFloat3(&m_Position), V);
+		V.r[3] = XMVectorSetW(XMVectorNegate(eyeInView), 1.0f);
+		XMStoreFloat4x4(&m_View, V);
+		m_ViewDirty = false;
+	}
+	return XMLoadFloat4x4(&m_View);
+}
+
+XMMATRIX XM_CALLCONV Camera::GetProj() const
+{
+	if (m_ProjDirty)
+	{
+		XMStoreFloat4x4(&m_Proj, XMMatrixPerspectiveFovLH(m_FovY, m_Aspect, m_NearZ, m_FarZ));
+		m_ProjDirty = false;
+	}
+	return XMLoadFloat4x4(&m_Proj);
+}
+
+XMMATRIX XM_CALLCONV Camera::GetViewProj() const
+{
+	if (m_ViewProjDirty)
+	{
+		XMStoreFloat4x4(&m_ViewProj, GetView() * GetProj());
+		m_ViewProjDirty = false;
+	}
+	return XMLoadFloat4x4(&m_ViewProj);
+}
+
+const FrustumPlanes& Camera::GetFrustum() const
+{
+	if (m_FrustumDirty)
+	{
+		m_Frustum = FrustumCuller::ExtractPlanes(GetViewProj());
+		m_FrustumDirty = false;
+	}
+	return m_Frustum;
+}
+
+uint32_t Camera::GetVersion() const
+{
+	return m_Version;
+}
+
+void Camera::SetPose(FXMVECTOR position, FXMVECTOR orientation)
+{
+	XMFLOAT3 newPosition;
+	XMFLOAT4 newOrientation;
+	XMStoreFloat3(&newPosition, position);
+	XMStoreFloat4(&newOrientation, orientation);
+	if (Equal(newPosition, m_Position) && Equal(newOrientation, m_Orientation))
+		return;
+	m_Position = newPosition;
+	m_Orientation = newOrientation;
+	MarkViewChanged();
+}
+
+void Camera::UpdateOrbitPose()
+{
+	XMVECTOR orientation = OrientationFromEuler(m_EulerAngles);
+	XMVECTOR look = XMVector3Rotate(g_XMIdentityR2.v, orientation);
+	SetPose(XMLoadFloat3(&m_Target) - look * m_Distance, orientation);
+}
+
+void Camera::MarkViewChanged()
+{
+	m_ViewDirty = true;
+	m_ViewProjDirty = true;
+	m_FrustumDirty = true;
+	++m_Version;
+}
+
+void Camera::MarkProjChanged()
+{
+	m_ProjDirty = true;
+	m_ViewProjDirty = true;
+	m_FrustumDirty = true;
+	++m_Version;
+}
@@ -0,0 +1,100 @@
+#ifndef CONSTANTBUFFERS_H
+#define CONSTANTBUFFERS_H
+
+#ifdef _WIN32
+#include <d3d11_1.h>
+#else
+#include "PlatformTypes.h"
+#endif
+#include <cstdint>
+#include <cstring>
+
+// 常量缓冲区上传统计。每次Upload累加写入的字节数，可按帧清零后读取
+class CBufferStats
+{
+public:
+	static void Reset() { UploadedBytes() = 0; UploadCount() = 0; }
+	static void Record(uint32_t bytes) { UploadedBytes() += bytes; ++UploadCount(); }
+
+	static uint64_t& UploadedBytes() { static uint64_t s_Bytes = 0; return s_Bytes; }
+	static uint32_t& UploadCount() { static uint32_t s_Count = 0; return s_Count; }
+};
+
+// 一个常量缓冲区及其CPU端副本。按更新频率拆分成多个对象，每个对象只在自己的数据变化时上传。
+// 设备和上下文为模板参数，只要求提供CreateBuffer/Map/Unmap；缓冲区类型也是模板参数，
+// 不依赖D3D11头文件和ComPtr，因此可以在Linux上用替身设备统计上传量
+template<class T, class Buffer = ID3D11Buffer>
+class CBufferObject
+{
+	static_assert(sizeof(T) % 16 == 0, "Constant buffer size must be a multiple of 16 bytes");
+
+public:
+	T data;		// CPU端副本，修改后调用Upload
+
+public:
+	CBufferObject() : data(), m_pBuffer(nullptr), m_Version(0), m_HasVersion(false) {}
+	~CBufferObject() { Reset(); }
+
+	CBufferObject(const CBufferObject&) = delete;
+	CBufferObject& operator=(const CBufferObject&) = delete;
+
+	template<class Device>
+	HRESULT Create(Device* pDevice)
+	{
+		Reset();
+		D3D11_BUFFER_DESC cbd;
+		ZeroMemory(&cbd, sizeof(cbd));
+		cbd.Usage = D3D11_USAGE_DYNAMIC;
+		cbd.ByteWidth = sizeof(T);
+		cbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		cbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		return pDevice->CreateBuffer(&cbd, nullptr, &m_pBuffer);
+	}
+
+	// 将data整体写入GPU
+	template<class Context>
+	HRESULT Upload(Context* pContext)
+	{
+		D3D11_MAPPED_SUBRESOURCE mappedData;
+		HRESULT hr = pContext->Map(m_pBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
+		if (FAILED(hr))
+			return hr;
+		memcpy(mappedData.pData, &data, sizeof(T));
+		pContext->Unmap(m_pBuffer, 0);
+		CBufferStats::Record(sizeof(T));
+		return S_OK;
+	}
+
+	// 数据来源(如摄像机)带有版本号时，只有版本与上次上传时不同才需要重新填写data并上传
+	bool NeedsUpload(uint32_t version) const { return !m_HasVersion || m_Version != version; }
+
+	template<class Context>
+	HRESULT Upload(Context* pContext, uint32_t version)
+	{
+		HRESULT hr = Upload(pContext);
+		if (SUCCEEDED(hr))
+		{
+			m_Version = version;
+			m_HasVersion = true;
+		}
+		return hr;
+	}
+
+	Buffer* Get() const { return m_pBuffer; }
+	Buffer* const* GetAddressOf() const { return &m_pBuffer; }
+
+	void Reset()
+	{
+		if (m_pBuffer)
+			m_pBuffer->Release();
+		m_pBuffer = nullptr;
+		m_HasVersion = false;
+	}
+
+private:
+	Buffer* m_pBuffer;
+	uint32_t m_Version;		// 上次上传时数据来源的版本
+	bool m_HasVersion;
+};
+
+#endif
@@ -0,0 +1,380 @@
+#include "ForestBVH.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+using namespace DirectX;
+
+ForestBVH::ForestBVH()
+{
+}
+
+void ForestBVH::Build(const ForestInstances::BoundingSpheres& spheres, uint32_t count, uint32_t leafSize)
+{
+	m_Nodes.clear();
+	m_Indices.resize(count);
+	m_LeafOf.resize(count);
+	if (count == 0)
+		return;
+
+	std::vector<XMFLOAT3> centers(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		m_Indices[i] = i;
+		centers[i] = XMFLOAT3(spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i]);
+	}
+
+	m_Nodes.reserve(2 * (count / std::max(1u, leafSize) + 1));
+	m_Nodes.push_back(Node());
+	BuildNode(0, 0, count, std::max(1u, leafSize), centers);
+	Refit(spheres);
+}
+
+void ForestBVH::BuildNode(uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t leafSize, const std::vector<XMFLOAT3>& centers)
+{
+	if (count <= leafSize)
+	{
+		m_Nodes[nodeIndex].first = first;
+		m_Nodes[nodeIndex].count = count;
+		for (uint32_t i = first; i < first + count; ++i)
+			m_LeafOf[m_Indices[i]] = nodeIndex;
+		return;
+	}
+
+	// 按球心包围盒最长的轴，从中位数处一分为二
+	float minPoint[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float maxPoint[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (uint32_t i = first; i < first + count; ++i)
+	{
+		const float* c = &centers[m_Indices[i]].x;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			minPoint[axis] = std::min(minPoint[axis], c[axis]);
+			maxPoint[axis] = std::max(maxPoint[axis], c[axis]);
+		}
+	}
+	int axis = 0;
+	for (int k = 1; k < 3; ++k)
+	{
+		if (maxPoint[k] - minPoint[k] > maxPoint[axis] - minPoint[axis])
+			axis = k;
+	}
+
+	uint32_t half = count / 2;
+	std::nth_element(m_Indices.begin() + first, m_Indices.begin() + first + half, m_Indices.begin() + first + count,
+		[&centers, axis](uint32_t a, uint32_t b) { return (&centers[a].x)[axis] < (&centers[b].x)[axis]; });
+
+	// 两个子节点相邻存放
+	uint32_t left = (uint32_t)m_Nodes.size();
+	m_Nodes[nodeIndex].first = left;
+	m_Nodes[nodeIndex].count = 0;
+	m_Nodes.push_back(Node());
+	m_Nodes.push_back(Node());
+	BuildNode(left, first, half, leafSize, centers);
+	BuildNode(left + 1, first + half, count - half, leafSize, centers);
+}
+
+void ForestBVH::Refit(const ForestInstances::BoundingSpheres& spheres)
+{
+	// 先清空叶节点的包围盒，再按实例顺序顺序读取包围球扩展所在叶节点，避免经m_Indices间接访问
+	for (Node& node : m_Nodes)
+	{
+		if (node.count == 0)
+			continue;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			node.minPoint[axis] = FLT_MAX;
+			node.maxPoint[axis] = -FLT_MAX;
+		}
+	}
+	uint32_t count = (uint32_t)m_LeafOf.size();
+	for (uint32_t index = 0; index < count; ++index)
+	{
+		Node& leaf = m_Nodes[m_LeafOf[index]];
+		float r = spheres.radius[index];
+		float c[3] = { spheres.centerX[index], spheres.centerY[index], spheres.centerZ[index] };
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			leaf.minPoint[axis] = std::min(leaf.minPoint[axis], c[axis] - r);
+			leaf.maxPoint[axis] = std::max(leaf.maxPoint[axis], c[axis] + r);
+		}
+	}
+
+	// 子节点总在父节点之后，逆序遍历内部节点即为自底向上
+	for (size_t n = m_Nodes.size(); n-- > 0;)
+	{
+		Node& node = m_Nodes[n];
+		if (node.count > 0)
+			continue;
+
+		const Node& a = m_Nodes[node.first];
+		const Node& b = m_Nodes[node.first + 1];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			node.minPoint[axis] = std::min(a.minPoint[axis], b.minPoint[axis]);
+			node.maxPoint[axis] = std::max(a.maxPoint[axis], b.maxPoint[axis]);
+		}
+	}
+}
+
+void ForestBVH::AppendSubtree(uint32_t nodeIndex, std::vector<uint32_t>& out) const
+{
+	// 子树的叶节点在m_Nodes中不连续，但建立时按范围划分，整棵子树的实例在m_Indices中是连续的一段，
+	// 沿最左和最右的路径找到起止位置即可
+	uint32_t leftMost = nodeIndex, rightMost = nodeIndex;
+	while (m_Nodes[leftMost].count == 0)
+		leftMost = m_Nodes[leftMost].first;
+	while (m_Nodes[rightMost].count == 0)
+		rightMost = m_Nodes[rightMost].first + 1;
+	uint32_t begin = m_Nodes[leftMost].first;
+	uint32_t end = m_Nodes[rightMost].first + m_Nodes[rightMost].count;
+	out.insert(out.end(), m_Indices.begin() + begin, m_Indices.begin() + end);
+}
+
+void ForestBVH::QueryFrustum(const FrustumPlanes& frustum, const ForestInstances::BoundingSpheres& spheres, std::vector<uint32_t>& out) const
+{
+	out.clear();
+	if (m_Nodes.empty())
+		return;
+
+	const XMFLOAT4* P = frustum.planes;
+	uint32_t stack[64];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		uint32_t nodeIndex = stack[--top];
+		const Node& node = m_Nodes[nodeIndex];
+
+		// 包围盒用中心和半长表示，s为中心到平面的距离，r为包围盒在法线上的投影半径
+		bool inside = true, outside = false;
+		for (int p = 0; p < 6 && !outside; ++p)
+		{
+			float cx = (node.minPoint[0] + node.maxPoint[0]) * 0.5f, ex = (node.maxPoint[0] - node.minPoint[0]) * 0.5f;
+			float cy = (node.minPoint[1] + node.maxPoint[1]) * 0.5f, ey = (node.maxPoint[1] - node.minPoint[1]) * 0.5f;
+			float cz = (node.minPoint[2] + node.maxPoint[2]) * 0.5f, ez = (node.maxPoint[2] - node.minPoint[2]) * 0.5f;
+			float s = P[p].x * cx + P[p].y * cy + P[p].z * cz + P[p].w;
+			float r = fabsf(P[p].x) * ex + fabsf(P[p].y) * ey + fabsf(P[p].z) * ez;
+			if (s + r < 0.0f)
+				outside = true;
+			else if (s - r < 0.0f)
+				inside = false;
+		}
+		if (outside)
+			continue;
+		if (inside)
+		{
+			AppendSubtree(nodeIndex, out);
+			continue;
+		}
+
+		if (node.count == 0)
+		{
+			stack[top++] = node.first;
+			stack[top++] = node.first + 1;
+			continue;
+		}
+
+		// 部分相交的叶节点逐个测试包围球
+		for (uint32_t i = node.first; i < node.first + node.count; ++i)
+		{
+			uint32_t index = m_Indices[i];
+			bool visible = true;
+			for (int p = 0; p < 6 && visible; ++p)
+				visible = P[p].x * spheres.centerX[index] + P[p].y * spheres.centerY[index] + P[p].z * spheres.centerZ[index] + P[p].w >= -spheres.radius[index];
+			if (visible)
+				out.push_back(index);
+		}
+	}
+}
+
+void ForestBVH::QuerySphere(const XMFLOAT3& center, float radius, const ForestInstances::BoundingSpheres& spheres, std::vector<uint32_t>& out) const
+{
+	out.clear();
+	if (m_Nodes.empty())
+		return;
+
+	const float c[3] = { center.x, center.y, center.z };
+	uint32_t stack[64];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		const Node& node = m_Nodes[stack[--top]];
+
+		// 球心到包围盒的最近距离
+		float distSq = 0.0f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float d = std::max(std::max(node.minPoint[axis] - c[axis], 0.0f), c[axis] - node.maxPoint[axis]);
+			distSq += d * d;
+		}
+		if (distSq > radius * radius)
+			continue;
+
+		if (node.count == 0)
+		{
+			stack[top++] = node.first;
+			stack[top++] = node.first + 1;
+			continue;
+		}
+
+		for (uint32_t i = node.first; i < node.first + node.count; ++i)
+		{
+			uint32_t index = m_Indices[i];
+			float dx = spheres.centerX[index] - c[0];
+			float dy = spheres.centerY[index] - c[1];
+			float dz = spheres.centerZ[index] - c[2];
+			float r = spheres.radius[index] + radius;
+			if (dx * dx + dy * dy + dz * dz <= r * r)
+				out.push_back(index);
+		}
+	}
+}
+
+void ForestBVH::QueryRay(const XMFLOAT3& origin, const XMFLOAT3& dir, float maxDist,
+	const ForestInstances::BoundingSpheres& spheres, std::vector<uint32_t>& out) const
+{
+	out.clear();
+	if (m_Nodes.empty())
+		return;
+
+	const float o[3] = { origin.x, origin.y, origin.z };
+	const float d[3] = { dir.x, dir.y, dir.z };
+	float invDir[3];
+	for (int axis = 0; axis < 3; ++axis)
+		invDir[axis] = fabsf(d[axis]) > 1e-20f ? 1.0f / d[axis] : (d[axis] >= 0.0f ? 1e30f : -1e30f);
+	float dirLenSq = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+
+	uint32_t stack[64];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		const Node& node = m_Nodes[stack[--top]];
+
+		// 射线与包围盒的slab测试
+		float tNear = 0.0f, tFar = maxDist;
+		for (int axis = 0; axis < 3 && tNear <= tFar; ++axis)
+		{
+			float t0 = (node.minPoint[axis] - o[axis]) * invDir[axis];
+			float t1 = (node.maxPoint[axis] - o[axis]) * invDir[axis];
+			if (t0 > t1)
+				std::swap(t0, t1);
+			tNear = std::max(tNear, t0);
+			tFar = std::min(tFar, t1);
+		}
+		if (tNear > tFar)
+			continue;
+
+		if (node.count == 0)
+		{
+			stack[top++] = node.first;
+			stack[top++] = node.first + 1;
+			continue;
+		}
+
+		// 解|o + t * d - c|^2 = r^2，判断[t0, t1]与[0, maxDist]是否重叠
+		for (uint32_t i = node.first; i < node.first + node.count; ++i)
+		{
+			uint32_t index = m_Indices[i];
+			float ocx = spheres.centerX[index] - o[0];
+			float ocy = spheres.centerY[index] - o[1];
+			float ocz = spheres.centerZ[index] - o[2];
+			float r = spheres.radius[index];
+			float b = ocx * d[0] + ocy * d[1] + ocz * d[2];
+			float c = ocx * ocx + ocy * ocy + ocz * ocz - r * r;
+			float disc = b * b - dirLenSq * c;
+			if (disc < 0.0f)
+				continue;
+			float sqrtDisc = sqrtf(disc);
+			if (b + sqrtDisc >= 0.0f && b - sqrtDisc <= maxDist * dirLenSq)
+				out.push_back(index);
+		}
+	}
+}
+
+uint32_t ForestBVH::GetNodeCount() const
+{
+	return (uint32_t)m_Nodes.size();
+}
+
+uint32_t ForestBVH::GetInstanceCount() const
+{
+	return (uint32_t)m_Indices.size();
+}
+
+void BenchmarkForestBVH(std::ostream& os, const std::vector<int>& gridSizes)
+{
+	typedef std::chrono::steady_clock Clock;
+	auto elapsedMs = [](Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+
+	// 与作业3初始相机相同的视锥体
+	XMMATRIX view = XMMatrixTranslation(0.0f, -60.0f, 100.0f) * XMMatrixRotationX(-0.7f);
+	XMMATRIX proj = XMMatrixPerspectiveFovLH(XM_PIDIV2, 4.0f / 3.0f, 1.0f, 1000.0f);
+	FrustumPlanes frustum = FrustumCuller::ExtractPlanes(view * proj);
+	XMFLOAT3 rayOrigin(0.0f, 60.0f, -100.0f), rayDir(0.436f, -0.262f, 0.873f);	// 从相机斜向射入森林
+
+	os << "instances\tnodes\tbuild ms\trefit ms\tflat cull ms\tbvh frustum ms\tenvelope frustum ms\tvisible\tsphere ms\tray ms\n";
+	for (int gridN : gridSizes)
+	{
+		ForestInstances forest(gridN);
+		forest.SetLocalBounds(XMFLOAT3(0.5f, 0.5f, 0.0f), 11.0f);	// 与名字模型相近的包围球
+		forest.Build(0.0f);
+		const ForestInstances::BoundingSpheres& spheres = forest.GetBoundingSpheres();
+		uint32_t count = forest.GetInstanceCount();
+
+		ForestBVH bvh;
+		Clock::time_point start = Clock::now();
+		bvh.Build(spheres, count);
+		double buildMs = elapsedMs(start);
+
+		forest.Build(0.5f);
+		start = Clock::now();
+		bvh.Refit(spheres);
+		double refitMs = elapsedMs(start);
+
+		// 按动画包络建立的BVH，每帧不需要Refit，节点较松
+		ForestInstances::BoundingSpheres envelope;
+		forest.GetEnvelopeSpheres(envelope);
+		ForestBVH envelopeBVH;
+		envelopeBVH.Build(envelope, count);
+
+		// 各查询重复多次取最短时间
+		int repeats = count < 1000000 ? 10 : 3;
+		double flatMs = 1e30, frustumMs = 1e30, envelopeMs = 1e30, sphereMs = 1e30, rayMs = 1e30;
+		FrustumCuller culler;
+		std::vector<uint32_t> result;
+		size_t visible = 0, envelopeVisible = 0;
+		for (int r = 0; r < repeats; ++r)
+		{
+			start = Clock::now();
+			culler.Cull(frustum, spheres.centerX.data(), spheres.centerY.data(), spheres.centerZ.data(), spheres.radius.data(), count);
+			flatMs = std::min(flatMs, elapsedMs(start));
+
+			start = Clock::now();
+			bvh.QueryFrustum(frustum, spheres, result);
+			frustumMs = std::min(frustumMs, elapsedMs(start));
+			visible = result.size();
+
+			start = Clock::now();
+			envelopeBVH.QueryFrustum(frustum, spheres, result);
+			envelopeMs = std::min(envelopeMs, elapsedMs(start));
+			envelopeVisible = result.size();
+
+			start = Clock::now();
+			bvh.QuerySphere(XMFLOAT3(0.0f, 0.0f, 0.0f), 50.0f, spheres, result);
+			sphereMs = std::min(sphereMs, elapsedMs(start));
+
+			start = Clock::now();
+			bvh.QueryRay(rayOrigin, rayDir, 1000.0f, spheres, result);
+			rayMs = std::min(rayMs, elapsedMs(start));
+		}
+
+		os << count << "\t" << bvh.GetNodeCount() << "\t" << buildMs << "\t" << refitMs << "\t"
+			<< flatMs << "\t" << frustumMs << "\t" << envelopeMs << "\t"
+			<< visible << "(" << envelopeVisible << ", " << culler.GetVisibleCount() << ")\t"
+			<< sphereMs << "\t" << rayMs << "\n";
+	}
+}
@@ -0,0 +1,60 @@
+#ifndef FORESTBVH_H
+#define FORESTBVH_H
+
+#include <vector>
+#include <cstdint>
+#include <ostream>
+#include "PortableMath.h"
+#include "ForestInstances.h"
+#include "FrustumCulling.h"
+
+// 森林实例包围球上的层次包围盒(BVH)。
+// 树的位置不变，只有尺寸和子物体的旋转随时间变化，因此拓扑只在Build时建立一次。
+// 节点包围盒只需包含查询时传入的包围球：用ForestInstances::GetEnvelopeSpheres的包络建立后，
+// 动画过程中不需要Refit，每帧只有查询的开销；包围球任意变化时才需要用Refit整体更新。
+// 查询时整棵子树完全在外则跳过，完全在内则直接输出，部分相交的叶节点逐个测试当前的包围球
+class ForestBVH
+{
+public:
+	ForestBVH();
+
+	// 按给定包围球(当前的包围球或动画中的包络)建立BVH，每个叶节点最多包含leafSize个实例
+	void Build(const ForestInstances::BoundingSpheres& spheres, uint32_t count, uint32_t leafSize = 8);
+	// 包围球超出建立时的范围后更新各节点的包围盒，拓扑不变，耗时与实例数成正比
+	void Refit(const ForestInstances::BoundingSpheres& spheres);
+
+	// 视锥体查询，与视锥体相交的实例下标存入out
+	void QueryFrustum(const FrustumPlanes& frustum, const ForestInstances::BoundingSpheres& spheres, std::vector<uint32_t>& out) const;
+	// 球体查询，与球相交的实例下标存入out
+	void QuerySphere(const DirectX::XMFLOAT3& center, float radius, const ForestInstances::BoundingSpheres& spheres, std::vector<uint32_t>& out) const;
+	// 射线查询，包围球与射线在[0, maxDist]内相交的实例下标存入out
+	void QueryRay(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& dir, float maxDist,
+		const ForestInstances::BoundingSpheres& spheres, std::vector<uint32_t>& out) const;
+
+	uint32_t GetNodeCount() const;
+	uint32_t GetInstanceCount() const;
+
+private:
+	struct Node
+	{
+		float minPoint[3];
+		float maxPoint[3];
+		uint32_t first;		// 叶节点为m_Indices中的起始位置，内部节点为左子节点下标(右子节点紧随其后)
+		uint32_t count;		// 叶节点的实例数，内部节点为0
+	};
+
+	// 将m_Indices中[first, first + count)的实例建立为以nodeIndex为根的子树
+	void BuildNode(uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t leafSize, const std::vector<DirectX::XMFLOAT3>& centers);
+	// 将整棵子树的实例全部输出
+	void AppendSubtree(uint32_t nodeIndex, std::vector<uint32_t>& out) const;
+
+private:
+	std::vector<Node> m_Nodes;			// 0号为根节点，父节点总在子节点之前
+	std::vector<uint32_t> m_Indices;	// 按叶节点顺序排列的实例下标
+	std::vector<uint32_t> m_LeafOf;		// 每个实例所在的叶节点，Refit时按实例顺序访问包围球
+};
+
+// 在不同网格大小下测量BVH的建立、Refit和各类查询耗时，并与逐实例视锥体剔除对比
+void BenchmarkForestBVH(std::ostream& os, const std::vector<int>& gridSizes);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef FORESTCONSTANTS_H
+#define FORESTCONSTANTS_H
+
+#include "PortableMath.h"
+
+// 森林绘制用到的常量缓冲区，按更新频率拆分，对应HLSL/Cube.hlsli中的b0、b1。
+// 放在GameApp之外，单元测试可以直接统计它们的上传量
+struct CBPerObject
+{
+	DirectX::XMMATRIX world;
+};
+
+struct CBPerFrame
+{
+	DirectX::XMMATRIX view;
+	DirectX::XMMATRIX proj;
+};
+
+#endif
@@ -0,0 +1,419 @@
+#include "ForestHLOD.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+	// 缓存文件格式：
+	//   "HLOD" | 版本 | 输入摘要 | 区块数
+	//   每个区块: 包围盒min[3] max[3] | 顶点数 | 索引数 | 顶点(位置按包围盒量化为3个uint16，颜色RGBA8) | 索引uint16
+	const char s_CacheMagic[4] = { 'H', 'L', 'O', 'D' };
+	const uint32_t s_CacheVersion = 1;
+
+	inline uint32_t PackColor(const XMFLOAT4& c)
+	{
+		auto toByte = [](float v) { return (uint32_t)(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f); };
+		return toByte(c.x) | (toByte(c.y) << 8) | (toByte(c.z) << 16) | (toByte(c.w) << 24);
+	}
+
+	inline XMFLOAT4 UnpackColor(uint32_t c)
+	{
+		return XMFLOAT4((c & 0xff) / 255.0f, ((c >> 8) & 0xff) / 255.0f, ((c >> 16) & 0xff) / 255.0f, (c >> 24) / 255.0f);
+	}
+
+	// FNV-1a
+	inline uint32_t HashBytes(uint32_t hash, const void* pData, size_t size)
+	{
+		const uint8_t* p = static_cast<const uint8_t*>(pData);
+		for (size_t i = 0; i < size; ++i)
+			hash = (hash ^ p[i]) * 16777619u;
+		return hash;
+	}
+}
+
+ForestHLOD::ForestHLOD()
+	: m_TileSize(1),
+	m_TilesPerRow(0),
+	m_ClusterSize(0.0f),
+	m_NextTile(0),
+	m_ReadyCount(0),
+	m_Cancel(false),
+	m_CacheKey(0),
+	m_LoadedFromCache(false),
+	m_BuildSeconds(0.0)
+{
+}
+
+ForestHLOD::~ForestHLOD()
+{
+	Stop();
+}
+
+void ForestHLOD::Start(const ForestInstances& forest, const LodMesh& treeMesh, uint32_t tileSize, float clusterSize,
+	const std::string& cacheFile, uint32_t threadCount)
+{
+	Stop();
+
+	uint32_t gridN = (uint32_t)forest.GetGridN();
+	m_TileSize = std::max(tileSize, 1u);
+	m_TilesPerRow = (gridN + m_TileSize - 1) / m_TileSize;
+	m_ClusterSize = clusterSize;
+	m_TreeMesh = treeMesh;
+	uint32_t tileCount = GetTileCount();
+
+	// 树网格在局部空间的包围球
+	XMVECTOR meshMin = XMVectorReplicate(FLT_MAX), meshMax = XMVectorReplicate(-FLT_MAX);
+	for (const LodVertex& v : treeMesh.vertices)
+	{
+		meshMin = XMVectorMin(meshMin, XMLoadFloat3(&v.pos));
+		meshMax = XMVectorMax(meshMax, XMLoadFloat3(&v.pos));
+	}
+	float meshReach = XMVectorGetX(XMVector3Length((meshMin + meshMax) * 0.5f)) + XMVectorGetX(XMVector3Length(meshMax - meshMin)) * 0.5f;
+	// 子物体缩小到0.2倍并平移18，树可以绕锚点任意旋转
+	float reachPerScale = std::max(meshReach, 18.0f + 0.2f * meshReach);
+
+	m_TileOfInstance.assign(forest.GetInstanceCount(), 0);
+	m_TileWorlds.assign(tileCount, std::vector<XMFLOAT4X4>());
+	m_TileMin.assign(tileCount, XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX));
+	m_TileMax.assign(tileCount, XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX));
+	for (uint32_t tree = 0; tree < forest.GetTreeCount(); ++tree)
+	{
+		uint32_t tile = (tree / gridN / m_TileSize) * m_TilesPerRow + (tree % gridN) / m_TileSize;
+		uint32_t first, last;
+		forest.GetChildRange(tree, first, last);
+		m_TileOfInstance[tree] = tile;
+		for (uint32_t k = first; k < last; ++k)
+			m_TileOfInstance[k] = tile;
+
+		XMMATRIX rest = forest.GetTreeRestWorld(tree);
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world, rest);
+		m_TileWorlds[tile].push_back(world);
+
+		XMVECTOR reach = XMVectorReplicate(forest.GetTreeMaxScale(tree) * reachPerScale);
+		XMStoreFloat3(&m_TileMin[tile], XMVectorMin(XMLoadFloat3(&m_TileMin[tile]), rest.r[3] - reach));
+		XMStoreFloat3(&m_TileMax[tile], XMVectorMax(XMLoadFloat3(&m_TileMax[tile]), rest.r[3] + reach));
+	}
+
+	m_Proxies.assign(tileCount, ProxyMesh());
+	m_Ready.reset(new std::atomic<bool>[tileCount]);
+	for (uint32_t tile = 0; tile < tileCount; ++tile)
+		m_Ready[tile].store(false);
+	m_NextTile = 0;
+	m_ReadyCount = 0;
+	m_Cancel = false;
+	m_NewlyReady.clear();
+	m_BuildSeconds = 0.0;
+	m_CacheFile = cacheFile;
+	m_CacheKey = ComputeKey(treeMesh);
+	m_StartTime = std::chrono::steady_clock::now();
+
+	m_LoadedFromCache = !cacheFile.empty() && LoadCache(cacheFile, m_CacheKey);
+	if (m_LoadedFromCache)
+	{
+		for (uint32_t tile = 0; tile < tileCount; ++tile)
+			MarkReady(tile);
+		return;
+	}
+
+	if (threadCount == 0)
+		threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	threadCount = std::min(threadCount, tileCount);
+	for (uint32_t i = 0; i < threadCount; ++i)
+		m_Threads.emplace_back(&ForestHLOD::WorkerLoop, this);
+}
+
+void ForestHLOD::Stop()
+{
+	m_Cancel = true;
+	for (std::thread& thread : m_Threads)
+		thread.join();
+	m_Threads.clear();
+}
+
+uint32_t ForestHLOD::GetTileCount() const
+{
+	return m_TilesPerRow * m_TilesPerRow;
+}
+
+uint32_t ForestHLOD::GetTileOf(uint32_t instance) const
+{
+	return m_TileOfInstance[instance];
+}
+
+void ForestHLOD::GetTileBounds(uint32_t tile, XMFLOAT3& minPoint, XMFLOAT3& maxPoint) const
+{
+	minPoint = m_TileMin[tile];
+	maxPoint = m_TileMax[tile];
+}
+
+float ForestHLOD::GetTileDistance(uint32_t tile, const XMFLOAT3& eye) const
+{
+	XMVECTOR p = XMLoadFloat3(&eye);
+	XMVECTOR closest = XMVectorClamp(p, XMLoadFloat3(&m_TileMin[tile]), XMLoadFloat3(&m_TileMax[tile]));
+	return XMVectorGetX(XMVector3Length(p - closest));
+}
+
+bool ForestHLOD::IsReady(uint32_t tile) const
+{
+	return m_Ready[tile].load(std::memory_order_acquire);
+}
+
+uint32_t ForestHLOD::GetReadyCount() const
+{
+	return m_ReadyCount;
+}
+
+const ForestHLOD::ProxyMesh& ForestHLOD::GetProxy(uint32_t tile) const
+{
+	return m_Proxies[tile];
+}
+
+void ForestHLOD::PollReady(std::vector<uint32_t>& tiles)
+{
+	tiles.clear();
+	std::lock_guard<std::mutex> lock(m_PollMutex);
+	tiles.swap(m_NewlyReady);
+}
+
+bool ForestHLOD::IsLoadedFromCache() const
+{
+	return m_LoadedFromCache;
+}
+
+double ForestHLOD::GetBuildSeconds() const
+{
+	return m_BuildSeconds;
+}
+
+void ForestHLOD::BuildProxy(const LodMesh& treeMesh, const std::vector<XMFLOAT4X4>& worlds,
+	float clusterSize, ProxyMesh& proxy)
+{
+	// 所有树的网格变换到世界空间后合并
+	std::vector<LodVertex> merged;
+	std::vector<uint32_t> mergedIndices;
+	merged.reserve(treeMesh.vertices.size() * worlds.size());
+	mergedIndices.reserve(treeMesh.indices.size() * worlds.size());
+	for (const XMFLOAT4X4& world : worlds)
+	{
+		XMMATRIX W = XMLoadFloat4x4(&world);
+		uint32_t base = (uint32_t)merged.size();
+		for (const LodVertex& v : treeMesh.vertices)
+		{
+			LodVertex out;
+			XMStoreFloat3(&out.pos, XMVector3Transform(XMLoadFloat3(&v.pos), W));
+			out.color = v.color;
+			merged.push_back(out);
+		}
+		for (uint16_t index : treeMesh.indices)
+			mergedIndices.push_back(base + index);
+	}
+
+	// 顶点聚类：落在同一个格子中的顶点合并为它们的平均值，退化的三角形丢弃。
+	// 聚类后顶点数超过16位索引范围时放大格子重来
+	float cell = clusterSize > 0.0f ? clusterSize : 1e-4f;
+	std::unordered_map<uint64_t, uint32_t> clusterOf;
+	std::vector<uint32_t> remap(merged.size());
+	std::vector<XMFLOAT4> posSum, colorSum;
+	for (;;)
+	{
+		clusterOf.clear();
+		posSum.clear();
+		colorSum.clear();
+		float invCell = 1.0f / cell;
+		for (size_t i = 0; i < merged.size(); ++i)
+		{
+			const XMFLOAT3& p = merged[i].pos;
+			uint64_t qx = (uint64_t)((int64_t)std::floor(p.x * invCell) + (1 << 20)) & 0x1fffff;
+			uint64_t qy = (uint64_t)((int64_t)std::floor(p.y * invCell) + (1 << 20)) & 0x1fffff;
+			uint64_t qz = (uint64_t)((int64_t)std::floor(p.z * invCell) + (1 << 20)) & 0x1fffff;
+			auto result = clusterOf.emplace((qx << 42) | (qy << 21) | qz, (uint32_t)posSum.size());
+			if (result.second)
+			{
+				posSum.push_back(XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f));
+				colorSum.push_back(XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f));
+			}
+			uint32_t c = result.first->second;
+			remap[i] = c;
+			posSum[c].x += p.x;
+			posSum[c].y += p.y;
+			posSum[c].z += p.z;
+			posSum[c].w += 1.0f;
+			colorSum[c].x += merged[i].color.x;
+			colorSum[c].y += merged[i].color.y;
+			colorSum[c].z += merged[i].color.z;
+			colorSum[c].w += merged[i].color.w;
+		}
+		if (posSum.size() <= 0x10000)
+			break;
+		cell *= 1.5f;
+	}
+
+	proxy.vertices.resize(posSum.size());
+	for (size_t c = 0; c < posSum.size(); ++c)
+	{
+		float inv = 1.0f / posSum[c].w;
+		proxy.vertices[c].pos = XMFLOAT3(posSum[c].x * inv, posSum[c].y * inv, posSum[c].z * inv);
+		proxy.vertices[c].color = XMFLOAT4(colorSum[c].x * inv, colorSum[c].y * inv, colorSum[c].z * inv, colorSum[c].w * inv);
+	}
+	proxy.indices.clear();
+	for (size_t t = 0; t + 2 < mergedIndices.size(); t += 3)
+	{
+		uint32_t a = remap[mergedIndices[t]];
+		uint32_t b = remap[mergedIndices[t + 1]];
+		uint32_t c = remap[mergedIndices[t + 2]];
+		if (a == b || b == c || c == a)
+			continue;
+		proxy.indices.push_back((uint16_t)a);
+		proxy.indices.push_back((uint16_t)b);
+		proxy.indices.push_back((uint16_t)c);
+	}
+}
+
+void ForestHLOD::WorkerLoop()
+{
+	uint32_t tileCount = GetTileCount();
+	while (!m_Cancel)
+	{
+		uint32_t tile = m_NextTile++;
+		if (tile >= tileCount)
+			break;
+		BuildProxy(m_TreeMesh, m_TileWorlds[tile], m_ClusterSize, m_Proxies[tile]);
+		MarkReady(tile);
+	}
+}
+
+void ForestHLOD::MarkReady(uint32_t tile)
+{
+	m_Ready[tile].store(true, std::memory_order_release);
+	{
+		std::lock_guard<std::mutex> lock(m_PollMutex);
+		m_NewlyReady.push_back(tile);
+	}
+	// 最后完成的线程负责写缓存
+	if (++m_ReadyCount == GetTileCount())
+	{
+		m_BuildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_StartTime).count();
+		if (!m_LoadedFromCache && !m_CacheFile.empty())
+			SaveCache(m_CacheFile, m_CacheKey);
+	}
+}
+
+uint32_t ForestHLOD::ComputeKey(const LodMesh& treeMesh) const
+{
+	uint32_t hash = 2166136261u;
+	hash = HashBytes(hash, &s_CacheVersion, sizeof(s_CacheVersion));
+	hash = HashBytes(hash, &m_TileSize, sizeof(m_TileSize));
+	hash = HashBytes(hash, &m_ClusterSize, sizeof(m_ClusterSize));
+	hash = HashBytes(hash, treeMesh.vertices.data(), treeMesh.vertices.size() * sizeof(LodVertex));
+	hash = HashBytes(hash, treeMesh.indices.data(), treeMesh.indices.size() * sizeof(uint16_t));
+	for (const std::vector<XMFLOAT4X4>& worlds : m_TileWorlds)
+		hash = HashBytes(hash, worlds.data(), worlds.size() * sizeof(XMFLOAT4X4));
+	return hash;
+}
+
+bool ForestHLOD::LoadCache(const std::string& fileName, uint32_t key)
+{
+	std::ifstream fin(fileName, std::ios::binary);
+	if (!fin)
+		return false;
+	auto read = [&](void* pData, size_t size) { return (bool)fin.read(static_cast<char*>(pData), size); };
+
+	char magic[4];
+	uint32_t version, fileKey, tileCount;
+	if (!read(magic, 4) || !read(&version, 4) || !read(&fileKey, 4) || !read(&tileCount, 4))
+		return false;
+	if (memcmp(magic, s_CacheMagic, 4) != 0 || version != s_CacheVersion || fileKey != key || tileCount != GetTileCount())
+		return false;
+
+	for (uint32_t tile = 0; tile < tileCount; ++tile)
+	{
+		ProxyMesh& proxy = m_Proxies[tile];
+		float bounds[6];
+		uint32_t vertexCount, indexCount;
+		if (!read(bounds, sizeof(bounds)) || !read(&vertexCount, 4) || !read(&indexCount, 4) ||
+			vertexCount > 0x10000 || indexCount % 3 != 0)
+			return false;
+
+		proxy.vertices.resize(vertexCount);
+		float scale[3];
+		for (int axis = 0; axis < 3; ++axis)
+			scale[axis] = (bounds[3 + axis] - bounds[axis]) / 65535.0f;
+		for (LodVertex& v : proxy.vertices)
+		{
+			uint16_t q[3];
+			uint32_t color;
+			if (!read(q, sizeof(q)) || !read(&color, 4))
+				return false;
+			v.pos = XMFLOAT3(bounds[0] + q[0] * scale[0], bounds[1] + q[1] * scale[1], bounds[2] + q[2] * scale[2]);
+			v.color = UnpackColor(color);
+		}
+
+		proxy.indices.resize(indexCount);
+		if (indexCount > 0 && !read(proxy.indices.data(), indexCount * sizeof(uint16_t)))
+			return false;
+		for (uint16_t index : proxy.indices)
+		{
+			if (index >= vertexCount)
+				return false;
+		}
+	}
+	return true;
+}
+
+bool ForestHLOD::SaveCache(const std::string& fileName, uint32_t key) const
+{
+	std::ofstream fout(fileName, std::ios::binary);
+	if (!fout)
+		return false;
+	auto write = [&](const void* pData, size_t size) { fout.write(static_cast<const char*>(pData), size); };
+
+	uint32_t tileCount = GetTileCount();
+	write(s_CacheMagic, 4);
+	write(&s_CacheVersion, 4);
+	write(&key, 4);
+	write(&tileCount, 4);
+	for (const ProxyMesh& proxy : m_Proxies)
+	{
+		// 位置按代理网格自己的包围盒量化
+		float bounds[6] = { FLT_MAX, FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (const LodVertex& v : proxy.vertices)
+		{
+			const float p[3] = { v.pos.x, v.pos.y, v.pos.z };
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				bounds[axis] = std::min(bounds[axis], p[axis]);
+				bounds[3 + axis] = std::max(bounds[3 + axis], p[axis]);
+			}
+		}
+		if (proxy.vertices.empty())
+			std::fill(bounds, bounds + 6, 0.0f);
+
+		uint32_t vertexCount = (uint32_t)proxy.vertices.size();
+		uint32_t indexCount = (uint32_t)proxy.indices.size();
+		write(bounds, sizeof(bounds));
+		write(&vertexCount, 4);
+		write(&indexCount, 4);
+		for (const LodVertex& v : proxy.vertices)
+		{
+			const float p[3] = { v.pos.x, v.pos.y, v.pos.z };
+			uint16_t q[3];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				float extent = bounds[3 + axis] - bounds[axis];
+				q[axis] = extent > 0.0f ? (uint16_t)((p[axis] - bounds[axis]) / extent * 65535.0f + 0.5f) : 0;
+			}
+			uint32_t color = PackColor(v.color);
+			write(q, sizeof(q));
+			write(&color, 4);
+		}
+		write(proxy.indices.data(), indexCount * sizeof(uint16_t));
+	}
+	return (bool)fout;
+}
@@ -0,0 +1,102 @@
+#ifndef FORESTHLOD_H
+#define FORESTHLOD_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "PortableMath.h"
+#include "ForestInstances.h"
+#include "ForestLOD.h"
+
+// 层次LOD(HLOD)。森林按tileSize x tileSize棵树划分为区块，每个区块把所有树的粗糙网格
+// 放到静止姿态下合并，再用顶点聚类简化为一个代理网格。整个区块都在切换距离之外时
+// 只绘制代理网格，区块内的树和子物体都不再提交。
+// 代理网格在后台线程中生成，完成后写入磁盘缓存，下次启动时输入不变则直接读取
+class ForestHLOD
+{
+public:
+	struct ProxyMesh
+	{
+		std::vector<LodVertex> vertices;
+		std::vector<uint16_t> indices;
+	};
+
+public:
+	ForestHLOD();
+	~ForestHLOD();
+
+	ForestHLOD(const ForestHLOD&) = delete;
+	ForestHLOD& operator=(const ForestHLOD&) = delete;
+
+	// 划分区块并开始生成代理网格，缓存有效时直接读取，否则启动后台线程
+	// [In]treeMesh		每棵树使用的网格，通常为最粗糙的一级LOD
+	// [In]clusterSize	顶点聚类的格子边长(世界空间)，越大代理网格越简单
+	// [In]cacheFile	缓存文件名，为空则不读写缓存
+	// [In]threadCount	后台线程数，为0则使用硬件线程数减1
+	void Start(const ForestInstances& forest, const LodMesh& treeMesh, uint32_t tileSize, float clusterSize,
+		const std::string& cacheFile, uint32_t threadCount = 0);
+	// 停止后台线程，已完成的区块仍然可用
+	void Stop();
+
+	uint32_t GetTileCount() const;
+	// 实例(树或子物体)所在的区块
+	uint32_t GetTileOf(uint32_t instance) const;
+	// 区块在动画中可能占据的范围，包含树的最大尺寸和子物体
+	void GetTileBounds(uint32_t tile, DirectX::XMFLOAT3& minPoint, DirectX::XMFLOAT3& maxPoint) const;
+	// 视点到区块范围的距离，视点在区块内时为0
+	float GetTileDistance(uint32_t tile, const DirectX::XMFLOAT3& eye) const;
+
+	bool IsReady(uint32_t tile) const;
+	uint32_t GetReadyCount() const;
+	// 区块的代理网格，只能在IsReady之后访问
+	const ProxyMesh& GetProxy(uint32_t tile) const;
+	// 取出上一次调用之后新完成的区块
+	void PollReady(std::vector<uint32_t>& tiles);
+
+	bool IsLoadedFromCache() const;
+	// 全部区块生成完毕所用的时间(秒)，尚未完成时为0
+	double GetBuildSeconds() const;
+
+	// 生成一个区块的代理网格：网格按各个世界矩阵(未转置)变换后合并，再做顶点聚类
+	static void BuildProxy(const LodMesh& treeMesh, const std::vector<DirectX::XMFLOAT4X4>& worlds,
+		float clusterSize, ProxyMesh& proxy);
+
+private:
+	void WorkerLoop();
+	void MarkReady(uint32_t tile);
+	// 输入的摘要，缓存中的摘要不同则缓存作废
+	uint32_t ComputeKey(const LodMesh& treeMesh) const;
+	bool LoadCache(const std::string& fileName, uint32_t key);
+	bool SaveCache(const std::string& fileName, uint32_t key) const;
+
+private:
+	uint32_t m_TileSize;
+	uint32_t m_TilesPerRow;
+	float m_ClusterSize;
+	std::vector<uint32_t> m_TileOfInstance;
+	std::vector<DirectX::XMFLOAT3> m_TileMin;
+	std::vector<DirectX::XMFLOAT3> m_TileMax;
+	std::vector<std::vector<DirectX::XMFLOAT4X4>> m_TileWorlds;	// 每个区块内各棵树的静止世界矩阵
+	LodMesh m_TreeMesh;
+
+	std::vector<ProxyMesh> m_Proxies;
+	std::unique_ptr<std::atomic<bool>[]> m_Ready;
+	std::vector<std::thread> m_Threads;
+	std::atomic<uint32_t> m_NextTile;				// 下一个待生成的区块
+	std::atomic<uint32_t> m_ReadyCount;
+	std::atomic<bool> m_Cancel;
+	std::mutex m_PollMutex;
+	std::vector<uint32_t> m_NewlyReady;				// 尚未被PollReady取走的区块
+	std::string m_CacheFile;
+	uint32_t m_CacheKey;
+	bool m_LoadedFromCache;
+	std::chrono::steady_clock::time_point m_StartTime;
+	std::atomic<double> m_BuildSeconds;
+};
+
+#endif
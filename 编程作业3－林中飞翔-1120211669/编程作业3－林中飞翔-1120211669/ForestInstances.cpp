@@ -0,0 +1,332 @@
+#include "ForestInstances.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <new>
+
+using namespace DirectX;
+
+namespace
+{
+	// 随机数的用途，作为CounterRng的stream
+	enum RandomStream
+	{
+		RandomStream_Scale = 0,			// 树的尺寸
+		RandomStream_ChildCount = 1,	// 子物体个数
+		RandomStream_ChildRotation = 2	// 子物体的旋转角，index为子物体序号
+	};
+
+	// 每个任务包含的树数
+	const uint32_t kTreesPerJob = 512;
+	// 写回实例时每个任务包含的实例数
+	const uint32_t kInstancesPerJob = 2048;
+	// 子物体的局部变换攒够这么多个再批量生成
+	const uint32_t kChildBatch = 64;
+	// 子物体先缩放，再平移到离锚点kChildDistance处，最后绕锚点旋转
+	const float kChildScale = 0.2f;
+	const float kChildDistance = 18.0f;
+}
+
+ForestInstances::ForestInstances(int gridN, uint32_t seed)
+	: m_GridN(gridN), m_Rng(seed), m_BuiltAngle(0.0f), m_Built(false), m_MultiplyCount(0),
+	m_LocalCenter(0.0f, 0.0f, 0.0f), m_LocalRadius(0.0f)
+{
+	uint32_t treeCount = GetTreeCount();
+	m_ChildOffset.resize(treeCount + 1);
+
+	// 每棵树有1~3个子物体，按树的顺序排在所有树之后
+	uint32_t offset = treeCount;
+	for (uint32_t index = 0; index < treeCount; ++index)
+	{
+		m_ChildOffset[index] = offset;
+		offset += m_Rng.Range(index, RandomStream_ChildCount, 0, 1, 4);
+	}
+	m_ChildOffset[treeCount] = offset;
+	m_Instances.resize(offset);
+
+	uint32_t paddedCount = (offset + 7) & ~7u;
+	m_Spheres.centerX.assign(paddedCount, 0.0f);
+	m_Spheres.centerY.assign(paddedCount, 0.0f);
+	m_Spheres.centerZ.assign(paddedCount, 0.0f);
+	m_Spheres.radius.assign(paddedCount, -FLT_MAX);
+
+	// 锚点为根，树和子物体为锚点的子节点，同一棵树的子物体相邻
+	m_Hierarchy.Reserve(treeCount + offset);
+	for (uint32_t index = 0; index < treeCount; ++index)
+		m_Hierarchy.AddNode(TransformHierarchy::kNoParent, AffineIdentity());
+	for (uint32_t index = 0; index < treeCount; ++index)
+		m_Hierarchy.AddNode(index, AffineIdentity());
+	for (uint32_t index = 0; index < treeCount; ++index)
+	{
+		for (uint32_t k = m_ChildOffset[index]; k < m_ChildOffset[index + 1]; ++k)
+			m_Hierarchy.AddNode(index, AffineIdentity());
+	}
+}
+
+void ForestInstances::Build(float angle, JobSystem* jobs)
+{
+	// 角度不变则所有局部矩阵都不变，没有需要更新的节点
+	if (m_Built && angle == m_BuiltAngle)
+	{
+		m_MultiplyCount = 0;
+		return;
+	}
+
+	if (jobs)
+		jobs->ParallelFor(GetTreeCount(), kTreesPerJob, [this, angle](uint32_t begin, uint32_t end) { SetLocalRange(angle, begin, end); });
+	else
+		SetLocalRange(angle, 0, GetTreeCount());
+
+	m_Hierarchy.Update(jobs);
+
+	if (jobs)
+		jobs->ParallelFor(GetInstanceCount(), kInstancesPerJob, [this](uint32_t begin, uint32_t end) { StoreRange(begin, end); });
+	else
+		StoreRange(0, GetInstanceCount());
+
+	// 局部变换都直接写出，矩阵乘法只发生在层次更新中
+	m_MultiplyCount = m_Hierarchy.GetMultiplyCount();
+	m_BuiltAngle = angle;
+	m_Built = true;
+}
+
+uint64_t ForestInstances::GetMultiplyCount() const
+{
+	return m_MultiplyCount;
+}
+
+uint64_t ForestInstances::GetNaiveMultiplyCount() const
+{
+	// 树: 旋转X*Y，再S*R*T共3次；子物体: 3个旋转2次，缩放*平移1次，S*T*S*R*T共6次
+	uint32_t childCount = GetInstanceCount() - GetTreeCount();
+	return 3ull * GetTreeCount() + 6ull * childCount;
+}
+
+void ForestInstances::SetLocalBounds(const XMFLOAT3& center, float radius)
+{
+	m_LocalCenter = center;
+	m_LocalRadius = radius;
+}
+
+void ForestInstances::SetLocalRange(float angle, uint32_t begin, uint32_t end)
+{
+	// 与树无关的部分只计算一次
+	AffineTransform rotate = AffineComposeSRT(XMFLOAT3(1.0f, 1.0f, 1.0f), angle, angle, XMFLOAT3(0.0f, 0.0f, 0.0f));
+	uint32_t treeCount = GetTreeCount();
+
+	// 子物体为Scaling(0.2) * Translation(18, 0, 0) * RotationX * RotationY，参数按SoA攒成一批再生成
+	float childScale[kChildBatch], childOffsetX[kChildBatch], childRotX[kChildBatch], childRotY[kChildBatch];
+	AffineTransform childLocal[kChildBatch];
+	std::fill(childScale, childScale + kChildBatch, kChildScale);//Child的大小和位置
+	std::fill(childOffsetX, childOffsetX + kChildBatch, kChildDistance);
+	SRTArrays childParams = { childScale, childScale, childScale, childOffsetX, nullptr, nullptr,
+		childRotX, childRotY, nullptr, nullptr, nullptr };
+	uint32_t batchFirst = m_ChildOffset[begin];
+	uint32_t batchCount = 0;
+	auto flushChildren = [&]()
+	{
+		AffineComposeSRTBatch(childParams, batchCount, childLocal);
+		for (uint32_t n = 0; n < batchCount; ++n)
+			m_Hierarchy.SetLocal(treeCount + batchFirst + n, childLocal[n]);
+		batchFirst += batchCount;
+		batchCount = 0;
+	};
+
+	for (uint32_t index = begin; index < end; ++index)
+	{
+		int i = index / m_GridN + 1;
+		int j = index % m_GridN + 1;
+		float scale = (sinf(angle * 3.0f + i * j * 0.2f) + 1.3f) * GetScaleFactor(index);//对于每个点，随机生成其尺寸大小
+		// 锚点为S*T，缩放是均匀的，直接写出而不做乘法
+		AffineTransform anchor;
+		anchor.r[0] = XMFLOAT4(scale, 0.0f, 0.0f, (i - 5.5f) * 4.5f);
+		anchor.r[1] = XMFLOAT4(0.0f, scale, 0.0f, 0.0f);
+		anchor.r[2] = XMFLOAT4(0.0f, 0.0f, scale, (j - 5.5f) * 4.5f);
+		m_Hierarchy.SetLocal(index, anchor);
+		// 均匀缩放与旋转可交换，R * (S * T)即原来的S * R * T
+		m_Hierarchy.SetLocal(treeCount + index, rotate);
+
+		for (uint32_t k = m_ChildOffset[index]; k < m_ChildOffset[index + 1]; ++k)
+		{
+			// 一次生成的4个随机数中取3个作为旋转角
+			uint32_t bits[4];
+			m_Rng.Generate4(index, RandomStream_ChildRotation, k - m_ChildOffset[index], bits);
+			float rx = CounterRng::ToFloat(bits[0]) * XM_2PI + angle;
+			float ry0 = CounterRng::ToFloat(bits[1]) * XM_2PI + angle;
+			float ry1 = CounterRng::ToFloat(bits[2]) * XM_2PI + angle;
+			// 两次绕Y轴的旋转合并为一次
+			childRotX[batchCount] = rx;
+			childRotY[batchCount] = ry0 + ry1;
+			if (++batchCount == kChildBatch)
+				flushChildren();
+		}
+	}
+	flushChildren();
+}
+
+void ForestInstances::StoreRange(uint32_t begin, uint32_t end)
+{
+	XMVECTOR localCenter = XMLoadFloat3(&m_LocalCenter);
+	uint32_t treeCount = GetTreeCount();
+	for (uint32_t index = begin; index < end; ++index)
+	{
+		// 仿射变换的布局就是转置后矩阵的前三行，直接写入
+		const AffineTransform& world = m_Hierarchy.GetWorld(treeCount + index);
+		AffineStoreTransposed(&m_Instances[index].world, world);
+		// 旋转不改变长度，缩放均匀时任一行的长度即为整体缩放
+		float scale = XMVectorGetX(XMVector3Length(XMLoadFloat4(&world.r[0])));
+		StoreSphere(index, AffineTransformPoint(world, localCenter), m_LocalRadius * scale);
+	}
+}
+
+int ForestInstances::GetGridN() const
+{
+	return m_GridN;
+}
+
+uint32_t ForestInstances::GetTreeCount() const
+{
+	return (uint32_t)(m_GridN * m_GridN);
+}
+
+uint32_t ForestInstances::GetInstanceCount() const
+{
+	return (uint32_t)m_Instances.size();
+}
+
+const std::vector<ForestInstances::InstanceData>& ForestInstances::GetInstances() const
+{
+	return m_Instances;
+}
+
+const ForestInstances::BoundingSpheres& ForestInstances::GetBoundingSpheres() const
+{
+	return m_Spheres;
+}
+
+void XM_CALLCONV ForestInstances::StoreSphere(uint32_t index, FXMVECTOR center, float radius)
+{
+	m_Spheres.centerX[index] = XMVectorGetX(center);
+	m_Spheres.centerY[index] = XMVectorGetY(center);
+	m_Spheres.centerZ[index] = XMVectorGetZ(center);
+	m_Spheres.radius[index] = radius;
+}
+
+XMMATRIX XM_CALLCONV ForestInstances::GetTreeWorld(uint32_t index) const
+{
+	return XMMatrixTranspose(XMLoadFloat4x4(&m_Instances[index].world));
+}
+
+void ForestInstances::GetChildRange(uint32_t index, uint32_t& first, uint32_t& last) const
+{
+	first = m_ChildOffset[index];
+	last = m_ChildOffset[index + 1];
+}
+
+XMMATRIX XM_CALLCONV ForestInstances::GetTreeRestWorld(uint32_t index) const
+{
+	// sin的平均值为0，与SetLocalRange中的锚点位置相同
+	int i = index / m_GridN + 1;
+	int j = index % m_GridN + 1;
+	float scale = 1.3f * GetScaleFactor(index);
+	return XMMatrixScaling(scale, scale, scale) * XMMatrixTranslation((i - 5.5f) * 4.5f, 0.0f, (j - 5.5f) * 4.5f);
+}
+
+float ForestInstances::GetTreeMaxScale(uint32_t index) const
+{
+	return 2.3f * GetScaleFactor(index);
+}
+
+void ForestInstances::GetEnvelopeSpheres(BoundingSpheres& out) const
+{
+	size_t paddedCount = m_Spheres.radius.size();
+	out.centerX.assign(paddedCount, 0.0f);
+	out.centerY.assign(paddedCount, 0.0f);
+	out.centerZ.assign(paddedCount, 0.0f);
+	out.radius.assign(paddedCount, -FLT_MAX);
+
+	// 树绕锚点旋转，球心到锚点的距离不超过scale * |c|；
+	// 子物体的球心到锚点的距离不超过scale * (kChildScale * |c| + kChildDistance)，半径为scale * kChildScale * r。
+	// 多留千分之一抵消浮点误差
+	float localDist = XMVectorGetX(XMVector3Length(XMLoadFloat3(&m_LocalCenter)));
+	float treeExtent = (localDist + m_LocalRadius) * 1.001f;
+	float childExtent = (kChildDistance + kChildScale * (localDist + m_LocalRadius)) * 1.001f;
+	for (uint32_t index = 0; index < GetTreeCount(); ++index)
+	{
+		int i = index / m_GridN + 1;
+		int j = index % m_GridN + 1;
+		float x = (i - 5.5f) * 4.5f, z = (j - 5.5f) * 4.5f;
+		float maxScale = GetTreeMaxScale(index);
+		out.centerX[index] = x;
+		out.centerZ[index] = z;
+		out.radius[index] = maxScale * treeExtent;
+		for (uint32_t k = m_ChildOffset[index]; k < m_ChildOffset[index + 1]; ++k)
+		{
+			out.centerX[k] = x;
+			out.centerZ[k] = z;
+			out.radius[k] = maxScale * childExtent;
+		}
+	}
+}
+
+float ForestInstances::GetScaleFactor(uint32_t index) const
+{
+	return 0.00015f * m_Rng.Range(index, RandomStream_Scale, 0, 300, 900);
+}
+
+void BenchmarkForestBuild(std::ostream& os, const std::vector<int>& gridSizes, uint32_t maxThreads)
+{
+	if (maxThreads == 0)
+		maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	for (int gridN : gridSizes)
+	{
+		// 大网格的实例和变换层次需要数GB内存，分配失败时跳过
+		std::unique_ptr<ForestInstances> pForest;
+		try
+		{
+			pForest.reset(new ForestInstances(gridN));
+		}
+		catch (const std::bad_alloc&)
+		{
+			os << "grid " << gridN << "x" << gridN << "  内存不足，跳过\n\n";
+			continue;
+		}
+		ForestInstances& forest = *pForest;
+		os << "grid " << gridN << "x" << gridN << "  trees " << forest.GetTreeCount()
+			<< "  instances " << forest.GetInstanceCount() << "\n";
+		os << "matrix multiplies/frame  naive " << forest.GetNaiveMultiplyCount();
+		forest.Build(-1.0f);
+		os << "  hierarchy " << forest.GetMultiplyCount();
+		forest.Build(-1.0f);
+		os << "  unchanged " << forest.GetMultiplyCount() << "\n";
+		os << "threads\tms/build\tspeedup\tMinstances/s\n";
+
+		// 小网格多测几次，取最短时间
+		int repeats = forest.GetTreeCount() < 100000 ? 20 : 3;
+		double baseMs = 0.0;
+		for (uint32_t threads = 1; threads <= maxThreads; ++threads)
+		{
+			JobSystem jobs(threads);
+			forest.Build(0.0f, &jobs);
+
+			double bestMs = 1e30;
+			for (int r = 0; r < repeats; ++r)
+			{
+				auto start = std::chrono::steady_clock::now();
+				forest.Build(0.01f * (r + 1), &jobs);
+				auto stop = std::chrono::steady_clock::now();
+				bestMs = std::min(bestMs, std::chrono::duration<double, std::milli>(stop - start).count());
+			}
+			if (threads == 1)
+				baseMs = bestMs;
+
+			os << threads << "\t" << bestMs << "\t" << baseMs / bestMs << "\t"
+				<< forest.GetInstanceCount() / (bestMs * 1000.0) << "\n";
+		}
+		os << "\n";
+	}
+}
@@ -0,0 +1,86 @@
+#ifndef FORESTLOD_H
+#define FORESTLOD_H
+
+#include <vector>
+#include <cstdint>
+#include "PortableMath.h"
+#include "ForestInstances.h"
+
+// 与GameApp::VertexPosColor布局相同的顶点，使LOD网格的生成不依赖D3D
+struct LodVertex
+{
+	DirectX::XMFLOAT3 pos;
+	DirectX::XMFLOAT4 color;
+};
+
+struct LodMesh
+{
+	std::vector<LodVertex> vertices;
+	std::vector<uint16_t> indices;
+
+	uint32_t GetTriangleCount() const { return (uint32_t)(indices.size() / 3); }
+};
+
+// 由立方体组成的网格(每个立方体8个顶点，顺序同NameVertices)生成一级LOD网格。
+// 每factor^3个格子合并为一个大立方体，角点颜色取同一角上最近的原顶点颜色，
+// 相邻大立方体之间看不见的面不生成。factor为1时只去掉内部面
+// [In]cellSize	原立方体边长
+// 顶点数超过16位索引范围时返回false
+bool BuildCubeLodMesh(const DirectX::XMFLOAT3* pPositions, const DirectX::XMFLOAT4* pColors, uint32_t stride,
+	uint32_t vertexCount, float cellSize, uint32_t factor, LodMesh& mesh);
+
+// 按包围球投影到屏幕上的直径(像素)为每个实例选择LOD，并按LOD分组以便分别提交。
+// 每个实例记住上一帧的级别，只有越过阈值一定比例后才切换，避免在阈值附近来回跳变
+class ForestLOD
+{
+public:
+	struct Level
+	{
+		uint32_t triangleCount;	// 该级网格的三角形数，用于统计
+		float minPixels;		// 投影直径不小于该值时使用这一级
+	};
+
+	static const uint8_t kUnassigned = 0xff;	// 还没有选择过级别
+	static const uint8_t kDropped = 0xfe;		// 子物体太小被丢弃
+
+public:
+	ForestLOD();
+
+	// 各级按从精细到粗糙排列，minPixels递减，最后一级通常为0
+	void SetLevels(const std::vector<Level>& levels);
+	// 切换需要越过阈值的比例，例如0.15表示变粗需小于阈值的85%，变细需大于阈值的115%
+	void SetHysteresis(float ratio);
+	// 子物体投影直径小于该值时不绘制，不大于0则不丢弃
+	void SetChildCullPixels(float pixels);
+	// 清除所有实例记住的级别
+	void Reset(uint32_t instanceCount);
+
+	// 世界空间的长度乘以该值再除以距离即为像素数
+	static float ComputePixelScale(float fovY, float viewportHeight);
+
+	// 为pIndices中的count个实例选择LOD，pIndices为空则为前count个。下标不小于treeCount的为子物体
+	void Select(const ForestInstances::BoundingSpheres& spheres, const uint32_t* pIndices, uint32_t count,
+		uint32_t treeCount, const DirectX::XMFLOAT3& eye, float pixelScale);
+
+	uint32_t GetLevelCount() const;
+	// 上一次Select中使用第level级的实例下标
+	const std::vector<uint32_t>& GetGroup(uint32_t level) const;
+	uint32_t GetDroppedCount() const;		// 被丢弃的子物体数
+	uint32_t GetSwitchCount() const;		// 级别发生变化的实例数
+	uint64_t GetTrianglesDrawn() const;		// 实际提交的三角形数
+	uint64_t GetTrianglesFull() const;		// 全部使用最精细一级时的三角形数
+	uint64_t GetTrianglesSaved() const;
+
+private:
+	std::vector<Level> m_Levels;
+	float m_Hysteresis;
+	float m_ChildCullPixels;
+	std::vector<uint8_t> m_Current;					// 每个实例当前的级别
+	std::vector<std::vector<uint32_t>> m_Groups;	// 每一级的实例下标
+	uint32_t m_DroppedCount;
+	uint32_t m_SwitchCount;
+	uint64_t m_TrianglesDrawn;
+	uint64_t m_TrianglesFull;
+};
+
+#endif
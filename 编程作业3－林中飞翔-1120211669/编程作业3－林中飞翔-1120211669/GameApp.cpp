@@ -2,6 +2,10 @@
 #include "d3dUtil.h"
 #include "DXTrace.h"
 #include "NameVertices.h"
+#include "MathBenchmark.h"
+#include <cfloat>
+#include <sstream>
+#include <fstream>
 using namespace DirectX;
 
 const D3D11_INPUT_ELEMENT_DESC GameApp::VertexPosColor::inputLayout[2] = {
@@ -9,13 +13,47 @@ const D3D11_INPUT_ELEMENT_DESC GameApp::VertexPosColor::inputLayout[2] = {
 	{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 }
 };
 
+const D3D11_INPUT_ELEMENT_DESC GameApp::VertexPosColor::instancedLayout[6] = {
+	{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "World", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "World", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "World", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "World", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 }
+};
+
+const D3D11_INPUT_ELEMENT_DESC GameApp::ImpostorInstance::inputLayout[5] = {
+	{ "CENTER", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "HALFSIZE", 0, DXGI_FORMAT_R32_FLOAT, 0, 12, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "RIGHT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "UP", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 28, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "UVRECT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 40, D3D11_INPUT_PER_INSTANCE_DATA, 1 }
+};
+
 GameApp::GameApp(HINSTANCE hInstance)
-	: D3DApp(hInstance), m_CBuffer(),
+	: D3DApp(hInstance),
+	m_CBRingSupported(false),
+	m_UseCBRing(true),
 	name(nullptr),// 初始化变量，置空、、、、、、、、、、、、、、、、、、、、、
 	nameN(80),
 	angle(0),
-	viewPos(0.0f, 60.0f, -100.0f),
-	viewRot(0.7f, 0.0f, 0.0f)
+	m_Paused(false),
+	m_Forest(nameN),
+	m_UseInstancing(true),
+	m_UseCulling(true),
+	m_UseBVH(true),
+	m_UseOcclusion(true),
+	m_UseLOD(true),
+	m_DropChildren(true),
+	m_UseImpostors(true),
+	m_ImpostorDistance(120.0f),
+	m_UseHLOD(true),
+	m_HLODDistance(200.0f),
+	m_HLODReported(false),
+	m_HLODDrawnTiles(0),
+	m_VisibleCount(0),
+	m_CulledCount(0),
+	m_CBUploadBytes(0)
 {
 }
 
@@ -45,11 +83,14 @@ bool GameApp::Init()
 void GameApp::OnResize()
 {
 	D3DApp::OnResize();
+	m_Camera.SetAspect(AspectRatio());
+	m_Occlusion.Resize(m_ClientWidth, m_ClientHeight);
 }
 
 void GameApp::UpdateScene(float dt)
 {
-	angle += 1.5f * dt;
+	if (!m_Paused)
+		angle += 1.5f * dt;
 
 	// 获取鼠标状态
 	Mouse::State mouseState = m_pMouse->GetState();
@@ -63,31 +104,121 @@ void GameApp::UpdateScene(float dt)
 	m_KeyboardTracker.Update(keyState);
 
 	XMFLOAT3 pos = { 0, 0, 0 };
+	XMFLOAT3 rot = m_Camera.GetEulerAngles();
 	float moveSpeed = 40.0f;
 	if (keyState.IsKeyDown(Keyboard::LeftShift)) moveSpeed *= 2.0f;
 	if (keyState.IsKeyDown(Keyboard::W)) pos.z += moveSpeed * dt;
 	if (keyState.IsKeyDown(Keyboard::S)) pos.z -= moveSpeed * dt;
 	if (keyState.IsKeyDown(Keyboard::A)) pos.x -= moveSpeed * dt;
 	if (keyState.IsKeyDown(Keyboard::D)) pos.x += moveSpeed * dt;
-	if (keyState.IsKeyDown(Keyboard::Q)) viewRot.z += 0.5f * dt;
-	if (keyState.IsKeyDown(Keyboard::E)) viewRot.z -= 0.5f * dt;
+	if (keyState.IsKeyDown(Keyboard::Q)) rot.z += 0.5f * dt;
+	if (keyState.IsKeyDown(Keyboard::E)) rot.z -= 0.5f * dt;
 
 	if (mouseState.leftButton == true && m_MouseTracker.leftButton == m_MouseTracker.HELD) // 这两者似乎只有在鼠标按下的那一帧存在区别(此时左为true，右为false)?
 	{
-		viewRot.y += (mouseState.x - lastMouseState.x) * 0.5f * dt;
-		viewRot.x += (mouseState.y - lastMouseState.y) * 0.5f * dt;
+		rot.y += (mouseState.x - lastMouseState.x) * 0.5f * dt;
+		rot.x += (mouseState.y - lastMouseState.y) * 0.5f * dt;
+	}
+
+	// 右键拾取名字中的格子，P键输出CPU光线投射预览
+	if (m_MouseTracker.rightButton == m_MouseTracker.PRESSED)
+		PickName(mouseState.x, mouseState.y);
+	if (m_KeyboardTracker.IsKeyPressed(Keyboard::P))
+		RenderNamePreview();
+	// B键测量生成实例的多线程伸缩性
+	if (m_KeyboardTracker.IsKeyPressed(Keyboard::B))
+		RunForestBenchmark();
+	// I键切换硬件实例化与逐个绘制
+	if (m_KeyboardTracker.IsKeyPressed(Keyboard::I))
+	{
+		m_UseInstancing = !m_UseInstancing;
+		m_StatusText = m_UseInstancing ? L"实例化: 开" : L"实例化: 关";
+	}
+	// C键切换视锥体剔除
+	if (m_KeyboardTracker.IsKeyPressed(Keyboard::C))
+	{
+		m_UseCulling = !m_UseCulling;
+		m_StatusText = m_UseCulling ? L"剔除: 开" : L"剔除: 关";
+	}
+	// 空格键暂停动画
+	if (m_KeyboardTracker.IsKeyPressed(Keyboard::Space))
+	{
+		m_Paused = !m_Paused;
+		m_StatusText = m_Paused ? L"动画: 暂停" : L"动画: 播放";
+	}
+	// V键切换BVH层次剔除与逐实例剔除
+	if (m_KeyboardTracker.IsKeyPressed(Keyboard::V))
+	{
+		m_UseBVH = !m_UseBVH;
+		m_StatusText = m_UseBVH ? L"剔除方式: BVH" : L"剔除方式: 逐实例";
+	}
+	// O键切换遮挡剔除
+	if (m_KeyboardTracker.IsKeyPressed(Keyboard::O))
+	{
+		m_UseOcclusion = !m_UseOcclusion;
+		m_StatusText = m_UseOcclusion ? L"遮挡剔除: 开" : L"遮挡剔除: 关";
+	}
+	// R键切换逐个绘制时常量缓冲区的更新方式
+	if (m_KeyboardTracker.IsKeyPressed(Keyboard::R))
+	{
+		m_UseCBRing = !m_UseCBRing;
+		if (!m_CBRingSupported)
+			m_StatusText = L"常量环形缓冲区: 设备不支持";
+		else
+			m_StatusText = m_UseCBRing ? L"常量更新: 环形缓冲区" : L"常量更新: 逐次Map";
+	}
+	// L键切换LOD，K键切换是否丢弃过小的子物体
+	if (m_KeyboardTracker.IsKeyPressed(Keyboard::L))
+	{
+		m_UseLOD = !m_UseLOD;
+		m_StatusText = m_UseLOD ? L"LOD: 开" : L"LOD: 关";
+	}
+	if (m_KeyboardTracker.IsKeyPressed(Keyboard::K))
+	{
+		m_DropChildren = !m_DropChildren;
+		m_ForestLOD.SetChildCullPixels(m_DropChildren ? 6.0f : 0.0f);
+		m_StatusText = m_DropChildren ? L"丢弃小物体: 开" : L"丢弃小物体: 关";
+	}
+	// M键切换冒名顶替，[和]键调整切换距离
+	if (m_KeyboardTracker.IsKeyPressed(Keyboard::M))
+	{
+		m_UseImpostors = !m_UseImpostors;
+		m_StatusText = m_UseImpostors ? L"冒名顶替: 开" : L"冒名顶替: 关";
 	}
+	if (m_KeyboardTracker.IsKeyPressed(Keyboard::OemOpenBrackets) || m_KeyboardTracker.IsKeyPressed(Keyboard::OemCloseBrackets))
+	{
+		m_ImpostorDistance *= m_KeyboardTracker.IsKeyPressed(Keyboard::OemOpenBrackets) ? 0.8f : 1.25f;
+		if (m_ImpostorDistance < 10.0f) m_ImpostorDistance = 10.0f;
+		else if (m_ImpostorDistance > 1000.0f) m_ImpostorDistance = 1000.0f;
+		std::wostringstream outs;
+		outs << L"冒名顶替距离: " << m_ImpostorDistance;
+		m_StatusText = outs.str();
+	}
+	// H键切换HLOD，逗号和句号键调整切换距离
+	if (m_KeyboardTracker.IsKeyPressed(Keyboard::H))
+	{
+		m_UseHLOD = !m_UseHLOD;
+		m_StatusText = m_UseHLOD ? L"HLOD: 开" : L"HLOD: 关";
+	}
+	if (m_KeyboardTracker.IsKeyPressed(Keyboard::OemComma) || m_KeyboardTracker.IsKeyPressed(Keyboard::OemPeriod))
+	{
+		m_HLODDistance *= m_KeyboardTracker.IsKeyPressed(Keyboard::OemComma) ? 0.8f : 1.25f;
+		if (m_HLODDistance < 20.0f) m_HLODDistance = 20.0f;
+		else if (m_HLODDistance > 1000.0f) m_HLODDistance = 1000.0f;
+		std::wostringstream outs;
+		outs << L"HLOD距离: " << m_HLODDistance;
+		m_StatusText = outs.str();
+	}
+	UpdateHLODBuffers();
 
-	if (viewRot.x > 1.5f) viewRot.x = 1.5f;
-	else if (viewRot.x < -1.5f) viewRot.x = -1.5f;
-	if (viewRot.z > 0.7f) viewRot.z = 0.7f;
-	else if (viewRot.z < -0.7f) viewRot.z = -0.7f;
+	if (rot.x > 1.5f) rot.x = 1.5f;
+	else if (rot.x < -1.5f) rot.x = -1.5f;
+	if (rot.z > 0.7f) rot.z = 0.7f;
+	else if (rot.z < -0.7f) rot.z = -0.7f;
 
-	XMStoreFloat3(&pos, XMVector3Transform(XMLoadFloat3(&pos),  XMMatrixRotationX(viewRot.x) * XMMatrixRotationZ(viewRot.z) * XMMatrixRotationY(viewRot.y)));
-	viewPos.x += pos.x;
-	viewPos.y += pos.y;
-	viewPos.z += pos.z;
-	m_CBuffer.view = XMMatrixTranspose(XMMatrixTranslation(-viewPos.x, -viewPos.y, -viewPos.z) * XMMatrixRotationY(-viewRot.y) * XMMatrixRotationZ(-viewRot.z) * XMMatrixRotationX(-viewRot.x));
+	// 先转向再沿新的朝向移动；摄像机不动时矩阵和视锥体都不会重新计算
+	m_Camera.SetEulerAngles(rot);
+	m_Camera.MoveLocal(pos);
 }
 
 void GameApp::DrawScene()
@@ -99,49 +230,476 @@ void GameApp::DrawScene()
 	m_pd3dImmediateContext->ClearRenderTargetView(m_pRenderTargetView.Get(), reinterpret_cast<const float*>(&black));
 	m_pd3dImmediateContext->ClearDepthStencilView(m_pDepthStencilView.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
 
-	for (int i = 1; i <= nameN; i++)
+	// 观察和投影矩阵只在摄像机变化后上传，一帧最多一次
+	CBufferStats::Reset();
+	if (m_CBPerFrame.NeedsUpload(m_Camera.GetVersion()))
 	{
-		for (int j = 1; j <= nameN; j++)
+		m_CBPerFrame.data.view = XMMatrixTranspose(m_Camera.GetView());
+		m_CBPerFrame.data.proj = XMMatrixTranspose(m_Camera.GetProj());
+		HR(m_CBPerFrame.Upload(m_pd3dImmediateContext.Get(), m_Camera.GetVersion()));
+	}
+
+	// 生成这一帧所有实例的世界矩阵
+	m_Forest.Build(angle, &m_Jobs);
+	// BVH按动画包络建立，包围球随尺寸变化时不需要Refit
+	const ForestInstances::BoundingSpheres& spheres = m_Forest.GetBoundingSpheres();
+
+	// 只提交视锥体内的实例
+	const uint32_t* pIndices = nullptr;
+	uint32_t count = m_Forest.GetInstanceCount();
+	const FrustumPlanes& frustum = m_Camera.GetFrustum();
+	if (m_UseCulling)
+	{
+		if (m_UseBVH)
 		{
-			float scale = (sinf(angle * 3.0f + i * j * 0.2f) + 1.3f) * 0.00015f * (rand() % 600 + 300);//对于每个点，随机生成其尺寸大小
-			DirectX::XMMATRIX mScale = XMMatrixScaling(scale, scale, scale);
-			DirectX::XMMATRIX mRotate = XMMatrixRotationX(angle) * XMMatrixRotationY(angle);
-			DirectX::XMMATRIX mTranslate = XMMatrixTranslation((i - 5.5f) * 4.5f, 0, (j - 5.5f) * 4.5f);
-			m_CBuffer.world = XMMatrixTranspose(mScale * mRotate * mTranslate); // mul(vec, mat) 中为行向量，矩阵右乘，顺序SRT, 参考https://www.cnblogs.com/X-Jun/p/9808727.html#_lab2_1_1
-			// 更新常量缓冲区，让立方体转起来
-			D3D11_MAPPED_SUBRESOURCE mappedData;
-			HR(m_pd3dImmediateContext->Map(m_pConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData));
-			memcpy_s(mappedData.pData, sizeof(m_CBuffer), &m_CBuffer, sizeof(m_CBuffer));
-			m_pd3dImmediateContext->Unmap(m_pConstantBuffer.Get(), 0);
-			m_pd3dImmediateContext->DrawIndexed(name->GetIndexCount(), 0, 0);// 通过对象获取索引个数、、、、、、、、、、、、、、、、、
-
-			srand(i * j + 1);
-			DirectX::XMMATRIX mScaleChild = XMMatrixScaling(0.2f, 0.2f, 0.2f);//Child的大小
-			DirectX::XMMATRIX mTranslateChild = XMMatrixTranslation(18.0f, 0, 0);
-			for (int k = 1; k <= 1 + rand() % 3; k++)
+			m_ForestBVH.QueryFrustum(frustum, spheres, m_BVHResult);
+			pIndices = m_BVHResult.data();
+			count = (uint32_t)m_BVHResult.size();
+		}
+		else
+		{
+			m_Culler.Cull(frustum, spheres.centerX.data(), spheres.centerY.data(), spheres.centerZ.data(), spheres.radius.data(), count);
+			pIndices = m_Culler.GetVisibleIndices().data();
+			count = m_Culler.GetVisibleCount();
+		}
+	}
+	// 再去掉被近处的树完全挡住的实例，遮挡体只从树中选，子物体太小不适合作遮挡体
+	if (m_UseOcclusion)
+	{
+		m_Occlusion.Cull(m_Forest.GetInstances(), spheres, pIndices, count, m_Forest.GetTreeCount(),
+			m_Camera.GetView(), m_Camera.GetProj(), &m_Jobs);
+		pIndices = m_Occlusion.GetVisibleIndices().data();
+		count = m_Occlusion.GetVisibleCount();
+	}
+	m_VisibleCount = count;
+	m_CulledCount = m_Forest.GetInstanceCount() - count;
+
+	// 整个区块都在HLOD距离之外时只绘制区块的代理网格，区块内的实例不再提交
+	if (m_UseHLOD)
+	{
+		SplitHLODTiles(pIndices, count);
+		pIndices = m_HLODIndices.data();
+		count = (uint32_t)m_HLODIndices.size();
+	}
+
+	// 超过切换距离的实例改为绘制冒名顶替，其余的照常经过LOD绘制网格
+	if (m_UseImpostors)
+	{
+		SplitImpostors(pIndices, count);
+		pIndices = m_NearIndices.data();
+		count = (uint32_t)m_NearIndices.size();
+	}
+
+	if (m_UseLOD)
+	{
+		// 按投影到屏幕上的大小为可见实例选择LOD，同一级的实例一起提交
+		m_ForestLOD.Select(spheres, pIndices, count, m_Forest.GetTreeCount(), m_Camera.GetPosition(),
+			ForestLOD::ComputePixelScale(m_Camera.GetFovY(), (float)m_ClientHeight));
+		if (m_UseInstancing)
+			DrawForestInstancedLOD();
+		else
+		{
+			for (uint32_t level = 0; level < m_ForestLOD.GetLevelCount(); ++level)
 			{
-				DirectX::XMMATRIX mRotateChild = XMMatrixRotationX(rand() + angle) * XMMatrixRotationY(rand() + angle) * XMMatrixRotationY(rand() + angle);
-				m_CBuffer.world = XMMatrixTranspose(mScaleChild * mTranslateChild * mScale * mRotateChild * mTranslate);
-
-				D3D11_MAPPED_SUBRESOURCE mappedData;
-				HR(m_pd3dImmediateContext->Map(m_pConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData));
-				memcpy_s(mappedData.pData, sizeof(m_CBuffer), &m_CBuffer, sizeof(m_CBuffer));
-				m_pd3dImmediateContext->Unmap(m_pConstantBuffer.Get(), 0);
-				m_pd3dImmediateContext->DrawIndexed(name->GetIndexCount(), 0, 0);// 通过对象获取索引个数、、、、、、、、、、、、、、、、、
+				const std::vector<uint32_t>& group = m_ForestLOD.GetGroup(level);
+				if (m_UseCBRing && m_CBRingSupported)
+					DrawForestPerObjectRing(group.data(), (uint32_t)group.size(), level);
+				else
+					DrawForestPerObject(group.data(), (uint32_t)group.size(), level);
 			}
 		}
 	}
-
+	else if (m_UseInstancing)
+		DrawForestInstanced(pIndices, count);
+	else if (m_UseCBRing && m_CBRingSupported)
+		DrawForestPerObjectRing(pIndices, count);
+	else
+		DrawForestPerObject(pIndices, count);
+	if (m_UseHLOD)
+		DrawHLODProxies(m_UseCulling ? &frustum : nullptr);
+	if (m_UseImpostors)
+		DrawImpostors();
+
+	m_CBUploadBytes = CBufferStats::UploadedBytes();
+	UpdateCaption();
 	HR(m_pSwapChain->Present(0, 0));
 }
 
-void GameApp::DrawName()
+void GameApp::DrawName(uint32_t level)
+{
+	// 每次绘制只上传世界矩阵
+	HR(m_CBPerObject.Upload(m_pd3dImmediateContext.Get()));
+	const LodDraw& draw = m_LodDraws[level];
+	m_pd3dImmediateContext->DrawIndexed(draw.indexCount, draw.startIndex, draw.baseVertex);
+}
+
+void GameApp::SetInstancedPipeline()
+{
+	// 槽0为顶点数据，槽1为实例数据
+	ID3D11Buffer* buffers[2] = { m_pVertexBuffer.Get(), m_pInstancedBuffer.Get() };
+	UINT strides[2] = { sizeof(VertexPosColor), sizeof(ForestInstances::InstanceData) };
+	UINT offsets[2] = { 0, 0 };
+	m_pd3dImmediateContext->IASetVertexBuffers(0, 2, buffers, strides, offsets);
+	m_pd3dImmediateContext->IASetInputLayout(m_pInstancedLayout.Get());
+	m_pd3dImmediateContext->VSSetShader(m_pInstancedVertexShader.Get(), nullptr, 0);
+}
+
+void GameApp::DrawForestInstanced(const uint32_t* pIndices, uint32_t count)
+{
+	// 观察和投影矩阵已在这一帧开始时上传，不需要更新常量缓冲区
+	if (count == 0)
+		return;
+
+	// 要绘制的实例的世界矩阵一次写入实例缓冲区
+	SetInstancedPipeline();
+	InstanceGroup group = { pIndices, count, name->GetIndexCount(), 0, 0 };
+	HR(DrawInstanceGroups(m_pd3dImmediateContext.Get(), m_pInstancedBuffer.Get(), m_Forest.GetInstances().data(), &group, 1));
+}
+
+void GameApp::DrawForestInstancedLOD()
+{
+	// 各级的实例依次写入实例缓冲区，绘制时用StartInstanceLocation区分
+	uint32_t levelCount = m_ForestLOD.GetLevelCount();
+	m_InstanceGroups.resize(levelCount);
+	uint32_t total = 0;
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		const std::vector<uint32_t>& indices = m_ForestLOD.GetGroup(level);
+		const LodDraw& draw = m_LodDraws[level];
+		InstanceGroup group = { indices.data(), (uint32_t)indices.size(), draw.indexCount, draw.startIndex, draw.baseVertex };
+		m_InstanceGroups[level] = group;
+		total += group.count;
+	}
+	if (total == 0)
+		return;
+
+	SetInstancedPipeline();
+	HR(DrawInstanceGroups(m_pd3dImmediateContext.Get(), m_pInstancedBuffer.Get(), m_Forest.GetInstances().data(),
+		m_InstanceGroups.data(), levelCount));
+}
+
+void GameApp::DrawForestPerObject(const uint32_t* pIndices, uint32_t count, uint32_t level)
+{
+	UINT stride = sizeof(VertexPosColor);
+	UINT offset = 0;
+	m_pd3dImmediateContext->IASetVertexBuffers(0, 1, m_pVertexBuffer.GetAddressOf(), &stride, &offset);
+	m_pd3dImmediateContext->IASetInputLayout(m_pVertexLayout.Get());
+	m_pd3dImmediateContext->VSSetShader(m_pVertexShader.Get(), nullptr, 0);
+
+	const std::vector<ForestInstances::InstanceData>& instances = m_Forest.GetInstances();
+	for (uint32_t k = 0; k < count; ++k)
+	{
+		m_CBPerObject.data.world = XMLoadFloat4x4(&instances[pIndices ? pIndices[k] : k].world);	// 实例数据中已经是转置后的矩阵
+		DrawName(level);
+	}
+}
+
+void GameApp::DrawForestPerObjectRing(const uint32_t* pIndices, uint32_t count, uint32_t level)
+{
+	UINT stride = sizeof(VertexPosColor);
+	UINT offset = 0;
+	m_pd3dImmediateContext->IASetVertexBuffers(0, 1, m_pVertexBuffer.GetAddressOf(), &stride, &offset);
+	m_pd3dImmediateContext->IASetInputLayout(m_pVertexLayout.Get());
+	m_pd3dImmediateContext->VSSetShader(m_pVertexShader.Get(), nullptr, 0);
+
+	const std::vector<ForestInstances::InstanceData>& instances = m_Forest.GetInstances();
+	const LodDraw& draw = m_LodDraws[level];
+	HR(DrawWithCBufferRing<CBPerObject>(m_pd3dImmediateContext1.Get(), m_pCBRingBuffer.Get(), m_CBRing, m_CBRingOffsets, 0, count,
+		[&](uint32_t k, CBPerObject& cb) { cb.world = XMLoadFloat4x4(&instances[pIndices ? pIndices[k] : k].world); },	// 实例数据中已经是转置后的矩阵
+		draw.indexCount, draw.startIndex, draw.baseVertex));
+
+	// 恢复b0为普通的逐物体常量缓冲区
+	m_pd3dImmediateContext->VSSetConstantBuffers(0, 1, m_CBPerObject.GetAddressOf());
+}
+
+void GameApp::SplitImpostors(const uint32_t* pIndices, uint32_t count)
+{
+	const ForestInstances::BoundingSpheres& spheres = m_Forest.GetBoundingSpheres();
+	float distSq = m_ImpostorDistance * m_ImpostorDistance;
+	const XMFLOAT3& eye = m_Camera.GetPosition();
+	m_NearIndices.clear();
+	m_ImpostorIndices.clear();
+	for (uint32_t k = 0; k < count; ++k)
+	{
+		uint32_t i = pIndices ? pIndices[k] : k;
+		float dx = spheres.centerX[i] - eye.x;
+		float dy = spheres.centerY[i] - eye.y;
+		float dz = spheres.centerZ[i] - eye.z;
+		(dx * dx + dy * dy + dz * dz > distSq ? m_ImpostorIndices : m_NearIndices).push_back(i);
+	}
+}
+
+void GameApp::DrawImpostors()
 {
+	if (m_ImpostorIndices.empty())
+		return;
+
+	const std::vector<ForestInstances::InstanceData>& instances = m_Forest.GetInstances();
+	const ForestInstances::BoundingSpheres& spheres = m_Forest.GetBoundingSpheres();
+	XMVECTOR eye = XMLoadFloat3(&m_Camera.GetPosition());
 	D3D11_MAPPED_SUBRESOURCE mappedData;
-	HR(m_pd3dImmediateContext->Map(m_pConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData));
-	memcpy_s(mappedData.pData, sizeof(m_CBuffer), &m_CBuffer, sizeof(m_CBuffer));
-	m_pd3dImmediateContext->Unmap(m_pConstantBuffer.Get(), 0);
-	m_pd3dImmediateContext->DrawIndexed(name->GetIndexCount(), 0, 0);// 通过对象获取索引个数、、、、、、、、、、、、、、、、、
+	HR(m_pd3dImmediateContext->Map(m_pImpostorBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData));
+	ImpostorInstance* pDest = reinterpret_cast<ImpostorInstance*>(mappedData.pData);
+	for (uint32_t i : m_ImpostorIndices)
+	{
+		XMVECTOR center = XMVectorSet(spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i], 0.0f);
+		XMVECTOR toEye = XMVector3Normalize(eye - center);
+		// 实例数据中是转置后的世界矩阵，缩放均匀时用它变换即得到局部空间的方向(未单位化)
+		XMMATRIX worldT = XMLoadFloat4x4(&instances[i].world);
+		uint32_t view = m_Impostors.FindNearestView(XMVector3TransformNormal(toEye, worldT));
+
+		// 格子烘焙时的上方向变换到世界空间，再去掉沿视线的分量，使四边形正对摄像机
+		XMFLOAT3 right, up;
+		m_Impostors.GetViewBasis(view, right, up);
+		XMVECTOR upW = XMVector3TransformNormal(XMLoadFloat3(&up), XMMatrixTranspose(worldT));
+		upW = XMVector3Normalize(upW - toEye * XMVector3Dot(upW, toEye));
+		XMVECTOR rightW = XMVector3Cross(upW, -toEye);
+
+		ImpostorInstance& inst = *pDest++;
+		XMStoreFloat3(&inst.center, center);
+		inst.halfSize = spheres.radius[i];
+		XMStoreFloat3(&inst.right, rightW);
+		XMStoreFloat3(&inst.up, upW);
+		inst.uvRect = m_Impostors.GetFrameUV(view);
+	}
+	m_pd3dImmediateContext->Unmap(m_pImpostorBuffer.Get(), 0);
+
+	UINT stride = sizeof(ImpostorInstance);
+	UINT offset = 0;
+	m_pd3dImmediateContext->IASetVertexBuffers(0, 1, m_pImpostorBuffer.GetAddressOf(), &stride, &offset);
+	m_pd3dImmediateContext->IASetInputLayout(m_pImpostorLayout.Get());
+	m_pd3dImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+	m_pd3dImmediateContext->VSSetShader(m_pImpostorVS.Get(), nullptr, 0);
+	ID3D11ShaderResourceView* srvs[2] = { m_pImpostorColorSRV.Get(), m_pImpostorDepthSRV.Get() };
+	m_pd3dImmediateContext->PSSetShaderResources(0, 2, srvs);
+	m_pd3dImmediateContext->PSSetSamplers(0, 1, m_pPointSampler.GetAddressOf());
+	m_pd3dImmediateContext->PSSetShader(m_pImpostorPS.Get(), nullptr, 0);
+
+	m_pd3dImmediateContext->DrawInstanced(4, (UINT)m_ImpostorIndices.size(), 0, 0);
+
+	// 恢复绘制网格时的图元类型和像素着色器
+	m_pd3dImmediateContext->IASetPrimitiveTopology(name->GetTopology());
+	m_pd3dImmediateContext->PSSetShader(m_pPixelShader.Get(), nullptr, 0);
+}
+
+void GameApp::UpdateHLODBuffers()
+{
+	m_HLOD.PollReady(m_HLODNewTiles);
+	for (uint32_t tile : m_HLODNewTiles)
+	{
+		const ForestHLOD::ProxyMesh& proxy = m_HLOD.GetProxy(tile);
+		if (proxy.indices.empty())
+			continue;
+
+		// 代理网格生成后不再变化
+		D3D11_BUFFER_DESC bd;
+		ZeroMemory(&bd, sizeof(bd));
+		bd.Usage = D3D11_USAGE_IMMUTABLE;
+		bd.ByteWidth = (UINT)(sizeof(LodVertex) * proxy.vertices.size());
+		bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		D3D11_SUBRESOURCE_DATA initData;
+		ZeroMemory(&initData, sizeof(initData));
+		initData.pSysMem = proxy.vertices.data();
+		HR(m_pd3dDevice->CreateBuffer(&bd, &initData, m_HLODVertexBuffers[tile].ReleaseAndGetAddressOf()));
+		bd.ByteWidth = (UINT)(sizeof(uint16_t) * proxy.indices.size());
+		bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		initData.pSysMem = proxy.indices.data();
+		HR(m_pd3dDevice->CreateBuffer(&bd, &initData, m_HLODIndexBuffers[tile].ReleaseAndGetAddressOf()));
+		m_HLODIndexCounts[tile] = (UINT)proxy.indices.size();
+	}
+
+	if (!m_HLODReported && m_HLOD.GetReadyCount() == m_HLOD.GetTileCount())
+	{
+		m_HLODReported = true;
+		std::wostringstream outs;
+		outs.precision(4);
+		outs << L"HLOD: " << m_HLOD.GetTileCount() << L"个区块 " << (m_HLOD.IsLoadedFromCache() ? L"从缓存读取 " : L"后台生成 ")
+			<< m_HLOD.GetBuildSeconds() * 1000.0 << L" ms";
+		m_StatusText = outs.str();
+	}
+}
+
+void GameApp::SplitHLODTiles(const uint32_t* pIndices, uint32_t count)
+{
+	// 只有代理网格已经就绪的区块才能替换
+	for (uint32_t tile = 0; tile < m_HLOD.GetTileCount(); ++tile)
+		m_HLODTileFar[tile] = m_HLODIndexCounts[tile] > 0 && m_HLOD.GetTileDistance(tile, m_Camera.GetPosition()) > m_HLODDistance;
+
+	m_HLODIndices.clear();
+	for (uint32_t k = 0; k < count; ++k)
+	{
+		uint32_t i = pIndices ? pIndices[k] : k;
+		if (!m_HLODTileFar[m_HLOD.GetTileOf(i)])
+			m_HLODIndices.push_back(i);
+	}
+}
+
+void GameApp::DrawHLODProxies(const FrustumPlanes* pFrustum)
+{
+	m_HLODDrawnTiles = 0;
+	UINT stride = sizeof(VertexPosColor);
+	UINT offset = 0;
+	for (uint32_t tile = 0; tile < m_HLOD.GetTileCount(); ++tile)
+	{
+		if (!m_HLODTileFar[tile])
+			continue;
+		if (pFrustum)
+		{
+			// 包围盒在某个平面外侧时剔除，用离平面最远的角点判断
+			XMFLOAT3 minPoint, maxPoint;
+			m_HLOD.GetTileBounds(tile, minPoint, maxPoint);
+			bool outside = false;
+			for (const XMFLOAT4& plane : pFrustum->planes)
+			{
+				float x = plane.x >= 0.0f ? maxPoint.x : minPoint.x;
+				float y = plane.y >= 0.0f ? maxPoint.y : minPoint.y;
+				float z = plane.z >= 0.0f ? maxPoint.z : minPoint.z;
+				if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f)
+				{
+					outside = true;
+					break;
+				}
+			}
+			if (outside)
+				continue;
+		}
+
+		// 没有远处区块时不上传常量也不切换着色器，在第一次绘制前再设置
+		if (m_HLODDrawnTiles == 0)
+		{
+			// 代理网格已经在世界空间中
+			m_CBPerObject.data.world = XMMatrixIdentity();
+			HR(m_CBPerObject.Upload(m_pd3dImmediateContext.Get()));
+			m_pd3dImmediateContext->IASetInputLayout(m_pVertexLayout.Get());
+			m_pd3dImmediateContext->VSSetShader(m_pVertexShader.Get(), nullptr, 0);
+		}
+		m_pd3dImmediateContext->IASetVertexBuffers(0, 1, m_HLODVertexBuffers[tile].GetAddressOf(), &stride, &offset);
+		m_pd3dImmediateContext->IASetIndexBuffer(m_HLODIndexBuffers[tile].Get(), DXGI_FORMAT_R16_UINT, 0);
+		m_pd3dImmediateContext->DrawIndexed(m_HLODIndexCounts[tile], 0, 0);
+		++m_HLODDrawnTiles;
+	}
+
+	// 恢复名字网格的索引缓冲区
+	m_pd3dImmediateContext->IASetIndexBuffer(m_pIndexBuffer.Get(), DXGI_FORMAT_R16_UINT, 0);
+}
+
+void GameApp::UpdateCaption()
+{
+	std::wostringstream outs;
+	outs << L"Rendering a Cube    ";
+	if (m_UseCulling)
+		outs << L"可见: " << m_VisibleCount << L" 剔除: " << m_CulledCount << L"    ";
+	if (m_UseOcclusion)
+		outs << L"遮挡: " << m_Occlusion.GetCulledCount() << L"/" << m_Occlusion.GetTestedCount()
+			<< L"(" << (int)(m_Occlusion.GetCulledFraction() * 100.0f + 0.5f) << L"%) 遮挡体: " << m_Occlusion.GetOccluderCount()
+			<< L" " << (int)m_Occlusion.GetTotalMicroseconds() << L"us    ";
+	outs << L"常量上传: " << m_CBUploadBytes << L"B    ";
+	if (m_UseLOD)
+	{
+		outs << L"LOD: ";
+		for (uint32_t level = 0; level < m_ForestLOD.GetLevelCount(); ++level)
+			outs << (level ? L"/" : L"") << m_ForestLOD.GetGroup(level).size();
+		outs << L" 丢弃: " << m_ForestLOD.GetDroppedCount()
+			<< L" 三角形: " << m_ForestLOD.GetTrianglesDrawn() << L"/" << m_ForestLOD.GetTrianglesFull() << L"    ";
+	}
+	if (m_UseImpostors)
+		outs << L"冒名顶替: " << m_ImpostorIndices.size() << L"(>" << m_ImpostorDistance << L")    ";
+	if (m_UseHLOD)
+		outs << L"HLOD: " << m_HLODDrawnTiles << L"块(>" << m_HLODDistance << L") 就绪: "
+			<< m_HLOD.GetReadyCount() << L"/" << m_HLOD.GetTileCount() << L"    ";
+	outs << L"矩阵乘法: " << m_Forest.GetMultiplyCount() << L"/" << m_Forest.GetNaiveMultiplyCount() << L"    ";
+	outs << m_StatusText;
+	m_MainWndCaption = outs.str();
+}
+
+void GameApp::PickName(int mouseX, int mouseY)
+{
+	// 屏幕坐标转换到NDC，再用(view * proj)的逆矩阵变换回世界空间得到射线
+	XMMATRIX invViewProj = XMMatrixInverse(nullptr, m_Camera.GetViewProj());
+	float ndcX = 2.0f * mouseX / m_ClientWidth - 1.0f;
+	float ndcY = 1.0f - 2.0f * mouseY / m_ClientHeight;
+	XMVECTOR rayOrigin = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 0.0f, 1.0f), invViewProj);
+	XMVECTOR rayDir = XMVector3Normalize(XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 1.0f, 1.0f), invViewProj) - rayOrigin);
+
+	// 先用BVH找出包围球与射线相交的实例
+	XMFLOAT3 origin, dir;
+	XMStoreFloat3(&origin, rayOrigin);
+	XMStoreFloat3(&dir, rayDir);
+	m_ForestBVH.QueryRay(origin, dir, FLT_MAX, m_Forest.GetBoundingSpheres(), m_BVHResult);
+
+	VoxelHit best = {};
+	best.distance = FLT_MAX;
+	int bestTree = -1;
+	for (uint32_t k : m_BVHResult)
+	{
+		// 前nameN * nameN个实例为上一帧的树
+		if (k >= m_Forest.GetTreeCount())
+			continue;
+		XMMATRIX W = m_Forest.GetTreeWorld(k);
+
+		// 射线变换到该树的局部空间，方向不单位化，使求得的t仍是世界空间的距离
+		XMMATRIX invW = XMMatrixInverse(nullptr, W);
+		XMFLOAT3 localOrigin, localDir;
+		XMStoreFloat3(&localOrigin, XMVector3TransformCoord(rayOrigin, invW));
+		XMStoreFloat3(&localDir, XMVector3TransformNormal(rayDir, invW));
+		VoxelHit hit;
+		if (m_NameGrid.CastRay(localOrigin, localDir, best.distance, hit))
+		{
+			best = hit;
+			bestTree = (int)k;
+		}
+	}
+
+	std::wostringstream outs;
+	outs.precision(4);
+	if (bestTree >= 0)
+	{
+		static const wchar_t* faceNames[6] = { L"+X", L"-X", L"+Y", L"-Y", L"+Z", L"-Z" };
+		outs << L"拾取: 树(" << bestTree / nameN + 1 << L", " << bestTree % nameN + 1 << L") "
+			<< L"格子(" << best.cell[0] << L", " << best.cell[1] << L", " << best.cell[2] << L") "
+			<< L"面 " << (best.face >= 0 ? faceNames[best.face] : L"内部") << L" 距离 " << best.distance;
+	}
+	else
+	{
+		outs << L"拾取: 无";
+	}
+	m_StatusText = outs.str();
+}
+
+void GameApp::RenderNamePreview()
+{
+	// 沿当前视线方向观察单个名字
+	XMFLOAT3 minPoint, maxPoint;
+	m_NameGrid.GetBounds(minPoint, maxPoint);
+	XMVECTOR center = (XMLoadFloat3(&minPoint) + XMLoadFloat3(&maxPoint)) * 0.5f;
+	XMVECTOR forward = m_Camera.GetLook();
+
+	VoxelPreviewCamera camera;
+	XMStoreFloat3(&camera.eye, center - forward * 30.0f);
+	XMStoreFloat3(&camera.target, center);
+	camera.up = XMFLOAT3(0.0f, 1.0f, 0.0f);
+	camera.fovY = XM_PIDIV4;
+
+	std::vector<uint32_t> pixels;
+	VoxelRayStats stats = m_NameGrid.RenderPreview(camera, m_ClientWidth, m_ClientHeight, pixels);
+	bool saved = SaveBitmapRGBA("NamePreview.bmp", pixels, m_ClientWidth, m_ClientHeight);
+
+	std::wostringstream outs;
+	outs.precision(4);
+	outs << L"预览: " << stats.rayCount << L" 条射线 "
+		<< stats.seconds * 1000.0 << L" ms " << stats.RaysPerSecond() / 1e6 << L" M rays/s"
+		<< (saved ? L" 已保存NamePreview.bmp" : L" 保存失败");
+	m_StatusText = outs.str();
+}
+
+void GameApp::RunForestBenchmark()
+{
+	std::ofstream fout("ForestBenchmark.txt");
+	BenchmarkForestBuild(fout, { nameN, 500, 2000 }, 0);
+	BenchmarkForestBVH(fout, { nameN, 250, 500, 1000, 2000 });
+	BenchmarkAffineTransforms(fout, 1 << 20);
+	BenchmarkMathBackends(fout, 1 << 18);
+	m_StatusText = fout ? L"基准测试: 已保存ForestBenchmark.txt" : L"基准测试: 保存失败";
 }
 
 bool GameApp::InitEffect()
@@ -155,10 +713,24 @@ bool GameApp::InitEffect()
 	HR(m_pd3dDevice->CreateInputLayout(VertexPosColor::inputLayout, ARRAYSIZE(VertexPosColor::inputLayout),
 		blob->GetBufferPointer(), blob->GetBufferSize(), m_pVertexLayout.GetAddressOf()));
 
+	// 创建实例化顶点着色器及其顶点布局
+	HR(CreateShaderFromFile(L"HLSL\\Cube_Instance_VS.cso", L"HLSL\\Cube_Instance_VS.hlsl", "VS", "vs_5_0", blob.ReleaseAndGetAddressOf()));
+	HR(m_pd3dDevice->CreateVertexShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, m_pInstancedVertexShader.GetAddressOf()));
+	HR(m_pd3dDevice->CreateInputLayout(VertexPosColor::instancedLayout, ARRAYSIZE(VertexPosColor::instancedLayout),
+		blob->GetBufferPointer(), blob->GetBufferSize(), m_pInstancedLayout.GetAddressOf()));
+
 	// 创建像素着色器
 	HR(CreateShaderFromFile(L"HLSL\\Cube_PS.cso", L"HLSL\\Cube_PS.hlsl", "PS", "ps_5_0", blob.ReleaseAndGetAddressOf()));
 	HR(m_pd3dDevice->CreatePixelShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, m_pPixelShader.GetAddressOf()));
 
+	// 创建冒名顶替着色器及其输入布局
+	HR(CreateShaderFromFile(L"HLSL\\Impostor_VS.cso", L"HLSL\\Impostor_VS.hlsl", "VS", "vs_5_0", blob.ReleaseAndGetAddressOf()));
+	HR(m_pd3dDevice->CreateVertexShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, m_pImpostorVS.GetAddressOf()));
+	HR(m_pd3dDevice->CreateInputLayout(ImpostorInstance::inputLayout, ARRAYSIZE(ImpostorInstance::inputLayout),
+		blob->GetBufferPointer(), blob->GetBufferSize(), m_pImpostorLayout.GetAddressOf()));
+	HR(CreateShaderFromFile(L"HLSL\\Impostor_PS.cso", L"HLSL\\Impostor_PS.hlsl", "PS", "ps_5_0", blob.ReleaseAndGetAddressOf()));
+	HR(m_pd3dDevice->CreatePixelShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, m_pImpostorPS.GetAddressOf()));
+
 	return true;
 }
 
@@ -168,53 +740,182 @@ bool GameApp::InitResource()
 	name = new NameVertices(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 	// 设置三角形顶点
 	VertexPosColor* vertices = name->GetNameVertices(); // 通过对象获取顶点、、、、、、、、、、、、、、、、、、、、、
+	WORD* indices = name->GetNameIndices(); // 通过对象获取索引、、、、、、、、、、、、、、、、、、、、、
+
+	// ******************
+	// 生成各级LOD网格，与原网格依次存入同一个顶点/索引缓冲区。
+	// 第1级只去掉立方体之间看不见的面，之后每级把2x2x2个格子合并为一个
+	//
+	static_assert(sizeof(LodVertex) == sizeof(VertexPosColor), "LodVertex must match VertexPosColor");
+	std::vector<VertexPosColor> lodVertices(vertices, vertices + name->GetVerticesCount());
+	std::vector<WORD> lodIndices(indices, indices + name->GetIndexCount());
+	std::vector<ForestLOD::Level> lodLevels;
+	LodMesh coarsestMesh;
+	m_LodDraws.assign(1, { name->GetIndexCount(), 0, 0 });
+	lodLevels.push_back({ name->GetIndexCount() / 3, 200.0f });
+	const uint32_t lodFactors[3] = { 1, 2, 4 };
+	const float lodMinPixels[3] = { 80.0f, 30.0f, 0.0f };	// 投影直径(像素)不小于该值时使用这一级
+	for (int i = 0; i < 3; ++i)
+	{
+		LodMesh mesh;
+		if (!BuildCubeLodMesh(&vertices->pos, &vertices->color, sizeof(VertexPosColor), name->GetVerticesCount(), 1.0f, lodFactors[i], mesh))
+			break;
+		m_LodDraws.push_back({ (UINT)mesh.indices.size(), (UINT)lodIndices.size(), (INT)lodVertices.size() });
+		lodLevels.push_back({ mesh.GetTriangleCount(), lodMinPixels[i] });
+		for (const LodVertex& v : mesh.vertices)
+			lodVertices.push_back({ v.pos, v.color });
+		lodIndices.insert(lodIndices.end(), mesh.indices.begin(), mesh.indices.end());
+		// 只去掉内部面的一级作为遮挡体，轮廓与原网格相同
+		if (i == 0)
+			m_Occlusion.SetOccluderMesh(&mesh.vertices[0].pos, sizeof(LodVertex), (UINT)mesh.vertices.size(),
+				mesh.indices.data(), (UINT)mesh.indices.size());
+		coarsestMesh = mesh;
+	}
+	lodLevels.back().minPixels = 0.0f;	// 最后一级总是可用
+	m_ForestLOD.SetLevels(lodLevels);
+	m_ForestLOD.SetHysteresis(0.15f);
+	m_ForestLOD.SetChildCullPixels(m_DropChildren ? 6.0f : 0.0f);
+
 	// 设置顶点缓冲区描述
 	D3D11_BUFFER_DESC vbd;
 	ZeroMemory(&vbd, sizeof(vbd));
 	vbd.Usage = D3D11_USAGE_IMMUTABLE;
-	vbd.ByteWidth = (sizeof * vertices) * name->GetVerticesCount(); // 计算位宽、、、、、、、、、、、、、、、、、、、、、、、、、
+	vbd.ByteWidth = (UINT)(sizeof(VertexPosColor) * lodVertices.size()); // 计算位宽、、、、、、、、、、、、、、、、、、、、、、、、、
 	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 	vbd.CPUAccessFlags = 0;
 	// 新建顶点缓冲区
 	D3D11_SUBRESOURCE_DATA InitData;
 	ZeroMemory(&InitData, sizeof(InitData));
-	InitData.pSysMem = vertices;
+	InitData.pSysMem = lodVertices.data();
 	HR(m_pd3dDevice->CreateBuffer(&vbd, &InitData, m_pVertexBuffer.GetAddressOf()));
 
+	// 由名字的立方体顶点构建体素网格，每个立方体边长为1
+	m_NameGrid.BuildFromCubeVertices(&vertices->pos, sizeof(VertexPosColor), name->GetVerticesCount(), 1.0f);
+	// 名字网格的包围球用于生成每个实例的包围球
+	XMFLOAT3 minPoint, maxPoint, localCenter;
+	m_NameGrid.GetBounds(minPoint, maxPoint);
+	XMStoreFloat3(&localCenter, (XMLoadFloat3(&minPoint) + XMLoadFloat3(&maxPoint)) * 0.5f);
+	m_Forest.SetLocalBounds(localCenter, XMVectorGetX(XMVector3Length(XMLoadFloat3(&maxPoint) - XMLoadFloat3(&minPoint))) * 0.5f);
+	m_Forest.Build(angle, &m_Jobs);
+	ForestInstances::BoundingSpheres envelope;
+	m_Forest.GetEnvelopeSpheres(envelope);
+	m_ForestBVH.Build(envelope, m_Forest.GetInstanceCount());
+
+	// ******************
+	// 每8x8棵树为一个区块，用最粗糙的LOD网格在后台生成代理网格，结果缓存在磁盘上
+	//
+	m_HLOD.Start(m_Forest, coarsestMesh, 8, 1.0f, "HLODCache.bin");
+	m_HLODVertexBuffers.resize(m_HLOD.GetTileCount());
+	m_HLODIndexBuffers.resize(m_HLOD.GetTileCount());
+	m_HLODIndexCounts.assign(m_HLOD.GetTileCount(), 0);
+	m_HLODTileFar.assign(m_HLOD.GetTileCount(), 0);
+
+	// ******************
+	// 用CPU从64个方向烘焙名字的冒名顶替图集，每个格子64x64
+	//
+	double bakeSeconds = m_Impostors.Bake(&vertices->pos, &vertices->color, sizeof(VertexPosColor), indices, name->GetIndexCount(),
+		localCenter, XMVectorGetX(XMVector3Length(XMLoadFloat3(&maxPoint) - XMLoadFloat3(&minPoint))) * 0.5f, 64, 64, &m_Jobs);
+	D3D11_TEXTURE2D_DESC texDesc;
+	ZeroMemory(&texDesc, sizeof(texDesc));
+	texDesc.Width = m_Impostors.GetWidth();
+	texDesc.Height = m_Impostors.GetHeight();
+	texDesc.MipLevels = 1;
+	texDesc.ArraySize = 1;
+	texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	D3D11_SUBRESOURCE_DATA texData;
+	ZeroMemory(&texData, sizeof(texData));
+	texData.pSysMem = m_Impostors.GetColor().data();
+	texData.SysMemPitch = m_Impostors.GetWidth() * sizeof(uint32_t);
+	ComPtr<ID3D11Texture2D> pTexture;
+	HR(m_pd3dDevice->CreateTexture2D(&texDesc, &texData, pTexture.GetAddressOf()));
+	HR(m_pd3dDevice->CreateShaderResourceView(pTexture.Get(), nullptr, m_pImpostorColorSRV.GetAddressOf()));
+	texDesc.Format = DXGI_FORMAT_R16_UNORM;
+	texData.pSysMem = m_Impostors.GetDepth().data();
+	texData.SysMemPitch = m_Impostors.GetWidth() * sizeof(uint16_t);
+	HR(m_pd3dDevice->CreateTexture2D(&texDesc, &texData, pTexture.ReleaseAndGetAddressOf()));
+	HR(m_pd3dDevice->CreateShaderResourceView(pTexture.Get(), nullptr, m_pImpostorDepthSRV.GetAddressOf()));
+
+	D3D11_SAMPLER_DESC sampDesc;
+	ZeroMemory(&sampDesc, sizeof(sampDesc));
+	sampDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
+	sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	sampDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+	sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	HR(m_pd3dDevice->CreateSamplerState(&sampDesc, m_pPointSampler.GetAddressOf()));
+
+	std::wostringstream outs;
+	outs.precision(4);
+	outs << L"冒名顶替图集: " << m_Impostors.GetViewCount() << L"个方向 " << m_Impostors.GetWidth() << L"x" << m_Impostors.GetHeight()
+		<< L" 烘焙 " << bakeSeconds * 1000.0 << L" ms";
+	m_StatusText = outs.str();
+
+	// ******************
+	// 设置实例缓冲区描述，实例数在ForestInstances构造时已确定，每帧整体更新
+	//
+	D3D11_BUFFER_DESC instbd;
+	ZeroMemory(&instbd, sizeof(instbd));
+	instbd.Usage = D3D11_USAGE_DYNAMIC;
+	instbd.ByteWidth = sizeof(ForestInstances::InstanceData) * m_Forest.GetInstanceCount();
+	instbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	instbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	// 新建实例缓冲区，不使用初始数据
+	HR(m_pd3dDevice->CreateBuffer(&instbd, nullptr, m_pInstancedBuffer.GetAddressOf()));
+	// 冒名顶替的实例缓冲区同样按全部实例分配
+	instbd.ByteWidth = sizeof(ImpostorInstance) * m_Forest.GetInstanceCount();
+	HR(m_pd3dDevice->CreateBuffer(&instbd, nullptr, m_pImpostorBuffer.GetAddressOf()));
+
 	// ******************
 	// 索引数组
 	//
-	WORD* indices = name->GetNameIndices(); // 通过对象获取索引、、、、、、、、、、、、、、、、、、、、、
 	// 设置索引缓冲区描述
 	D3D11_BUFFER_DESC ibd;
 	ZeroMemory(&ibd, sizeof(ibd));
 	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = (sizeof * indices) * name->GetIndexCount(); // 计算位宽、、、、、、、、、、、、、、、、、、、、、、、、、
+	ibd.ByteWidth = (UINT)(sizeof(WORD) * lodIndices.size()); // 计算位宽、、、、、、、、、、、、、、、、、、、、、、、、、
 	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
 	ibd.CPUAccessFlags = 0;
 	// 新建索引缓冲区
-	InitData.pSysMem = indices;
+	InitData.pSysMem = lodIndices.data();
 	HR(m_pd3dDevice->CreateBuffer(&ibd, &InitData, m_pIndexBuffer.GetAddressOf()));
 	// 输入装配阶段的索引缓冲区设置
 	m_pd3dImmediateContext->IASetIndexBuffer(m_pIndexBuffer.Get(), DXGI_FORMAT_R16_UINT, 0);
 
 
 	// ******************
-	// 设置常量缓冲区描述
-	//
-	D3D11_BUFFER_DESC cbd;
-	ZeroMemory(&cbd, sizeof(cbd));
-	cbd.Usage = D3D11_USAGE_DYNAMIC;
-	cbd.ByteWidth = sizeof(ConstantBuffer);
-	cbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	cbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 	// 新建常量缓冲区，不使用初始数据
-	HR(m_pd3dDevice->CreateBuffer(&cbd, nullptr, m_pConstantBuffer.GetAddressOf()));
+	//
+	HR(m_CBPerObject.Create(m_pd3dDevice.Get()));
+	HR(m_CBPerFrame.Create(m_pd3dDevice.Get()));
 
 	// 初始化常量缓冲区的值
-	m_CBuffer.world = XMMatrixIdentity();	// 单位矩阵的转置是它本身
-	m_CBuffer.view = XMMatrixTranspose(XMMatrixTranslation(-viewPos.x, -viewPos.y, -viewPos.z) * XMMatrixRotationY(-viewRot.y) * XMMatrixRotationZ(-viewRot.z) * XMMatrixRotationX(-viewRot.x));
-	m_CBuffer.proj = XMMatrixTranspose(XMMatrixPerspectiveFovLH(XM_PIDIV2, AspectRatio(), 1.0f, 1000.0f));
+	m_CBPerObject.data.world = XMMatrixIdentity();	// 单位矩阵的转置是它本身
+	// 观察和投影矩阵在第一次绘制时由摄像机写入
+	m_Camera.SetLens(XM_PIDIV2, AspectRatio(), 1.0f, 1000.0f);
+	m_Camera.SetFirstPerson(XMFLOAT3(0.0f, 60.0f, -100.0f), XMFLOAT3(0.7f, 0.0f, 0.0f));
+
+	// 常量缓冲区偏移绑定需要D3D11.1，且驱动支持ConstantBufferOffsetting
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	m_CBRingSupported = m_pd3dImmediateContext1 != nullptr &&
+		SUCCEEDED(m_pd3dDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) &&
+		options.ConstantBufferOffsetting;
+	if (m_CBRingSupported)
+	{
+		// 每个物体占256字节，一次Map最多容纳4096个物体
+		m_CBRing.SetCapacity(4096 * CBufferRing::kAlignment);
+		D3D11_BUFFER_DESC cbd;
+		ZeroMemory(&cbd, sizeof(cbd));
+		cbd.Usage = D3D11_USAGE_DYNAMIC;
+		cbd.ByteWidth = m_CBRing.GetCapacity();
+		cbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		cbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		HR(m_pd3dDevice->CreateBuffer(&cbd, nullptr, m_pCBRingBuffer.GetAddressOf()));
+		m_CBRingOffsets.reserve(4096);
+	}
 
 
 	// ******************
@@ -231,8 +932,9 @@ bool GameApp::InitResource()
 	m_pd3dImmediateContext->IASetInputLayout(m_pVertexLayout.Get());
 	// 将着色器绑定到渲染管线
 	m_pd3dImmediateContext->VSSetShader(m_pVertexShader.Get(), nullptr, 0);
-	// 将更新好的常量缓冲区绑定到顶点着色器
-	m_pd3dImmediateContext->VSSetConstantBuffers(0, 1, m_pConstantBuffer.GetAddressOf());
+	// 将常量缓冲区绑定到顶点着色器，b0为每个物体的，b1为每帧的
+	m_pd3dImmediateContext->VSSetConstantBuffers(0, 1, m_CBPerObject.GetAddressOf());
+	m_pd3dImmediateContext->VSSetConstantBuffers(1, 1, m_CBPerFrame.GetAddressOf());
 
 	m_pd3dImmediateContext->PSSetShader(m_pPixelShader.Get(), nullptr, 0);
 
@@ -242,9 +944,20 @@ bool GameApp::InitResource()
 	D3D11SetDebugObjectName(m_pVertexLayout.Get(), "VertexPosColorLayout");
 	D3D11SetDebugObjectName(m_pVertexBuffer.Get(), "VertexBuffer");
 	D3D11SetDebugObjectName(m_pIndexBuffer.Get(), "IndexBuffer");
-	D3D11SetDebugObjectName(m_pConstantBuffer.Get(), "ConstantBuffer");
+	D3D11SetDebugObjectName(m_CBPerObject.Get(), "CBPerObject");
+	D3D11SetDebugObjectName(m_CBPerFrame.Get(), "CBPerFrame");
+	if (m_pCBRingBuffer)
+		D3D11SetDebugObjectName(m_pCBRingBuffer.Get(), "CBRingBuffer");
+	D3D11SetDebugObjectName(m_pInstancedLayout.Get(), "InstancedLayout");
+	D3D11SetDebugObjectName(m_pInstancedBuffer.Get(), "InstancedBuffer");
 	D3D11SetDebugObjectName(m_pVertexShader.Get(), "Cube_VS");
+	D3D11SetDebugObjectName(m_pInstancedVertexShader.Get(), "Cube_Instance_VS");
 	D3D11SetDebugObjectName(m_pPixelShader.Get(), "Cube_PS");
+	D3D11SetDebugObjectName(m_pImpostorVS.Get(), "Impostor_VS");
+	D3D11SetDebugObjectName(m_pImpostorPS.Get(), "Impostor_PS");
+	D3D11SetDebugObjectName(m_pImpostorLayout.Get(), "ImpostorLayout");
+	D3D11SetDebugObjectName(m_pImpostorBuffer.Get(), "ImpostorBuffer");
+	D3D11SetDebugObjectName(m_pPointSampler.Get(), "PointSampler");
 
 	return true;
 }
@@ -2,6 +2,21 @@
 #define GAMEAPP_H
 
 #include "d3dApp.h"
+#include "VoxelGrid.h"
+#include "ForestInstances.h"
+#include "InstancedDraw.h"
+#include "JobSystem.h"
+#include "FrustumCulling.h"
+#include "ForestBVH.h"
+#include "OcclusionCulling.h"
+#include "ConstantBuffers.h"
+#include "ForestConstants.h"
+#include "CBufferRing.h"
+#include "CBufferRingDraw.h"
+#include "ForestLOD.h"
+#include "ImpostorAtlas.h"
+#include "ForestHLOD.h"
+#include "Camera.h"
 
 class NameVertices;// 声明类， 避免头文件与类之间的相互依赖、、、、、、、、、、、、、、、、、、、、、、、、
 
@@ -13,13 +28,26 @@ public:
 		DirectX::XMFLOAT3 pos;
 		DirectX::XMFLOAT4 color;
 		static const D3D11_INPUT_ELEMENT_DESC inputLayout[2];
+		static const D3D11_INPUT_ELEMENT_DESC instancedLayout[6];	// 槽1为逐实例的世界矩阵
 	};
 
-	struct ConstantBuffer
+	// 冒名顶替四边形的逐实例数据
+	struct ImpostorInstance
 	{
-		DirectX::XMMATRIX world;
-		DirectX::XMMATRIX view;
-		DirectX::XMMATRIX proj;
+		DirectX::XMFLOAT3 center;
+		float halfSize;
+		DirectX::XMFLOAT3 right;
+		DirectX::XMFLOAT3 up;
+		DirectX::XMFLOAT4 uvRect;
+		static const D3D11_INPUT_ELEMENT_DESC inputLayout[5];
+	};
+
+	// 一级LOD网格在合并后的顶点/索引缓冲区中的位置
+	struct LodDraw
+	{
+		UINT indexCount;
+		UINT startIndex;
+		INT baseVertex;
 	};
 
 public:
@@ -35,24 +63,92 @@ public:
 private:
 	bool InitEffect();
 	bool InitResource();
-	void DrawName();
+	void DrawName(uint32_t level = 0);		// 用第level级LOD网格绘制一个名字
+	void SetInstancedPipeline();			// 绑定顶点、实例缓冲区和实例化着色器
+	// 绘制pIndices中的count个实例，pIndices为空则绘制前count个
+	void DrawForestInstanced(const uint32_t* pIndices, uint32_t count);	// 实例写入实例缓冲区，一次DrawIndexedInstanced
+	void DrawForestInstancedLOD();		// 按m_ForestLOD的分组写入实例缓冲区，每一级一次DrawIndexedInstanced
+	void DrawForestPerObject(const uint32_t* pIndices, uint32_t count, uint32_t level = 0);	// 逐个更新常量缓冲区并绘制
+	void DrawForestPerObjectRing(const uint32_t* pIndices, uint32_t count, uint32_t level = 0);	// 常量一次写入环形缓冲区，按偏移绑定后逐个绘制
+	void SplitImpostors(const uint32_t* pIndices, uint32_t count);	// 按切换距离把实例分为网格和冒名顶替两组
+	void DrawImpostors();					// 远处的实例绘制为朝向摄像机的四边形
+	void UpdateHLODBuffers();				// 为后台新生成的HLOD代理网格创建缓冲区
+	void SplitHLODTiles(const uint32_t* pIndices, uint32_t count);	// 去掉整块改用代理网格的区块中的实例
+	void DrawHLODProxies(const FrustumPlanes* pFrustum);	// 绘制远处区块的代理网格，pFrustum为空则不剔除
+	void UpdateCaption();					// 窗口标题显示可见/剔除数和最近的提示信息
+	void PickName(int mouseX, int mouseY);	// 用鼠标位置发出射线，拾取名字中的格子
+	void RenderNamePreview();				// 用CPU光线投射渲染名字预览并保存为位图
+	void RunForestBenchmark();				// 测量不同网格大小和线程数下生成实例的耗时并保存
 
 
 private:
 	ComPtr<ID3D11InputLayout> m_pVertexLayout;	    // 顶点输入布局
-	ComPtr<ID3D11Buffer> m_pVertexBuffer;			// 顶点缓冲区
-	ComPtr<ID3D11Buffer> m_pIndexBuffer;			// 索引缓冲区
-	ComPtr<ID3D11Buffer> m_pConstantBuffer;		    // 常量缓冲区
+	ComPtr<ID3D11Buffer> m_pVertexBuffer;			// 顶点缓冲区，依次存放各级LOD网格
+	ComPtr<ID3D11Buffer> m_pIndexBuffer;			// 索引缓冲区，依次存放各级LOD网格
+	std::vector<LodDraw> m_LodDraws;				// 各级LOD网格的绘制参数，第0级为原网格
+	ComPtr<ID3D11InputLayout> m_pInstancedLayout;	// 实例化输入布局
+	ComPtr<ID3D11Buffer> m_pInstancedBuffer;		// 实例缓冲区
+	std::vector<InstanceGroup> m_InstanceGroups;	// 实例化绘制时各级LOD的实例
 
 	ComPtr<ID3D11VertexShader> m_pVertexShader;	    // 顶点着色器
+	ComPtr<ID3D11VertexShader> m_pInstancedVertexShader;	// 实例化顶点着色器
 	ComPtr<ID3D11PixelShader> m_pPixelShader;		// 像素着色器
-	ConstantBuffer m_CBuffer;	                    // 用于修改GPU常量缓冲区的变量
+	ComPtr<ID3D11VertexShader> m_pImpostorVS;		// 冒名顶替顶点着色器
+	ComPtr<ID3D11PixelShader> m_pImpostorPS;		// 冒名顶替像素着色器
+	ComPtr<ID3D11InputLayout> m_pImpostorLayout;	// 冒名顶替输入布局，只有逐实例数据
+	ComPtr<ID3D11Buffer> m_pImpostorBuffer;			// 冒名顶替实例缓冲区
+	ComPtr<ID3D11ShaderResourceView> m_pImpostorColorSRV;	// 图集颜色
+	ComPtr<ID3D11ShaderResourceView> m_pImpostorDepthSRV;	// 图集深度
+	ComPtr<ID3D11SamplerState> m_pPointSampler;		// 点采样，避免深度在轮廓处被混合
+	CBufferObject<CBPerObject> m_CBPerObject;		// 每个物体更新的常量缓冲区
+	CBufferObject<CBPerFrame> m_CBPerFrame;			// 每帧更新一次的常量缓冲区
+	ComPtr<ID3D11Buffer> m_pCBRingBuffer;			// 逐物体常量的环形缓冲区，需要D3D11.1的偏移绑定
+	CBufferRing m_CBRing;							// 环形缓冲区的分配器
+	std::vector<uint32_t> m_CBRingOffsets;			// 这一批绘制在环形缓冲区中的偏移
+	bool m_CBRingSupported;							// 设备是否支持常量缓冲区偏移绑定
+	bool m_UseCBRing;								// 逐个绘制时是否使用环形缓冲区
 
 	NameVertices* name;// 存储绘制名字的顶点、类型、、、、、、、、、、、、、、、、、、、、、、
 	int nameN;
 	float angle;
-	DirectX::XMFLOAT3 viewPos;
-	DirectX::XMFLOAT3 viewRot;
+	bool m_Paused;									// 暂停时角度不变，森林不需要更新
+	Camera m_Camera;								// 自由飞行的第一人称摄像机
+
+	ForestInstances m_Forest;						// 每帧所有树及子物体的世界矩阵，也用于拾取
+	JobSystem m_Jobs;								// 并行生成实例的任务系统
+	bool m_UseInstancing;							// 是否使用硬件实例化绘制
+	FrustumCuller m_Culler;							// 视锥体剔除
+	bool m_UseCulling;								// 是否进行视锥体剔除
+	ForestBVH m_ForestBVH;							// 实例包围球上的BVH，用于层次剔除和拾取
+	bool m_UseBVH;									// 剔除时是否使用BVH
+	std::vector<uint32_t> m_BVHResult;				// BVH查询结果
+	OcclusionCuller m_Occlusion;					// 用近处的树在CPU上做遮挡剔除
+	bool m_UseOcclusion;							// 是否进行遮挡剔除
+	ForestLOD m_ForestLOD;							// 按投影大小为每个实例选择LOD
+	bool m_UseLOD;									// 是否使用LOD
+	bool m_DropChildren;							// 是否丢弃过小的子物体
+	ImpostorAtlas m_Impostors;						// 名字从各个方向预先渲染的图集
+	bool m_UseImpostors;							// 远处是否使用冒名顶替
+	float m_ImpostorDistance;						// 超过该距离改用冒名顶替
+	std::vector<uint32_t> m_NearIndices;			// 这一帧绘制网格的实例
+	std::vector<uint32_t> m_ImpostorIndices;		// 这一帧绘制冒名顶替的实例
+	ForestHLOD m_HLOD;								// 按区块合并的代理网格，在后台线程中生成
+	bool m_UseHLOD;									// 远处区块是否使用代理网格
+	float m_HLODDistance;							// 区块整体超过该距离改用代理网格
+	bool m_HLODReported;							// 是否已提示过代理网格生成完毕
+	std::vector<ComPtr<ID3D11Buffer>> m_HLODVertexBuffers;	// 每个区块代理网格的顶点缓冲区
+	std::vector<ComPtr<ID3D11Buffer>> m_HLODIndexBuffers;	// 每个区块代理网格的索引缓冲区
+	std::vector<UINT> m_HLODIndexCounts;			// 每个区块代理网格的索引数，未就绪时为0
+	std::vector<uint8_t> m_HLODTileFar;				// 这一帧区块是否改用代理网格
+	std::vector<uint32_t> m_HLODIndices;			// 这一帧去掉远处区块后剩下的实例
+	std::vector<uint32_t> m_HLODNewTiles;			// 这一帧新生成的区块
+	uint32_t m_HLODDrawnTiles;						// 这一帧绘制的代理网格数
+	uint32_t m_VisibleCount;						// 这一帧提交的实例数
+	uint32_t m_CulledCount;							// 这一帧剔除的实例数
+	uint64_t m_CBUploadBytes;						// 这一帧上传到常量缓冲区的字节数
+	std::wstring m_StatusText;						// 最近一次操作的提示信息
+
+	VoxelGrid m_NameGrid;							// 名字的体素占用网格，用于CPU拾取和预览
 };
 
 
@@ -1,9 +1,14 @@
 
-cbuffer ConstantBuffer : register(b0)
+// Ƶʲ֣ÿλֻϴg_World
+cbuffer CBPerObject : register(b0)
 {
     matrix g_World; // matrixfloat4x4row_major£ĬΪ
-    matrix g_View;  // ǰrow_majorʾ
-    matrix g_Proj;  // ý̳ʹĬϵ󣬵ҪC++ԤȽתá
+}                   // ǰrow_majorʾ
+
+cbuffer CBPerFrame : register(b1)
+{
+    matrix g_View;  // ý̳ʹĬϵ󣬵ҪC++ԤȽתá
+    matrix g_Proj;
 }
 
 
@@ -13,8 +18,33 @@ struct VertexIn
 	float4 color : COLOR;
 };
 
+struct InstanceIn
+{
+	float3 posL : POSITION;
+	float4 color : COLOR;
+	matrix world : World;  // ʵ(C++ת)
+};
+
 struct VertexOut
 {
 	float4 posH : SV_POSITION;
 	float4 color : COLOR;
 };
+
+// ðıεʵݣıεĽǵSV_VertexID
+struct ImpostorIn
+{
+	float3 center : CENTER;     // Χ(ռ)
+	float halfSize : HALFSIZE;  // ıΰ߳ڰΧ뾶
+	float3 right : RIGHT;       // ıεҷϷߴֱ
+	float3 up : UP;
+	float4 uvRect : UVRECT;     // øͼеϽǺʹС
+};
+
+struct ImpostorOut
+{
+	float4 posH : SV_POSITION;
+	float2 tex : TEXCOORD;
+	float viewZ : VIEWZ;                        // ıϸõĹ۲ռ
+	nointerpolation float halfSize : HALFSIZE;
+};
@@ -0,0 +1,16 @@
+#include "Cube.hlsli"
+
+Texture2D g_ImpostorColor : register(t0);
+Texture2D g_ImpostorDepth : register(t1);
+SamplerState g_Sam : register(s0);
+
+// ðɫͼ0~1ӦΧǰˣ
+// ݴдÿصȣʹı븽ȷ໥ڵ
+float4 PS(ImpostorOut pIn, out float depth : SV_Depth) : SV_Target
+{
+    float4 color = g_ImpostorColor.Sample(g_Sam, pIn.tex);
+    clip(color.a - 0.5f);
+    float viewZ = pIn.viewZ + (g_ImpostorDepth.Sample(g_Sam, pIn.tex).r * 2.0f - 1.0f) * pIn.halfSize;
+    depth = g_Proj[2][2] + g_Proj[3][2] / viewZ;
+    return color;
+}
@@ -0,0 +1,15 @@
+#include "Cube.hlsli"
+
+// ʹö㻺δ4Ϊϡϡ¡
+ImpostorOut VS(ImpostorIn vIn, uint vertexID : SV_VertexID)
+{
+    ImpostorOut vOut;
+    float2 corner = float2((vertexID & 1) ? 1.0f : -1.0f, (vertexID & 2) ? -1.0f : 1.0f);
+    float3 posW = vIn.center + (corner.x * vIn.right + corner.y * vIn.up) * vIn.halfSize;
+    float4 posV = mul(float4(posW, 1.0f), g_View);
+    vOut.posH = mul(posV, g_Proj);
+    vOut.tex = vIn.uvRect.xy + float2(corner.x * 0.5f + 0.5f, 0.5f - corner.y * 0.5f) * vIn.uvRect.zw;
+    vOut.viewZ = posV.z;
+    vOut.halfSize = vIn.halfSize;
+    return vOut;
+}
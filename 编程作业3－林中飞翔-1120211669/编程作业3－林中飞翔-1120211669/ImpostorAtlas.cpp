@@ -0,0 +1,238 @@
+#include "ImpostorAtlas.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// 投影到格子中的顶点，x、y为像素坐标，z为[0, 1]的深度
+	struct RasterVertex
+	{
+		float x, y, z;
+		float r, g, b, a;
+	};
+
+	inline uint32_t PackColor(const XMFLOAT4& c)
+	{
+		auto toByte = [](float v) { return (uint32_t)(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f); };
+		return toByte(c.x) | (toByte(c.y) << 8) | (toByte(c.z) << 16) | (toByte(c.w) << 24);
+	}
+
+	inline float EdgeFunction(const RasterVertex& a, const RasterVertex& b, float px, float py)
+	{
+		return (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+	}
+}
+
+ImpostorAtlas::ImpostorAtlas()
+	: m_Center(0.0f, 0.0f, 0.0f),
+	m_Radius(1.0f),
+	m_FrameSize(0),
+	m_Columns(0),
+	m_Rows(0)
+{
+}
+
+double ImpostorAtlas::Bake(const XMFLOAT3* pPositions, const XMFLOAT4* pColors, uint32_t stride,
+	const uint16_t* pIndices, uint32_t indexCount, const XMFLOAT3& center, float radius,
+	uint32_t viewCount, uint32_t frameSize, JobSystem* jobs)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	m_Center = center;
+	m_Radius = radius;
+	m_FrameSize = frameSize;
+	m_Columns = (uint32_t)std::ceil(std::sqrt((double)viewCount));
+	m_Rows = (viewCount + m_Columns - 1) / m_Columns;
+	m_Color.assign((size_t)GetWidth() * GetHeight(), 0);
+	m_Depth.assign((size_t)GetWidth() * GetHeight(), 0xffff);
+
+	// 观察方向按黄金角螺旋分布在球面上，每个方向的基与XMMatrixLookAtLH的相同
+	m_ViewDirs.resize(viewCount);
+	m_ViewRights.resize(viewCount);
+	m_ViewUps.resize(viewCount);
+	const float goldenAngle = 2.39996323f;
+	for (uint32_t i = 0; i < viewCount; ++i)
+	{
+		float y = 1.0f - (i + 0.5f) * 2.0f / viewCount;
+		float r = std::sqrt(std::max(0.0f, 1.0f - y * y));
+		float phi = i * goldenAngle;
+		XMVECTOR dir = XMVectorSet(std::cos(phi) * r, y, std::sin(phi) * r, 0.0f);
+		XMVECTOR forward = -dir;
+		XMVECTOR worldUp = std::fabs(y) > 0.99f ? XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+		XMVECTOR right = XMVector3Normalize(XMVector3Cross(worldUp, forward));
+		XMStoreFloat3(&m_ViewDirs[i], dir);
+		XMStoreFloat3(&m_ViewRights[i], right);
+		XMStoreFloat3(&m_ViewUps[i], XMVector3Cross(forward, right));
+	}
+
+	// 所有方向共用一份顶点数据，颜色预先打包
+	uint32_t vertexCount = 0;
+	for (uint32_t i = 0; i < indexCount; ++i)
+		vertexCount = std::max(vertexCount, (uint32_t)pIndices[i] + 1);
+	const char* pPosBytes = reinterpret_cast<const char*>(pPositions);
+	const char* pColorBytes = reinterpret_cast<const char*>(pColors);
+	std::vector<XMFLOAT3> positions(vertexCount);
+	std::vector<uint32_t> colors(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; ++i)
+	{
+		positions[i] = *reinterpret_cast<const XMFLOAT3*>(pPosBytes + (size_t)i * stride);
+		colors[i] = PackColor(*reinterpret_cast<const XMFLOAT4*>(pColorBytes + (size_t)i * stride));
+	}
+
+	// 每个方向写入图集中互不重叠的格子，可以直接并行
+	auto bakeRange = [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t view = begin; view < end; ++view)
+			BakeView(view, positions, colors, pIndices, indexCount);
+	};
+	if (jobs)
+		jobs->ParallelFor(viewCount, 1, bakeRange);
+	else
+		bakeRange(0, viewCount);
+
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ImpostorAtlas::BakeView(uint32_t view, const std::vector<XMFLOAT3>& positions,
+	const std::vector<uint32_t>& colors, const uint16_t* pIndices, uint32_t indexCount)
+{
+	XMVECTOR center = XMLoadFloat3(&m_Center);
+	XMVECTOR right = XMLoadFloat3(&m_ViewRights[view]);
+	XMVECTOR up = XMLoadFloat3(&m_ViewUps[view]);
+	XMVECTOR forward = -XMLoadFloat3(&m_ViewDirs[view]);
+	float size = (float)m_FrameSize;
+	float invRadius = 1.0f / m_Radius;
+
+	// 正交投影：包围球的直径对应整个格子
+	std::vector<RasterVertex> projected(positions.size());
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		XMVECTOR rel = XMLoadFloat3(&positions[i]) - center;
+		float x = XMVectorGetX(XMVector3Dot(rel, right)) * invRadius;
+		float y = XMVectorGetX(XMVector3Dot(rel, up)) * invRadius;
+		float z = XMVectorGetX(XMVector3Dot(rel, forward)) * invRadius;
+		RasterVertex& v = projected[i];
+		v.x = (x * 0.5f + 0.5f) * size;
+		v.y = (0.5f - y * 0.5f) * size;
+		v.z = std::min(std::max(z * 0.5f + 0.5f, 0.0f), 1.0f);
+		v.r = (float)(colors[i] & 0xff);
+		v.g = (float)((colors[i] >> 8) & 0xff);
+		v.b = (float)((colors[i] >> 16) & 0xff);
+		v.a = (float)(colors[i] >> 24);
+	}
+
+	uint32_t width = GetWidth();
+	uint32_t originX = (view % m_Columns) * m_FrameSize;
+	uint32_t originY = (view / m_Columns) * m_FrameSize;
+	for (uint32_t t = 0; t + 2 < indexCount; t += 3)
+	{
+		const RasterVertex& v0 = projected[pIndices[t]];
+		const RasterVertex& v1 = projected[pIndices[t + 1]];
+		const RasterVertex& v2 = projected[pIndices[t + 2]];
+		// 正交投影下正反面都可能可见，不做背面剔除，统一按正面积处理
+		float area = EdgeFunction(v0, v1, v2.x, v2.y);
+		if (std::fabs(area) < 1e-8f)
+			continue;
+		float sign = area > 0.0f ? 1.0f : -1.0f;
+		float invArea = 1.0f / std::fabs(area);
+
+		int minX = std::max(0, (int)std::floor(std::min({ v0.x, v1.x, v2.x })));
+		int minY = std::max(0, (int)std::floor(std::min({ v0.y, v1.y, v2.y })));
+		int maxX = std::min((int)m_FrameSize - 1, (int)std::ceil(std::max({ v0.x, v1.x, v2.x })));
+		int maxY = std::min((int)m_FrameSize - 1, (int)std::ceil(std::max({ v0.y, v1.y, v2.y })));
+		for (int py = minY; py <= maxY; ++py)
+		{
+			float sy = py + 0.5f;
+			for (int px = minX; px <= maxX; ++px)
+			{
+				float sx = px + 0.5f;
+				// 用像素中心的重心坐标判断覆盖并插值深度和颜色
+				float w0 = EdgeFunction(v1, v2, sx, sy) * sign;
+				float w1 = EdgeFunction(v2, v0, sx, sy) * sign;
+				float w2 = EdgeFunction(v0, v1, sx, sy) * sign;
+				if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+					continue;
+				w0 *= invArea;
+				w1 *= invArea;
+				w2 *= invArea;
+
+				size_t index = (size_t)(originY + py) * width + originX + px;
+				uint16_t depth = (uint16_t)((w0 * v0.z + w1 * v1.z + w2 * v2.z) * 65534.0f + 0.5f);
+				if (depth >= m_Depth[index])
+					continue;
+				m_Depth[index] = depth;
+				auto channel = [&](float c0, float c1, float c2) { return (uint32_t)(w0 * c0 + w1 * c1 + w2 * c2 + 0.5f); };
+				m_Color[index] = channel(v0.r, v1.r, v2.r) | (channel(v0.g, v1.g, v2.g) << 8) |
+					(channel(v0.b, v1.b, v2.b) << 16) | (channel(v0.a, v1.a, v2.a) << 24);
+			}
+		}
+	}
+}
+
+uint32_t XM_CALLCONV ImpostorAtlas::FindNearestView(FXMVECTOR localDir) const
+{
+	uint32_t best = 0;
+	float bestDot = -2.0f;
+	XMVECTOR dir = XMVector3Normalize(localDir);
+	for (uint32_t i = 0; i < (uint32_t)m_ViewDirs.size(); ++i)
+	{
+		float d = XMVectorGetX(XMVector3Dot(dir, XMLoadFloat3(&m_ViewDirs[i])));
+		if (d > bestDot)
+		{
+			bestDot = d;
+			best = i;
+		}
+	}
+	return best;
+}
+
+void ImpostorAtlas::GetViewBasis(uint32_t view, XMFLOAT3& right, XMFLOAT3& up) const
+{
+	right = m_ViewRights[view];
+	up = m_ViewUps[view];
+}
+
+XMFLOAT4 ImpostorAtlas::GetFrameUV(uint32_t view) const
+{
+	float invWidth = 1.0f / GetWidth();
+	float invHeight = 1.0f / GetHeight();
+	return XMFLOAT4(
+		(view % m_Columns) * m_FrameSize * invWidth,
+		(view / m_Columns) * m_FrameSize * invHeight,
+		m_FrameSize * invWidth,
+		m_FrameSize * invHeight);
+}
+
+uint32_t ImpostorAtlas::GetViewCount() const
+{
+	return (uint32_t)m_ViewDirs.size();
+}
+
+uint32_t ImpostorAtlas::GetFrameSize() const
+{
+	return m_FrameSize;
+}
+
+uint32_t ImpostorAtlas::GetWidth() const
+{
+	return m_Columns * m_FrameSize;
+}
+
+uint32_t ImpostorAtlas::GetHeight() const
+{
+	return m_Rows * m_FrameSize;
+}
+
+const std::vector<uint32_t>& ImpostorAtlas::GetColor() const
+{
+	return m_Color;
+}
+
+const std::vector<uint16_t>& ImpostorAtlas::GetDepth() const
+{
+	return m_Depth;
+}
@@ -0,0 +1,62 @@
+#ifndef IMPOSTORATLAS_H
+#define IMPOSTORATLAS_H
+
+#include <vector>
+#include <cstdint>
+#include "PortableMath.h"
+
+class JobSystem;
+
+// 冒名顶替(impostor)图集。用CPU光栅化把网格从多个方向正交投影到图集的各个格子中，
+// 每个格子保存颜色(RGBA8)和深度(16位，0为离观察者最近)。
+// 远处的实例改为绘制一个朝向摄像机的四边形，采样与视线方向最接近的格子
+class ImpostorAtlas
+{
+public:
+	ImpostorAtlas();
+
+	// 烘焙图集，各个方向可以并行光栅化
+	// [In]pPositions/pColors	顶点位置和颜色，步长均为stride
+	// [In]pIndices				三角形列表的索引
+	// [In]center/radius		网格的包围球，四边形的半边长等于半径
+	// [In]viewCount			观察方向数，方向在整个球面上均匀分布
+	// [In]frameSize			每个格子的边长(像素)
+	// [In]jobs					为空则在调用线程中烘焙
+	// 返回烘焙耗时(秒)
+	double Bake(const DirectX::XMFLOAT3* pPositions, const DirectX::XMFLOAT4* pColors, uint32_t stride,
+		const uint16_t* pIndices, uint32_t indexCount, const DirectX::XMFLOAT3& center, float radius,
+		uint32_t viewCount, uint32_t frameSize, JobSystem* jobs = nullptr);
+
+	// 局部空间中从网格中心指向观察者的方向所对应的最接近的格子
+	uint32_t XM_CALLCONV FindNearestView(DirectX::FXMVECTOR localDir) const;
+	// 第view个格子烘焙时的右方向和上方向(局部空间)
+	void GetViewBasis(uint32_t view, DirectX::XMFLOAT3& right, DirectX::XMFLOAT3& up) const;
+	// 第view个格子在图集中的纹理坐标，(x, y)为左上角，(z, w)为大小
+	DirectX::XMFLOAT4 GetFrameUV(uint32_t view) const;
+
+	uint32_t GetViewCount() const;
+	uint32_t GetFrameSize() const;
+	uint32_t GetWidth() const;
+	uint32_t GetHeight() const;
+	const std::vector<uint32_t>& GetColor() const;	// 按行存放的RGBA8，与DXGI_FORMAT_R8G8B8A8_UNORM一致
+	const std::vector<uint16_t>& GetDepth() const;	// 按行存放，与DXGI_FORMAT_R16_UNORM一致
+
+private:
+	// 光栅化第view个方向
+	void BakeView(uint32_t view, const std::vector<DirectX::XMFLOAT3>& positions,
+		const std::vector<uint32_t>& colors, const uint16_t* pIndices, uint32_t indexCount);
+
+private:
+	std::vector<DirectX::XMFLOAT3> m_ViewDirs;		// 从中心指向观察者的方向
+	std::vector<DirectX::XMFLOAT3> m_ViewRights;
+	std::vector<DirectX::XMFLOAT3> m_ViewUps;
+	DirectX::XMFLOAT3 m_Center;
+	float m_Radius;
+	uint32_t m_FrameSize;
+	uint32_t m_Columns;								// 图集每行的格子数
+	uint32_t m_Rows;
+	std::vector<uint32_t> m_Color;
+	std::vector<uint16_t> m_Depth;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef INSTANCEDDRAW_H
+#define INSTANCEDDRAW_H
+
+#ifdef _WIN32
+#include <d3d11_1.h>
+#else
+#include "PlatformTypes.h"
+#endif
+#include <cstdint>
+#include <cstring>
+
+// 实例化绘制中使用同一个网格的一组实例
+struct InstanceGroup
+{
+	const uint32_t* pIndices;	// 实例在源数组中的下标，为空时为源数组的前count个
+	uint32_t count;
+	UINT indexCount;			// 以下与DrawIndexedInstanced的参数相同
+	UINT startIndex;
+	INT baseVertex;
+};
+
+// 把各组实例依次写入实例缓冲区(整个缓冲区只Map一次)，再每组调用一次DrawIndexedInstanced，
+// 用StartInstanceLocation区分各组在缓冲区中的位置。空的组不绘制，全部为空时也不Map。
+// 上下文为模板参数，只要求提供与ID3D11DeviceContext签名相同的Map/Unmap/DrawIndexedInstanced，
+// 因此可以在Linux上用记录调用的替身上下文测试。输入布局、着色器和顶点缓冲区由调用方事先设置
+template<class Context, class Buffer, class T>
+HRESULT DrawInstanceGroups(Context* pContext, Buffer* pInstanceBuffer, const T* pSource,
+	const InstanceGroup* pGroups, uint32_t groupCount)
+{
+	uint32_t total = 0;
+	for (uint32_t g = 0; g < groupCount; ++g)
+		total += pGroups[g].count;
+	if (total == 0)
+		return S_OK;
+
+	D3D11_MAPPED_SUBRESOURCE mappedData;
+	HRESULT hr = pContext->Map(pInstanceBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
+	if (FAILED(hr))
+		return hr;
+	T* pDest = static_cast<T*>(mappedData.pData);
+	for (uint32_t g = 0; g < groupCount; ++g)
+	{
+		const InstanceGroup& group = pGroups[g];
+		if (group.pIndices)
+		{
+			for (uint32_t k = 0; k < group.count; ++k)
+				*pDest++ = pSource[group.pIndices[k]];
+		}
+		else
+		{
+			memcpy(pDest, pSource, sizeof(T) * group.count);
+			pDest += group.count;
+		}
+	}
+	pContext->Unmap(pInstanceBuffer, 0);
+
+	UINT startInstance = 0;
+	for (uint32_t g = 0; g < groupCount; ++g)
+	{
+		const InstanceGroup& group = pGroups[g];
+		if (group.count == 0)
+			continue;
+		pContext->DrawIndexedInstanced(group.indexCount, group.count, group.startIndex, group.baseVertex, startInstance);
+		startInstance += group.count;
+	}
+	return S_OK;
+}
+
+#endif
@@ -0,0 +1,23 @@
+// AVX2后端。此文件需要单独以AVX2和FMA编译(MSVC为/arch:AVX2，GCC/Clang为-mavx2 -mfma)，
+// 运行前由MathBenchmark.cpp检查CPU是否支持
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+
+#define PMATH_FORCE_AVX2
+#include "PortableMath.h"
+
+#define MATHBENCH_ENTRY GetMathKernelsAVX2
+#include "MathBenchKernels.inl"
+
+#else
+
+#include "MathBenchmark.h"
+
+void GetMathKernelsAVX2(MathBenchBackend& backend)
+{
+	backend = MathBenchBackend();
+	backend.name = "AVX2";
+	backend.note = "not compiled with AVX2/FMA";
+	backend.available = false;
+}
+
+#endif
@@ -0,0 +1,101 @@
+// 各后端共用的测试代码，由MathBench*.cpp在选定后端并包含PortableMath.h之后包含，
+// 包含前需要定义MATHBENCH_ENTRY为入口函数的名字。
+// 这里只使用数学库和原始指针，不实例化标准库模板：AVX2的翻译单元使用不同的编译选项，
+// 其中实例化的内联函数可能被链接器选作整个程序的版本，在不支持AVX2的CPU上就会出错
+
+#include "MathBenchmark.h"
+
+namespace
+{
+	using namespace DirectX;
+
+	XMMATRIX XM_CALLCONV BenchViewProj()
+	{
+		XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 10.0f, -20.0f, 1.0f),
+			XMVectorSet(0.0f, 0.0f, 50.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		return view * XMMatrixPerspectiveFovLH(XM_PIDIV2, 16.0f / 9.0f, 0.5f, 500.0f);
+	}
+
+	void TransformCoordKernel(const float* pInput, uint32_t count, float* pOutput)
+	{
+		XMMATRIX viewProj = BenchViewProj();
+		for (uint32_t i = 0; i < count; ++i, pInput += MathBenchInputFloats, pOutput += 4)
+		{
+			// 点都在视点前方，w不会接近0
+			XMVECTOR p = XMVectorSet(pInput[0] * 50.0f, pInput[1] * 50.0f, pInput[2] * 50.0f + 80.0f, 1.0f);
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(pOutput), XMVector3TransformCoord(p, viewProj));
+		}
+	}
+
+	void MatrixChainKernel(const float* pInput, uint32_t count, float* pOutput)
+	{
+		XMMATRIX viewProj = BenchViewProj();
+		for (uint32_t i = 0; i < count; ++i, pInput += MathBenchInputFloats, pOutput += 16)
+		{
+			XMMATRIX world = XMMatrixScaling(1.0f + pInput[3], 1.0f + pInput[4], 1.0f + pInput[5]) *
+				XMMatrixRotationX(pInput[6] * XM_PI) * XMMatrixRotationY(pInput[7] * XM_PI) *
+				XMMatrixTranslation(pInput[8] * 100.0f, pInput[9] * 100.0f, pInput[10] * 100.0f);
+			XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(pOutput), XMMatrixTranspose(world * viewProj));
+		}
+	}
+
+	void NormalizeCrossKernel(const float* pInput, uint32_t count, float* pOutput)
+	{
+		for (uint32_t i = 0; i < count; ++i, pInput += MathBenchInputFloats, pOutput += 4)
+		{
+			XMVECTOR a = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(pInput));
+			XMVECTOR b = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(pInput + 3));
+			XMVECTOR c = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(pInput + 6));
+			XMVECTOR n = XMVector3Normalize(XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a)));
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(pOutput), n);
+		}
+	}
+
+	void PlaneCullKernel(const float* pInput, uint32_t count, float* pOutput)
+	{
+		// 与FrustumCulling相同的平面提取方法
+		XMMATRIX M = XMMatrixTranspose(BenchViewProj());
+		XMVECTOR planes[6] = {
+			XMVectorAdd(M.r[3], M.r[0]), XMVectorSubtract(M.r[3], M.r[0]),
+			XMVectorAdd(M.r[3], M.r[1]), XMVectorSubtract(M.r[3], M.r[1]),
+			M.r[2], XMVectorSubtract(M.r[3], M.r[2])
+		};
+		for (XMVECTOR& plane : planes)
+			plane = XMPlaneNormalize(plane);
+
+		for (uint32_t i = 0; i < count; ++i, pInput += MathBenchInputFloats, ++pOutput)
+		{
+			XMVECTOR center = XMVectorSet(pInput[0] * 100.0f, pInput[1] * 100.0f, pInput[2] * 100.0f + 100.0f, 1.0f);
+			XMVECTOR d = XMVector4Dot(planes[0], center);
+			for (int k = 1; k < 6; ++k)
+				d = XMVectorMin(d, XMVector4Dot(planes[k], center));
+			// 不小于0时包围球与视锥体相交
+			*pOutput = XMVectorGetX(d) + (pInput[3] + 1.0f) * 5.0f;
+		}
+	}
+
+	void SinCosKernel(const float* pInput, uint32_t count, float* pOutput)
+	{
+		// 角度在[-4pi, 4pi)内，需要先约化
+		XMVECTOR scale = XMVectorReplicate(2.0f * XM_2PI);
+		for (uint32_t i = 0; i < count; ++i, pInput += MathBenchInputFloats, pOutput += 8)
+		{
+			XMVECTOR s, c;
+			XMVectorSinCos(&s, &c, XMVectorMultiply(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pInput)), scale));
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(pOutput), s);
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(pOutput + 4), c);
+		}
+	}
+}
+
+void MATHBENCH_ENTRY(MathBenchBackend& backend)
+{
+	backend.name = PMATH_BACKEND_NAME;
+	backend.note = "";
+	backend.available = true;
+	backend.kernels[MathBench_TransformCoord] = TransformCoordKernel;
+	backend.kernels[MathBench_MatrixChain] = MatrixChainKernel;
+	backend.kernels[MathBench_NormalizeCross] = NormalizeCrossKernel;
+	backend.kernels[MathBench_PlaneCull] = PlaneCullKernel;
+	backend.kernels[MathBench_SinCos] = SinCosKernel;
+}
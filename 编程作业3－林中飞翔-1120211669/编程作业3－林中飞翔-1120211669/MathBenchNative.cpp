@@ -0,0 +1,5 @@
+// 工程默认选择的后端，与其他模块使用的相同。Windows上为DirectXMath
+#include "PortableMath.h"
+
+#define MATHBENCH_ENTRY GetMathKernelsNative
+#include "MathBenchKernels.inl"
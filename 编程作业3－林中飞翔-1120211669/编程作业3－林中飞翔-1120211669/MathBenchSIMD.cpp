@@ -0,0 +1,27 @@
+// 128位SIMD后端：x86上为SSE2，ARM上为NEON
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PMATH_FORCE_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64) || defined(_M_ARM)
+#define PMATH_FORCE_NEON
+#endif
+
+#if defined(PMATH_FORCE_SSE2) || defined(PMATH_FORCE_NEON)
+
+#include "PortableMath.h"
+
+#define MATHBENCH_ENTRY GetMathKernelsSIMD
+#include "MathBenchKernels.inl"
+
+#else
+
+#include "MathBenchmark.h"
+
+void GetMathKernelsSIMD(MathBenchBackend& backend)
+{
+	backend = MathBenchBackend();
+	backend.name = "SIMD";
+	backend.note = "no SSE2/NEON on this target";
+	backend.available = false;
+}
+
+#endif
@@ -0,0 +1,6 @@
+// 标量后端，作为其他后端的参考结果
+#define PMATH_FORCE_SCALAR
+#include "PortableMath.h"
+
+#define MATHBENCH_ENTRY GetMathKernelsScalar
+#include "MathBenchKernels.inl"
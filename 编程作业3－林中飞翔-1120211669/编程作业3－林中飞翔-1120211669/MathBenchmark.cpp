@@ -0,0 +1,121 @@
+#include "MathBenchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	const char* const kernelNames[MathBench_Count] = {
+		"TransformCoord", "MatrixChain", "NormalizeCross", "PlaneCull", "SinCos"
+	};
+
+	// AVX2和FMA指令可用，并且操作系统会保存YMM寄存器
+	bool CpuSupportsAVX2()
+	{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+		__cpuid(info, 1);
+		bool fma = (info[2] & (1 << 12)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		if (!fma || !osxsave || !avx || (_xgetbv(0) & 6) != 6)
+			return false;
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+		return false;
+#endif
+	}
+
+	template<typename Func>
+	double BestMilliseconds(int repeats, Func func)
+	{
+		double best = 1e30;
+		for (int r = 0; r < repeats; ++r)
+		{
+			auto start = std::chrono::steady_clock::now();
+			func();
+			auto stop = std::chrono::steady_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>(stop - start).count());
+		}
+		return best;
+	}
+
+	// 相对误差，参考值的量级小于1时按绝对误差计
+	float MaxRelativeError(const std::vector<float>& result, const std::vector<float>& reference)
+	{
+		float err = 0.0f;
+		for (size_t i = 0; i < result.size(); ++i)
+			err = std::max(err, std::fabs(result[i] - reference[i]) / std::max(std::fabs(reference[i]), 1.0f));
+		return err;
+	}
+}
+
+void BenchmarkMathBackends(std::ostream& os, uint32_t count)
+{
+	std::minstd_rand rng(1);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+	std::vector<float> input((size_t)count * MathBenchInputFloats);
+	for (float& v : input)
+		v = dist(rng);
+
+	MathBenchBackend backends[4] = {};
+	GetMathKernelsScalar(backends[0]);
+	GetMathKernelsSIMD(backends[1]);
+	GetMathKernelsAVX2(backends[2]);
+	GetMathKernelsNative(backends[3]);
+	if (backends[2].available && !CpuSupportsAVX2())
+	{
+		backends[2].available = false;
+		backends[2].note = "CPU lacks AVX2/FMA";
+	}
+
+	const int repeats = 5;
+	os << "math backends  count " << count << "  (native: " << backends[3].name << ")\n";
+	os << "backend\tkernel\tns/item\tspeedup\tmax rel error\n";
+
+	// 标量后端是第一个，作为耗时和误差的参考
+	double scalarMs[MathBench_Count] = {};
+	std::vector<float> reference[MathBench_Count];
+	std::vector<float> output;
+	for (const MathBenchBackend& backend : backends)
+	{
+		if (!backend.available)
+		{
+			os << backend.name << "\t(skipped: " << backend.note << ")\n";
+			continue;
+		}
+		for (int k = 0; k < MathBench_Count; ++k)
+		{
+			output.assign((size_t)count * MathBenchOutputFloats[k], 0.0f);
+			MathBenchKernelFunc kernel = backend.kernels[k];
+			double ms = BestMilliseconds(repeats, [&]() { kernel(input.data(), count, output.data()); });
+			float err = 0.0f;
+			if (&backend == &backends[0])
+			{
+				scalarMs[k] = ms;
+				reference[k] = output;
+			}
+			else
+			{
+				err = MaxRelativeError(output, reference[k]);
+			}
+			os << backend.name << "\t" << kernelNames[k] << "\t" << ms * 1e6 / count << "\t"
+				<< scalarMs[k] / ms << "\t" << err << "\n";
+		}
+	}
+	os << "\n";
+}
@@ -0,0 +1,44 @@
+#ifndef MATHBENCHMARK_H
+#define MATHBENCHMARK_H
+
+#include <cstdint>
+#include <ostream>
+
+// PortableMath各个后端的对比测试。每个后端在单独的翻译单元(MathBench*.cpp)中编译同一份测试代码
+// (MathBenchKernels.inl)，对相同的输入计算，结果与标量后端比较误差。
+// 这里只用函数指针和原始数组交换数据，不出现任何数学库的类型，不同后端的翻译单元之间没有类型冲突
+
+enum MathBenchKernel
+{
+	MathBench_TransformCoord,	// 点乘视图投影矩阵并做透视除法
+	MathBench_MatrixChain,		// S * Rx * Ry * T * ViewProj
+	MathBench_NormalizeCross,	// 由三角形的顶点求单位法线
+	MathBench_PlaneCull,		// 包围球到6个视锥体平面的最小距离
+	MathBench_SinCos,			// 4个一组求正弦和余弦
+	MathBench_Count
+};
+
+// 每个元素的输入为16个[-1, 1)内的随机数，各测试输出的float个数见下
+const uint32_t MathBenchInputFloats = 16;
+const uint32_t MathBenchOutputFloats[MathBench_Count] = { 4, 16, 4, 1, 8 };
+
+typedef void (*MathBenchKernelFunc)(const float* pInput, uint32_t count, float* pOutput);
+
+struct MathBenchBackend
+{
+	const char* name;
+	const char* note;			// 不可用时的原因
+	bool available;
+	MathBenchKernelFunc kernels[MathBench_Count];
+};
+
+// 各翻译单元提供的后端
+void GetMathKernelsScalar(MathBenchBackend& backend);
+void GetMathKernelsSIMD(MathBenchBackend& backend);		// x86上为SSE2，ARM上为NEON
+void GetMathKernelsAVX2(MathBenchBackend& backend);		// 需要以AVX2和FMA编译，运行前还要检查CPU是否支持
+void GetMathKernelsNative(MathBenchBackend& backend);	// 工程默认的后端，Windows上为DirectXMath
+
+// 依次运行各个后端，输出每个测试的耗时、相对标量后端的加速比和最大相对误差
+void BenchmarkMathBackends(std::ostream& os, uint32_t count);
+
+#endif
@@ -0,0 +1,489 @@
+#include "OcclusionCulling.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+
+using namespace DirectX;
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	double MicrosecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+	}
+
+	// 先在浮点数中截断，避免靠近近平面的顶点坐标过大时转换为整数溢出
+	int32_t ClampToInt(float v, int32_t lo, int32_t hi)
+	{
+		if (!(v > (float)lo))
+			return lo;
+		if (v >= (float)hi)
+			return hi;
+		return (int32_t)v;
+	}
+
+	// 在[c - r, c + r] x [z - r, z + r]上c / z的最小值和最大值，包含了球的投影
+	float MinRatio(float c, float z, float r)
+	{
+		float a = c - r;
+		return a / (a >= 0.0f ? z + r : z - r);
+	}
+
+	float MaxRatio(float c, float z, float r)
+	{
+		float b = c + r;
+		return b / (b >= 0.0f ? z - r : z + r);
+	}
+}
+
+OcclusionCuller::OcclusionCuller()
+	: m_MaxOccluders(64),
+	m_Width(0),
+	m_Height(0),
+	m_TilesX(0),
+	m_TilesY(0),
+	m_RightMask(0),
+	m_BottomMask(0),
+	m_ProjX(1.0f), m_ProjY(1.0f),
+	m_ProjZ(0.0f), m_ProjW(0.0f),
+	m_NearZ(1.0f),
+	m_TestedCount(0),
+	m_CulledCount(0),
+	m_RasterMicroseconds(0.0),
+	m_TestMicroseconds(0.0)
+{
+}
+
+void OcclusionCuller::SetOccluderMesh(const XMFLOAT3* pPositions, uint32_t stride, uint32_t vertexCount,
+	const uint16_t* pIndices, uint32_t indexCount)
+{
+	m_MeshPositions.resize(vertexCount);
+	const uint8_t* pSrc = reinterpret_cast<const uint8_t*>(pPositions);
+	for (uint32_t i = 0; i < vertexCount; ++i)
+		m_MeshPositions[i] = *reinterpret_cast<const XMFLOAT3*>(pSrc + (size_t)i * stride);
+	m_MeshIndices.assign(pIndices, pIndices + indexCount - indexCount % 3);
+}
+
+void OcclusionCuller::Resize(uint32_t width, uint32_t height)
+{
+	if (width == m_Width && height == m_Height)
+		return;
+	m_Width = width;
+	m_Height = height;
+	m_TilesX = (width + kTileSize - 1) / kTileSize;
+	m_TilesY = (height + kTileSize - 1) / kTileSize;
+	m_Tiles.resize((size_t)m_TilesX * m_TilesY);
+
+	// 窗口尺寸不是4的倍数时，最右一列分块的右边几列像素和最下一行分块的下边几行像素在窗口外
+	m_RightMask = 0;
+	m_BottomMask = 0;
+	for (uint32_t i = 0; i < kTileSize; ++i)
+	{
+		for (uint32_t j = 0; j < kTileSize; ++j)
+		{
+			if (width && (m_TilesX - 1) * kTileSize + i >= width)
+				m_RightMask |= 1u << (j * kTileSize + i);
+			if (height && (m_TilesY - 1) * kTileSize + j >= height)
+				m_BottomMask |= 1u << (j * kTileSize + i);
+		}
+	}
+
+	width = m_TilesX;
+	height = m_TilesY;
+	m_LevelWidths.assign(1, width);
+	m_LevelHeights.assign(1, height);
+	m_HiZ.assign(1, std::vector<float>((size_t)width * height, 1.0f));
+	while (width > 1 || height > 1)
+	{
+		width = (width + 1) / 2;
+		height = (height + 1) / 2;
+		m_LevelWidths.push_back(width);
+		m_LevelHeights.push_back(height);
+		m_HiZ.emplace_back((size_t)width * height, 1.0f);
+	}
+}
+
+void OcclusionCuller::SetMaxOccluders(uint32_t count)
+{
+	m_MaxOccluders = count;
+}
+
+void XM_CALLCONV OcclusionCuller::Cull(const std::vector<ForestInstances::InstanceData>& instances, const ForestInstances::BoundingSpheres& spheres,
+	const uint32_t* pIndices, uint32_t count, uint32_t treeCount, FXMMATRIX view, CXMMATRIX proj, JobSystem* jobs)
+{
+	Clock::time_point start = Clock::now();
+	auto parallelFor = [jobs](uint32_t n, uint32_t grain, const JobSystem::RangeFunc& func)
+	{
+		if (jobs)
+			jobs->ParallelFor(n, grain, func);
+		else
+			func(0, n);
+	};
+
+	m_TestedCount = count;
+	m_CulledCount = 0;
+	m_Occluders.clear();
+	m_VisibleIndices.resize(count);
+	for (uint32_t k = 0; k < count; ++k)
+		m_VisibleIndices[k] = pIndices ? pIndices[k] : k;
+	if (m_Width == 0 || m_Height == 0 || m_MeshIndices.empty() || count == 0)
+	{
+		m_RasterMicroseconds = MicrosecondsSince(start);
+		m_TestMicroseconds = 0.0;
+		return;
+	}
+
+	// 行向量右乘，裁剪空间x = P00 * x，y = P11 * y，z = P22 * z + P32，w = z
+	XMFLOAT4X4 P;
+	XMStoreFloat4x4(&P, proj);
+	m_ProjX = P._11;
+	m_ProjY = P._22;
+	m_ProjZ = P._33;
+	m_ProjW = P._43;
+	m_NearZ = -P._43 / P._33;
+	XMMATRIX viewMat = view;
+
+	// 按观察空间中半径与距离之比选出投影最大的几棵树作为遮挡体，比值相同时按下标保证结果确定
+	m_Candidates.clear();
+	for (uint32_t k = 0; k < count; ++k)
+	{
+		uint32_t index = m_VisibleIndices[k];
+		if (index >= treeCount)
+			continue;
+		XMVECTOR centerV = XMVector3Transform(XMVectorSet(spheres.centerX[index], spheres.centerY[index], spheres.centerZ[index], 1.0f), viewMat);
+		float z = XMVectorGetZ(centerV);
+		if (z > m_NearZ)
+			m_Candidates.emplace_back(spheres.radius[index] / z, index);
+	}
+	uint32_t occluderCount = std::min((uint32_t)m_Candidates.size(), m_MaxOccluders);
+	std::partial_sort(m_Candidates.begin(), m_Candidates.begin() + occluderCount, m_Candidates.end(),
+		std::greater<std::pair<float, uint32_t>>());
+	for (uint32_t i = 0; i < occluderCount; ++i)
+		m_Occluders.push_back(m_Candidates[i].second);
+
+	// 每个遮挡体独立变换并建立三角形，写入各自的区间
+	uint32_t vertexCount = (uint32_t)m_MeshPositions.size();
+	uint32_t triangleCount = (uint32_t)m_MeshIndices.size() / 3;
+	m_ScreenVertices.resize((size_t)occluderCount * vertexCount);
+	m_Triangles.resize((size_t)occluderCount * triangleCount);
+	m_OccluderRows.resize((size_t)occluderCount * 2);
+	XMMATRIX viewProj = viewMat * proj;
+	parallelFor(occluderCount, 1, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+			SetupOccluder(i, instances[m_Occluders[i]], viewProj);
+	});
+
+	// 按分块行分带光栅化，每个任务只写自己的分块。遮挡体的顺序固定，同一分块内的合并顺序与线程数无关
+	for (uint32_t y = 0; y < m_TilesY; ++y)
+	{
+		for (uint32_t x = 0; x < m_TilesX; ++x)
+		{
+			TileDepth& tile = m_Tiles[(size_t)y * m_TilesX + x];
+			tile.committed = 1.0f;
+			tile.working = 0.0f;
+			tile.mask = (x + 1 == m_TilesX ? m_RightMask : 0) | (y + 1 == m_TilesY ? m_BottomMask : 0);
+		}
+	}
+	uint32_t bandCount = (m_TilesY + kBandTiles - 1) / kBandTiles;
+	parallelFor(bandCount, 1, [this](uint32_t begin, uint32_t end)
+	{
+		RasterizeRows(begin * kBandTiles, std::min(end * kBandTiles, m_TilesY));
+	});
+	BuildHiZ();
+	m_RasterMicroseconds = MicrosecondsSince(start);
+
+	// 每个实例的结果写入各自的位置，再按原顺序收集
+	start = Clock::now();
+	m_Visible.resize(count);
+	parallelFor(count, 256, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t k = begin; k < end; ++k)
+		{
+			uint32_t index = m_VisibleIndices[k];
+			XMVECTOR centerV = XMVector3Transform(XMVectorSet(spheres.centerX[index], spheres.centerY[index], spheres.centerZ[index], 1.0f), viewMat);
+			m_Visible[k] = TestSphere(centerV, spheres.radius[index]) ? 1 : 0;
+		}
+	});
+	uint32_t visibleCount = 0;
+	for (uint32_t k = 0; k < count; ++k)
+	{
+		if (m_Visible[k])
+			m_VisibleIndices[visibleCount++] = m_VisibleIndices[k];
+	}
+	m_VisibleIndices.resize(visibleCount);
+	m_CulledCount = count - visibleCount;
+	m_TestMicroseconds = MicrosecondsSince(start);
+}
+
+void XM_CALLCONV OcclusionCuller::SetupOccluder(uint32_t occluder, const ForestInstances::InstanceData& instance, FXMMATRIX viewProj)
+{
+	// 实例数据中是转置后的世界矩阵
+	XMMATRIX worldViewProj = XMMatrixTranspose(XMLoadFloat4x4(&instance.world)) * viewProj;
+	uint32_t vertexCount = (uint32_t)m_MeshPositions.size();
+	XMFLOAT4* pVerts = m_ScreenVertices.data() + (size_t)occluder * vertexCount;
+	float halfW = 0.5f * m_Width, halfH = 0.5f * m_Height;
+	for (uint32_t i = 0; i < vertexCount; ++i)
+	{
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(&m_MeshPositions[i]), worldViewProj));
+		// 在近平面之前的顶点w记为0，所在的三角形不参与
+		if (clip.z < 0.0f || clip.w <= 0.0f)
+		{
+			pVerts[i] = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+			continue;
+		}
+		float invW = 1.0f / clip.w;
+		pVerts[i] = XMFLOAT4((clip.x * invW + 1.0f) * halfW, (1.0f - clip.y * invW) * halfH, clip.z * invW, clip.w);
+	}
+
+	uint32_t triangleCount = (uint32_t)m_MeshIndices.size() / 3;
+	OccluderTriangle* pTris = m_Triangles.data() + (size_t)occluder * triangleCount;
+	int32_t minRow = (int32_t)m_TilesY, maxRow = -1;
+	for (uint32_t t = 0; t < triangleCount; ++t)
+	{
+		OccluderTriangle& tri = pTris[t];
+		tri.minX = 1;
+		tri.maxX = 0;
+		const XMFLOAT4* v[3] = { &pVerts[m_MeshIndices[3 * t]], &pVerts[m_MeshIndices[3 * t + 1]], &pVerts[m_MeshIndices[3 * t + 2]] };
+		if (v[0]->w <= 0.0f || v[1]->w <= 0.0f || v[2]->w <= 0.0f)
+			continue;
+		// 屏幕y向下，顺时针(正面)的三角形面积为正，背面和退化的三角形不参与
+		float area = (v[1]->x - v[0]->x) * (v[2]->y - v[0]->y) - (v[2]->x - v[0]->x) * (v[1]->y - v[0]->y);
+		if (!(area > 0.0f))
+			continue;
+
+		float minX = std::min(v[0]->x, std::min(v[1]->x, v[2]->x));
+		float maxX = std::max(v[0]->x, std::max(v[1]->x, v[2]->x));
+		float minY = std::min(v[0]->y, std::min(v[1]->y, v[2]->y));
+		float maxY = std::max(v[0]->y, std::max(v[1]->y, v[2]->y));
+		// 像素中心为(i + 0.5, j + 0.5)，先求覆盖的像素范围再换算为分块
+		int32_t x0 = ClampToInt(std::ceil(minX - 0.5f), 0, (int32_t)m_Width);
+		int32_t x1 = ClampToInt(std::floor(maxX - 0.5f), -1, (int32_t)m_Width - 1);
+		int32_t y0 = ClampToInt(std::ceil(minY - 0.5f), 0, (int32_t)m_Height);
+		int32_t y1 = ClampToInt(std::floor(maxY - 0.5f), -1, (int32_t)m_Height - 1);
+		if (x0 > x1 || y0 > y1)
+			continue;
+		tri.minX = x0 / (int32_t)kTileSize;
+		tri.maxX = x1 / (int32_t)kTileSize;
+		tri.minY = y0 / (int32_t)kTileSize;
+		tri.maxY = y1 / (int32_t)kTileSize;
+		minRow = std::min(minRow, tri.minY);
+		maxRow = std::max(maxRow, tri.maxY);
+
+		// 第i条边从顶点i指向顶点i+1，E(p) = (b - a) x (p - a)
+		for (int i = 0; i < 3; ++i)
+		{
+			const XMFLOAT4& a = *v[i];
+			const XMFLOAT4& b = *v[(i + 1) % 3];
+			tri.edgeA[i] = a.y - b.y;
+			tri.edgeB[i] = b.x - a.x;
+			tri.edgeC[i] = (b.y - a.y) * a.x - (b.x - a.x) * a.y;
+		}
+		tri.depth = std::max(v[0]->z, std::max(v[1]->z, v[2]->z));
+	}
+	m_OccluderRows[2 * occluder] = minRow;
+	m_OccluderRows[2 * occluder + 1] = maxRow;
+}
+
+void OcclusionCuller::RasterizeRows(uint32_t beginRow, uint32_t endRow)
+{
+	const uint32_t fullMask = (1u << (kTileSize * kTileSize)) - 1;
+	uint32_t triangleCount = (uint32_t)m_MeshIndices.size() / 3;
+	for (size_t i = 0; i < m_Occluders.size(); ++i)
+	{
+		// 先按整个遮挡体跳过不在这一带中的
+		if (m_OccluderRows[2 * i + 1] < (int32_t)beginRow || m_OccluderRows[2 * i] >= (int32_t)endRow)
+			continue;
+		const OccluderTriangle* pTris = m_Triangles.data() + i * triangleCount;
+		for (uint32_t t = 0; t < triangleCount; ++t)
+		{
+			const OccluderTriangle& tri = pTris[t];
+			if (tri.minX > tri.maxX || tri.maxY < (int32_t)beginRow || tri.minY >= (int32_t)endRow)
+				continue;
+			int32_t y0 = std::max(tri.minY, (int32_t)beginRow);
+			int32_t y1 = std::min(tri.maxY, (int32_t)endRow - 1);
+			for (int32_t y = y0; y <= y1; ++y)
+			{
+				for (int32_t x = tri.minX; x <= tri.maxX; ++x)
+				{
+					TileDepth& tile = m_Tiles[(size_t)y * m_TilesX + x];
+					// 比已提交的深度远的三角形不会带来新的遮挡
+					if (tri.depth >= tile.committed)
+						continue;
+					uint32_t coverage = ComputeCoverage(tri, x, y);
+					if (coverage == 0)
+						continue;
+					// 合并到正在累积的覆盖中，深度取较远的；覆盖满整个分块后提交，
+					// 提交的深度一定比原来的近，因为参与合并的三角形都比它近
+					tile.mask |= coverage;
+					tile.working = std::max(tile.working, tri.depth);
+					if (tile.mask == fullMask)
+					{
+						tile.committed = tile.working;
+						tile.working = 0.0f;
+						tile.mask = ((uint32_t)x + 1 == m_TilesX ? m_RightMask : 0) | ((uint32_t)y + 1 == m_TilesY ? m_BottomMask : 0);
+					}
+				}
+			}
+		}
+	}
+}
+
+uint32_t OcclusionCuller::ComputeCoverage(const OccluderTriangle& tri, uint32_t tileX, uint32_t tileY) const
+{
+	// 一次处理分块中的一行4个像素，每行的结果按第y * 4 + x位的权重累加，最后得到16位掩码
+	const XMVECTOR zero = XMVectorZero();
+	const XMVECTOR rowWeights = XMVectorSet(1.0f, 2.0f, 4.0f, 8.0f);
+	float x0 = (float)(tileX * kTileSize);
+	XMVECTOR px = XMVectorAdd(XMVectorReplicate(x0), XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f));
+	XMVECTOR E0 = XMVectorMultiplyAdd(XMVectorReplicate(tri.edgeA[0]), px, XMVectorReplicate(tri.edgeC[0]));
+	XMVECTOR E1 = XMVectorMultiplyAdd(XMVectorReplicate(tri.edgeA[1]), px, XMVectorReplicate(tri.edgeC[1]));
+	XMVECTOR E2 = XMVectorMultiplyAdd(XMVectorReplicate(tri.edgeA[2]), px, XMVectorReplicate(tri.edgeC[2]));
+	XMVECTOR bits = zero;
+	XMVECTOR weights = rowWeights;
+	float py = tileY * kTileSize + 0.5f;
+	for (uint32_t row = 0; row < kTileSize; ++row, py += 1.0f)
+	{
+		XMVECTOR inside = XMVectorLessOrEqual(zero, XMVectorAdd(E0, XMVectorReplicate(tri.edgeB[0] * py)));
+		inside = XMVectorAndInt(inside, XMVectorLessOrEqual(zero, XMVectorAdd(E1, XMVectorReplicate(tri.edgeB[1] * py))));
+		inside = XMVectorAndInt(inside, XMVectorLessOrEqual(zero, XMVectorAdd(E2, XMVectorReplicate(tri.edgeB[2] * py))));
+		bits = XMVectorAdd(bits, XMVectorSelect(zero, weights, inside));
+		weights = XMVectorScale(weights, 16.0f);
+	}
+	XMFLOAT4 sum;
+	XMStoreFloat4(&sum, bits);
+	return (uint32_t)(sum.x + sum.y + sum.z + sum.w);
+}
+
+void OcclusionCuller::BuildHiZ()
+{
+	float* pLevel0 = m_HiZ[0].data();
+	for (size_t i = 0; i < m_Tiles.size(); ++i)
+		pLevel0[i] = m_Tiles[i].committed;
+	for (size_t level = 1; level < m_LevelWidths.size(); ++level)
+	{
+		uint32_t srcW = m_LevelWidths[level - 1], srcH = m_LevelHeights[level - 1];
+		uint32_t w = m_LevelWidths[level], h = m_LevelHeights[level];
+		const float* pSrc = m_HiZ[level - 1].data();
+		float* pDest = m_HiZ[level].data();
+		for (uint32_t y = 0; y < h; ++y)
+		{
+			// 奇数尺寸时最后一行/列只有一个子纹素
+			const float* pRow0 = pSrc + (size_t)(2 * y) * srcW;
+			const float* pRow1 = pSrc + (size_t)std::min(2 * y + 1, srcH - 1) * srcW;
+			for (uint32_t x = 0; x < w; ++x)
+			{
+				uint32_t x0 = 2 * x, x1 = std::min(2 * x + 1, srcW - 1);
+				pDest[(size_t)y * w + x] = std::max(std::max(pRow0[x0], pRow0[x1]), std::max(pRow1[x0], pRow1[x1]));
+			}
+		}
+	}
+}
+
+bool XM_CALLCONV OcclusionCuller::TestSphere(FXMVECTOR centerV, float radius) const
+{
+	XMFLOAT3 c;
+	XMStoreFloat3(&c, centerV);
+	// 与近平面相交的包围球无法得到有效的投影
+	if (c.z - radius <= m_NearZ)
+		return true;
+
+	float ndcX0 = m_ProjX * MinRatio(c.x, c.z, radius), ndcX1 = m_ProjX * MaxRatio(c.x, c.z, radius);
+	float ndcY0 = m_ProjY * MinRatio(c.y, c.z, radius), ndcY1 = m_ProjY * MaxRatio(c.y, c.z, radius);
+	float sx0 = (ndcX0 + 1.0f) * 0.5f * m_Width, sx1 = (ndcX1 + 1.0f) * 0.5f * m_Width;
+	float sy0 = (1.0f - ndcY1) * 0.5f * m_Height, sy1 = (1.0f - ndcY0) * 0.5f * m_Height;
+	// 完全在屏幕外的交给视锥体剔除
+	if (sx1 <= 0.0f || sy1 <= 0.0f || sx0 >= (float)m_Width || sy0 >= (float)m_Height)
+		return true;
+
+	uint32_t px0 = (uint32_t)ClampToInt(std::floor(sx0), 0, (int32_t)m_Width - 1);
+	uint32_t px1 = (uint32_t)ClampToInt(std::ceil(sx1) - 1.0f, 0, (int32_t)m_Width - 1);
+	uint32_t py0 = (uint32_t)ClampToInt(std::floor(sy0), 0, (int32_t)m_Height - 1);
+	uint32_t py1 = (uint32_t)ClampToInt(std::ceil(sy1) - 1.0f, 0, (int32_t)m_Height - 1);
+	float nearestDepth = m_ProjZ + m_ProjW / (c.z - radius);
+
+	// 换算为分块，再选择矩形最多跨2x2个纹素的一级
+	uint32_t tx0 = px0 / kTileSize, tx1 = px1 / kTileSize;
+	uint32_t ty0 = py0 / kTileSize, ty1 = py1 / kTileSize;
+	uint32_t level = 0;
+	while (level + 1 < m_LevelWidths.size() && ((tx1 >> level) - (tx0 >> level) > 1 || (ty1 >> level) - (ty0 >> level) > 1))
+		++level;
+	const float* pLevel = m_HiZ[level].data();
+	uint32_t pitch = m_LevelWidths[level];
+	for (uint32_t y = ty0 >> level; y <= (ty1 >> level); ++y)
+	{
+		for (uint32_t x = tx0 >> level; x <= (tx1 >> level); ++x)
+		{
+			if (pLevel[(size_t)y * pitch + x] >= nearestDepth)
+				return true;
+		}
+	}
+	return false;
+}
+
+const std::vector<uint32_t>& OcclusionCuller::GetVisibleIndices() const
+{
+	return m_VisibleIndices;
+}
+
+uint32_t OcclusionCuller::GetVisibleCount() const
+{
+	return (uint32_t)m_VisibleIndices.size();
+}
+
+uint32_t OcclusionCuller::GetTestedCount() const
+{
+	return m_TestedCount;
+}
+
+uint32_t OcclusionCuller::GetCulledCount() const
+{
+	return m_CulledCount;
+}
+
+float OcclusionCuller::GetCulledFraction() const
+{
+	return m_TestedCount ? (float)m_CulledCount / m_TestedCount : 0.0f;
+}
+
+uint32_t OcclusionCuller::GetOccluderCount() const
+{
+	return (uint32_t)m_Occluders.size();
+}
+
+double OcclusionCuller::GetRasterMicroseconds() const
+{
+	return m_RasterMicroseconds;
+}
+
+double OcclusionCuller::GetTestMicroseconds() const
+{
+	return m_TestMicroseconds;
+}
+
+double OcclusionCuller::GetTotalMicroseconds() const
+{
+	return m_RasterMicroseconds + m_TestMicroseconds;
+}
+
+uint32_t OcclusionCuller::GetTilesX() const
+{
+	return m_TilesX;
+}
+
+uint32_t OcclusionCuller::GetTilesY() const
+{
+	return m_TilesY;
+}
+
+void OcclusionCuller::ReadDepth(std::vector<float>& depth) const
+{
+	depth.resize(m_Tiles.size());
+	for (size_t i = 0; i < m_Tiles.size(); ++i)
+		depth[i] = m_Tiles[i].committed;
+}
@@ -0,0 +1,120 @@
+#ifndef OCCLUSIONCULLING_H
+#define OCCLUSIONCULLING_H
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include "PortableMath.h"
+#include "ForestInstances.h"
+
+class JobSystem;
+
+// 软件遮挡剔除，做法参照masked occlusion culling。每帧选出离摄像机最近、投影最大的若干棵树作为遮挡体，
+// 用去掉内部面的简化网格在CPU上光栅化。覆盖按窗口分辨率的像素中心计算(与GPU相同)，
+// 但深度只按4x4像素的分块保存：每个分块有一个16位的覆盖掩码和这部分覆盖的最远深度，
+// 掩码填满后才把深度提交为整个分块的遮挡深度。分块深度再逐级取最大值生成层次深度(Hi-Z)。
+// 测试时把实例包围球投影为屏幕矩形和最近深度，在Hi-Z中选2x2个纹素覆盖矩形的一级，
+// 这些纹素的遮挡深度都比包围球更近时剔除。
+// 遮挡体的深度取每个三角形三个顶点中最远的，与近平面相交的三角形不参与，因此只会少剔除不会多剔除
+class OcclusionCuller
+{
+public:
+	OcclusionCuller();
+
+	// 遮挡体使用的局部空间网格，数据会被复制
+	void SetOccluderMesh(const DirectX::XMFLOAT3* pPositions, uint32_t stride, uint32_t vertexCount,
+		const uint16_t* pIndices, uint32_t indexCount);
+	// 窗口分辨率，分块深度缓冲区为它的1/4
+	void Resize(uint32_t width, uint32_t height);
+	// 每帧最多的遮挡体数
+	void SetMaxOccluders(uint32_t count);
+
+	// 对pIndices中的count个实例做遮挡剔除，pIndices为空则为前count个，结果保持原来的顺序。
+	// 遮挡体只从下标小于treeCount的树中选择。view、proj为未转置的矩阵
+	// [In]jobs	不为空则变换遮挡体、按行分带光栅化和测试实例都在工作线程中进行
+	void XM_CALLCONV Cull(const std::vector<ForestInstances::InstanceData>& instances, const ForestInstances::BoundingSpheres& spheres,
+		const uint32_t* pIndices, uint32_t count, uint32_t treeCount, DirectX::FXMMATRIX view, DirectX::CXMMATRIX proj,
+		JobSystem* jobs = nullptr);
+
+	const std::vector<uint32_t>& GetVisibleIndices() const;
+	uint32_t GetVisibleCount() const;
+	uint32_t GetTestedCount() const;		// 上一次Cull中测试的实例数
+	uint32_t GetCulledCount() const;		// 上一次Cull中被遮挡的实例数
+	float GetCulledFraction() const;
+	uint32_t GetOccluderCount() const;		// 上一次Cull中实际使用的遮挡体数
+	double GetRasterMicroseconds() const;	// 选择、变换和光栅化遮挡体以及生成Hi-Z的耗时
+	double GetTestMicroseconds() const;		// 测试实例的耗时
+	double GetTotalMicroseconds() const;
+
+	uint32_t GetTilesX() const;
+	uint32_t GetTilesY() const;
+	// 各分块提交的遮挡深度，按行紧密排列，没有被完全覆盖的分块为1
+	void ReadDepth(std::vector<float>& depth) const;
+
+private:
+	static const uint32_t kTileSize = 4;	// 分块边长(像素)，16个像素对应掩码的16位
+	static const uint32_t kBandTiles = 8;	// 每个光栅化任务处理的分块行数
+
+	// 遮挡体三角形在屏幕空间的边函数E(x, y) = A * x + B * y + C，内部三个都不小于0
+	struct OccluderTriangle
+	{
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+		float depth;						// 三个顶点中最远的深度
+		int32_t minX, minY, maxX, maxY;		// 覆盖的分块范围(含)，minX > maxX表示不参与
+	};
+
+	// 每个分块的遮挡信息
+	struct TileDepth
+	{
+		float committed;		// 整个分块都被遮挡的深度
+		float working;			// 正在累积的覆盖中最远的深度
+		uint32_t mask;			// 正在累积的覆盖，第y * 4 + x位对应分块内的像素(x, y)
+	};
+
+	// 变换第occluder个遮挡体并建立它的三角形
+	void XM_CALLCONV SetupOccluder(uint32_t occluder, const ForestInstances::InstanceData& instance, DirectX::FXMMATRIX viewProj);
+	// 光栅化[beginRow, endRow)分块行内的所有遮挡体三角形
+	void RasterizeRows(uint32_t beginRow, uint32_t endRow);
+	// 三角形在分块(tileX, tileY)中覆盖的像素掩码
+	uint32_t ComputeCoverage(const OccluderTriangle& tri, uint32_t tileX, uint32_t tileY) const;
+	void BuildHiZ();
+	// 包围球是否可能可见
+	bool XM_CALLCONV TestSphere(DirectX::FXMVECTOR centerV, float radius) const;
+
+private:
+	std::vector<DirectX::XMFLOAT3> m_MeshPositions;
+	std::vector<uint32_t> m_MeshIndices;
+	uint32_t m_MaxOccluders;
+
+	uint32_t m_Width;						// 窗口分辨率
+	uint32_t m_Height;
+	uint32_t m_TilesX;
+	uint32_t m_TilesY;
+	std::vector<TileDepth> m_Tiles;
+	uint32_t m_RightMask;					// 最右一列和最下一行分块中在窗口外的像素，视为已覆盖
+	uint32_t m_BottomMask;
+	std::vector<std::vector<float>> m_HiZ;	// 第0级为各分块提交的深度，之后每级取上一级2x2的最大值
+	std::vector<uint32_t> m_LevelWidths;	// 各级的宽高
+	std::vector<uint32_t> m_LevelHeights;
+
+	float m_ProjX, m_ProjY;					// 投影矩阵的缩放项
+	float m_ProjZ, m_ProjW;					// 深度 = m_ProjZ + m_ProjW / 观察空间z
+	float m_NearZ;
+
+	std::vector<std::pair<float, uint32_t>> m_Candidates;	// (投影大小, 实例下标)
+	std::vector<uint32_t> m_Occluders;
+	std::vector<int32_t> m_OccluderRows;					// 每个遮挡体覆盖的分块行范围，两个一组
+	std::vector<DirectX::XMFLOAT4> m_ScreenVertices;		// 每个遮挡体的顶点：屏幕x、y、深度、w
+	std::vector<OccluderTriangle> m_Triangles;				// 每个遮挡体的三角形依次存放
+	std::vector<uint8_t> m_Visible;
+	std::vector<uint32_t> m_VisibleIndices;
+
+	uint32_t m_TestedCount;
+	uint32_t m_CulledCount;
+	double m_RasterMicroseconds;
+	double m_TestMicroseconds;
+};
+
+#endif
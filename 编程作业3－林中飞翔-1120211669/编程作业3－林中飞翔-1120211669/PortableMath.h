@@ -0,0 +1,1424 @@
+#ifndef PORTABLEMATH_H
+#define PORTABLEMATH_H
+
+// 可移植的数学库。提供与DirectXMath同名的类型和函数(CPU端模块用到的部分)，使这些模块可以在Linux上编译运行。
+// 后端在编译期选择：
+//   定义PMATH_FORCE_SCALAR、PMATH_FORCE_SSE2、PMATH_FORCE_AVX2或PMATH_FORCE_NEON时强制使用对应的后端；
+//   否则Windows上直接使用DirectXMath，其他平台按编译选项依次选择AVX2(需要FMA)、SSE2、NEON，都不支持时使用标量实现。
+// 标量后端逐分量计算，与SIMD后端使用相同的公式，作为测试时的参考结果。
+// 各后端放在不同的内联命名空间中，名字修饰互不相同，因此不同后端编译的翻译单元可以链接到同一个程序里。
+// 同一个翻译单元只能使用一个后端，强制指定后端时也不能再包含DirectXMath.h
+
+#if defined(PMATH_FORCE_SCALAR)
+#define PMATH_BACKEND_SCALAR
+#elif defined(PMATH_FORCE_SSE2)
+#define PMATH_BACKEND_SSE2
+#elif defined(PMATH_FORCE_AVX2)
+#define PMATH_BACKEND_AVX2
+#elif defined(PMATH_FORCE_NEON)
+#define PMATH_BACKEND_NEON
+#elif defined(_WIN32)
+#define PMATH_BACKEND_DIRECTXMATH
+#elif defined(__AVX2__) && defined(__FMA__)
+#define PMATH_BACKEND_AVX2
+#elif defined(__SSE2__)
+#define PMATH_BACKEND_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PMATH_BACKEND_NEON
+#else
+#define PMATH_BACKEND_SCALAR
+#endif
+
+#if defined(PMATH_BACKEND_DIRECTXMATH)
+
+#include <DirectXMath.h>
+#define PMATH_BACKEND_NAME "DirectXMath"
+
+#else
+
+#if defined(DIRECTX_MATH_VERSION)
+#error PortableMath.h: 强制指定后端的翻译单元不能同时包含DirectXMath.h
+#endif
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(PMATH_BACKEND_SCALAR)
+#define PMATH_BACKEND_NAME "Scalar"
+#define PMATH_NAMESPACE PMathScalar
+#ifndef _XM_NO_INTRINSICS_
+#define _XM_NO_INTRINSICS_
+#endif
+#elif defined(PMATH_BACKEND_SSE2)
+#if !defined(__SSE2__) && !defined(_M_X64) && !(defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#error PortableMath.h: 编译选项未启用SSE2
+#endif
+#include <emmintrin.h>
+#define PMATH_BACKEND_NAME "SSE2"
+#define PMATH_NAMESPACE PMathSSE2
+#define PMATH_PERMUTE_PS(v, c) _mm_shuffle_ps((v), (v), (c))
+#elif defined(PMATH_BACKEND_AVX2)
+#if !defined(__AVX2__) || (!defined(__FMA__) && !defined(_MSC_VER))
+#error PortableMath.h: 编译选项未启用AVX2和FMA
+#endif
+#include <immintrin.h>
+#define PMATH_BACKEND_NAME "AVX2"
+#define PMATH_NAMESPACE PMathAVX2
+#define PMATH_PERMUTE_PS(v, c) _mm_permute_ps((v), (c))
+#elif defined(PMATH_BACKEND_NEON)
+#if !defined(__ARM_NEON) && !defined(__ARM_NEON__) && !defined(_M_ARM64) && !defined(_M_ARM)
+#error PortableMath.h: 编译选项未启用NEON
+#endif
+#if defined(_MSC_VER) && !defined(__clang__) && (defined(_M_ARM64) || defined(_M_ARM64EC))
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
+#endif
+#define PMATH_BACKEND_NAME "NEON"
+#define PMATH_NAMESPACE PMathNEON
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define PMATH_NEON_A64
+#endif
+#endif
+
+#if defined(_MSC_VER) && !defined(PMATH_BACKEND_SCALAR) && !defined(_M_ARM) && !defined(_M_ARM64)
+#define XM_CALLCONV __vectorcall
+#else
+#define XM_CALLCONV
+#endif
+
+#if defined(_MSC_VER)
+#define XM_GLOBALCONST extern const __declspec(selectany)
+#else
+#define XM_GLOBALCONST extern const __attribute__((weak))
+#endif
+
+// GCC和Clang的向量扩展已经为SIMD类型提供了算术运算符
+#if !defined(PMATH_BACKEND_SCALAR) && (defined(__GNUC__) || defined(__clang__))
+#define _XM_NO_XMVECTOR_OVERLOADS_
+#endif
+
+namespace DirectX
+{
+inline namespace PMATH_NAMESPACE
+{
+
+constexpr float XM_PI = 3.141592654f;
+constexpr float XM_2PI = 6.283185307f;
+constexpr float XM_1DIVPI = 0.318309886f;
+constexpr float XM_1DIV2PI = 0.159154943f;
+constexpr float XM_PIDIV2 = 1.570796327f;
+constexpr float XM_PIDIV4 = 0.785398163f;
+
+//
+// 向量类型
+//
+
+#if defined(PMATH_BACKEND_SCALAR)
+struct alignas(16) PMVector4
+{
+	union
+	{
+		float vector4_f32[4];
+		uint32_t vector4_u32[4];
+	};
+};
+typedef PMVector4 XMVECTOR;
+#elif defined(PMATH_BACKEND_NEON)
+typedef float32x4_t XMVECTOR;
+#else
+typedef __m128 XMVECTOR;
+#endif
+
+// 参数传递方式：标量后端按引用，SIMD后端前三个向量参数按值传递(可以放在寄存器中)
+#if defined(PMATH_BACKEND_SCALAR)
+typedef const XMVECTOR& FXMVECTOR;
+typedef const XMVECTOR& GXMVECTOR;
+typedef const XMVECTOR& HXMVECTOR;
+#else
+typedef const XMVECTOR FXMVECTOR;
+typedef const XMVECTOR GXMVECTOR;
+typedef const XMVECTOR HXMVECTOR;
+#endif
+typedef const XMVECTOR& CXMVECTOR;
+
+struct alignas(16) XMVECTORF32
+{
+	union
+	{
+		float f[4];
+		XMVECTOR v;
+	};
+
+	inline operator XMVECTOR() const { return v; }
+	inline operator const float*() const { return f; }
+};
+
+struct alignas(16) XMVECTORU32
+{
+	union
+	{
+		uint32_t u[4];
+		XMVECTOR v;
+	};
+
+	inline operator XMVECTOR() const { return v; }
+};
+
+#ifndef _XM_NO_XMVECTOR_OVERLOADS_
+XMVECTOR XM_CALLCONV operator+(FXMVECTOR V);
+XMVECTOR XM_CALLCONV operator-(FXMVECTOR V);
+XMVECTOR& XM_CALLCONV operator+=(XMVECTOR& V1, FXMVECTOR V2);
+XMVECTOR& XM_CALLCONV operator-=(XMVECTOR& V1, FXMVECTOR V2);
+XMVECTOR& XM_CALLCONV operator*=(XMVECTOR& V1, FXMVECTOR V2);
+XMVECTOR& XM_CALLCONV operator/=(XMVECTOR& V1, FXMVECTOR V2);
+XMVECTOR& operator*=(XMVECTOR& V, float S);
+XMVECTOR& operator/=(XMVECTOR& V, float S);
+XMVECTOR XM_CALLCONV operator+(FXMVECTOR V1, FXMVECTOR V2);
+XMVECTOR XM_CALLCONV operator-(FXMVECTOR V1, FXMVECTOR V2);
+XMVECTOR XM_CALLCONV operator*(FXMVECTOR V1, FXMVECTOR V2);
+XMVECTOR XM_CALLCONV operator/(FXMVECTOR V1, FXMVECTOR V2);
+XMVECTOR XM_CALLCONV operator*(FXMVECTOR V, float S);
+XMVECTOR XM_CALLCONV operator*(float S, FXMVECTOR V);
+XMVECTOR XM_CALLCONV operator/(FXMVECTOR V, float S);
+#endif
+
+//
+// 矩阵类型，行向量约定，与DirectXMath相同
+//
+
+struct XMMATRIX;
+typedef const XMMATRIX& FXMMATRIX;
+typedef const XMMATRIX& CXMMATRIX;
+
+struct alignas(16) XMMATRIX
+{
+	XMVECTOR r[4];
+
+	XMMATRIX() = default;
+
+	XMMATRIX(const XMMATRIX&) = default;
+	XMMATRIX& operator=(const XMMATRIX&) = default;
+
+	XMMATRIX(XMMATRIX&&) = default;
+	XMMATRIX& operator=(XMMATRIX&&) = default;
+
+	XMMATRIX(FXMVECTOR R0, FXMVECTOR R1, FXMVECTOR R2, CXMVECTOR R3) : r{ R0, R1, R2, R3 } {}
+	XMMATRIX(float m00, float m01, float m02, float m03,
+		float m10, float m11, float m12, float m13,
+		float m20, float m21, float m22, float m23,
+		float m30, float m31, float m32, float m33);
+	explicit XMMATRIX(const float* pArray);
+
+	XMMATRIX& operator*=(FXMMATRIX M);
+	XMMATRIX operator*(FXMMATRIX M) const;
+};
+
+//
+// 存储类型
+//
+
+struct XMFLOAT2
+{
+	float x;
+	float y;
+
+	XMFLOAT2() = default;
+
+	XMFLOAT2(const XMFLOAT2&) = default;
+	XMFLOAT2& operator=(const XMFLOAT2&) = default;
+
+	XMFLOAT2(XMFLOAT2&&) = default;
+	XMFLOAT2& operator=(XMFLOAT2&&) = default;
+
+	constexpr XMFLOAT2(float _x, float _y) : x(_x), y(_y) {}
+	explicit XMFLOAT2(const float* pArray) : x(pArray[0]), y(pArray[1]) {}
+};
+
+struct XMFLOAT3
+{
+	float x;
+	float y;
+	float z;
+
+	XMFLOAT3() = default;
+
+	XMFLOAT3(const XMFLOAT3&) = default;
+	XMFLOAT3& operator=(const XMFLOAT3&) = default;
+
+	XMFLOAT3(XMFLOAT3&&) = default;
+	XMFLOAT3& operator=(XMFLOAT3&&) = default;
+
+	constexpr XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+	explicit XMFLOAT3(const float* pArray) : x(pArray[0]), y(pArray[1]), z(pArray[2]) {}
+};
+
+struct XMFLOAT4
+{
+	float x;
+	float y;
+	float z;
+	float w;
+
+	XMFLOAT4() = default;
+
+	XMFLOAT4(const XMFLOAT4&) = default;
+	XMFLOAT4& operator=(const XMFLOAT4&) = default;
+
+	XMFLOAT4(XMFLOAT4&&) = default;
+	XMFLOAT4& operator=(XMFLOAT4&&) = default;
+
+	constexpr XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+	explicit XMFLOAT4(const float* pArray) : x(pArray[0]), y(pArray[1]), z(pArray[2]), w(pArray[3]) {}
+};
+
+struct XMINT3
+{
+	int32_t x;
+	int32_t y;
+	int32_t z;
+
+	XMINT3() = default;
+
+	XMINT3(const XMINT3&) = default;
+	XMINT3& operator=(const XMINT3&) = default;
+
+	XMINT3(XMINT3&&) = default;
+	XMINT3& operator=(XMINT3&&) = default;
+
+	constexpr XMINT3(int32_t _x, int32_t _y, int32_t _z) : x(_x), y(_y), z(_z) {}
+	explicit XMINT3(const int32_t* pArray) : x(pArray[0]), y(pArray[1]), z(pArray[2]) {}
+};
+
+struct XMFLOAT4X4
+{
+	union
+	{
+		struct
+		{
+			float _11, _12, _13, _14;
+			float _21, _22, _23, _24;
+			float _31, _32, _33, _34;
+			float _41, _42, _43, _44;
+		};
+		float m[4][4];
+	};
+
+	XMFLOAT4X4() = default;
+
+	XMFLOAT4X4(const XMFLOAT4X4&) = default;
+	XMFLOAT4X4& operator=(const XMFLOAT4X4&) = default;
+
+	XMFLOAT4X4(XMFLOAT4X4&&) = default;
+	XMFLOAT4X4& operator=(XMFLOAT4X4&&) = default;
+
+	constexpr XMFLOAT4X4(float m00, float m01, float m02, float m03,
+		float m10, float m11, float m12, float m13,
+		float m20, float m21, float m22, float m23,
+		float m30, float m31, float m32, float m33)
+		: _11(m00), _12(m01), _13(m02), _14(m03),
+		_21(m10), _22(m11), _23(m12), _24(m13),
+		_31(m20), _32(m21), _33(m22), _34(m23),
+		_41(m30), _42(m31), _43(m32), _44(m33) {}
+	explicit XMFLOAT4X4(const float* pArray)
+	{
+		for (int i = 0; i < 16; ++i)
+			m[i / 4][i % 4] = pArray[i];
+	}
+
+	float operator()(size_t row, size_t column) const { return m[row][column]; }
+	float& operator()(size_t row, size_t column) { return m[row][column]; }
+};
+
+//
+// 常量
+//
+
+XM_GLOBALCONST XMVECTORF32 g_XMIdentityR0 = { { { 1.0f, 0.0f, 0.0f, 0.0f } } };
+XM_GLOBALCONST XMVECTORF32 g_XMIdentityR1 = { { { 0.0f, 1.0f, 0.0f, 0.0f } } };
+XM_GLOBALCONST XMVECTORF32 g_XMIdentityR2 = { { { 0.0f, 0.0f, 1.0f, 0.0f } } };
+XM_GLOBALCONST XMVECTORF32 g_XMIdentityR3 = { { { 0.0f, 0.0f, 0.0f, 1.0f } } };
+XM_GLOBALCONST XMVECTORF32 g_XMOne = { { { 1.0f, 1.0f, 1.0f, 1.0f } } };
+XM_GLOBALCONST XMVECTORF32 g_XMNegativeOne = { { { -1.0f, -1.0f, -1.0f, -1.0f } } };
+XM_GLOBALCONST XMVECTORF32 g_XMPi = { { { XM_PI, XM_PI, XM_PI, XM_PI } } };
+XM_GLOBALCONST XMVECTORF32 g_XMHalfPi = { { { XM_PIDIV2, XM_PIDIV2, XM_PIDIV2, XM_PIDIV2 } } };
+XM_GLOBALCONST XMVECTORF32 g_XMTwoPi = { { { XM_2PI, XM_2PI, XM_2PI, XM_2PI } } };
+XM_GLOBALCONST XMVECTORF32 g_XMReciprocalTwoPi = { { { XM_1DIV2PI, XM_1DIV2PI, XM_1DIV2PI, XM_1DIV2PI } } };
+XM_GLOBALCONST XMVECTORU32 g_XMMask3 = { { { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0x00000000 } } };
+XM_GLOBALCONST XMVECTORU32 g_XMMaskW = { { { 0x00000000, 0x00000000, 0x00000000, 0xFFFFFFFF } } };
+XM_GLOBALCONST XMVECTORU32 g_XMSelect1110 = { { { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0x00000000 } } };
+XM_GLOBALCONST XMVECTORU32 g_XMAbsMask = { { { 0x7FFFFFFF, 0x7FFFFFFF, 0x7FFFFFFF, 0x7FFFFFFF } } };
+XM_GLOBALCONST XMVECTORU32 g_XMNegativeZero = { { { 0x80000000, 0x80000000, 0x80000000, 0x80000000 } } };
+XM_GLOBALCONST XMVECTORF32 g_XMNoFraction = { { { 8388608.0f, 8388608.0f, 8388608.0f, 8388608.0f } } };
+
+#if defined(PMATH_BACKEND_NEON) && defined(PMATH_NEON_A64)
+namespace Internal
+{
+	// 任意排列4个分量，用查表指令一次完成
+	template<uint32_t X, uint32_t Y, uint32_t Z, uint32_t W>
+	inline float32x4_t PermuteNEON(float32x4_t v)
+	{
+		static const uint8_t table[16] = {
+			X * 4, X * 4 + 1, X * 4 + 2, X * 4 + 3, Y * 4, Y * 4 + 1, Y * 4 + 2, Y * 4 + 3,
+			Z * 4, Z * 4 + 1, Z * 4 + 2, Z * 4 + 3, W * 4, W * 4 + 1, W * 4 + 2, W * 4 + 3 };
+		return vreinterpretq_f32_u8(vqtbl1q_u8(vreinterpretq_u8_f32(v), vld1q_u8(table)));
+	}
+}
+#elif defined(PMATH_BACKEND_NEON)
+namespace Internal
+{
+	// ARMv7没有128位查表指令，经由内存排列，编译器通常会优化为vext/vrev
+	template<uint32_t X, uint32_t Y, uint32_t Z, uint32_t W>
+	inline float32x4_t PermuteNEON(float32x4_t v)
+	{
+		float a[4], b[4];
+		vst1q_f32(a, v);
+		b[0] = a[X]; b[1] = a[Y]; b[2] = a[Z]; b[3] = a[W];
+		return vld1q_f32(b);
+	}
+}
+#endif
+
+//
+// 向量的初始化与读写
+//
+
+inline XMVECTOR XM_CALLCONV XMVectorZero()
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	XMVECTOR v;
+	v.vector4_f32[0] = v.vector4_f32[1] = v.vector4_f32[2] = v.vector4_f32[3] = 0.0f;
+	return v;
+#elif defined(PMATH_BACKEND_NEON)
+	return vdupq_n_f32(0.0f);
+#else
+	return _mm_setzero_ps();
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorSet(float x, float y, float z, float w)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	XMVECTOR v;
+	v.vector4_f32[0] = x;
+	v.vector4_f32[1] = y;
+	v.vector4_f32[2] = z;
+	v.vector4_f32[3] = w;
+	return v;
+#elif defined(PMATH_BACKEND_NEON)
+	const float v[4] = { x, y, z, w };
+	return vld1q_f32(v);
+#else
+	return _mm_set_ps(w, z, y, x);
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorReplicate(float value)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return XMVectorSet(value, value, value, value);
+#elif defined(PMATH_BACKEND_NEON)
+	return vdupq_n_f32(value);
+#else
+	return _mm_set1_ps(value);
+#endif
+}
+
+inline float XM_CALLCONV XMVectorGetX(FXMVECTOR V)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return V.vector4_f32[0];
+#elif defined(PMATH_BACKEND_NEON)
+	return vgetq_lane_f32(V, 0);
+#else
+	return _mm_cvtss_f32(V);
+#endif
+}
+
+inline float XM_CALLCONV XMVectorGetY(FXMVECTOR V)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return V.vector4_f32[1];
+#elif defined(PMATH_BACKEND_NEON)
+	return vgetq_lane_f32(V, 1);
+#else
+	return _mm_cvtss_f32(PMATH_PERMUTE_PS(V, _MM_SHUFFLE(1, 1, 1, 1)));
+#endif
+}
+
+inline float XM_CALLCONV XMVectorGetZ(FXMVECTOR V)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return V.vector4_f32[2];
+#elif defined(PMATH_BACKEND_NEON)
+	return vgetq_lane_f32(V, 2);
+#else
+	return _mm_cvtss_f32(PMATH_PERMUTE_PS(V, _MM_SHUFFLE(2, 2, 2, 2)));
+#endif
+}
+
+inline float XM_CALLCONV XMVectorGetW(FXMVECTOR V)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return V.vector4_f32[3];
+#elif defined(PMATH_BACKEND_NEON)
+	return vgetq_lane_f32(V, 3);
+#else
+	return _mm_cvtss_f32(PMATH_PERMUTE_PS(V, _MM_SHUFFLE(3, 3, 3, 3)));
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorSetW(FXMVECTOR V, float w)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	XMVECTOR r = V;
+	r.vector4_f32[3] = w;
+	return r;
+#elif defined(PMATH_BACKEND_NEON)
+	return vsetq_lane_f32(w, V, 3);
+#else
+	// 交换x和w，替换最低的分量后再换回来
+	XMVECTOR r = PMATH_PERMUTE_PS(V, _MM_SHUFFLE(0, 2, 1, 3));
+	r = _mm_move_ss(r, _mm_set_ss(w));
+	return PMATH_PERMUTE_PS(r, _MM_SHUFFLE(0, 2, 1, 3));
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorSplatX(FXMVECTOR V)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return XMVectorReplicate(V.vector4_f32[0]);
+#elif defined(PMATH_BACKEND_NEON)
+	return vdupq_lane_f32(vget_low_f32(V), 0);
+#else
+	return PMATH_PERMUTE_PS(V, _MM_SHUFFLE(0, 0, 0, 0));
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorSplatY(FXMVECTOR V)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return XMVectorReplicate(V.vector4_f32[1]);
+#elif defined(PMATH_BACKEND_NEON)
+	return vdupq_lane_f32(vget_low_f32(V), 1);
+#else
+	return PMATH_PERMUTE_PS(V, _MM_SHUFFLE(1, 1, 1, 1));
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorSplatZ(FXMVECTOR V)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return XMVectorReplicate(V.vector4_f32[2]);
+#elif defined(PMATH_BACKEND_NEON)
+	return vdupq_lane_f32(vget_high_f32(V), 0);
+#else
+	return PMATH_PERMUTE_PS(V, _MM_SHUFFLE(2, 2, 2, 2));
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorSplatW(FXMVECTOR V)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return XMVectorReplicate(V.vector4_f32[3]);
+#elif defined(PMATH_BACKEND_NEON)
+	return vdupq_lane_f32(vget_high_f32(V), 1);
+#else
+	return PMATH_PERMUTE_PS(V, _MM_SHUFFLE(3, 3, 3, 3));
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadFloat2(const XMFLOAT2* pSource)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return XMVectorSet(pSource->x, pSource->y, 0.0f, 0.0f);
+#elif defined(PMATH_BACKEND_NEON)
+	return vcombine_f32(vld1_f32(&pSource->x), vdup_n_f32(0.0f));
+#else
+	return _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(pSource)));
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadFloat3(const XMFLOAT3* pSource)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return XMVectorSet(pSource->x, pSource->y, pSource->z, 0.0f);
+#elif defined(PMATH_BACKEND_NEON)
+	float32x2_t xy = vld1_f32(&pSource->x);
+	float32x2_t z = vld1_lane_f32(&pSource->z, vdup_n_f32(0.0f), 0);
+	return vcombine_f32(xy, z);
+#else
+	__m128 xy = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(pSource)));
+	__m128 z = _mm_load_ss(&pSource->z);
+	return _mm_movelh_ps(xy, z);
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadFloat4(const XMFLOAT4* pSource)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return XMVectorSet(pSource->x, pSource->y, pSource->z, pSource->w);
+#elif defined(PMATH_BACKEND_NEON)
+	return vld1q_f32(&pSource->x);
+#else
+	return _mm_loadu_ps(&pSource->x);
+#endif
+}
+
+inline void XM_CALLCONV XMStoreFloat2(XMFLOAT2* pDestination, FXMVECTOR V)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	pDestination->x = V.vector4_f32[0];
+	pDestination->y = V.vector4_f32[1];
+#elif defined(PMATH_BACKEND_NEON)
+	vst1_f32(&pDestination->x, vget_low_f32(V));
+#else
+	_mm_store_sd(reinterpret_cast<double*>(pDestination), _mm_castps_pd(V));
+#endif
+}
+
+inline void XM_CALLCONV XMStoreFloat3(XMFLOAT3* pDestination, FXMVECTOR V)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	pDestination->x = V.vector4_f32[0];
+	pDestination->y = V.vector4_f32[1];
+	pDestination->z = V.vector4_f32[2];
+#elif defined(PMATH_BACKEND_NEON)
+	vst1_f32(&pDestination->x, vget_low_f32(V));
+	vst1q_lane_f32(&pDestination->z, V, 2);
+#else
+	_mm_store_sd(reinterpret_cast<double*>(pDestination), _mm_castps_pd(V));
+	_mm_store_ss(&pDestination->z, PMATH_PERMUTE_PS(V, _MM_SHUFFLE(2, 2, 2, 2)));
+#endif
+}
+
+inline void XM_CALLCONV XMStoreFloat4(XMFLOAT4* pDestination, FXMVECTOR V)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	pDestination->x = V.vector4_f32[0];
+	pDestination->y = V.vector4_f32[1];
+	pDestination->z = V.vector4_f32[2];
+	pDestination->w = V.vector4_f32[3];
+#elif defined(PMATH_BACKEND_NEON)
+	vst1q_f32(&pDestination->x, V);
+#else
+	_mm_storeu_ps(&pDestination->x, V);
+#endif
+}
+
+//
+// 逐分量运算
+//
+
+inline XMVECTOR XM_CALLCONV XMVectorAdd(FXMVECTOR V1, FXMVECTOR V2)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return XMVectorSet(V1.vector4_f32[0] + V2.vector4_f32[0], V1.vector4_f32[1] + V2.vector4_f32[1],
+		V1.vector4_f32[2] + V2.vector4_f32[2], V1.vector4_f32[3] + V2.vector4_f32[3]);
+#elif defined(PMATH_BACKEND_NEON)
+	return vaddq_f32(V1, V2);
+#else
+	return _mm_add_ps(V1, V2);
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorSubtract(FXMVECTOR V1, FXMVECTOR V2)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return XMVectorSet(V1.vector4_f32[0] - V2.vector4_f32[0], V1.vector4_f32[1] - V2.vector4_f32[1],
+		V1.vector4_f32[2] - V2.vector4_f32[2], V1.vector4_f32[3] - V2.vector4_f32[3]);
+#elif defined(PMATH_BACKEND_NEON)
+	return vsubq_f32(V1, V2);
+#else
+	return _mm_sub_ps(V1, V2);
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorMultiply(FXMVECTOR V1, FXMVECTOR V2)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return XMVectorSet(V1.vector4_f32[0] * V2.vector4_f32[0], V1.vector4_f32[1] * V2.vector4_f32[1],
+		V1.vector4_f32[2] * V2.vector4_f32[2], V1.vector4_f32[3] * V2.vector4_f32[3]);
+#elif defined(PMATH_BACKEND_NEON)
+	return vmulq_f32(V1, V2);
+#else
+	return _mm_mul_ps(V1, V2);
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorDivide(FXMVECTOR V1, FXMVECTOR V2)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return XMVectorSet(V1.vector4_f32[0] / V2.vector4_f32[0], V1.vector4_f32[1] / V2.vector4_f32[1],
+		V1.vector4_f32[2] / V2.vector4_f32[2], V1.vector4_f32[3] / V2.vector4_f32[3]);
+#elif defined(PMATH_BACKEND_NEON) && defined(PMATH_NEON_A64)
+	return vdivq_f32(V1, V2);
+#elif defined(PMATH_BACKEND_NEON)
+	// 倒数估计值再做两次牛顿迭代
+	float32x4_t r = vrecpeq_f32(V2);
+	r = vmulq_f32(vrecpsq_f32(r, V2), r);
+	r = vmulq_f32(vrecpsq_f32(r, V2), r);
+	return vmulq_f32(V1, r);
+#else
+	return _mm_div_ps(V1, V2);
+#endif
+}
+
+// V1 * V2 + V3，AVX2和ARMv8上为一条融合乘加指令
+inline XMVECTOR XM_CALLCONV XMVectorMultiplyAdd(FXMVECTOR V1, FXMVECTOR V2, FXMVECTOR V3)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return XMVectorSet(V1.vector4_f32[0] * V2.vector4_f32[0] + V3.vector4_f32[0],
+		V1.vector4_f32[1] * V2.vector4_f32[1] + V3.vector4_f32[1],
+		V1.vector4_f32[2] * V2.vector4_f32[2] + V3.vector4_f32[2],
+		V1.vector4_f32[3] * V2.vector4_f32[3] + V3.vector4_f32[3]);
+#elif defined(PMATH_BACKEND_NEON) && defined(PMATH_NEON_A64)
+	return vfmaq_f32(V3, V1, V2);
+#elif defined(PMATH_BACKEND_NEON)
+	return vmlaq_f32(V3, V1, V2);
+#elif defined(PMATH_BACKEND_AVX2)
+	return _mm_fmadd_ps(V1, V2, V3);
+#else
+	return _mm_add_ps(_mm_mul_ps(V1, V2), V3);
+#endif
+}
+
+// V3 - V1 * V2
+inline XMVECTOR XM_CALLCONV XMVectorNegativeMultiplySubtract(FXMVECTOR V1, FXMVECTOR V2, FXMVECTOR V3)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return XMVectorSubtract(V3, XMVectorMultiply(V1, V2));
+#elif defined(PMATH_BACKEND_NEON) && defined(PMATH_NEON_A64)
+	return vfmsq_f32(V3, V1, V2);
+#elif defined(PMATH_BACKEND_NEON)
+	return vmlsq_f32(V3, V1, V2);
+#elif defined(PMATH_BACKEND_AVX2)
+	return _mm_fnmadd_ps(V1, V2, V3);
+#else
+	return _mm_sub_ps(V3, _mm_mul_ps(V1, V2));
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorScale(FXMVECTOR V, float scaleFactor)
+{
+	return XMVectorMultiply(V, XMVectorReplicate(scaleFactor));
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorNegate(FXMVECTOR V)
+{
+#if defined(PMATH_BACKEND_NEON)
+	return vnegq_f32(V);
+#else
+	return XMVectorSubtract(XMVectorZero(), V);
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorMin(FXMVECTOR V1, FXMVECTOR V2)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	XMVECTOR r;
+	for (int i = 0; i < 4; ++i)
+		r.vector4_f32[i] = V1.vector4_f32[i] < V2.vector4_f32[i] ? V1.vector4_f32[i] : V2.vector4_f32[i];
+	return r;
+#elif defined(PMATH_BACKEND_NEON)
+	return vminq_f32(V1, V2);
+#else
+	return _mm_min_ps(V1, V2);
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorMax(FXMVECTOR V1, FXMVECTOR V2)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	XMVECTOR r;
+	for (int i = 0; i < 4; ++i)
+		r.vector4_f32[i] = V1.vector4_f32[i] > V2.vector4_f32[i] ? V1.vector4_f32[i] : V2.vector4_f32[i];
+	return r;
+#elif defined(PMATH_BACKEND_NEON)
+	return vmaxq_f32(V1, V2);
+#else
+	return _mm_max_ps(V1, V2);
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorClamp(FXMVECTOR V, FXMVECTOR Min, FXMVECTOR Max)
+{
+	return XMVectorMin(Max, XMVectorMax(Min, V));
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorSqrt(FXMVECTOR V)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return XMVectorSet(std::sqrt(V.vector4_f32[0]), std::sqrt(V.vector4_f32[1]),
+		std::sqrt(V.vector4_f32[2]), std::sqrt(V.vector4_f32[3]));
+#elif defined(PMATH_BACKEND_NEON) && defined(PMATH_NEON_A64)
+	return vsqrtq_f32(V);
+#elif defined(PMATH_BACKEND_NEON)
+	// sqrt(v) = v * rsqrt(v)，v为0时rsqrt为无穷大，需要单独处理
+	float32x4_t s = vrsqrteq_f32(V);
+	s = vmulq_f32(s, vrsqrtsq_f32(vmulq_f32(V, s), s));
+	s = vmulq_f32(s, vrsqrtsq_f32(vmulq_f32(V, s), s));
+	uint32x4_t zero = vceqq_f32(V, vdupq_n_f32(0.0f));
+	return vbslq_f32(zero, V, vmulq_f32(V, s));
+#else
+	return _mm_sqrt_ps(V);
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorReciprocal(FXMVECTOR V)
+{
+	return XMVectorDivide(XMVectorReplicate(1.0f), V);
+}
+
+// 就近取整，恰好在中间时取偶数
+inline XMVECTOR XM_CALLCONV XMVectorRound(FXMVECTOR V)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return XMVectorSet(std::nearbyint(V.vector4_f32[0]), std::nearbyint(V.vector4_f32[1]),
+		std::nearbyint(V.vector4_f32[2]), std::nearbyint(V.vector4_f32[3]));
+#elif defined(PMATH_BACKEND_NEON) && defined(PMATH_NEON_A64)
+	return vrndnq_f32(V);
+#elif defined(PMATH_BACKEND_NEON)
+	// 加减2^23把小数部分舍掉，绝对值不小于2^23的数已经是整数
+	uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(V), vdupq_n_u32(0x80000000));
+	float32x4_t magic = vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(g_XMNoFraction.v), sign));
+	float32x4_t r = vsubq_f32(vaddq_f32(V, magic), magic);
+	uint32x4_t small = vcltq_f32(vabsq_f32(V), g_XMNoFraction.v);
+	return vbslq_f32(small, r, V);
+#elif defined(PMATH_BACKEND_AVX2)
+	return _mm_round_ps(V, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+#else
+	// 转换为整数时按MXCSR的默认模式就近取整，绝对值不小于2^23的数已经是整数，保持不变
+	__m128 r = _mm_cvtepi32_ps(_mm_cvtps_epi32(V));
+	__m128 small = _mm_cmplt_ps(_mm_and_ps(V, g_XMAbsMask.v), g_XMNoFraction.v);
+	return _mm_or_ps(_mm_and_ps(small, r), _mm_andnot_ps(small, V));
+#endif
+}
+
+//
+// 按位运算与比较，比较结果的每个分量为全0或全1
+//
+
+inline XMVECTOR XM_CALLCONV XMVectorAndInt(FXMVECTOR V1, FXMVECTOR V2)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	XMVECTOR r;
+	for (int i = 0; i < 4; ++i)
+		r.vector4_u32[i] = V1.vector4_u32[i] & V2.vector4_u32[i];
+	return r;
+#elif defined(PMATH_BACKEND_NEON)
+	return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(V1), vreinterpretq_u32_f32(V2)));
+#else
+	return _mm_and_ps(V1, V2);
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorOrInt(FXMVECTOR V1, FXMVECTOR V2)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	XMVECTOR r;
+	for (int i = 0; i < 4; ++i)
+		r.vector4_u32[i] = V1.vector4_u32[i] | V2.vector4_u32[i];
+	return r;
+#elif defined(PMATH_BACKEND_NEON)
+	return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(V1), vreinterpretq_u32_f32(V2)));
+#else
+	return _mm_or_ps(V1, V2);
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorLessOrEqual(FXMVECTOR V1, FXMVECTOR V2)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	XMVECTOR r;
+	for (int i = 0; i < 4; ++i)
+		r.vector4_u32[i] = V1.vector4_f32[i] <= V2.vector4_f32[i] ? 0xFFFFFFFF : 0;
+	return r;
+#elif defined(PMATH_BACKEND_NEON)
+	return vreinterpretq_f32_u32(vcleq_f32(V1, V2));
+#else
+	return _mm_cmple_ps(V1, V2);
+#endif
+}
+
+// Control的分量为全1时取V2，否则取V1
+inline XMVECTOR XM_CALLCONV XMVectorSelect(FXMVECTOR V1, FXMVECTOR V2, FXMVECTOR Control)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	XMVECTOR r;
+	for (int i = 0; i < 4; ++i)
+		r.vector4_u32[i] = (V1.vector4_u32[i] & ~Control.vector4_u32[i]) | (V2.vector4_u32[i] & Control.vector4_u32[i]);
+	return r;
+#elif defined(PMATH_BACKEND_NEON)
+	return vbslq_f32(vreinterpretq_u32_f32(Control), V2, V1);
+#elif defined(PMATH_BACKEND_AVX2)
+	return _mm_blendv_ps(V1, V2, Control);
+#else
+	return _mm_or_ps(_mm_andnot_ps(Control, V1), _mm_and_ps(V2, Control));
+#endif
+}
+
+//
+// 三角函数
+//
+
+// 把角度约化到[-pi, pi]
+inline XMVECTOR XM_CALLCONV XMVectorModAngles(FXMVECTOR Angles)
+{
+	XMVECTOR v = XMVectorRound(XMVectorMultiply(Angles, g_XMReciprocalTwoPi));
+	return XMVectorNegativeMultiplySubtract(g_XMTwoPi, v, Angles);
+}
+
+// 与DirectXMath相同的11次(正弦)和10次(余弦)极小化多项式
+inline void XM_CALLCONV XMVectorSinCos(XMVECTOR* pSin, XMVECTOR* pCos, FXMVECTOR V)
+{
+	XMVECTOR x = XMVectorModAngles(V);
+
+	// 利用sin(y) = sin(pi - y)把x约化到[-pi/2, pi/2]，此时余弦要变号
+	XMVECTOR sign = XMVectorAndInt(x, g_XMNegativeZero);
+	XMVECTOR c = XMVectorOrInt(g_XMPi, sign);
+	XMVECTOR absx = XMVectorAndInt(x, g_XMAbsMask);
+	XMVECTOR rflx = XMVectorSubtract(c, x);
+	XMVECTOR comp = XMVectorLessOrEqual(absx, g_XMHalfPi);
+	x = XMVectorSelect(rflx, x, comp);
+	sign = XMVectorSelect(g_XMNegativeOne, g_XMOne, comp);
+	XMVECTOR x2 = XMVectorMultiply(x, x);
+
+	XMVECTOR s = XMVectorMultiplyAdd(XMVectorReplicate(-2.3889859e-08f), x2, XMVectorReplicate(2.7525562e-06f));
+	s = XMVectorMultiplyAdd(s, x2, XMVectorReplicate(-0.00019840874f));
+	s = XMVectorMultiplyAdd(s, x2, XMVectorReplicate(0.0083333310f));
+	s = XMVectorMultiplyAdd(s, x2, XMVectorReplicate(-0.16666667f));
+	s = XMVectorMultiplyAdd(s, x2, g_XMOne);
+	*pSin = XMVectorMultiply(s, x);
+
+	XMVECTOR k = XMVectorMultiplyAdd(XMVectorReplicate(-2.6051615e-07f), x2, XMVectorReplicate(2.4760495e-05f));
+	k = XMVectorMultiplyAdd(k, x2, XMVectorReplicate(-0.0013888378f));
+	k = XMVectorMultiplyAdd(k, x2, XMVectorReplicate(0.041666638f));
+	k = XMVectorMultiplyAdd(k, x2, XMVectorReplicate(-0.5f));
+	k = XMVectorMultiplyAdd(k, x2, g_XMOne);
+	*pCos = XMVectorMultiply(k, sign);
+}
+
+inline void XMScalarSinCos(float* pSin, float* pCos, float Value)
+{
+	// 约化到[-pi, pi]
+	float quotient = XM_1DIV2PI * Value;
+	if (Value >= 0.0f)
+		quotient = (float)((int)(quotient + 0.5f));
+	else
+		quotient = (float)((int)(quotient - 0.5f));
+	float y = Value - XM_2PI * quotient;
+
+	// 再约化到[-pi/2, pi/2]
+	float sign;
+	if (y > XM_PIDIV2)
+	{
+		y = XM_PI - y;
+		sign = -1.0f;
+	}
+	else if (y < -XM_PIDIV2)
+	{
+		y = -XM_PI - y;
+		sign = -1.0f;
+	}
+	else
+	{
+		sign = +1.0f;
+	}
+
+	float y2 = y * y;
+	*pSin = (((((-2.3889859e-08f * y2 + 2.7525562e-06f) * y2 - 0.00019840874f) * y2 + 0.0083333310f) * y2 - 0.16666667f) * y2 + 1.0f) * y;
+	float p = ((((-2.6051615e-07f * y2 + 2.4760495e-05f) * y2 - 0.0013888378f) * y2 + 0.041666638f) * y2 - 0.5f) * y2 + 1.0f;
+	*pCos = sign * p;
+}
+
+//
+// 几何运算，点积和长度的结果复制到所有分量。
+// x86上不用SSE4.1的dpps：它的延迟比两次重排加两次加法更长，在剔除这类连续求点积的循环中反而更慢
+//
+
+inline XMVECTOR XM_CALLCONV XMVector4Dot(FXMVECTOR V1, FXMVECTOR V2)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return XMVectorReplicate(V1.vector4_f32[0] * V2.vector4_f32[0] + V1.vector4_f32[1] * V2.vector4_f32[1] +
+		V1.vector4_f32[2] * V2.vector4_f32[2] + V1.vector4_f32[3] * V2.vector4_f32[3]);
+#elif defined(PMATH_BACKEND_NEON)
+	float32x4_t m = vmulq_f32(V1, V2);
+	float32x2_t s = vadd_f32(vget_low_f32(m), vget_high_f32(m));
+	s = vpadd_f32(s, s);
+	return vcombine_f32(s, s);
+#else
+	__m128 m = _mm_mul_ps(V1, V2);
+	m = _mm_add_ps(m, PMATH_PERMUTE_PS(m, _MM_SHUFFLE(1, 0, 3, 2)));
+	return _mm_add_ps(m, PMATH_PERMUTE_PS(m, _MM_SHUFFLE(2, 3, 0, 1)));
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMVector3Dot(FXMVECTOR V1, FXMVECTOR V2)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return XMVectorReplicate(V1.vector4_f32[0] * V2.vector4_f32[0] + V1.vector4_f32[1] * V2.vector4_f32[1] +
+		V1.vector4_f32[2] * V2.vector4_f32[2]);
+#elif defined(PMATH_BACKEND_NEON)
+	float32x4_t m = vmulq_f32(V1, V2);
+	float32x2_t xy = vpadd_f32(vget_low_f32(m), vget_low_f32(m));
+	float32x2_t s = vadd_f32(xy, vdup_lane_f32(vget_high_f32(m), 0));
+	return vcombine_f32(s, s);
+#else
+	__m128 m = _mm_and_ps(_mm_mul_ps(V1, V2), g_XMMask3.v);
+	m = _mm_add_ps(m, PMATH_PERMUTE_PS(m, _MM_SHUFFLE(1, 0, 3, 2)));
+	return _mm_add_ps(m, PMATH_PERMUTE_PS(m, _MM_SHUFFLE(2, 3, 0, 1)));
+#endif
+}
+
+// w分量为0
+inline XMVECTOR XM_CALLCONV XMVector3Cross(FXMVECTOR V1, FXMVECTOR V2)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	return XMVectorSet(
+		V1.vector4_f32[1] * V2.vector4_f32[2] - V1.vector4_f32[2] * V2.vector4_f32[1],
+		V1.vector4_f32[2] * V2.vector4_f32[0] - V1.vector4_f32[0] * V2.vector4_f32[2],
+		V1.vector4_f32[0] * V2.vector4_f32[1] - V1.vector4_f32[1] * V2.vector4_f32[0],
+		0.0f);
+#elif defined(PMATH_BACKEND_NEON)
+	float32x4_t a = Internal::PermuteNEON<1, 2, 0, 3>(V1);
+	float32x4_t b = Internal::PermuteNEON<2, 0, 1, 3>(V2);
+	float32x4_t r = vmulq_f32(a, b);
+	a = Internal::PermuteNEON<1, 2, 0, 3>(a);
+	b = Internal::PermuteNEON<2, 0, 1, 3>(b);
+	r = XMVectorNegativeMultiplySubtract(a, b, r);
+	return XMVectorAndInt(r, g_XMMask3.v);
+#else
+	// (y1, z1, x1) * (z2, x2, y2) - (z1, x1, y1) * (y2, z2, x2)
+	__m128 a = PMATH_PERMUTE_PS(V1, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 b = PMATH_PERMUTE_PS(V2, _MM_SHUFFLE(3, 1, 0, 2));
+	__m128 r = _mm_mul_ps(a, b);
+	a = PMATH_PERMUTE_PS(a, _MM_SHUFFLE(3, 0, 2, 1));
+	b = PMATH_PERMUTE_PS(b, _MM_SHUFFLE(3, 1, 0, 2));
+	r = XMVectorNegativeMultiplySubtract(a, b, r);
+	return _mm_and_ps(r, g_XMMask3.v);
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMVector3LengthSq(FXMVECTOR V)
+{
+	return XMVector3Dot(V, V);
+}
+
+inline XMVECTOR XM_CALLCONV XMVector3Length(FXMVECTOR V)
+{
+	return XMVectorSqrt(XMVector3Dot(V, V));
+}
+
+// 长度为0的向量返回0
+inline XMVECTOR XM_CALLCONV XMVector3Normalize(FXMVECTOR V)
+{
+	XMVECTOR length = XMVector3Length(V);
+	XMVECTOR isZero = XMVectorLessOrEqual(length, XMVectorZero());
+	return XMVectorSelect(XMVectorDivide(V, length), XMVectorZero(), isZero);
+}
+
+// 平面(a, b, c, d)除以法线(a, b, c)的长度，法线长度为0时返回0
+inline XMVECTOR XM_CALLCONV XMPlaneNormalize(FXMVECTOR P)
+{
+	XMVECTOR length = XMVector3Length(P);
+	XMVECTOR isZero = XMVectorLessOrEqual(length, XMVectorZero());
+	return XMVectorSelect(XMVectorDivide(P, length), XMVectorZero(), isZero);
+}
+
+// (x, y, z, 1) * M
+inline XMVECTOR XM_CALLCONV XMVector3Transform(FXMVECTOR V, FXMMATRIX M)
+{
+	XMVECTOR r = XMVectorMultiplyAdd(XMVectorSplatZ(V), M.r[2], M.r[3]);
+	r = XMVectorMultiplyAdd(XMVectorSplatY(V), M.r[1], r);
+	return XMVectorMultiplyAdd(XMVectorSplatX(V), M.r[0], r);
+}
+
+// (x, y, z, 1) * M，再除以w
+inline XMVECTOR XM_CALLCONV XMVector3TransformCoord(FXMVECTOR V, FXMMATRIX M)
+{
+	XMVECTOR r = XMVector3Transform(V, M);
+	return XMVectorDivide(r, XMVectorSplatW(r));
+}
+
+// (x, y, z, 0) * M
+inline XMVECTOR XM_CALLCONV XMVector3TransformNormal(FXMVECTOR V, FXMMATRIX M)
+{
+	XMVECTOR r = XMVectorMultiply(XMVectorSplatZ(V), M.r[2]);
+	r = XMVectorMultiplyAdd(XMVectorSplatY(V), M.r[1], r);
+	return XMVectorMultiplyAdd(XMVectorSplatX(V), M.r[0], r);
+}
+
+//
+// 矩阵运算
+//
+
+inline XMMATRIX XM_CALLCONV XMMatrixIdentity()
+{
+	return XMMATRIX(g_XMIdentityR0.v, g_XMIdentityR1.v, g_XMIdentityR2.v, g_XMIdentityR3.v);
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixTranspose(FXMMATRIX M)
+{
+#if defined(PMATH_BACKEND_SCALAR)
+	XMMATRIX r;
+	for (int i = 0; i < 4; ++i)
+		for (int j = 0; j < 4; ++j)
+			r.r[i].vector4_f32[j] = M.r[j].vector4_f32[i];
+	return r;
+#elif defined(PMATH_BACKEND_NEON)
+	float32x4x2_t p0 = vzipq_f32(M.r[0], M.r[2]);
+	float32x4x2_t p1 = vzipq_f32(M.r[1], M.r[3]);
+	float32x4x2_t t0 = vzipq_f32(p0.val[0], p1.val[0]);
+	float32x4x2_t t1 = vzipq_f32(p0.val[1], p1.val[1]);
+	return XMMATRIX(t0.val[0], t0.val[1], t1.val[0], t1.val[1]);
+#else
+	__m128 t0 = _mm_shuffle_ps(M.r[0], M.r[1], _MM_SHUFFLE(1, 0, 1, 0));	// x0 y0 x1 y1
+	__m128 t2 = _mm_shuffle_ps(M.r[0], M.r[1], _MM_SHUFFLE(3, 2, 3, 2));	// z0 w0 z1 w1
+	__m128 t1 = _mm_shuffle_ps(M.r[2], M.r[3], _MM_SHUFFLE(1, 0, 1, 0));	// x2 y2 x3 y3
+	__m128 t3 = _mm_shuffle_ps(M.r[2], M.r[3], _MM_SHUFFLE(3, 2, 3, 2));	// z2 w2 z3 w3
+	return XMMATRIX(
+		_mm_shuffle_ps(t0, t1, _MM_SHUFFLE(2, 0, 2, 0)),
+		_mm_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 1, 3, 1)),
+		_mm_shuffle_ps(t2, t3, _MM_SHUFFLE(2, 0, 2, 0)),
+		_mm_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 1, 3, 1)));
+#endif
+}
+
+// 先变换M1再变换M2
+inline XMMATRIX XM_CALLCONV XMMatrixMultiply(FXMMATRIX M1, CXMMATRIX M2)
+{
+#if defined(PMATH_BACKEND_AVX2)
+	// 一次算两行：M1的两行放在256位寄存器的高低两半，M2的同一行复制到两半
+	__m256 a01 = _mm256_insertf128_ps(_mm256_castps128_ps256(M1.r[0]), M1.r[1], 1);
+	__m256 a23 = _mm256_insertf128_ps(_mm256_castps128_ps256(M1.r[2]), M1.r[3], 1);
+	__m256 b01 = _mm256_insertf128_ps(_mm256_castps128_ps256(M2.r[0]), M2.r[1], 1);
+	__m256 b23 = _mm256_insertf128_ps(_mm256_castps128_ps256(M2.r[2]), M2.r[3], 1);
+	__m256 b = _mm256_permute2f128_ps(b01, b01, 0x00);
+	__m256 c01 = _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, _MM_SHUFFLE(0, 0, 0, 0)), b);
+	__m256 c23 = _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, _MM_SHUFFLE(0, 0, 0, 0)), b);
+	b = _mm256_permute2f128_ps(b01, b01, 0x11);
+	c01 = _mm256_fmadd_ps(_mm256_shuffle_ps(a01, a01, _MM_SHUFFLE(1, 1, 1, 1)), b, c01);
+	c23 = _mm256_fmadd_ps(_mm256_shuffle_ps(a23, a23, _MM_SHUFFLE(1, 1, 1, 1)), b, c23);
+	b = _mm256_permute2f128_ps(b23, b23, 0x00);
+	c01 = _mm256_fmadd_ps(_mm256_shuffle_ps(a01, a01, _MM_SHUFFLE(2, 2, 2, 2)), b, c01);
+	c23 = _mm256_fmadd_ps(_mm256_shuffle_ps(a23, a23, _MM_SHUFFLE(2, 2, 2, 2)), b, c23);
+	b = _mm256_permute2f128_ps(b23, b23, 0x11);
+	c01 = _mm256_fmadd_ps(_mm256_shuffle_ps(a01, a01, _MM_SHUFFLE(3, 3, 3, 3)), b, c01);
+	c23 = _mm256_fmadd_ps(_mm256_shuffle_ps(a23, a23, _MM_SHUFFLE(3, 3, 3, 3)), b, c23);
+	return XMMATRIX(_mm256_castps256_ps128(c01), _mm256_extractf128_ps(c01, 1),
+		_mm256_castps256_ps128(c23), _mm256_extractf128_ps(c23, 1));
+#elif defined(PMATH_BACKEND_NEON)
+	XMMATRIX r;
+	for (int i = 0; i < 4; ++i)
+	{
+		float32x2_t lo = vget_low_f32(M1.r[i]);
+		float32x2_t hi = vget_high_f32(M1.r[i]);
+		float32x4_t c = vmulq_lane_f32(M2.r[0], lo, 0);
+#if defined(PMATH_NEON_A64)
+		c = vfmaq_lane_f32(c, M2.r[1], lo, 1);
+		c = vfmaq_lane_f32(c, M2.r[2], hi, 0);
+		c = vfmaq_lane_f32(c, M2.r[3], hi, 1);
+#else
+		c = vmlaq_lane_f32(c, M2.r[1], lo, 1);
+		c = vmlaq_lane_f32(c, M2.r[2], hi, 0);
+		c = vmlaq_lane_f32(c, M2.r[3], hi, 1);
+#endif
+		r.r[i] = c;
+	}
+	return r;
+#else
+	// 结果的第i行为M1第i行的各分量分别乘M2的各行再相加
+	XMMATRIX r;
+	for (int i = 0; i < 4; ++i)
+	{
+		XMVECTOR c = XMVectorMultiply(XMVectorSplatX(M1.r[i]), M2.r[0]);
+		c = XMVectorMultiplyAdd(XMVectorSplatY(M1.r[i]), M2.r[1], c);
+		c = XMVectorMultiplyAdd(XMVectorSplatZ(M1.r[i]), M2.r[2], c);
+		r.r[i] = XMVectorMultiplyAdd(XMVectorSplatW(M1.r[i]), M2.r[3], c);
+	}
+	return r;
+#endif
+}
+
+// 伴随矩阵除以行列式。不在热路径上，各后端共用标量实现，结果完全一致
+inline XMMATRIX XM_CALLCONV XMMatrixInverse(XMVECTOR* pDeterminant, FXMMATRIX M)
+{
+	XMFLOAT4 rows[4];
+	for (int i = 0; i < 4; ++i)
+		XMStoreFloat4(&rows[i], M.r[i]);
+	const float* m = &rows[0].x;
+	float inv[16];
+	inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+	inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+	inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+	inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+	inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+	inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+	inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+	inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+	inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+	inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+	inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+	inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+	inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+	inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+	inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+	inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+	float det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+	if (pDeterminant)
+		*pDeterminant = XMVectorReplicate(det);
+	float invDet = 1.0f / det;
+	for (float& v : inv)
+		v *= invDet;
+	return XMMATRIX(inv);
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixTranslation(float offsetX, float offsetY, float offsetZ)
+{
+	return XMMATRIX(g_XMIdentityR0.v, g_XMIdentityR1.v, g_XMIdentityR2.v, XMVectorSet(offsetX, offsetY, offsetZ, 1.0f));
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixScaling(float scaleX, float scaleY, float scaleZ)
+{
+	return XMMATRIX(XMVectorSet(scaleX, 0.0f, 0.0f, 0.0f), XMVectorSet(0.0f, scaleY, 0.0f, 0.0f),
+		XMVectorSet(0.0f, 0.0f, scaleZ, 0.0f), g_XMIdentityR3.v);
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixRotationX(float angle)
+{
+	float s, c;
+	XMScalarSinCos(&s, &c, angle);
+	return XMMATRIX(g_XMIdentityR0.v, XMVectorSet(0.0f, c, s, 0.0f), XMVectorSet(0.0f, -s, c, 0.0f), g_XMIdentityR3.v);
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixRotationY(float angle)
+{
+	float s, c;
+	XMScalarSinCos(&s, &c, angle);
+	return XMMATRIX(XMVectorSet(c, 0.0f, -s, 0.0f), g_XMIdentityR1.v, XMVectorSet(s, 0.0f, c, 0.0f), g_XMIdentityR3.v);
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixRotationZ(float angle)
+{
+	float s, c;
+	XMScalarSinCos(&s, &c, angle);
+	return XMMATRIX(XMVectorSet(c, s, 0.0f, 0.0f), XMVectorSet(-s, c, 0.0f, 0.0f), g_XMIdentityR2.v, g_XMIdentityR3.v);
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixLookToLH(FXMVECTOR EyePosition, FXMVECTOR EyeDirection, FXMVECTOR UpDirection)
+{
+	XMVECTOR r2 = XMVector3Normalize(EyeDirection);
+	XMVECTOR r0 = XMVector3Normalize(XMVector3Cross(UpDirection, r2));
+	XMVECTOR r1 = XMVector3Cross(r2, r0);
+	XMVECTOR negEye = XMVectorNegate(EyePosition);
+	XMMATRIX M(
+		XMVectorSelect(XMVector3Dot(r0, negEye), r0, g_XMSelect1110.v),
+		XMVectorSelect(XMVector3Dot(r1, negEye), r1, g_XMSelect1110.v),
+		XMVectorSelect(XMVector3Dot(r2, negEye), r2, g_XMSelect1110.v),
+		g_XMIdentityR3.v);
+	return XMMatrixTranspose(M);
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixLookAtLH(FXMVECTOR EyePosition, FXMVECTOR FocusPosition, FXMVECTOR UpDirection)
+{
+	return XMMatrixLookToLH(EyePosition, XMVectorSubtract(FocusPosition, EyePosition), UpDirection);
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixPerspectiveFovLH(float FovAngleY, float AspectRatio, float NearZ, float FarZ)
+{
+	float sinFov, cosFov;
+	XMScalarSinCos(&sinFov, &cosFov, 0.5f * FovAngleY);
+	float height = cosFov / sinFov;
+	float width = height / AspectRatio;
+	float range = FarZ / (FarZ - NearZ);
+	return XMMATRIX(
+		width, 0.0f, 0.0f, 0.0f,
+		0.0f, height, 0.0f, 0.0f,
+		0.0f, 0.0f, range, 1.0f,
+		0.0f, 0.0f, -range * NearZ, 0.0f);
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixOrthographicLH(float ViewWidth, float ViewHeight, float NearZ, float FarZ)
+{
+	float range = 1.0f / (FarZ - NearZ);
+	return XMMATRIX(
+		2.0f / ViewWidth, 0.0f, 0.0f, 0.0f,
+		0.0f, 2.0f / ViewHeight, 0.0f, 0.0f,
+		0.0f, 0.0f, range, 0.0f,
+		0.0f, 0.0f, -range * NearZ, 1.0f);
+}
+
+inline XMMATRIX XM_CALLCONV XMLoadFloat4x4(const XMFLOAT4X4* pSource)
+{
+	return XMMATRIX(
+		XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pSource->m[0])),
+		XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pSource->m[1])),
+		XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pSource->m[2])),
+		XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pSource->m[3])));
+}
+
+inline void XM_CALLCONV XMStoreFloat4x4(XMFLOAT4X4* pDestination, FXMMATRIX M)
+{
+	for (int i = 0; i < 4; ++i)
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(pDestination->m[i]), M.r[i]);
+}
+
+//
+// 四元数，(x, y, z)为虚部，w为实部。与DirectXMath相同，XMQuaternionMultiply(Q1, Q2)表示先旋转Q1再旋转Q2。
+// 摄像机等每帧只调用几次，各后端共用标量实现
+//
+
+inline XMVECTOR XM_CALLCONV XMQuaternionIdentity()
+{
+	return g_XMIdentityR3.v;
+}
+
+inline XMVECTOR XM_CALLCONV XMQuaternionMultiply(FXMVECTOR Q1, FXMVECTOR Q2)
+{
+	XMFLOAT4 a, b;
+	XMStoreFloat4(&a, Q1);
+	XMStoreFloat4(&b, Q2);
+	return XMVectorSet(
+		b.w * a.x + b.x * a.w + b.y * a.z - b.z * a.y,
+		b.w * a.y - b.x * a.z + b.y * a.w + b.z * a.x,
+		b.w * a.z + b.x * a.y - b.y * a.x + b.z * a.w,
+		b.w * a.w - b.x * a.x - b.y * a.y - b.z * a.z);
+}
+
+inline XMVECTOR XM_CALLCONV XMQuaternionConjugate(FXMVECTOR Q)
+{
+	return XMVectorMultiply(Q, XMVectorSet(-1.0f, -1.0f, -1.0f, 1.0f));
+}
+
+// 长度为0的四元数返回0
+inline XMVECTOR XM_CALLCONV XMQuaternionNormalize(FXMVECTOR Q)
+{
+	XMVECTOR length = XMVectorSqrt(XMVector4Dot(Q, Q));
+	XMVECTOR isZero = XMVectorLessOrEqual(length, XMVectorZero());
+	return XMVectorSelect(XMVectorDivide(Q, length), XMVectorZero(), isZero);
+}
+
+// NormalAxis需为单位向量
+inline XMVECTOR XM_CALLCONV XMQuaternionRotationNormal(FXMVECTOR NormalAxis, float Angle)
+{
+	float s, c;
+	XMScalarSinCos(&s, &c, 0.5f * Angle);
+	return XMVectorSetW(XMVectorScale(NormalAxis, s), c);
+}
+
+inline XMVECTOR XM_CALLCONV XMQuaternionRotationAxis(FXMVECTOR Axis, float Angle)
+{
+	return XMQuaternionRotationNormal(XMVector3Normalize(Axis), Angle);
+}
+
+// 旋转矩阵(不含缩放)转换为四元数，按最大的对角元选择分支以保证精度
+inline XMVECTOR XM_CALLCONV XMQuaternionRotationMatrix(FXMMATRIX M)
+{
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, M);
+	float trace = m._11 + m._22 + m._33;
+	if (trace > 0.0f)
+	{
+		float s = 2.0f * std::sqrt(trace + 1.0f);
+		return XMVectorSet((m._23 - m._32) / s, (m._31 - m._13) / s, (m._12 - m._21) / s, 0.25f * s);
+	}
+	if (m._11 > m._22 && m._11 > m._33)
+	{
+		float s = 2.0f * std::sqrt(1.0f + m._11 - m._22 - m._33);
+		return XMVectorSet(0.25f * s, (m._12 + m._21) / s, (m._31 + m._13) / s, (m._23 - m._32) / s);
+	}
+	if (m._22 > m._33)
+	{
+		float s = 2.0f * std::sqrt(1.0f + m._22 - m._11 - m._33);
+		return XMVectorSet((m._12 + m._21) / s, 0.25f * s, (m._23 + m._32) / s, (m._31 - m._13) / s);
+	}
+	float s = 2.0f * std::sqrt(1.0f + m._33 - m._11 - m._22);
+	return XMVectorSet((m._31 + m._13) / s, (m._23 + m._32) / s, 0.25f * s, (m._12 - m._21) / s);
+}
+
+// Q需为单位四元数
+inline XMMATRIX XM_CALLCONV XMMatrixRotationQuaternion(FXMVECTOR Q)
+{
+	XMFLOAT4 q;
+	XMStoreFloat4(&q, Q);
+	float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+	return XMMATRIX(
+		1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f,
+		2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f,
+		2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+// 用单位四元数旋转(x, y, z)，w分量为0
+inline XMVECTOR XM_CALLCONV XMVector3Rotate(FXMVECTOR V, FXMVECTOR RotationQuaternion)
+{
+	XMVECTOR A = XMVectorAndInt(V, g_XMMask3.v);
+	XMVECTOR Q = XMQuaternionConjugate(RotationQuaternion);
+	return XMQuaternionMultiply(XMQuaternionMultiply(Q, A), RotationQuaternion);
+}
+
+//
+// XMMATRIX的成员函数
+//
+
+inline XMMATRIX::XMMATRIX(float m00, float m01, float m02, float m03,
+	float m10, float m11, float m12, float m13,
+	float m20, float m21, float m22, float m23,
+	float m30, float m31, float m32, float m33)
+{
+	r[0] = XMVectorSet(m00, m01, m02, m03);
+	r[1] = XMVectorSet(m10, m11, m12, m13);
+	r[2] = XMVectorSet(m20, m21, m22, m23);
+	r[3] = XMVectorSet(m30, m31, m32, m33);
+}
+
+inline XMMATRIX::XMMATRIX(const float* pArray)
+{
+	for (int i = 0; i < 4; ++i)
+		r[i] = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pArray + i * 4));
+}
+
+inline XMMATRIX& XMMATRIX::operator*=(FXMMATRIX M)
+{
+	*this = XMMatrixMultiply(*this, M);
+	return *this;
+}
+
+inline XMMATRIX XMMATRIX::operator*(FXMMATRIX M) const
+{
+	return XMMatrixMultiply(*this, M);
+}
+
+//
+// XMVECTOR的运算符
+//
+
+#ifndef _XM_NO_XMVECTOR_OVERLOADS_
+inline XMVECTOR XM_CALLCONV operator+(FXMVECTOR V) { return V; }
+inline XMVECTOR XM_CALLCONV operator-(FXMVECTOR V) { return XMVectorNegate(V); }
+inline XMVECTOR& XM_CALLCONV operator+=(XMVECTOR& V1, FXMVECTOR V2) { V1 = XMVectorAdd(V1, V2); return V1; }
+inline XMVECTOR& XM_CALLCONV operator-=(XMVECTOR& V1, FXMVECTOR V2) { V1 = XMVectorSubtract(V1, V2); return V1; }
+inline XMVECTOR& XM_CALLCONV operator*=(XMVECTOR& V1, FXMVECTOR V2) { V1 = XMVectorMultiply(V1, V2); return V1; }
+inline XMVECTOR& XM_CALLCONV operator/=(XMVECTOR& V1, FXMVECTOR V2) { V1 = XMVectorDivide(V1, V2); return V1; }
+inline XMVECTOR& operator*=(XMVECTOR& V, float S) { V = XMVectorScale(V, S); return V; }
+inline XMVECTOR& operator/=(XMVECTOR& V, float S) { V = XMVectorDivide(V, XMVectorReplicate(S)); return V; }
+inline XMVECTOR XM_CALLCONV operator+(FXMVECTOR V1, FXMVECTOR V2) { return XMVectorAdd(V1, V2); }
+inline XMVECTOR XM_CALLCONV operator-(FXMVECTOR V1, FXMVECTOR V2) { return XMVectorSubtract(V1, V2); }
+inline XMVECTOR XM_CALLCONV operator*(FXMVECTOR V1, FXMVECTOR V2) { return XMVectorMultiply(V1, V2); }
+inline XMVECTOR XM_CALLCONV operator/(FXMVECTOR V1, FXMVECTOR V2) { return XMVectorDivide(V1, V2); }
+inline XMVECTOR XM_CALLCONV operator*(FXMVECTOR V, float S) { return XMVectorScale(V, S); }
+inline XMVECTOR XM_CALLCONV operator*(float S, FXMVECTOR V) { return XMVectorScale(V, S); }
+inline XMVECTOR XM_CALLCONV operator/(FXMVECTOR V, float S) { return XMVectorDivide(V, XMVectorReplicate(S)); }
+#endif
+
+}	// inline namespace PMATH_NAMESPACE
+}	// namespace DirectX
+
+#endif	// !PMATH_BACKEND_DIRECTXMATH
+
+#endif
@@ -0,0 +1,194 @@
+#ifndef STANDINDEVICE_H
+#define STANDINDEVICE_H
+
+#include "PlatformTypes.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// 单元测试用的替身设备和上下文，代替ID3D11Device/ID3D11DeviceContext1中用到的几个函数，签名与之相同。
+// 缓冲区内容保存在内存中，上下文记录每次Map/Unmap和绘制调用，测试据此检查写入的数据和绘制参数。
+// 绘制记录中带有当时顶点着色器b0绑定的缓冲区和常量范围，按偏移绑定时按D3D11.1的规则检查对齐和越界。
+// WRITE_DISCARD映射时先用0xCD填满缓冲区，模拟重命名后内容未定义，漏写的部分可以被检查出来
+
+// PlatformTypes.h中只有声明，这里给出定义。与COM对象一样用引用计数管理
+struct ID3D11Buffer
+{
+	D3D11_BUFFER_DESC desc;
+	std::vector<uint8_t> data;
+	uint32_t refCount;
+
+	uint32_t AddRef() { return ++refCount; }
+	uint32_t Release()
+	{
+		uint32_t count = --refCount;
+		if (count == 0)
+			delete this;
+		return count;
+	}
+};
+
+class StandInDevice
+{
+public:
+	HRESULT CreateBuffer(const D3D11_BUFFER_DESC* pDesc, const D3D11_SUBRESOURCE_DATA* pInitialData, ID3D11Buffer** ppBuffer)
+	{
+		if (!pDesc || !ppBuffer || pDesc->ByteWidth == 0)
+			return E_INVALIDARG;
+		// 与D3D11一样，常量缓冲区的大小必须是16的倍数
+		if ((pDesc->BindFlags & D3D11_BIND_CONSTANT_BUFFER) && pDesc->ByteWidth % 16 != 0)
+			return E_INVALIDARG;
+		ID3D11Buffer* pBuffer = new ID3D11Buffer;
+		pBuffer->desc = *pDesc;
+		pBuffer->data.assign(pDesc->ByteWidth, 0);
+		pBuffer->refCount = 1;
+		if (pInitialData && pInitialData->pSysMem)
+			std::copy_n(static_cast<const uint8_t*>(pInitialData->pSysMem), pDesc->ByteWidth, pBuffer->data.begin());
+		*ppBuffer = pBuffer;
+		++m_CreateCount;
+		return S_OK;
+	}
+
+	uint32_t GetCreateCount() const { return m_CreateCount; }
+
+private:
+	uint32_t m_CreateCount = 0;
+};
+
+class StandInContext
+{
+public:
+	struct MapRecord
+	{
+		ID3D11Buffer* pBuffer;
+		D3D11_MAP mapType;
+		UINT bytes;						// 映射的缓冲区大小
+		std::vector<uint8_t> contents;	// Unmap时缓冲区的内容
+	};
+
+	struct DrawRecord
+	{
+		UINT indexCount;
+		UINT instanceCount;		// DrawIndexed为1
+		UINT startIndex;
+		INT baseVertex;
+		UINT startInstance;
+		bool instanced;
+		ID3D11Buffer* pVSBuffer0;	// 绘制时顶点着色器b0绑定的缓冲区及其常量范围
+		UINT firstConstant;
+		UINT numConstants;
+	};
+
+public:
+	HRESULT Map(ID3D11Buffer* pBuffer, UINT subresource, D3D11_MAP mapType, UINT mapFlags, D3D11_MAPPED_SUBRESOURCE* pMapped)
+	{
+		// 同一时间只允许映射一个缓冲区，动态缓冲区只能写入
+		if (!pBuffer || !pMapped || subresource != 0 || mapFlags != 0 || m_pMapped ||
+			!(pBuffer->desc.CPUAccessFlags & D3D11_CPU_ACCESS_WRITE))
+		{
+			++m_ErrorCount;
+			return E_INVALIDARG;
+		}
+		if (mapType == D3D11_MAP_WRITE_DISCARD)
+			std::fill(pBuffer->data.begin(), pBuffer->data.end(), (uint8_t)0xCD);
+		m_pMapped = pBuffer;
+		pMapped->pData = pBuffer->data.data();
+		pMapped->RowPitch = pMapped->DepthPitch = pBuffer->desc.ByteWidth;
+		MapRecord record = { pBuffer, mapType, pBuffer->desc.ByteWidth, std::vector<uint8_t>() };
+		m_Maps.push_back(record);
+		return S_OK;
+	}
+
+	void Unmap(ID3D11Buffer* pBuffer, UINT subresource)
+	{
+		if (pBuffer != m_pMapped || subresource != 0)
+		{
+			++m_ErrorCount;
+			return;
+		}
+		m_Maps.back().contents = pBuffer->data;
+		m_pMapped = nullptr;
+	}
+
+	void VSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer* const* ppBuffers)
+	{
+		for (UINT i = 0; i < numBuffers; ++i)
+		{
+			if (startSlot + i == 0)
+				BindSlot0(ppBuffers[i], 0, ppBuffers[i] ? ppBuffers[i]->desc.ByteWidth / 16 : 0);
+		}
+	}
+
+	// 与D3D11.1一样，FirstConstant和NumConstants必须是16的倍数，NumConstants不超过4096，范围不能超出缓冲区
+	void VSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer* const* ppBuffers,
+		const UINT* pFirstConstant, const UINT* pNumConstants)
+	{
+		for (UINT i = 0; i < numBuffers; ++i)
+		{
+			ID3D11Buffer* pBuffer = ppBuffers[i];
+			UINT first = pFirstConstant[i], num = pNumConstants[i];
+			if (first % 16 != 0 || num % 16 != 0 || num == 0 || num > 4096 ||
+				(pBuffer && (uint64_t)(first + num) * 16 > pBuffer->desc.ByteWidth))
+				++m_ErrorCount;
+			if (startSlot + i == 0)
+				BindSlot0(pBuffer, first, num);
+		}
+	}
+
+	void DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex)
+	{
+		RecordDraw(indexCount, 1, startIndex, baseVertex, 0, false);
+	}
+
+	void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+	{
+		RecordDraw(indexCount, instanceCount, startIndex, baseVertex, startInstance, true);
+	}
+
+	const std::vector<MapRecord>& GetMaps() const { return m_Maps; }
+	const std::vector<DrawRecord>& GetDraws() const { return m_Draws; }
+	// 所有Map的缓冲区大小之和，即上传到GPU的字节数
+	uint64_t GetMappedBytes() const
+	{
+		uint64_t bytes = 0;
+		for (const MapRecord& record : m_Maps)
+			bytes += record.bytes;
+		return bytes;
+	}
+	// 不合法的调用次数：重复Map、Unmap不匹配、映射期间绘制等
+	uint32_t GetErrorCount() const { return m_ErrorCount; }
+
+	void ClearRecords()
+	{
+		m_Maps.clear();
+		m_Draws.clear();
+	}
+
+private:
+	void BindSlot0(ID3D11Buffer* pBuffer, UINT firstConstant, UINT numConstants)
+	{
+		m_pVSBuffer0 = pBuffer;
+		m_FirstConstant0 = firstConstant;
+		m_NumConstants0 = numConstants;
+	}
+
+	void RecordDraw(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance, bool instanced)
+	{
+		if (m_pMapped)
+			++m_ErrorCount;
+		DrawRecord record = { indexCount, instanceCount, startIndex, baseVertex, startInstance, instanced,
+			m_pVSBuffer0, m_FirstConstant0, m_NumConstants0 };
+		m_Draws.push_back(record);
+	}
+
+private:
+	ID3D11Buffer* m_pMapped = nullptr;
+	ID3D11Buffer* m_pVSBuffer0 = nullptr;
+	UINT m_FirstConstant0 = 0;
+	UINT m_NumConstants0 = 0;
+	std::vector<MapRecord> m_Maps;
+	std::vector<DrawRecord> m_Draws;
+	uint32_t m_ErrorCount = 0;
+};
+
+#endif
@@ -0,0 +1,169 @@
+#include "UnitTest.h"
+#include "StandInDevice.h"
+#include "CBufferRingDraw.h"
+#include "ForestConstants.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// 与GameApp::InitResource相同：每个物体占256字节，一次Map最多容纳4096个物体
+	const uint32_t kRingSlots = 4096;
+	const UINT kIndexCount = 36;
+
+	ID3D11Buffer* CreateRingBuffer(StandInDevice& device, const CBufferRing& ring)
+	{
+		D3D11_BUFFER_DESC cbd;
+		ZeroMemory(&cbd, sizeof(cbd));
+		cbd.Usage = D3D11_USAGE_DYNAMIC;
+		cbd.ByteWidth = ring.GetCapacity();
+		cbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		cbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		ID3D11Buffer* pBuffer = nullptr;
+		device.CreateBuffer(&cbd, nullptr, &pBuffer);
+		return pBuffer;
+	}
+
+	// 第k个物体的世界矩阵为沿x平移k，第3行第0列即可区分各个物体
+	void FillObject(uint32_t k, CBPerObject& cb)
+	{
+		cb.world = XMMatrixTranslation((float)k, 0.0f, 0.0f);
+	}
+
+	float ReadObjectId(const std::vector<uint8_t>& contents, uint32_t offset)
+	{
+		float id;
+		std::memcpy(&id, contents.data() + offset + 12 * sizeof(float), sizeof(float));
+		return id;
+	}
+}
+
+TEST_CASE(CBufferRing_AlignmentAndConstants)
+{
+	CHECK_EQ(CBufferRing::AlignSize(1), 256u);
+	CHECK_EQ(CBufferRing::AlignSize(64), 256u);
+	CHECK_EQ(CBufferRing::AlignSize(256), 256u);
+	CHECK_EQ(CBufferRing::AlignSize(257), 512u);
+	CHECK_EQ(CBufferRing::ToFirstConstant(0), 0u);
+	CHECK_EQ(CBufferRing::ToFirstConstant(256), 16u);
+	CHECK_EQ(CBufferRing::ToFirstConstant(4095 * 256), 4095u * 16);
+	// NumConstants向上取到16个常量(256字节)
+	CHECK_EQ(CBufferRing::ToNumConstants(sizeof(CBPerObject)), 16u);
+	CHECK_EQ(CBufferRing::ToNumConstants(sizeof(CBPerFrame)), 16u);
+	CHECK_EQ(CBufferRing::ToNumConstants(257), 32u);
+
+	// 容量向下取整，每次分配的偏移都是256的倍数
+	CBufferRing ring(kRingSlots * CBufferRing::kAlignment + 100);
+	CHECK_EQ(ring.GetCapacity(), kRingSlots * CBufferRing::kAlignment);
+	std::vector<uint8_t> memory(ring.GetCapacity());
+	ring.Begin(memory.data());
+	uint32_t offset = 1;
+	CHECK(ring.Allocate(16, offset) == memory.data());
+	CHECK_EQ(offset, 0u);
+	CHECK(ring.Allocate(300, offset) == memory.data() + 256);
+	CHECK_EQ(offset, 256u);
+	CHECK(ring.Allocate(1, offset) != nullptr);
+	CHECK_EQ(offset, 768u);
+	CHECK_EQ(ring.GetRemainingSlots(sizeof(CBPerObject)), kRingSlots - 4);
+	CHECK_EQ(ring.End(), 1024u);
+}
+
+TEST_CASE(CBufferRing_FullRingOverflows)
+{
+	CBufferRing ring(kRingSlots * CBufferRing::kAlignment);
+	std::vector<uint8_t> memory(ring.GetCapacity());
+	ring.Begin(memory.data());
+	CBPerObject cb;
+	uint32_t offset = 0;
+	for (uint32_t k = 0; k < kRingSlots; ++k)
+	{
+		FillObject(k, cb);
+		CHECK(ring.Push(cb, offset));
+		CHECK_EQ(offset, k * CBufferRing::kAlignment);
+	}
+	// 第4097个放不下，偏移不变
+	CHECK_EQ(ring.GetRemainingSlots(sizeof(CBPerObject)), 0u);
+	uint32_t last = offset;
+	CHECK(!ring.Push(cb, offset));
+	CHECK_EQ(offset, last);
+	CHECK_EQ(ring.End(), ring.GetCapacity());
+
+	// 重新Begin后从头分配
+	ring.Begin(memory.data());
+	CHECK(ring.Push(cb, offset));
+	CHECK_EQ(offset, 0u);
+	ring.End();
+}
+
+TEST_CASE(CBufferRing_DrawWrapsAt4096Slots)
+{
+	StandInDevice device;
+	StandInContext context;
+	CBufferRing ring(kRingSlots * CBufferRing::kAlignment);
+	ID3D11Buffer* pRingBuffer = CreateRingBuffer(device, ring);
+	std::vector<uint32_t> offsets;
+
+	// 两批满的再加5个，需要Map三次
+	const uint32_t count = 2 * kRingSlots + 5;
+	CBufferStats::Reset();
+	CHECK_EQ(DrawWithCBufferRing<CBPerObject>(&context, pRingBuffer, ring, offsets, 0, count, FillObject, kIndexCount, 6, 2), S_OK);
+	CHECK_EQ(context.GetErrorCount(), 0u);
+	CHECK_EQ(context.GetMaps().size(), (size_t)3);
+	CHECK_EQ(context.GetDraws().size(), (size_t)count);
+	CHECK_EQ(CBufferStats::UploadCount(), 3u);
+	CHECK_EQ(CBufferStats::UploadedBytes(), (uint64_t)count * sizeof(CBPerObject));
+	if (context.GetMaps().size() != 3 || context.GetDraws().size() != count)
+	{
+		pRingBuffer->Release();
+		return;
+	}
+
+	uint32_t badDraws = 0, badData = 0;
+	for (uint32_t k = 0; k < count; ++k)
+	{
+		// 每批从环形缓冲区的开头重新分配
+		const StandInContext::DrawRecord& draw = context.GetDraws()[k];
+		uint32_t slot = k % kRingSlots;
+		if (draw.pVSBuffer0 != pRingBuffer || draw.firstConstant != slot * 16 || draw.numConstants != 16 ||
+			draw.indexCount != kIndexCount || draw.startIndex != 6 || draw.baseVertex != 2 || draw.instanced)
+			++badDraws;
+		const StandInContext::MapRecord& map = context.GetMaps()[k / kRingSlots];
+		if (ReadObjectId(map.contents, slot * CBufferRing::kAlignment) != (float)k)
+			++badData;
+	}
+	CHECK_EQ(badDraws, 0u);
+	CHECK_EQ(badData, 0u);
+	CHECK_EQ(offsets.size(), (size_t)5);
+
+	// 正好4096个只需一次Map
+	context.ClearRecords();
+	CHECK_EQ(DrawWithCBufferRing<CBPerObject>(&context, pRingBuffer, ring, offsets, 0, kRingSlots, FillObject, kIndexCount, 0, 0), S_OK);
+	CHECK_EQ(context.GetMaps().size(), (size_t)1);
+	CHECK_EQ(context.GetDraws().back().firstConstant, (kRingSlots - 1) * 16);
+	CHECK_EQ(context.GetErrorCount(), 0u);
+	pRingBuffer->Release();
+}
+
+TEST_CASE(CBufferRing_DrawEdgeCases)
+{
+	StandInDevice device;
+	StandInContext context;
+	std::vector<uint32_t> offsets;
+
+	// 没有物体时不Map
+	CBufferRing ring(kRingSlots * CBufferRing::kAlignment);
+	ID3D11Buffer* pRingBuffer = CreateRingBuffer(device, ring);
+	CHECK_EQ(DrawWithCBufferRing<CBPerObject>(&context, pRingBuffer, ring, offsets, 0, 0, FillObject, kIndexCount, 0, 0), S_OK);
+	CHECK(context.GetMaps().empty());
+	CHECK(context.GetDraws().empty());
+	pRingBuffer->Release();
+
+	// 容量不足一块时返回错误而不是死循环
+	CBufferRing tiny(CBufferRing::kAlignment);
+	ID3D11Buffer* pTinyBuffer = CreateRingBuffer(device, tiny);
+	tiny.SetCapacity(0);
+	CHECK_EQ(DrawWithCBufferRing<CBPerObject>(&context, pTinyBuffer, tiny, offsets, 0, 3, FillObject, kIndexCount, 0, 0), E_OUTOFMEMORY);
+	CHECK(context.GetDraws().empty());
+	CHECK_EQ(context.GetErrorCount(), 0u);
+	pTinyBuffer->Release();
+}
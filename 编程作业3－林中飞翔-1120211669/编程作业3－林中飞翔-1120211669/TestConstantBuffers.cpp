@@ -0,0 +1,119 @@
+#include "UnitTest.h"
+#include "StandInDevice.h"
+#include "ConstantBuffers.h"
+#include "ForestConstants.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// 拆分之前每次绘制都整体上传的常量缓冲区
+	struct CBCombined
+	{
+		XMMATRIX world;
+		XMMATRIX view;
+		XMMATRIX proj;
+	};
+
+	const uint32_t kDrawCount = 50;
+
+	// 按GameApp::DrawScene/DrawName的顺序模拟一帧：摄像机变化时上传b1，每次绘制只上传b0
+	void DrawFrame(StandInContext& context, CBufferObject<CBPerObject>& perObject, CBufferObject<CBPerFrame>& perFrame, uint32_t cameraVersion)
+	{
+		if (perFrame.NeedsUpload(cameraVersion))
+		{
+			perFrame.data.view = XMMatrixTranspose(XMMatrixLookAtLH(XMVectorSet(0.0f, 5.0f, -10.0f, 1.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+			perFrame.data.proj = XMMatrixTranspose(XMMatrixPerspectiveFovLH(XM_PIDIV4, 4.0f / 3.0f, 0.5f, 1000.0f));
+			perFrame.Upload(&context, cameraVersion);
+		}
+		for (uint32_t k = 0; k < kDrawCount; ++k)
+		{
+			perObject.data.world = XMMatrixTranspose(XMMatrixTranslation((float)k, 0.0f, 0.0f));
+			perObject.Upload(&context);
+			context.DrawIndexed(36, 0, 0);
+		}
+	}
+}
+
+TEST_CASE(ConstantBuffers_PerDrawUploadIs64Bytes)
+{
+	CHECK_EQ(sizeof(CBPerObject), (size_t)64);
+	CHECK_EQ(sizeof(CBPerFrame), (size_t)128);
+	CHECK_EQ(sizeof(CBCombined), (size_t)192);
+
+	StandInDevice device;
+	StandInContext context;
+	CBufferObject<CBPerObject> perObject;
+	CBufferObject<CBPerFrame> perFrame;
+	CHECK_EQ(perObject.Create(&device), S_OK);
+	CHECK_EQ(perFrame.Create(&device), S_OK);
+	CHECK_EQ(device.GetCreateCount(), 2u);
+
+	// 第一帧上传一次b1，之后摄像机不变时每次绘制只有64字节
+	CBufferStats::Reset();
+	DrawFrame(context, perObject, perFrame, 1);
+	CHECK_EQ(context.GetErrorCount(), 0u);
+	CHECK_EQ(context.GetMaps().size(), (size_t)(kDrawCount + 1));
+	CHECK_EQ(context.GetMappedBytes(), (uint64_t)(128 + 64 * kDrawCount));
+	CHECK_EQ(CBufferStats::UploadedBytes(), context.GetMappedBytes());
+
+	context.ClearRecords();
+	CBufferStats::Reset();
+	DrawFrame(context, perObject, perFrame, 1);
+	CHECK_EQ(context.GetMappedBytes(), (uint64_t)(64 * kDrawCount));
+	CHECK_EQ(CBufferStats::UploadCount(), kDrawCount);
+	CHECK_EQ(context.GetDraws().size(), (size_t)kDrawCount);
+	for (const StandInContext::MapRecord& map : context.GetMaps())
+	{
+		CHECK(map.pBuffer == perObject.Get());
+		CHECK_EQ(map.bytes, 64u);
+	}
+
+	// 摄像机变化后b1再上传一次
+	context.ClearRecords();
+	DrawFrame(context, perObject, perFrame, 2);
+	CHECK_EQ(context.GetMappedBytes(), (uint64_t)(128 + 64 * kDrawCount));
+	CHECK(context.GetMaps().front().pBuffer == perFrame.Get());
+}
+
+TEST_CASE(ConstantBuffers_CombinedBufferUploads192Bytes)
+{
+	// 对照：拆分之前同样的一帧每次绘制上传192字节
+	StandInDevice device;
+	StandInContext context;
+	CBufferObject<CBCombined> combined;
+	CHECK_EQ(combined.Create(&device), S_OK);
+	CBufferStats::Reset();
+	for (uint32_t k = 0; k < kDrawCount; ++k)
+	{
+		combined.data.world = XMMatrixTranspose(XMMatrixTranslation((float)k, 0.0f, 0.0f));
+		combined.Upload(&context);
+		context.DrawIndexed(36, 0, 0);
+	}
+	CHECK_EQ(context.GetMappedBytes(), (uint64_t)(192 * kDrawCount));
+	CHECK_EQ(CBufferStats::UploadedBytes(), (uint64_t)(192 * kDrawCount));
+}
+
+TEST_CASE(ConstantBuffers_UploadWritesData)
+{
+	StandInDevice device;
+	StandInContext context;
+	CBufferObject<CBPerObject> perObject;
+	CHECK_EQ(perObject.Create(&device), S_OK);
+	perObject.data.world = XMMatrixTranspose(XMMatrixScaling(2.0f, 3.0f, 4.0f));
+	CHECK_EQ(perObject.Upload(&context), S_OK);
+	CHECK_EQ(context.GetMaps().size(), (size_t)1);
+	if (context.GetMaps().size() == 1)
+	{
+		const StandInContext::MapRecord& map = context.GetMaps()[0];
+		CHECK_EQ(map.mapType, D3D11_MAP_WRITE_DISCARD);
+		CHECK(std::memcmp(map.contents.data(), &perObject.data, sizeof(CBPerObject)) == 0);
+	}
+
+	// 重新创建时释放旧的缓冲区，版本记录也随之失效
+	CHECK(perObject.NeedsUpload(0));
+	CHECK_EQ(perObject.Upload(&context, 7), S_OK);
+	CHECK(!perObject.NeedsUpload(7));
+	CHECK_EQ(perObject.Create(&device), S_OK);
+	CHECK(perObject.NeedsUpload(7));
+}
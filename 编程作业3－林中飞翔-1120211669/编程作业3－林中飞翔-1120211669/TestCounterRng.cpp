@@ -0,0 +1,66 @@
+#include "UnitTest.h"
+#include "CounterRng.h"
+
+namespace
+{
+	struct PhiloxVector
+	{
+		uint32_t ctr[4];
+		uint32_t key[2];
+		uint32_t expected[4];
+	};
+
+	// Random123的kat_vectors中philox4x32_10的三组已知答案
+	const PhiloxVector kPhiloxVectors[] =
+	{
+		{ { 0x00000000u, 0x00000000u, 0x00000000u, 0x00000000u }, { 0x00000000u, 0x00000000u },
+			{ 0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u } },
+		{ { 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu }, { 0xffffffffu, 0xffffffffu },
+			{ 0x408f276du, 0x41c83b0eu, 0xa20bc7c6u, 0x6d5451fdu } },
+		{ { 0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u }, { 0xa4093822u, 0x299f31d0u },
+			{ 0xd16cfe09u, 0x94fdccebu, 0x5001e420u, 0x24126ea1u } },
+	};
+}
+
+TEST_CASE(CounterRng_PhiloxKnownAnswers)
+{
+	for (const PhiloxVector& v : kPhiloxVectors)
+	{
+		uint32_t out[4];
+		CounterRng::Philox4x32(v.ctr, v.key[0], v.key[1], out);
+		for (int i = 0; i < 4; ++i)
+			CHECK_EQ(out[i], v.expected[i]);
+	}
+}
+
+TEST_CASE(CounterRng_SeedIsKey)
+{
+	// 种子的低、高32位为两个密钥字，计数器为(id, stream, index, 0)
+	const PhiloxVector& zero = kPhiloxVectors[0];
+	uint32_t out[4];
+	CounterRng(0).Generate4(0, 0, 0, out);
+	for (int i = 0; i < 4; ++i)
+		CHECK_EQ(out[i], zero.expected[i]);
+
+	const PhiloxVector& pi = kPhiloxVectors[2];
+	uint64_t seed = (uint64_t)pi.key[1] << 32 | pi.key[0];
+	uint32_t ctr[4] = { 7, 3, 11, 0 }, expected[4];
+	CounterRng::Philox4x32(ctr, pi.key[0], pi.key[1], expected);
+	CounterRng(seed).Generate4(7, 3, 11, out);
+	for (int i = 0; i < 4; ++i)
+		CHECK_EQ(out[i], expected[i]);
+}
+
+TEST_CASE(CounterRng_RangeAndFloat)
+{
+	CounterRng rng(29);
+	for (uint32_t id = 0; id < 1000; ++id)
+	{
+		int r = rng.Range(id, 1, 0, 1, 4);
+		CHECK(r >= 1 && r < 4);
+		float f = rng.Float(id, 2);
+		CHECK(f >= 0.0f && f < 1.0f);
+	}
+	CHECK(CounterRng::ToFloat(0xffffffffu) < 1.0f);
+	CHECK_EQ(CounterRng::ToFloat(0u), 0.0f);
+}
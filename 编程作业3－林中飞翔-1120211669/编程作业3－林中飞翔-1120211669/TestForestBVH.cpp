@@ -0,0 +1,81 @@
+#include "UnitTest.h"
+#include "ForestBVH.h"
+#include <algorithm>
+
+using namespace DirectX;
+
+namespace
+{
+	const int kGridN = 40;
+	const float kAngles[] = { 0.0f, 0.37f, 1.3f, 2.9f, 5.5f };
+
+	// 与GameApp中名字模型相近的局部包围球
+	void SetNameBounds(ForestInstances& forest)
+	{
+		forest.SetLocalBounds(XMFLOAT3(0.5f, 0.5f, 0.0f), 11.0f);
+	}
+
+	// 绕森林中心转动，从上方斜看，视锥体只覆盖一部分树
+	FrustumPlanes MakeFrustum(float yaw)
+	{
+		XMMATRIX view = XMMatrixRotationY(yaw) * XMMatrixTranslation(0.0f, -60.0f, 100.0f) * XMMatrixRotationX(-0.7f);
+		XMMATRIX proj = XMMatrixPerspectiveFovLH(XM_PIDIV4, 4.0f / 3.0f, 1.0f, 1000.0f);
+		return FrustumCuller::ExtractPlanes(view * proj);
+	}
+}
+
+TEST_CASE(ForestBVH_EnvelopeContainsAnimatedSpheres)
+{
+	ForestInstances forest(kGridN);
+	SetNameBounds(forest);
+	ForestInstances::BoundingSpheres envelope;
+	forest.GetEnvelopeSpheres(envelope);
+	CHECK_EQ(envelope.radius.size(), forest.GetBoundingSpheres().radius.size());
+
+	uint32_t outside = 0;
+	for (float angle : kAngles)
+	{
+		forest.Build(angle);
+		const ForestInstances::BoundingSpheres& spheres = forest.GetBoundingSpheres();
+		for (uint32_t k = 0; k < forest.GetInstanceCount(); ++k)
+		{
+			float dx = spheres.centerX[k] - envelope.centerX[k];
+			float dy = spheres.centerY[k] - envelope.centerY[k];
+			float dz = spheres.centerZ[k] - envelope.centerZ[k];
+			float room = envelope.radius[k] - spheres.radius[k];
+			if (room < 0.0f || dx * dx + dy * dy + dz * dz > room * room)
+				++outside;
+		}
+	}
+	CHECK_EQ(outside, 0u);
+}
+
+TEST_CASE(ForestBVH_EnvelopeQueryMatchesFlatCull)
+{
+	// 只在开始时按包络建立一次，之后各帧不Refit，结果仍与逐实例剔除相同
+	ForestInstances forest(kGridN);
+	SetNameBounds(forest);
+	ForestInstances::BoundingSpheres envelope;
+	forest.GetEnvelopeSpheres(envelope);
+	ForestBVH bvh;
+	bvh.Build(envelope, forest.GetInstanceCount());
+	CHECK_EQ(bvh.GetInstanceCount(), forest.GetInstanceCount());
+
+	FrustumCuller culler;
+	std::vector<uint32_t> result, expected;
+	for (float angle : kAngles)
+	{
+		forest.Build(angle);
+		const ForestInstances::BoundingSpheres& spheres = forest.GetBoundingSpheres();
+		FrustumPlanes frustum = MakeFrustum(angle);
+		culler.Cull(frustum, spheres.centerX.data(), spheres.centerY.data(), spheres.centerZ.data(), spheres.radius.data(), forest.GetInstanceCount());
+		expected.assign(culler.GetVisibleIndices().begin(), culler.GetVisibleIndices().begin() + culler.GetVisibleCount());
+
+		bvh.QueryFrustum(frustum, spheres, result);
+		std::sort(result.begin(), result.end());
+		std::sort(expected.begin(), expected.end());
+		CHECK(!expected.empty());
+		CHECK(expected.size() < forest.GetInstanceCount());
+		CHECK(result == expected);
+	}
+}
@@ -0,0 +1,199 @@
+#include "UnitTest.h"
+#include "StandInDevice.h"
+#include "InstancedDraw.h"
+#include "ForestInstances.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	typedef ForestInstances::InstanceData InstanceData;
+
+	const int kGridN = 12;
+	const uint32_t kSeed = 27;
+	const float kAngle = 1.25f;
+	const UINT kIndexCount = 36 * 76;
+
+	// 原来DrawScene中逐棵树计算矩阵的循环，rand()换成与ForestInstances.cpp中RandomStream相同的CounterRng用途，
+	// 树按(i - 1) * gridN + (j - 1)排列，子物体按树的顺序排在所有树之后
+	std::vector<XMFLOAT4X4> BuildReference(int gridN, uint64_t seed, float angle)
+	{
+		CounterRng rng(seed);
+		std::vector<XMFLOAT4X4> trees(gridN * gridN), children;
+		for (int i = 1; i <= gridN; i++)
+		{
+			for (int j = 1; j <= gridN; j++)
+			{
+				uint32_t index = (i - 1) * gridN + (j - 1);
+				float scale = (sinf(angle * 3.0f + i * j * 0.2f) + 1.3f) * 0.00015f * rng.Range(index, 0, 0, 300, 900);
+				XMMATRIX mScale = XMMatrixScaling(scale, scale, scale);
+				XMMATRIX mRotate = XMMatrixRotationX(angle) * XMMatrixRotationY(angle);
+				XMMATRIX mTranslate = XMMatrixTranslation((i - 5.5f) * 4.5f, 0, (j - 5.5f) * 4.5f);
+				XMStoreFloat4x4(&trees[index], XMMatrixTranspose(mScale * mRotate * mTranslate));
+
+				XMMATRIX mScaleChild = XMMatrixScaling(0.2f, 0.2f, 0.2f);
+				XMMATRIX mTranslateChild = XMMatrixTranslation(18.0f, 0, 0);
+				int childCount = rng.Range(index, 1, 0, 1, 4);
+				for (int k = 0; k < childCount; k++)
+				{
+					uint32_t bits[4];
+					rng.Generate4(index, 2, k, bits);
+					XMMATRIX mRotateChild = XMMatrixRotationX(CounterRng::ToFloat(bits[0]) * XM_2PI + angle) *
+						XMMatrixRotationY(CounterRng::ToFloat(bits[1]) * XM_2PI + angle) *
+						XMMatrixRotationY(CounterRng::ToFloat(bits[2]) * XM_2PI + angle);
+					XMFLOAT4X4 world;
+					XMStoreFloat4x4(&world, XMMatrixTranspose(mScaleChild * mTranslateChild * mScale * mRotateChild * mTranslate));
+					children.push_back(world);
+				}
+			}
+		}
+		trees.insert(trees.end(), children.begin(), children.end());
+		return trees;
+	}
+
+	// 层次变换与直接相乘的舍入顺序不同，按元素的量级比较
+	bool NearlyEqual(const XMFLOAT4X4& a, const XMFLOAT4X4& b)
+	{
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				if (std::fabs(a.m[r][c] - b.m[r][c]) > 1e-4f * std::max(1.0f, std::fabs(b.m[r][c])))
+					return false;
+			}
+		}
+		return true;
+	}
+
+	uint32_t CountMismatches(const InstanceData* pData, const std::vector<XMFLOAT4X4>& expected, const uint32_t* pIndices, uint32_t count)
+	{
+		uint32_t mismatches = 0;
+		for (uint32_t k = 0; k < count; ++k)
+			mismatches += NearlyEqual(pData[k].world, expected[pIndices ? pIndices[k] : k]) ? 0 : 1;
+		return mismatches;
+	}
+
+	ID3D11Buffer* CreateInstanceBuffer(StandInDevice& device, uint32_t instanceCount)
+	{
+		D3D11_BUFFER_DESC desc;
+		ZeroMemory(&desc, sizeof(desc));
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		desc.ByteWidth = (UINT)(sizeof(InstanceData) * instanceCount);
+		desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		ID3D11Buffer* pBuffer = nullptr;
+		device.CreateBuffer(&desc, nullptr, &pBuffer);
+		return pBuffer;
+	}
+}
+
+TEST_CASE(ForestInstances_MatchesPerTreeLoop)
+{
+	std::vector<XMFLOAT4X4> expected = BuildReference(kGridN, kSeed, kAngle);
+	ForestInstances forest(kGridN, kSeed);
+	forest.Build(kAngle);
+	CHECK_EQ(forest.GetInstanceCount(), (uint32_t)expected.size());
+	CHECK_EQ(CountMismatches(forest.GetInstances().data(), expected, nullptr, forest.GetInstanceCount()), 0u);
+
+	// 多线程生成的结果与单线程逐位相同
+	JobSystem jobs(3);
+	ForestInstances parallel(kGridN, kSeed);
+	parallel.Build(kAngle, &jobs);
+	CHECK(std::equal(forest.GetInstances().begin(), forest.GetInstances().end(), parallel.GetInstances().begin(),
+		[](const InstanceData& a, const InstanceData& b) { return std::memcmp(&a, &b, sizeof(a)) == 0; }));
+}
+
+TEST_CASE(ForestInstances_SingleInstancedDraw)
+{
+	std::vector<XMFLOAT4X4> expected = BuildReference(kGridN, kSeed, kAngle);
+	ForestInstances forest(kGridN, kSeed);
+	forest.Build(kAngle);
+	uint32_t count = forest.GetInstanceCount();
+
+	StandInDevice device;
+	StandInContext context;
+	ID3D11Buffer* pInstanceBuffer = CreateInstanceBuffer(device, count);
+	InstanceGroup group = { nullptr, count, kIndexCount, 0, 0 };
+	CHECK_EQ(DrawInstanceGroups(&context, pInstanceBuffer, forest.GetInstances().data(), &group, 1), S_OK);
+
+	// 整帧只有一次Map和一次DrawIndexedInstanced
+	CHECK_EQ(context.GetErrorCount(), 0u);
+	CHECK_EQ(context.GetMaps().size(), (size_t)1);
+	CHECK_EQ(context.GetDraws().size(), (size_t)1);
+	if (context.GetMaps().size() == 1 && context.GetDraws().size() == 1)
+	{
+		const StandInContext::MapRecord& map = context.GetMaps()[0];
+		CHECK(map.pBuffer == pInstanceBuffer);
+		CHECK_EQ(map.mapType, D3D11_MAP_WRITE_DISCARD);
+		CHECK_EQ(map.contents.size(), sizeof(InstanceData) * count);
+		CHECK_EQ(CountMismatches(reinterpret_cast<const InstanceData*>(map.contents.data()), expected, nullptr, count), 0u);
+
+		const StandInContext::DrawRecord& draw = context.GetDraws()[0];
+		CHECK(draw.instanced);
+		CHECK_EQ(draw.indexCount, kIndexCount);
+		CHECK_EQ(draw.instanceCount, count);
+		CHECK_EQ(draw.startInstance, 0u);
+	}
+	pInstanceBuffer->Release();
+}
+
+TEST_CASE(ForestInstances_GroupedDrawUsesStartInstance)
+{
+	std::vector<XMFLOAT4X4> expected = BuildReference(kGridN, kSeed, kAngle);
+	ForestInstances forest(kGridN, kSeed);
+	forest.Build(kAngle);
+
+	// 模拟剔除和LOD分组：第0组为下标为3的倍数的实例，第1组为空，第2组为其余的树
+	std::vector<uint32_t> groups[3];
+	for (uint32_t index = 0; index < forest.GetInstanceCount(); ++index)
+	{
+		if (index % 3 == 0)
+			groups[0].push_back(index);
+		else if (index < forest.GetTreeCount())
+			groups[2].push_back(index);
+	}
+	InstanceGroup draws[3];
+	for (uint32_t g = 0; g < 3; ++g)
+	{
+		InstanceGroup group = { groups[g].data(), (uint32_t)groups[g].size(), kIndexCount / (g + 1), 100 * g, (INT)(10 * g) };
+		draws[g] = group;
+	}
+
+	StandInDevice device;
+	StandInContext context;
+	ID3D11Buffer* pInstanceBuffer = CreateInstanceBuffer(device, forest.GetInstanceCount());
+	CHECK_EQ(DrawInstanceGroups(&context, pInstanceBuffer, forest.GetInstances().data(), draws, 3), S_OK);
+
+	CHECK_EQ(context.GetErrorCount(), 0u);
+	CHECK_EQ(context.GetMaps().size(), (size_t)1);
+	CHECK_EQ(context.GetDraws().size(), (size_t)2);
+	if (context.GetMaps().size() == 1 && context.GetDraws().size() == 2)
+	{
+		// 各组在缓冲区中首尾相接，空的组不绘制
+		const InstanceData* pData = reinterpret_cast<const InstanceData*>(context.GetMaps()[0].contents.data());
+		uint32_t first = draws[0].count;
+		CHECK_EQ(CountMismatches(pData, expected, groups[0].data(), first), 0u);
+		CHECK_EQ(CountMismatches(pData + first, expected, groups[2].data(), draws[2].count), 0u);
+
+		const StandInContext::DrawRecord& d0 = context.GetDraws()[0];
+		const StandInContext::DrawRecord& d1 = context.GetDraws()[1];
+		CHECK_EQ(d0.instanceCount, draws[0].count);
+		CHECK_EQ(d0.startInstance, 0u);
+		CHECK_EQ(d1.instanceCount, draws[2].count);
+		CHECK_EQ(d1.startInstance, first);
+		CHECK_EQ(d1.indexCount, draws[2].indexCount);
+		CHECK_EQ(d1.startIndex, draws[2].startIndex);
+		CHECK_EQ(d1.baseVertex, draws[2].baseVertex);
+	}
+
+	// 全部为空时不Map也不绘制
+	context.ClearRecords();
+	InstanceGroup empty = { nullptr, 0, kIndexCount, 0, 0 };
+	CHECK_EQ(DrawInstanceGroups(&context, pInstanceBuffer, forest.GetInstances().data(), &empty, 1), S_OK);
+	CHECK(context.GetMaps().empty());
+	CHECK(context.GetDraws().empty());
+	pInstanceBuffer->Release();
+}
@@ -0,0 +1,134 @@
+#include "TransformHierarchy.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+
+using namespace DirectX;
+
+namespace
+{
+	// 每个任务包含的节点数
+	const uint32_t kNodesPerJob = 1024;
+}
+
+TransformHierarchy::TransformHierarchy()
+	: m_MultiplyCount(0)
+{
+}
+
+void TransformHierarchy::Clear()
+{
+	m_Parent.clear();
+	m_Local.clear();
+	m_World.clear();
+	m_Flags.clear();
+	m_LevelStart.clear();
+	m_MultiplyCount = 0;
+}
+
+void TransformHierarchy::Reserve(uint32_t nodeCount)
+{
+	m_Parent.reserve(nodeCount);
+	m_Local.reserve(nodeCount);
+	m_World.reserve(nodeCount);
+	m_Flags.reserve(nodeCount);
+}
+
+uint32_t TransformHierarchy::AddNode(uint32_t parent, const AffineTransform& local)
+{
+	uint32_t index = (uint32_t)m_Parent.size();
+
+	// 根节点深度为0，其余节点为父节点所在层的下一层
+	uint32_t depth = 0;
+	if (parent != kNoParent)
+		depth = (uint32_t)(std::upper_bound(m_LevelStart.begin(), m_LevelStart.end(), parent) - m_LevelStart.begin());
+	assert(m_LevelStart.empty() || depth + 1 >= m_LevelStart.size());
+	if (depth == m_LevelStart.size())
+		m_LevelStart.push_back(index);
+
+	m_Parent.push_back(parent);
+	m_Local.push_back(local);
+	m_World.push_back(local);
+	m_Flags.push_back(NodeFlag_Dirty);
+	return index;
+}
+
+void TransformHierarchy::SetLocal(uint32_t node, const AffineTransform& local)
+{
+	m_Local[node] = local;
+	m_Flags[node] |= NodeFlag_Dirty;
+}
+
+void TransformHierarchy::Update(JobSystem* jobs)
+{
+	uint32_t nodeCount = GetNodeCount();
+	std::atomic<uint64_t> multiplyCount(0);
+
+	// 逐层更新，同一层内的节点互不依赖
+	for (size_t level = 0; level < m_LevelStart.size(); ++level)
+	{
+		uint32_t begin = m_LevelStart[level];
+		uint32_t end = level + 1 < m_LevelStart.size() ? m_LevelStart[level + 1] : nodeCount;
+		if (jobs)
+		{
+			jobs->ParallelFor(end - begin, kNodesPerJob, [this, begin, &multiplyCount](uint32_t b, uint32_t e)
+			{
+				multiplyCount += UpdateRange(begin + b, begin + e);
+			});
+		}
+		else
+		{
+			multiplyCount += UpdateRange(begin, end);
+		}
+	}
+	m_MultiplyCount = multiplyCount;
+}
+
+uint64_t TransformHierarchy::UpdateRange(uint32_t begin, uint32_t end)
+{
+	uint64_t multiplyCount = 0;
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		uint32_t parent = m_Parent[i];
+		bool parentUpdated = parent != kNoParent && (m_Flags[parent] & NodeFlag_Updated);
+		if (!(m_Flags[i] & NodeFlag_Dirty) && !parentUpdated)
+		{
+			m_Flags[i] = 0;
+			continue;
+		}
+
+		if (parent == kNoParent)
+		{
+			m_World[i] = m_Local[i];
+		}
+		else
+		{
+			// 3x4的仿射乘法，最后一列总是(0, 0, 0, 1)，不需要参与计算
+			m_World[i] = AffineMultiply(m_Local[i], m_World[parent]);
+			++multiplyCount;
+		}
+		m_Flags[i] = NodeFlag_Updated;
+	}
+	return multiplyCount;
+}
+
+uint32_t TransformHierarchy::GetNodeCount() const
+{
+	return (uint32_t)m_Parent.size();
+}
+
+const AffineTransform& TransformHierarchy::GetWorld(uint32_t node) const
+{
+	return m_World[node];
+}
+
+bool TransformHierarchy::WasUpdated(uint32_t node) const
+{
+	return (m_Flags[node] & NodeFlag_Updated) != 0;
+}
+
+uint64_t TransformHierarchy::GetMultiplyCount() const
+{
+	return m_MultiplyCount;
+}
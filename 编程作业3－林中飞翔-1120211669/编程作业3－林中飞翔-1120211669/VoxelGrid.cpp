@@ -0,0 +1,494 @@
+#include "VoxelGrid.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <thread>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define VOXEL_USE_SSE2 1
+#else
+#define VOXEL_USE_SSE2 0
+#endif
+
+using namespace DirectX;
+
+// DDA遍历状态，所有量都在网格空间(格子边长为1，最小角点为原点)中
+struct VoxelGrid::Traversal
+{
+	int cell[3];		// 当前格子
+	int step[3];		// 各轴前进方向(-1, 0, 1)
+	float tMax[3];		// 射线到达各轴下一个格子边界时的t
+	float tDelta[3];	// 各轴跨过一个格子所需的t
+	float t;			// 进入当前格子时的t
+	float tLimit;		// 离开网格或到达最大距离时的t
+	int face;			// 进入当前格子经过的面
+};
+
+namespace
+{
+	// 不同朝向的面使用不同亮度，使预览有立体感
+	const float s_FaceShade[6] = { 0.85f, 0.65f, 1.0f, 0.45f, 0.75f, 0.55f };
+
+	// 沿某轴正方向前进时从格子的负面进入，反之从正面进入
+	inline int FaceFromStep(int axis, int step)
+	{
+		return axis * 2 + (step > 0 ? 1 : 0);
+	}
+
+	inline uint32_t PackRGBA(float r, float g, float b)
+	{
+		auto toByte = [](float v) { return (uint32_t)(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f); };
+		return toByte(r) | (toByte(g) << 8) | (toByte(b) << 16) | 0xFF000000u;
+	}
+
+	// 按NameVertices处理顶点颜色的方式由局部坐标得到颜色，再乘以面的亮度
+	inline uint32_t ShadeHit(const VoxelHit& hit, const float o[3], const float d[3])
+	{
+		if (!hit.hit)
+			return 0xFF000000u;
+		float px = o[0] + d[0] * hit.distance;
+		float py = o[1] + d[1] * hit.distance;
+		float pz = o[2] + d[2] * hit.distance;
+		float shade = hit.face >= 0 ? s_FaceShade[hit.face] : 1.0f;
+		return PackRGBA((px / 3.0f + 1.5f) * shade, (py / 3.0f + 1.0f) * shade, (pz * 10.0f / 3.0f + 0.7f) * shade);
+	}
+
+	inline void ResetHit(VoxelHit& hit, float maxDist)
+	{
+		hit.hit = false;
+		hit.cell[0] = hit.cell[1] = hit.cell[2] = -1;
+		hit.face = VoxelFace_None;
+		hit.distance = maxDist;
+	}
+}
+
+VoxelGrid::VoxelGrid()
+	: m_Origin(0.0f, 0.0f, 0.0f), m_CellSize(1.0f), m_Dim{ 0, 0, 0 }, m_OccupiedCount(0)
+{
+}
+
+void VoxelGrid::BuildFromCubeVertices(const XMFLOAT3* pPositions, uint32_t stride, uint32_t vertexCount, float cellSize)
+{
+	const char* pBytes = reinterpret_cast<const char*>(pPositions);
+	auto position = [&](uint32_t i) { return *reinterpret_cast<const XMFLOAT3*>(pBytes + (size_t)i * stride); };
+
+	// 以所有立方体的最小角点作为网格原点
+	XMFLOAT3 origin(FLT_MAX, FLT_MAX, FLT_MAX);
+	for (uint32_t i = 0; i < vertexCount; ++i)
+	{
+		XMFLOAT3 p = position(i);
+		origin.x = std::min(origin.x, p.x);
+		origin.y = std::min(origin.y, p.y);
+		origin.z = std::min(origin.z, p.z);
+	}
+
+	// 每8个顶点的最小角点即为该立方体所在的格子
+	std::vector<XMINT3> cells;
+	cells.reserve(vertexCount / 8);
+	for (uint32_t i = 0; i + 8 <= vertexCount; i += 8)
+	{
+		XMFLOAT3 minCorner = position(i);
+		for (uint32_t j = 1; j < 8; ++j)
+		{
+			XMFLOAT3 p = position(i + j);
+			minCorner.x = std::min(minCorner.x, p.x);
+			minCorner.y = std::min(minCorner.y, p.y);
+			minCorner.z = std::min(minCorner.z, p.z);
+		}
+		cells.push_back(XMINT3(
+			(int)std::floor((minCorner.x - origin.x) / cellSize + 0.5f),
+			(int)std::floor((minCorner.y - origin.y) / cellSize + 0.5f),
+			(int)std::floor((minCorner.z - origin.z) / cellSize + 0.5f)));
+	}
+
+	BuildFromCells(cells, origin, cellSize);
+}
+
+void VoxelGrid::BuildFromCells(const std::vector<XMINT3>& cells, const XMFLOAT3& origin, float cellSize)
+{
+	m_CellSize = cellSize;
+	m_OccupiedCount = 0;
+	m_Bits.clear();
+	m_Dim[0] = m_Dim[1] = m_Dim[2] = 0;
+	m_Origin = origin;
+	if (cells.empty())
+		return;
+
+	// 收紧网格范围，使最小的格子坐标为0
+	XMINT3 lo = cells[0], hi = cells[0];
+	for (const XMINT3& c : cells)
+	{
+		lo.x = std::min(lo.x, c.x), lo.y = std::min(lo.y, c.y), lo.z = std::min(lo.z, c.z);
+		hi.x = std::max(hi.x, c.x), hi.y = std::max(hi.y, c.y), hi.z = std::max(hi.z, c.z);
+	}
+	m_Origin = XMFLOAT3(origin.x + lo.x * cellSize, origin.y + lo.y * cellSize, origin.z + lo.z * cellSize);
+	m_Dim[0] = hi.x - lo.x + 1;
+	m_Dim[1] = hi.y - lo.y + 1;
+	m_Dim[2] = hi.z - lo.z + 1;
+	m_Bits.assign(((size_t)m_Dim[0] * m_Dim[1] * m_Dim[2] + 63) / 64, 0);
+
+	for (const XMINT3& c : cells)
+	{
+		size_t index = ((size_t)(c.z - lo.z) * m_Dim[1] + (c.y - lo.y)) * m_Dim[0] + (c.x - lo.x);
+		uint64_t bit = 1ull << (index & 63);
+		if (!(m_Bits[index >> 6] & bit))
+		{
+			m_Bits[index >> 6] |= bit;
+			++m_OccupiedCount;
+		}
+	}
+}
+
+bool VoxelGrid::IsOccupied(int x, int y, int z) const
+{
+	if (x < 0 || y < 0 || z < 0 || x >= m_Dim[0] || y >= m_Dim[1] || z >= m_Dim[2])
+		return false;
+	size_t index = ((size_t)z * m_Dim[1] + y) * m_Dim[0] + x;
+	return (m_Bits[index >> 6] >> (index & 63)) & 1;
+}
+
+uint32_t VoxelGrid::GetOccupiedCount() const
+{
+	return m_OccupiedCount;
+}
+
+int VoxelGrid::GetDimension(int axis) const
+{
+	return m_Dim[axis];
+}
+
+float VoxelGrid::GetCellSize() const
+{
+	return m_CellSize;
+}
+
+const XMFLOAT3& VoxelGrid::GetOrigin() const
+{
+	return m_Origin;
+}
+
+void VoxelGrid::GetBounds(XMFLOAT3& minPoint, XMFLOAT3& maxPoint) const
+{
+	minPoint = m_Origin;
+	maxPoint = XMFLOAT3(m_Origin.x + m_Dim[0] * m_CellSize, m_Origin.y + m_Dim[1] * m_CellSize, m_Origin.z + m_Dim[2] * m_CellSize);
+}
+
+bool VoxelGrid::BeginTraversal(const float origin[3], const float dir[3], float maxDist, Traversal& tr) const
+{
+	if (m_OccupiedCount == 0)
+		return false;
+
+	// 转换到网格空间，方向同样除以格子边长，使参数t与原空间一致
+	float invCell = 1.0f / m_CellSize;
+	const float* gridOrigin = &m_Origin.x;
+	float o[3], d[3];
+	for (int a = 0; a < 3; ++a)
+	{
+		o[a] = (origin[a] - gridOrigin[a]) * invCell;
+		d[a] = dir[a] * invCell;
+	}
+
+	// 与网格包围盒做slab测试
+	float tEnter = -FLT_MAX, tExit = FLT_MAX;
+	int enterAxis = -1;
+	for (int a = 0; a < 3; ++a)
+	{
+		if (std::fabs(d[a]) < 1e-12f)
+		{
+			if (o[a] < 0.0f || o[a] > (float)m_Dim[a])
+				return false;
+			continue;
+		}
+		float inv = 1.0f / d[a];
+		float t0 = -o[a] * inv, t1 = ((float)m_Dim[a] - o[a]) * inv;
+		if (t0 > t1)
+			std::swap(t0, t1);
+		if (t0 > tEnter)
+			tEnter = t0, enterAxis = a;
+		tExit = std::min(tExit, t1);
+	}
+	if (tEnter > tExit || tExit < 0.0f)
+		return false;
+
+	tr.t = std::max(tEnter, 0.0f);
+	tr.tLimit = std::min(tExit, maxDist);
+	if (tr.t > tr.tLimit)
+		return false;
+	tr.face = (tEnter > 0.0f && enterAxis >= 0) ? FaceFromStep(enterAxis, d[enterAxis] > 0.0f ? 1 : -1) : VoxelFace_None;
+
+	for (int a = 0; a < 3; ++a)
+	{
+		int c = (int)std::floor(o[a] + d[a] * tr.t);
+		tr.cell[a] = std::min(std::max(c, 0), m_Dim[a] - 1);
+		if (d[a] > 0.0f)
+		{
+			tr.step[a] = 1;
+			tr.tDelta[a] = 1.0f / d[a];
+			tr.tMax[a] = (tr.cell[a] + 1 - o[a]) / d[a];
+		}
+		else if (d[a] < 0.0f)
+		{
+			tr.step[a] = -1;
+			tr.tDelta[a] = -1.0f / d[a];
+			tr.tMax[a] = (tr.cell[a] - o[a]) / d[a];
+		}
+		else
+		{
+			tr.step[a] = 0;
+			tr.tDelta[a] = FLT_MAX;
+			tr.tMax[a] = FLT_MAX;
+		}
+	}
+	return true;
+}
+
+bool VoxelGrid::CastRay(const XMFLOAT3& origin, const XMFLOAT3& dir, float maxDist, VoxelHit& hit) const
+{
+	ResetHit(hit, maxDist);
+
+	Traversal tr;
+	if (!BeginTraversal(&origin.x, &dir.x, maxDist, tr))
+		return false;
+
+	for (;;)
+	{
+		if (IsOccupied(tr.cell[0], tr.cell[1], tr.cell[2]))
+		{
+			hit.hit = true;
+			hit.cell[0] = tr.cell[0], hit.cell[1] = tr.cell[1], hit.cell[2] = tr.cell[2];
+			hit.face = tr.face;
+			hit.distance = tr.t;
+			return true;
+		}
+
+		// 沿tMax最小的轴前进一格
+		int axis = tr.tMax[0] <= tr.tMax[1] ? (tr.tMax[0] <= tr.tMax[2] ? 0 : 2) : (tr.tMax[1] <= tr.tMax[2] ? 1 : 2);
+		tr.t = tr.tMax[axis];
+		if (tr.t > tr.tLimit)
+			return false;
+		tr.cell[axis] += tr.step[axis];
+		if (tr.cell[axis] < 0 || tr.cell[axis] >= m_Dim[axis])
+			return false;
+		tr.tMax[axis] += tr.tDelta[axis];
+		tr.face = FaceFromStep(axis, tr.step[axis]);
+	}
+}
+
+void VoxelGrid::CastRayPacket4(const VoxelRayPacket4& packet, VoxelHit hits[4]) const
+{
+#if VOXEL_USE_SSE2
+	// 各通道先标量地完成裁剪和初始化，再用SSE2同时推进4条射线
+	alignas(16) int cell[3][4], step[3][4], axisFace[3][4], face[4];
+	alignas(16) float tMax[3][4], tDelta[3][4], t[4], tLimit[4];
+	int activeMask = 0;
+	for (int lane = 0; lane < 4; ++lane)
+	{
+		ResetHit(hits[lane], packet.maxDist[lane]);
+		float o[3] = { packet.ox[lane], packet.oy[lane], packet.oz[lane] };
+		float d[3] = { packet.dx[lane], packet.dy[lane], packet.dz[lane] };
+		Traversal tr;
+		bool active = BeginTraversal(o, d, packet.maxDist[lane], tr);
+		if (!active)
+		{
+			// 不活跃的通道也要填入安全的值
+			tr.t = tr.tLimit = 0.0f;
+			tr.face = VoxelFace_None;
+			for (int a = 0; a < 3; ++a)
+				tr.cell[a] = 0, tr.step[a] = 0, tr.tMax[a] = FLT_MAX, tr.tDelta[a] = 0.0f;
+		}
+		for (int a = 0; a < 3; ++a)
+		{
+			cell[a][lane] = tr.cell[a];
+			step[a][lane] = tr.step[a];
+			axisFace[a][lane] = FaceFromStep(a, tr.step[a]);
+			tMax[a][lane] = tr.tMax[a];
+			tDelta[a][lane] = tr.tDelta[a];
+		}
+		t[lane] = tr.t;
+		tLimit[lane] = tr.tLimit;
+		face[lane] = tr.face;
+		activeMask |= (int)active << lane;
+	}
+
+	__m128i vCell[3], vStep[3], vAxisFace[3], vDimMinus1[3];
+	__m128 vTMax[3], vTDelta[3];
+	for (int a = 0; a < 3; ++a)
+	{
+		vCell[a] = _mm_load_si128(reinterpret_cast<const __m128i*>(cell[a]));
+		vStep[a] = _mm_load_si128(reinterpret_cast<const __m128i*>(step[a]));
+		vAxisFace[a] = _mm_load_si128(reinterpret_cast<const __m128i*>(axisFace[a]));
+		vDimMinus1[a] = _mm_set1_epi32(m_Dim[a] - 1);
+		vTMax[a] = _mm_load_ps(tMax[a]);
+		vTDelta[a] = _mm_load_ps(tDelta[a]);
+	}
+	__m128 vT = _mm_load_ps(t);
+	__m128 vLimit = _mm_load_ps(tLimit);
+	__m128i vFace = _mm_load_si128(reinterpret_cast<const __m128i*>(face));
+	const __m128i vMinusOne = _mm_set1_epi32(-1);
+
+	while (activeMask)
+	{
+		// 位集查询无法向量化，逐个活跃通道检查当前格子
+		_mm_store_si128(reinterpret_cast<__m128i*>(cell[0]), vCell[0]);
+		_mm_store_si128(reinterpret_cast<__m128i*>(cell[1]), vCell[1]);
+		_mm_store_si128(reinterpret_cast<__m128i*>(cell[2]), vCell[2]);
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			if (!(activeMask & (1 << lane)) || !IsOccupied(cell[0][lane], cell[1][lane], cell[2][lane]))
+				continue;
+			_mm_store_ps(t, vT);
+			_mm_store_si128(reinterpret_cast<__m128i*>(face), vFace);
+			VoxelHit& hit = hits[lane];
+			hit.hit = true;
+			hit.cell[0] = cell[0][lane], hit.cell[1] = cell[1][lane], hit.cell[2] = cell[2][lane];
+			hit.face = face[lane];
+			hit.distance = t[lane];
+			activeMask &= ~(1 << lane);
+		}
+		if (!activeMask)
+			break;
+
+		// 每个通道选出tMax最小的轴
+		__m128 selX = _mm_and_ps(_mm_cmple_ps(vTMax[0], vTMax[1]), _mm_cmple_ps(vTMax[0], vTMax[2]));
+		__m128 selY = _mm_andnot_ps(selX, _mm_cmple_ps(vTMax[1], vTMax[2]));
+		__m128 selZ = _mm_andnot_ps(_mm_or_ps(selX, selY), _mm_castsi128_ps(vMinusOne));
+		__m128 sel[3] = { selX, selY, selZ };
+
+		vT = _mm_or_ps(_mm_and_ps(selX, vTMax[0]), _mm_or_ps(_mm_and_ps(selY, vTMax[1]), _mm_and_ps(selZ, vTMax[2])));
+		__m128i inside = vMinusOne;
+		__m128i newFace = _mm_setzero_si128();
+		for (int a = 0; a < 3; ++a)
+		{
+			__m128i mask = _mm_castps_si128(sel[a]);
+			vCell[a] = _mm_add_epi32(vCell[a], _mm_and_si128(mask, vStep[a]));
+			vTMax[a] = _mm_add_ps(vTMax[a], _mm_and_ps(sel[a], vTDelta[a]));
+			newFace = _mm_or_si128(newFace, _mm_and_si128(mask, vAxisFace[a]));
+			inside = _mm_and_si128(inside, _mm_andnot_si128(
+				_mm_or_si128(_mm_cmplt_epi32(vCell[a], _mm_setzero_si128()), _mm_cmpgt_epi32(vCell[a], vDimMinus1[a])), vMinusOne));
+		}
+		vFace = newFace;
+
+		// 离开网格或超出最大距离的通道失活
+		__m128 keep = _mm_and_ps(_mm_castsi128_ps(inside), _mm_cmple_ps(vT, vLimit));
+		activeMask &= _mm_movemask_ps(keep);
+	}
+#else
+	for (int lane = 0; lane < 4; ++lane)
+	{
+		CastRay(XMFLOAT3(packet.ox[lane], packet.oy[lane], packet.oz[lane]),
+			XMFLOAT3(packet.dx[lane], packet.dy[lane], packet.dz[lane]), packet.maxDist[lane], hits[lane]);
+	}
+#endif
+}
+
+VoxelRayStats VoxelGrid::RenderPreview(const VoxelPreviewCamera& camera, uint32_t width, uint32_t height,
+	std::vector<uint32_t>& pixels, uint32_t threadCount) const
+{
+	VoxelRayStats stats = { (uint64_t)width * height, 0.0 };
+	pixels.assign((size_t)width * height, 0xFF000000u);
+	if (width == 0 || height == 0)
+		return stats;
+
+	// 构建左手系相机基
+	XMVECTOR eye = XMLoadFloat3(&camera.eye);
+	XMVECTOR forward = XMVector3Normalize(XMLoadFloat3(&camera.target) - eye);
+	XMVECTOR right = XMVector3Normalize(XMVector3Cross(XMLoadFloat3(&camera.up), forward));
+	XMVECTOR up = XMVector3Cross(forward, right);
+	float tanHalfY = tanf(camera.fovY * 0.5f);
+	float tanHalfX = tanHalfY * width / height;
+	XMFLOAT3 f, r, u;
+	XMStoreFloat3(&f, forward);
+	XMStoreFloat3(&r, right);
+	XMStoreFloat3(&u, up);
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	std::atomic<uint32_t> nextRow(0);
+	auto worker = [&]()
+	{
+		VoxelRayPacket4 packet;
+		VoxelHit hits[4];
+		for (uint32_t y = nextRow++; y < height; y = nextRow++)
+		{
+			float sy = (1.0f - 2.0f * (y + 0.5f) / height) * tanHalfY;
+			for (uint32_t x0 = 0; x0 < width; x0 += 4)
+			{
+				for (int lane = 0; lane < 4; ++lane)
+				{
+					// 超出行尾的通道重复最后一个像素
+					uint32_t x = std::min(x0 + lane, width - 1);
+					float sx = (2.0f * (x + 0.5f) / width - 1.0f) * tanHalfX;
+					float dx = f.x + r.x * sx + u.x * sy;
+					float dy = f.y + r.y * sx + u.y * sy;
+					float dz = f.z + r.z * sx + u.z * sy;
+					float invLen = 1.0f / sqrtf(dx * dx + dy * dy + dz * dz);
+					packet.ox[lane] = camera.eye.x, packet.oy[lane] = camera.eye.y, packet.oz[lane] = camera.eye.z;
+					packet.dx[lane] = dx * invLen, packet.dy[lane] = dy * invLen, packet.dz[lane] = dz * invLen;
+					packet.maxDist[lane] = FLT_MAX;
+				}
+				CastRayPacket4(packet, hits);
+				for (uint32_t lane = 0; lane < 4 && x0 + lane < width; ++lane)
+				{
+					float o[3] = { packet.ox[lane], packet.oy[lane], packet.oz[lane] };
+					float d[3] = { packet.dx[lane], packet.dy[lane], packet.dz[lane] };
+					pixels[(size_t)y * width + x0 + lane] = ShadeHit(hits[lane], o, d);
+				}
+			}
+		}
+	};
+
+	auto start = std::chrono::high_resolution_clock::now();
+	std::vector<std::thread> threads;
+	for (uint32_t i = 1; i < threadCount; ++i)
+		threads.emplace_back(worker);
+	worker();
+	for (std::thread& th : threads)
+		th.join();
+	stats.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	return stats;
+}
+
+bool SaveBitmapRGBA(const char* fileName, const std::vector<uint32_t>& pixels, uint32_t width, uint32_t height)
+{
+	if (pixels.size() < (size_t)width * height)
+		return false;
+	std::ofstream fout(fileName, std::ios::binary);
+	if (!fout)
+		return false;
+
+	auto put16 = [&](uint16_t v) { fout.put((char)(v & 0xFF)).put((char)(v >> 8)); };
+	auto put32 = [&](uint32_t v) { put16((uint16_t)(v & 0xFFFF)); put16((uint16_t)(v >> 16)); };
+
+	uint32_t imageSize = width * height * 4;
+	// BITMAPFILEHEADER
+	put16(0x4D42);
+	put32(14 + 40 + imageSize);
+	put32(0);
+	put32(14 + 40);
+	// BITMAPINFOHEADER，高度取负表示自上而下存放
+	put32(40);
+	put32(width);
+	put32((uint32_t)(-(int32_t)height));
+	put16(1);
+	put16(32);
+	put32(0);
+	put32(imageSize);
+	put32(2835);
+	put32(2835);
+	put32(0);
+	put32(0);
+
+	// RGBA -> BGRA
+	for (size_t i = 0; i < (size_t)width * height; ++i)
+	{
+		uint32_t c = pixels[i];
+		put32((c & 0xFF00FF00u) | ((c & 0xFF) << 16) | ((c >> 16) & 0xFF));
+	}
+	return (bool)fout;
+}
@@ -0,0 +1,105 @@
+#ifndef VOXELGRID_H
+#define VOXELGRID_H
+
+#include <vector>
+#include <cstdint>
+#include "PortableMath.h"
+
+// 射线命中的面，与rand.cpp中立方体索引的面顺序一致
+enum VoxelFace
+{
+	VoxelFace_None = -1,	// 射线起点就在被占用的格子内
+	VoxelFace_PosX = 0,		// 右面(+X面)
+	VoxelFace_NegX = 1,		// 左面(-X面)
+	VoxelFace_PosY = 2,		// 顶面(+Y面)
+	VoxelFace_NegY = 3,		// 底面(-Y面)
+	VoxelFace_PosZ = 4,		// 背面(+Z面)
+	VoxelFace_NegZ = 5		// 正面(-Z面)
+};
+
+// 单条射线的求交结果
+struct VoxelHit
+{
+	bool hit;				// 是否命中
+	int cell[3];			// 命中格子的坐标
+	int face;				// 命中的面(VoxelFace)
+	float distance;			// 命中距离(以射线方向的参数t计)
+};
+
+// 4条射线组成的射线包，按分量分开存放(SoA)，便于SIMD
+struct VoxelRayPacket4
+{
+	float ox[4], oy[4], oz[4];	// 射线起点
+	float dx[4], dy[4], dz[4];	// 射线方向(不要求单位化)
+	float maxDist[4];			// 最大求交距离
+};
+
+// 射线统计
+struct VoxelRayStats
+{
+	uint64_t rayCount;		// 发射的射线数
+	double seconds;			// 耗时(秒)
+
+	double RaysPerSecond() const { return seconds > 0.0 ? rayCount / seconds : 0.0; }
+};
+
+// 预览相机参数
+struct VoxelPreviewCamera
+{
+	DirectX::XMFLOAT3 eye;		// 观察点
+	DirectX::XMFLOAT3 target;	// 目标点
+	DirectX::XMFLOAT3 up;		// 上方向
+	float fovY;					// 竖直视野(弧度)
+};
+
+// 体素占用网格，用位集存放每个格子是否被占用。
+// 使用Amanatides-Woo的DDA算法逐格遍历射线，用于CPU拾取和无GPU的预览渲染
+class VoxelGrid
+{
+public:
+	VoxelGrid();
+
+	// 从立方体顶点数组构建网格，每8个顶点构成一个边长为cellSize的立方体(即NameVertices中由rand.cpp生成的格子)
+	// [In]pPositions	第一个顶点位置
+	// [In]stride		相邻两个顶点之间的字节跨度
+	// [In]vertexCount	顶点数目，应当为8的倍数
+	// [In]cellSize		格子边长
+	void BuildFromCubeVertices(const DirectX::XMFLOAT3* pPositions, uint32_t stride, uint32_t vertexCount, float cellSize);
+	// 从格子坐标列表构建网格，第i个格子占据[origin + cells[i] * cellSize, origin + (cells[i] + 1) * cellSize)
+	void BuildFromCells(const std::vector<DirectX::XMINT3>& cells, const DirectX::XMFLOAT3& origin, float cellSize);
+
+	bool IsOccupied(int x, int y, int z) const;
+	uint32_t GetOccupiedCount() const;
+	int GetDimension(int axis) const;
+	float GetCellSize() const;
+	const DirectX::XMFLOAT3& GetOrigin() const;
+	// 获取包围盒
+	void GetBounds(DirectX::XMFLOAT3& minPoint, DirectX::XMFLOAT3& maxPoint) const;
+
+	// 单条射线求交，返回是否命中
+	bool CastRay(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& dir, float maxDist, VoxelHit& hit) const;
+	// 4条射线并行遍历(SSE2)
+	void CastRayPacket4(const VoxelRayPacket4& packet, VoxelHit hits[4]) const;
+
+	// 多线程整帧光线投射预览，输出RGBA8图像(行优先，自上而下)
+	// [In]threadCount	线程数，为0则使用硬件线程数
+	VoxelRayStats RenderPreview(const VoxelPreviewCamera& camera, uint32_t width, uint32_t height,
+		std::vector<uint32_t>& pixels, uint32_t threadCount = 0) const;
+
+private:
+	struct Traversal;
+	// 将射线转换到网格空间并裁剪到网格包围盒，初始化DDA的遍历状态，返回是否与网格相交
+	bool BeginTraversal(const float origin[3], const float dir[3], float maxDist, Traversal& tr) const;
+
+private:
+	DirectX::XMFLOAT3 m_Origin;		// 网格最小角点
+	float m_CellSize;				// 格子边长
+	int m_Dim[3];					// 各轴格子数
+	uint32_t m_OccupiedCount;		// 被占用的格子数
+	std::vector<uint64_t> m_Bits;	// 占用位集
+};
+
+// 将RGBA8图像保存为32位BMP文件，返回是否成功
+bool SaveBitmapRGBA(const char* fileName, const std::vector<uint32_t>& pixels, uint32_t width, uint32_t height);
+
+#endif
@@ -0,0 +1,267 @@
+#include "AmbientProbes.h"
+#include "JobSystem.h"
+#include "SoftSimd.h"
+#include <chrono>
+
+using namespace DirectX;
+using namespace SoftSimd;
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// 辐照度系数 = A_l * K_i^2 * ∫L * poly_i，A_l为截断余弦的卷积系数(π, 2π/3, π/4)，
+	// K_i为球谐基函数的归一化常数，poly_i为EvaluateAmbientProbe中的多项式
+	const float kIrradianceScale[AmbientProbeCoefficients] = {
+		0.25f,
+		0.5f, 0.5f, 0.5f,
+		15.0f / 16.0f, 15.0f / 16.0f, 5.0f / 64.0f, 15.0f / 16.0f, 15.0f / 64.0f
+	};
+
+	const uint32_t kSkyRows = 32;		// 天空按经纬度积分，从天顶到天底的行数
+	const uint32_t kSkyColumns = 64;
+
+	// sums[3 * i + c]累加每个光源的 颜色c * poly_i(光源方向)。
+	// 光源到(ox, oy, oz)的距离大于range时不计入，pWeight不为空时颜色再乘上对应的权重
+	void AccumulateSH(const float* pX, const float* pY, const float* pZ, const float* pRange,
+		const float* pR, const float* pG, const float* pB, const float* pWeight, uint32_t paddedCount,
+		float ox, float oy, float oz, float sums[AmbientProbeCoefficients * 3])
+	{
+		VFloat acc[AmbientProbeCoefficients * 3];
+		for (VFloat& v : acc)
+			v = VSplat(0.0f);
+
+		const VFloat origin[3] = { VSplat(ox), VSplat(oy), VSplat(oz) };
+		const VFloat zero = VSplat(0.0f), one = VSplat(1.0f), three = VSplat(3.0f), minDist = VSplat(1e-6f);
+		for (uint32_t i = 0; i < paddedCount; i += kLanes)
+		{
+			VFloat vx = VSub(VLoad(pX + i), origin[0]);
+			VFloat vy = VSub(VLoad(pY + i), origin[1]);
+			VFloat vz = VSub(VLoad(pZ + i), origin[2]);
+			VFloat d = VSqrt(VAdd(VAdd(VMul(vx, vx), VMul(vy, vy)), VMul(vz, vz)));
+			VFloat w = VSelect(VCmpLe(d, VLoad(pRange + i)), pWeight ? VLoad(pWeight + i) : one, zero);
+			if (!VMask(VCmpGt(w, zero)))
+				continue;
+
+			VFloat invD = VDiv(one, VMax(d, minDist));
+			VFloat x = VMul(vx, invD), y = VMul(vy, invD), z = VMul(vz, invD);
+			const VFloat color[3] = { VMul(VLoad(pR + i), w), VMul(VLoad(pG + i), w), VMul(VLoad(pB + i), w) };
+			const VFloat poly[AmbientProbeCoefficients] = {
+				one, y, z, x,
+				VMul(x, y), VMul(y, z), VSub(VMul(three, VMul(z, z)), one), VMul(x, z), VSub(VMul(x, x), VMul(y, y))
+			};
+			for (uint32_t k = 0; k < AmbientProbeCoefficients; ++k)
+				for (uint32_t c = 0; c < 3; ++c)
+					acc[3 * k + c] = VAdd(acc[3 * k + c], VMul(poly[k], color[c]));
+		}
+
+		float lanes[kLanes];
+		for (uint32_t k = 0; k < AmbientProbeCoefficients * 3; ++k)
+		{
+			VStore(lanes, acc[k]);
+			float s = 0.0f;
+			for (uint32_t l = 0; l < kLanes; ++l)
+				s += lanes[l];
+			sums[k] += s;
+		}
+	}
+
+	void PadStreams(std::vector<float>* streams[7], uint32_t count)
+	{
+		uint32_t padded = (count + kLanes - 1) / kLanes * kLanes;
+		for (int s = 0; s < 7; ++s)
+			streams[s]->resize(padded, s == 3 ? -1.0f : 0.0f);
+	}
+}
+
+AmbientProbeGrid::AmbientProbeGrid()
+	: m_Constants(),
+	m_Directionality(0.5f),
+	m_SkyCoefficients(),
+	m_BuildMicroseconds(0.0)
+{
+	m_PointLights.count = m_SpotLights.count = 0;
+	SetGrid(XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f), 2, 2, 2);
+}
+
+void AmbientProbeGrid::SetGrid(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax, uint32_t countX, uint32_t countY, uint32_t countZ)
+{
+	countX = std::max(countX, 2u);
+	countY = std::max(countY, 2u);
+	countZ = std::max(countZ, 2u);
+	m_Constants.gridMin = boundsMin;
+	m_Constants.invCellSize = XMFLOAT3(
+		(countX - 1) / std::max(boundsMax.x - boundsMin.x, 1e-6f),
+		(countY - 1) / std::max(boundsMax.y - boundsMin.y, 1e-6f),
+		(countZ - 1) / std::max(boundsMax.z - boundsMin.z, 1e-6f));
+	m_Constants.countX = countX;
+	m_Constants.countY = countY;
+	m_Constants.countZ = countZ;
+	m_Constants.enabled = 1;
+	m_Coefficients.assign((size_t)GetProbeCount() * AmbientProbeCoefficients, XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f));
+}
+
+void AmbientProbeGrid::SetSky(const XMFLOAT3& zenith, const XMFLOAT3& horizon, const XMFLOAT3& ground)
+{
+	// 每个采样方向当作单位球面上的一个光源，颜色为辐亮度乘以立体角，
+	// 均匀的辐亮度color / π得到的辐照度即为color
+	std::vector<float> streams[7];
+	const float dTheta = XM_PI / kSkyRows, dPhi = XM_2PI / kSkyColumns;
+	for (uint32_t row = 0; row < kSkyRows; ++row)
+	{
+		float theta = (row + 0.5f) * dTheta;
+		float y = std::cos(theta), sinTheta = std::sin(theta);
+		float solidAngle = sinTheta * dTheta * dPhi / XM_PI;
+		const XMFLOAT3& edge = y >= 0.0f ? zenith : ground;
+		float t = std::fabs(y);
+		XMFLOAT3 color(horizon.x + (edge.x - horizon.x) * t, horizon.y + (edge.y - horizon.y) * t, horizon.z + (edge.z - horizon.z) * t);
+		for (uint32_t column = 0; column < kSkyColumns; ++column)
+		{
+			float phi = (column + 0.5f) * dPhi;
+			streams[0].push_back(sinTheta * std::cos(phi));
+			streams[1].push_back(y);
+			streams[2].push_back(sinTheta * std::sin(phi));
+			streams[3].push_back(2.0f);
+			streams[4].push_back(color.x * solidAngle);
+			streams[5].push_back(color.y * solidAngle);
+			streams[6].push_back(color.z * solidAngle);
+		}
+	}
+	std::vector<float>* pStreams[7] = { &streams[0], &streams[1], &streams[2], &streams[3], &streams[4], &streams[5], &streams[6] };
+	PadStreams(pStreams, kSkyRows * kSkyColumns);
+
+	float sums[AmbientProbeCoefficients * 3] = {};
+	AccumulateSH(streams[0].data(), streams[1].data(), streams[2].data(), streams[3].data(),
+		streams[4].data(), streams[5].data(), streams[6].data(), nullptr, (uint32_t)streams[0].size(), 0.0f, 0.0f, 0.0f, sums);
+	for (uint32_t i = 0; i < AmbientProbeCoefficients * 3; ++i)
+		m_SkyCoefficients[i] = sums[i] * kIrradianceScale[i / 3];
+}
+
+void AmbientProbeGrid::SetDirectionality(float directionality)
+{
+	m_Directionality = std::min(std::max(directionality, 0.0f), 1.0f);
+}
+
+void AmbientProbeGrid::Build(const DirectionalLight* pDirLights, uint32_t dirCount, const PointLight* pPointLights, uint32_t pointCount,
+	const SpotLight* pSpotLights, uint32_t spotCount, JobSystem* jobs)
+{
+	Clock::time_point start = Clock::now();
+
+	LightStreams* pStreams[2] = { &m_PointLights, &m_SpotLights };
+	for (uint32_t pass = 0; pass < 2; ++pass)
+	{
+		LightStreams& streams = *pStreams[pass];
+		uint32_t count = pass == 0 ? pointCount : spotCount;
+		std::vector<float>* pVectors[7] = { &streams.x, &streams.y, &streams.z, &streams.range, &streams.r, &streams.g, &streams.b };
+		for (std::vector<float>* v : pVectors)
+			v->clear();
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const XMFLOAT3& pos = pass == 0 ? pPointLights[i].position : pSpotLights[i].position;
+			const XMFLOAT4& ambient = pass == 0 ? pPointLights[i].ambient : pSpotLights[i].ambient;
+			streams.x.push_back(pos.x);
+			streams.y.push_back(pos.y);
+			streams.z.push_back(pos.z);
+			streams.range.push_back(pass == 0 ? pPointLights[i].range : pSpotLights[i].range);
+			streams.r.push_back(ambient.x);
+			streams.g.push_back(ambient.y);
+			streams.b.push_back(ambient.z);
+		}
+		PadStreams(pVectors, count);
+		streams.count = count;
+	}
+
+	uint32_t probeCount = GetProbeCount();
+	JobSystem::RangeFunc func = [&](uint32_t begin, uint32_t end)
+	{
+		std::vector<float> spotWeights(m_SpotLights.x.size(), 0.0f);
+		for (uint32_t probe = begin; probe < end; ++probe)
+			BuildProbe(probe, pDirLights, dirCount, pSpotLights, spotWeights);
+	};
+	if (jobs)
+		jobs->ParallelFor(probeCount, 8, func);
+	else
+		func(0, probeCount);
+
+	m_BuildMicroseconds = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+void AmbientProbeGrid::BuildProbe(uint32_t probe, const DirectionalLight* pDirLights, uint32_t dirCount,
+	const SpotLight* pSpotLights, std::vector<float>& spotWeights)
+{
+	const AmbientProbeConstants& c = m_Constants;
+	uint32_t ix = probe % c.countX, iy = probe / c.countX % c.countY, iz = probe / (c.countX * c.countY);
+	float px = c.gridMin.x + ix / c.invCellSize.x;
+	float py = c.gridMin.y + iy / c.invCellSize.y;
+	float pz = c.gridMin.z + iz / c.invCellSize.z;
+
+	float sums[AmbientProbeCoefficients * 3] = {};
+	for (uint32_t i = 0; i < dirCount; ++i)
+	{
+		XMFLOAT3 l;
+		XMStoreFloat3(&l, XMVectorNegate(XMVector3Normalize(XMLoadFloat3(&pDirLights[i].direction))));
+		const float poly[AmbientProbeCoefficients] = { 1.0f, l.y, l.z, l.x, l.x * l.y, l.y * l.z, 3.0f * l.z * l.z - 1.0f, l.x * l.z, l.x * l.x - l.y * l.y };
+		const XMFLOAT4& a = pDirLights[i].ambient;
+		for (uint32_t k = 0; k < AmbientProbeCoefficients; ++k)
+		{
+			sums[3 * k + 0] += poly[k] * a.x;
+			sums[3 * k + 1] += poly[k] * a.y;
+			sums[3 * k + 2] += poly[k] * a.z;
+		}
+	}
+
+	AccumulateSH(m_PointLights.x.data(), m_PointLights.y.data(), m_PointLights.z.data(), m_PointLights.range.data(),
+		m_PointLights.r.data(), m_PointLights.g.data(), m_PointLights.b.data(), nullptr, (uint32_t)m_PointLights.x.size(), px, py, pz, sums);
+
+	if (m_SpotLights.count)
+	{
+		// 聚光因子用与HLSL相同的ComputeSpotFactor在探针处计算
+		const float3 probePos(px, py, pz);
+		for (uint32_t i = 0; i < m_SpotLights.count; ++i)
+		{
+			const SpotLight& L = pSpotLights[i];
+			float3 lightVec = L.position - probePos;
+			float d = length(lightVec);
+			spotWeights[i] = d > 0.0f ? ComputeSpotFactor(L, lightVec / d) : 1.0f;
+		}
+		AccumulateSH(m_SpotLights.x.data(), m_SpotLights.y.data(), m_SpotLights.z.data(), m_SpotLights.range.data(),
+			m_SpotLights.r.data(), m_SpotLights.g.data(), m_SpotLights.b.data(), spotWeights.data(), (uint32_t)m_SpotLights.x.size(), px, py, pz, sums);
+	}
+
+	// 各向同性的部分只有常数项，方向性的部分是强度为4倍的方向光，两者的常数项合起来仍为sums[0]
+	XMFLOAT4* pCoefficients = m_Coefficients.data() + (size_t)probe * AmbientProbeCoefficients;
+	for (uint32_t k = 0; k < AmbientProbeCoefficients; ++k)
+	{
+		float scale = k == 0 ? 1.0f : 4.0f * m_Directionality * kIrradianceScale[k];
+		pCoefficients[k] = XMFLOAT4(
+			sums[3 * k + 0] * scale + m_SkyCoefficients[3 * k + 0],
+			sums[3 * k + 1] * scale + m_SkyCoefficients[3 * k + 1],
+			sums[3 * k + 2] * scale + m_SkyCoefficients[3 * k + 2],
+			0.0f);
+	}
+}
+
+const AmbientProbeConstants& AmbientProbeGrid::GetConstants() const
+{
+	return m_Constants;
+}
+
+const std::vector<XMFLOAT4>& AmbientProbeGrid::GetCoefficients() const
+{
+	return m_Coefficients;
+}
+
+uint32_t AmbientProbeGrid::GetProbeCount() const
+{
+	return m_Constants.countX * m_Constants.countY * m_Constants.countZ;
+}
+
+double AmbientProbeGrid::GetBuildMicroseconds() const
+{
+	return m_BuildMicroseconds;
+}
+
+XMVECTOR XM_CALLCONV AmbientProbeGrid::Sample(FXMVECTOR posW, FXMVECTOR normal) const
+{
+	return SampleAmbientProbes(m_Constants, m_Coefficients.data(), posW, normal);
+}
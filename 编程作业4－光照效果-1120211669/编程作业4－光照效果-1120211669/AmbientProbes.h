@@ -0,0 +1,129 @@
+#ifndef AMBIENTPROBES_H
+#define AMBIENTPROBES_H
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include "LightHelper.h"
+
+class JobSystem;
+
+// 球谐环境光探针的常量，对应HLSL中的CBAmbientProbes(b5)。
+// 探针位于gridMin + (i, j, k) / invCellSize，每个方向至少2个
+struct AmbientProbeConstants
+{
+	DirectX::XMFLOAT3 gridMin;
+	uint32_t countX;
+	DirectX::XMFLOAT3 invCellSize;
+	uint32_t countY;
+	uint32_t countZ;
+	uint32_t enabled;		// 为0时仍使用各光源的ambient
+	uint32_t pad[2];
+};
+HLSL_CHECK_SIZE(AmbientProbeConstants);
+HLSL_CHECK_PACKING(AmbientProbeConstants, gridMin);
+HLSL_CHECK_PACKING(AmbientProbeConstants, invCellSize);
+
+// 每个探针的9个系数，rgb为已乘上余弦卷积和基函数常数的辐照度系数，法线n处的环境光为
+// c0 + c1 * y + c2 * z + c3 * x + c4 * xy + c5 * yz + c6 * (3z^2 - 1) + c7 * xz + c8 * (x^2 - y^2)
+const uint32_t AmbientProbeCoefficients = 9;
+
+inline DirectX::XMVECTOR XM_CALLCONV EvaluateAmbientProbe(const DirectX::XMFLOAT4* pCoefficients, DirectX::FXMVECTOR normal)
+{
+	using namespace DirectX;
+	XMFLOAT3 n;
+	XMStoreFloat3(&n, normal);
+	const float basis[AmbientProbeCoefficients] = { 1.0f, n.y, n.z, n.x, n.x * n.y, n.y * n.z, 3.0f * n.z * n.z - 1.0f, n.x * n.z, n.x * n.x - n.y * n.y };
+	XMVECTOR e = XMVectorZero();
+	for (uint32_t i = 0; i < AmbientProbeCoefficients; ++i)
+		e = XMVectorMultiplyAdd(XMLoadFloat4(&pCoefficients[i]), XMVectorReplicate(basis[i]), e);
+	// 9个系数近似截断余弦有轻微的振铃，背光处可能略小于0
+	return XMVectorMax(e, XMVectorZero());
+}
+
+// 世界空间中的点在探针网格中三线性插值，与Light.hlsli中的SampleAmbientProbes相同
+inline DirectX::XMVECTOR XM_CALLCONV SampleAmbientProbes(const AmbientProbeConstants& c, const DirectX::XMFLOAT4* pProbes,
+	DirectX::FXMVECTOR posW, DirectX::FXMVECTOR normal)
+{
+	using namespace DirectX;
+	XMFLOAT3 p;
+	XMStoreFloat3(&p, posW);
+	const float g[3] = { (p.x - c.gridMin.x) * c.invCellSize.x, (p.y - c.gridMin.y) * c.invCellSize.y, (p.z - c.gridMin.z) * c.invCellSize.z };
+	const uint32_t counts[3] = { c.countX, c.countY, c.countZ };
+	uint32_t i0[3];
+	float t[3];
+	for (int a = 0; a < 3; ++a)
+	{
+		float clamped = std::fmin(std::fmax(g[a], 0.0f), counts[a] - 1.0f);
+		i0[a] = std::min((uint32_t)clamped, counts[a] - 2);
+		t[a] = clamped - i0[a];
+	}
+
+	XMVECTOR e = XMVectorZero();
+	for (uint32_t corner = 0; corner < 8; ++corner)
+	{
+		uint32_t x = i0[0] + (corner & 1), y = i0[1] + (corner >> 1 & 1), z = i0[2] + (corner >> 2);
+		float w = ((corner & 1) ? t[0] : 1.0f - t[0]) * ((corner >> 1 & 1) ? t[1] : 1.0f - t[1]) * ((corner >> 2) ? t[2] : 1.0f - t[2]);
+		const XMFLOAT4* pCoefficients = pProbes + ((size_t)(z * c.countY + y) * c.countX + x) * AmbientProbeCoefficients;
+		e = XMVectorMultiplyAdd(EvaluateAmbientProbe(pCoefficients, normal), XMVectorReplicate(w), e);
+	}
+	return e;
+}
+
+// 球谐(SH9)环境光探针网格，代替各光源固定的ambient。
+// 每个探针把所有光源的ambient投影到9个球谐系数上：其中1 - directionality的部分各向同性，
+// 其余部分看作从光源方向射来的光，按截断余弦卷积成辐照度，在全部法线上的平均值与原来的ambient相同。
+// 点光和聚光灯只在探针位于range内(聚光灯再乘上探针处的聚光因子)时计入，与原来逐像素的判断相同。
+// 天空按天顶、地平线和地面三种颜色插值，在SetSky中数值积分一次，之后叠加到每个探针上。
+// 点光和聚光灯按SoA排列，每次用SIMD处理kLanes个光源；按探针并行，结果与线程数无关
+class AmbientProbeGrid
+{
+public:
+	AmbientProbeGrid();
+
+	// 在包围盒内均匀放置countX x countY x countZ个探针，每个方向至少2个
+	void SetGrid(const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax, uint32_t countX, uint32_t countY, uint32_t countZ);
+	// 颜色为法线朝向该方向附近时得到的环境光，全部相同时各个方向的环境光都等于该颜色
+	void SetSky(const DirectX::XMFLOAT3& zenith, const DirectX::XMFLOAT3& horizon, const DirectX::XMFLOAT3& ground);
+	// 光源的ambient中有方向性的比例，0为完全各向同性，默认0.5
+	void SetDirectionality(float directionality);
+
+	// 光源为世界空间
+	// [In]jobs	不为空则按探针在工作线程中计算
+	void Build(const DirectionalLight* pDirLights, uint32_t dirCount, const PointLight* pPointLights, uint32_t pointCount,
+		const SpotLight* pSpotLights, uint32_t spotCount, JobSystem* jobs = nullptr);
+
+	// enabled为1
+	const AmbientProbeConstants& GetConstants() const;
+	// 每个探针AmbientProbeCoefficients个，按x、y、z的顺序排列
+	const std::vector<DirectX::XMFLOAT4>& GetCoefficients() const;
+	uint32_t GetProbeCount() const;
+	double GetBuildMicroseconds() const;
+
+	DirectX::XMVECTOR XM_CALLCONV Sample(DirectX::FXMVECTOR posW, DirectX::FXMVECTOR normal) const;
+
+private:
+	// SoA排列的光源，长度补齐为kLanes的倍数，补齐的部分range为-1
+	struct LightStreams
+	{
+		std::vector<float> x, y, z;
+		std::vector<float> range;
+		std::vector<float> r, g, b;		// ambient
+		uint32_t count;
+	};
+
+	void BuildProbe(uint32_t probe, const DirectionalLight* pDirLights, uint32_t dirCount,
+		const SpotLight* pSpotLights, std::vector<float>& spotWeights);
+
+private:
+	AmbientProbeConstants m_Constants;
+	float m_Directionality;
+	float m_SkyCoefficients[AmbientProbeCoefficients * 3];	// 天空的辐照度系数
+	LightStreams m_PointLights;
+	LightStreams m_SpotLights;
+	std::vector<DirectX::XMFLOAT4> m_Coefficients;
+	double m_BuildMicroseconds;
+};
+
+#endif
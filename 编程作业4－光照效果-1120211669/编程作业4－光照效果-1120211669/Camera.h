@@ -0,0 +1,99 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <cstdint>
+#include "PortableMath.h"
+#include "FrustumCulling.h"
+
+enum CameraMode
+{
+	CameraMode_FirstPerson,	// 位置加欧拉角，自由飞行
+	CameraMode_Orbit,		// 绕目标点旋转，位置由目标点、距离和角度决定
+	CameraMode_LookAt		// 观察点、目标点和上方向，与XMMatrixLookAtLH相同
+};
+
+// 摄像机，各个场景和视锥体剔除共用。朝向以单位四元数保存，三种控制方式最终都归结为位置加朝向。
+// 观察矩阵、投影矩阵、二者的乘积和视锥体平面都缓存起来，只在输入变化后第一次读取时重新计算；
+// 设置的值与原来相同时不算变化。矩阵均未转置，行向量右乘
+class Camera
+{
+public:
+	Camera();
+
+	// 投影参数，aspect为宽高比
+	void SetLens(float fovY, float aspect, float nearZ, float farZ);
+	void SetAspect(float aspect);			// 窗口大小变化时调用
+
+	// 第一人称。angles的x、y、z分别为俯仰、偏航、滚转角(弧度)，先绕X轴，再绕Z轴，最后绕Y轴旋转
+	void SetFirstPerson(const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT3& angles);
+	void SetEulerAngles(const DirectX::XMFLOAT3& angles);
+	void SetPosition(const DirectX::XMFLOAT3& position);
+	// 直接指定朝向(单位四元数)，之后为第一人称模式，GetEulerAngles不再与朝向对应
+	void SetOrientation(const DirectX::XMFLOAT4& quaternion);
+	// 沿摄像机自身的坐标轴平移(x右、y上、z前)，环绕和注视模式下目标点一起移动
+	void MoveLocal(const DirectX::XMFLOAT3& offset);
+
+	// 环绕。摄像机位于目标点沿视线后方distance处，俯仰角为正时从上方看向目标点
+	void SetOrbit(const DirectX::XMFLOAT3& target, float distance, float pitch, float yaw);
+	void Orbit(float deltaPitch, float deltaYaw);	// 俯仰角限制在(-pi/2, pi/2)内
+	void Zoom(float deltaDistance);					// 距离不小于近平面
+
+	// 注视
+	void LookAt(const DirectX::XMFLOAT3& eye, const DirectX::XMFLOAT3& target, const DirectX::XMFLOAT3& up);
+
+	CameraMode GetMode() const;
+	const DirectX::XMFLOAT3& GetPosition() const;
+	const DirectX::XMFLOAT4& GetOrientation() const;
+	const DirectX::XMFLOAT3& GetEulerAngles() const;	// 第一人称和环绕模式下最后设置的角度
+	const DirectX::XMFLOAT3& GetTarget() const;			// 环绕和注视模式的目标点
+	float GetDistance() const;
+	float GetFovY() const;
+	float GetAspect() const;
+	float GetNearZ() const;
+	float GetFarZ() const;
+
+	// 摄像机的三个轴在世界空间中的方向
+	DirectX::XMVECTOR XM_CALLCONV GetRight() const;
+	DirectX::XMVECTOR XM_CALLCONV GetUp() const;
+	DirectX::XMVECTOR XM_CALLCONV GetLook() const;
+
+	DirectX::XMMATRIX XM_CALLCONV GetView() const;
+	DirectX::XMMATRIX XM_CALLCONV GetProj() const;
+	DirectX::XMMATRIX XM_CALLCONV GetViewProj() const;
+	const FrustumPlanes& GetFrustum() const;
+
+	// 观察或投影矩阵每变化一次加1，从1开始。使用者记下上传时的值，不同时才需要重新上传
+	uint32_t GetVersion() const;
+
+private:
+	// 位置或朝向与原来不同时才标记观察矩阵需要更新
+	void SetPose(DirectX::FXMVECTOR position, DirectX::FXMVECTOR orientation);
+	void UpdateOrbitPose();
+	void MarkViewChanged();
+	void MarkProjChanged();
+
+private:
+	CameraMode m_Mode;
+	DirectX::XMFLOAT3 m_Position;
+	DirectX::XMFLOAT4 m_Orientation;	// 摄像机空间到世界空间的旋转
+	DirectX::XMFLOAT3 m_EulerAngles;	// 俯仰、偏航、滚转角
+	DirectX::XMFLOAT3 m_Target;
+	float m_Distance;
+
+	float m_FovY;
+	float m_Aspect;
+	float m_NearZ;
+	float m_FarZ;
+
+	mutable DirectX::XMFLOAT4X4 m_View;
+	mutable DirectX::XMFLOAT4X4 m_Proj;
+	mutable DirectX::XMFLOAT4X4 m_ViewProj;
+	mutable FrustumPlanes m_Frustum;
+	mutable bool m_ViewDirty;
+	mutable bool m_ProjDirty;
+	mutable bool m_ViewProjDirty;
+	mutable bool m_FrustumDirty;
+	uint32_t m_Version;
+};
+
+#endif
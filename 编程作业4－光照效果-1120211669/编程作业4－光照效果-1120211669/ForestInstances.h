@@ -0,0 +1,91 @@
+#ifndef FORESTINSTANCES_H
+#define FORESTINSTANCES_H
+
+#include <vector>
+#include <cstdint>
+#include <ostream>
+#include "PortableMath.h"
+#include "CounterRng.h"
+#include "TransformHierarchy.h"
+
+class JobSystem;
+
+// 字符森林的实例数据，只在CPU端生成世界矩阵，不依赖D3D设备。
+// 世界矩阵由变换层次计算：每棵树有一个锚点(尺寸和位置)，树本身和它的子物体都挂在锚点下
+class ForestInstances
+{
+public:
+	// 每个实例的数据，与实例缓冲区中的元素一一对应
+	struct InstanceData
+	{
+		DirectX::XMFLOAT4X4 world;	// 世界矩阵的转置，与常量缓冲区中的约定一致
+	};
+
+	// 每个实例在世界空间的包围球，按分量分开存放(SoA)便于SIMD剔除。
+	// 长度补齐为8的倍数，补齐部分的半径为-FLT_MAX，总是被剔除
+	struct BoundingSpheres
+	{
+		std::vector<float> centerX;
+		std::vector<float> centerY;
+		std::vector<float> centerZ;
+		std::vector<float> radius;
+	};
+
+public:
+	// 子物体个数在构造时确定，实例数组也在此时分配好
+	// [In]seed	随机数种子，相同的种子总是生成相同的森林
+	ForestInstances(int gridN, uint32_t seed = 0);
+
+	// 生成这一帧所有树及其子物体的世界矩阵，angle与上一次相同时直接返回
+	// 前gridN * gridN个实例为树，按(i - 1) * gridN + (j - 1)排列，其后为子物体
+	// [In]jobs	不为空则按树的范围切分并行生成，每个任务只写入自己那一段实例
+	//			随机数由(树的编号, 用途)决定，结果与线程数和执行顺序无关
+	void Build(float angle, JobSystem* jobs = nullptr);
+	// 上一次Build中的矩阵乘法次数(局部变换直接写出，只有层次更新中的仿射乘法)
+	uint64_t GetMultiplyCount() const;
+	// 不使用层次、每帧对每个实例完整计算矩阵链时的乘法次数，用于对比
+	uint64_t GetNaiveMultiplyCount() const;
+	// 设置名字模型在局部空间的包围球，Build时据此生成每个实例的包围球
+	void SetLocalBounds(const DirectX::XMFLOAT3& center, float radius);
+
+	int GetGridN() const;
+	uint32_t GetTreeCount() const;
+	uint32_t GetInstanceCount() const;
+	const std::vector<InstanceData>& GetInstances() const;
+	const BoundingSpheres& GetBoundingSpheres() const;
+	// 获取第index棵树未转置的世界矩阵
+	DirectX::XMMATRIX XM_CALLCONV GetTreeWorld(uint32_t index) const;
+	// 第index棵树的子物体在实例数组中的范围[first, last)
+	void GetChildRange(uint32_t index, uint32_t& first, uint32_t& last) const;
+	// 第index棵树去掉动画后的世界矩阵：尺寸取动画中的平均值，不旋转。用于生成静态的代理网格
+	DirectX::XMMATRIX XM_CALLCONV GetTreeRestWorld(uint32_t index) const;
+	// 第index棵树在动画中的最大尺寸
+	float GetTreeMaxScale(uint32_t index) const;
+
+private:
+	// 设置[begin, end)范围内的树的锚点、树和子物体的局部矩阵
+	void SetLocalRange(float angle, uint32_t begin, uint32_t end);
+	// 将层次更新后的世界矩阵和包围球写入[begin, end)范围内的实例
+	void StoreRange(uint32_t begin, uint32_t end);
+	void XM_CALLCONV StoreSphere(uint32_t index, DirectX::FXMVECTOR center, float radius);
+	// 第index棵树随机的尺寸系数，动画中的尺寸为(sin(...) + 1.3) * 系数
+	float GetScaleFactor(uint32_t index) const;
+
+private:
+	int m_GridN;								// 每行的树数
+	CounterRng m_Rng;							// 计数器随机数发生器
+	std::vector<uint32_t> m_ChildOffset;		// 每棵树第一个子物体在实例数组中的下标，末尾多存一个总数
+	TransformHierarchy m_Hierarchy;				// 前gridN * gridN个节点为锚点，其后第k个节点对应第k个实例
+	float m_BuiltAngle;							// 上一次Build的角度
+	bool m_Built;								// 是否已经Build过
+	uint64_t m_MultiplyCount;					// 上一次Build中的矩阵乘法次数
+	std::vector<InstanceData> m_Instances;		// 这一帧所有实例
+	BoundingSpheres m_Spheres;					// 这一帧所有实例的包围球
+	DirectX::XMFLOAT3 m_LocalCenter;			// 局部空间包围球球心
+	float m_LocalRadius;						// 局部空间包围球半径
+};
+
+// 在不同网格大小和线程数下测量Build的耗时，结果写入os
+void BenchmarkForestBuild(std::ostream& os, const std::vector<int>& gridSizes, uint32_t maxThreads);
+
+#endif
@@ -1,16 +1,60 @@
 #include "GameApp.h"
 #include "d3dUtil.h"
 #include "DXTrace.h"
+#include "AffineTransform.h"
+#include "SoftShaders.h"
+#include "PngImage.h"
+#include "CounterRng.h"
+#include <sstream>
+#include <algorithm>
 using namespace DirectX;
 
+// 软件光栅化直接使用常量缓冲区的CPU数据，布局必须与着色器的C++版本一致
+static_assert(sizeof(GameApp::CBPerObject) == sizeof(SoftShaders::LightCBPerObject), "CBPerObject layout mismatch");
+static_assert(sizeof(GameApp::CBPerFrame) == sizeof(SoftShaders::LightCBPerFrame), "CBPerFrame layout mismatch");
+static_assert(sizeof(GameApp::CBPerMaterial) == sizeof(SoftShaders::LightCBPerMaterial), "CBPerMaterial layout mismatch");
+
+namespace
+{
+	// 多光源模式的光源数
+	const uint32_t kManyPointLights = 256;
+	const uint32_t kManySpotLights = 64;
+
+	// 随机数的用途，作为CounterRng的stream
+	enum ManyLightStream : uint32_t
+	{
+		StreamPointPosition,
+		StreamPointColor,
+		StreamSpotPosition,
+		StreamSpotTarget,
+		StreamSpotShape
+	};
+
+	// 单位球面上的均匀随机方向
+	XMVECTOR RandomDirection(const CounterRng& rng, uint32_t id, uint32_t stream)
+	{
+		uint32_t bits[4];
+		rng.Generate4(id, stream, 0, bits);
+		float z = CounterRng::ToFloat(bits[0]) * 2.0f - 1.0f;
+		float phi = CounterRng::ToFloat(bits[1]) * XM_2PI;
+		float r = sqrtf(1.0f - z * z);
+		return XMVectorSet(r * cosf(phi), r * sinf(phi), z, 0.0f);
+	}
+}
+
 GameApp::GameApp(HINSTANCE hInstance)
 	: D3DApp(hInstance), 
 	m_IndexCount(),
-	m_VSConstantBuffer(),
-	m_PSConstantBuffer(),
 	m_DirLight(),
 	m_PointLight(),
-	m_SpotLight()
+	m_SpotLight(),
+	m_CameraVersion(0),
+	m_UseManyLights(false),
+	m_ManyLightsAngle(0.0f),
+	m_UseBakedLighting(false),
+	m_LastBakedMeshes(0),
+	m_LastBakeMicroseconds(0.0),
+	m_UseAmbientProbes(false)
 {
 }
 
@@ -39,47 +83,107 @@ bool GameApp::Init()
 void GameApp::OnResize()
 {
 	D3DApp::OnResize();
+	m_Camera.SetAspect(AspectRatio());
 }
 
 void GameApp::UpdateScene(float dt)
 {
 	static float phi = 0.0f, theta = 0.0f;
 	phi += 0.0001f, theta += 0.00015f;
-	XMMATRIX W = XMMatrixRotationX(phi) * XMMatrixRotationY(theta);
-	m_VSConstantBuffer.world = XMMatrixTranspose(W);
-	m_VSConstantBuffer.worldInvTranspose = XMMatrixInverse(nullptr, W);	// 两次转置可以抵消
+	// 仿射变换直接按转置后的布局写出，法线矩阵由闭式解得到，不需要对4x4矩阵求逆
+	AffineTransform W = AffineComposeSRT(XMFLOAT3(1.0f, 1.0f, 1.0f), phi, theta, XMFLOAT3(0.0f, 0.0f, 0.0f));
+	m_CBPerObject.data.world = AffineToMatrixTransposed(W);
+	m_CBPerObject.data.worldInvTranspose = AffineToMatrixTransposed(AffineInverseTransposeUniform(W));
+
+	// 左键拖动绕立方体旋转，滚轮拉近拉远
+	Mouse::State mouseState = m_pMouse->GetState();
+	Mouse::State lastMouseState = m_MouseTracker.GetLastState();
+	m_MouseTracker.Update(mouseState);
+	if (mouseState.leftButton && m_MouseTracker.leftButton == m_MouseTracker.HELD)
+		m_Camera.Orbit((mouseState.y - lastMouseState.y) * 0.01f, (mouseState.x - lastMouseState.x) * 0.01f);
+	if (mouseState.scrollWheelValue != lastMouseState.scrollWheelValue)
+		m_Camera.Zoom((lastMouseState.scrollWheelValue - mouseState.scrollWheelValue) / 120.0f * 0.5f);
 
 	// 键盘切换灯光类型
 	Keyboard::State state = m_pKeyboard->GetState();
 	m_KeyboardTracker.Update(state);	
+	bool lightChanged = true;
 	if (m_KeyboardTracker.IsKeyPressed(Keyboard::D1))
 	{
-		m_PSConstantBuffer.dirLight = m_DirLight;
-		m_PSConstantBuffer.pointLight = PointLight();
-		m_PSConstantBuffer.spotLight = SpotLight();
+		m_CBPerFrame.data.dirLight = m_DirLight;
+		m_CBPerFrame.data.pointLight = PointLight();
+		m_CBPerFrame.data.spotLight = SpotLight();
 	}
 	else if (m_KeyboardTracker.IsKeyPressed(Keyboard::D2))
 	{
-		m_PSConstantBuffer.dirLight = DirectionalLight();
-		m_PSConstantBuffer.pointLight = m_PointLight;
-		m_PSConstantBuffer.spotLight = SpotLight();
+		m_CBPerFrame.data.dirLight = DirectionalLight();
+		m_CBPerFrame.data.pointLight = m_PointLight;
+		m_CBPerFrame.data.spotLight = SpotLight();
 	}
 	else if (m_KeyboardTracker.IsKeyPressed(Keyboard::D3))
 	{
-		m_PSConstantBuffer.dirLight = DirectionalLight();
-		m_PSConstantBuffer.pointLight = PointLight();
-		m_PSConstantBuffer.spotLight = m_SpotLight;
+		m_CBPerFrame.data.dirLight = DirectionalLight();
+		m_CBPerFrame.data.pointLight = PointLight();
+		m_CBPerFrame.data.spotLight = m_SpotLight;
+	}
+	else
+	{
+		lightChanged = false;
 	}
+	// 4键在三个光源之外叠加数百个分簇着色的点光和聚光灯
+	bool manyLightsToggled = m_KeyboardTracker.IsKeyPressed(Keyboard::D4);
+	if (manyLightsToggled)
+		m_UseManyLights = !m_UseManyLights;
+	// B键切换到烘焙光照的静止场景
+	bool bakedToggled = m_KeyboardTracker.IsKeyPressed(Keyboard::B);
+	if (bakedToggled)
+		m_UseBakedLighting = !m_UseBakedLighting;
+	// H键切换球谐探针的环境光
+	bool probesToggled = m_KeyboardTracker.IsKeyPressed(Keyboard::H);
+	if (probesToggled)
+		m_UseAmbientProbes = !m_UseAmbientProbes;
 
 	// 更新常量缓冲区，让立方体转起来
-	D3D11_MAPPED_SUBRESOURCE mappedData;
-	HR(m_pd3dImmediateContext->Map(m_pConstantBuffers[0].Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData));
-	memcpy_s(mappedData.pData, sizeof(VSConstantBuffer), &m_VSConstantBuffer, sizeof(VSConstantBuffer));
-	m_pd3dImmediateContext->Unmap(m_pConstantBuffers[0].Get(), 0);
-
-	HR(m_pd3dImmediateContext->Map(m_pConstantBuffers[1].Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData));
-	memcpy_s(mappedData.pData, sizeof(PSConstantBuffer), &m_PSConstantBuffer, sizeof(PSConstantBuffer));
-	m_pd3dImmediateContext->Unmap(m_pConstantBuffers[1].Get(), 0);
+	HR(m_CBPerObject.Upload(m_pd3dImmediateContext.Get()));
+	// 灯光或摄像机变化时才上传
+	bool cameraChanged = m_CameraVersion != m_Camera.GetVersion();
+	if (cameraChanged)
+	{
+		m_CBPerFrame.data.view = XMMatrixTranspose(m_Camera.GetView());
+		m_CBPerFrame.data.proj = XMMatrixTranspose(m_Camera.GetProj());
+		const XMFLOAT3& eyePos = m_Camera.GetPosition();
+		m_CBPerFrame.data.eyePos = XMFLOAT4(eyePos.x, eyePos.y, eyePos.z, 0.0f);
+		m_CameraVersion = m_Camera.GetVersion();
+	}
+	if (lightChanged || cameraChanged)
+		HR(m_CBPerFrame.Upload(m_pd3dImmediateContext.Get()));
+
+	// 多光源每帧转动，光源和摄像机都在变化，每帧重新分簇
+	if (m_UseManyLights)
+		m_ManyLightsAngle += dt * 0.5f;
+	if (m_UseManyLights || manyLightsToggled)
+	{
+		UpdateManyLights();
+		UpdateLightClusters();
+		UpdateCaption();
+	}
+
+	// 烘焙器比较光源的变化，只重新烘焙受影响的网格
+	if (m_UseBakedLighting)
+		UpdateBakedLighting();
+	if (bakedToggled)
+		UpdateCaption();
+
+	// 探针只在光源变化时重建，多光源模式下每帧重建
+	if (probesToggled || (m_UseAmbientProbes && (lightChanged || m_UseManyLights || manyLightsToggled)))
+	{
+		UpdateAmbientProbes();
+		UpdateCaption();
+	}
+
+	// P键用软件光栅化渲染当前画面，与GPU使用同样的常量
+	if (m_KeyboardTracker.IsKeyPressed(Keyboard::P))
+		RenderSoftwareFrame();
 }
 
 void GameApp::DrawScene()
@@ -90,8 +194,25 @@ void GameApp::DrawScene()
 	m_pd3dImmediateContext->ClearRenderTargetView(m_pRenderTargetView.Get(), reinterpret_cast<const float*>(&Colors::Black));
 	m_pd3dImmediateContext->ClearDepthStencilView(m_pDepthStencilView.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
 	
-	// 绘制几何模型
-	m_pd3dImmediateContext->DrawIndexed(m_IndexCount, 0, 0);
+	// 绘制几何模型，烘焙模式下换成静止场景和只输出顶点颜色的像素着色器
+	UINT stride = sizeof(VertexPosNormalColor);
+	UINT offset = 0;
+	if (m_UseBakedLighting)
+	{
+		m_pd3dImmediateContext->IASetVertexBuffers(0, 1, m_pBakedVertexBuffer.GetAddressOf(), &stride, &offset);
+		m_pd3dImmediateContext->IASetIndexBuffer(m_pBakedIndexBuffer.Get(), DXGI_FORMAT_R16_UINT, 0);
+		m_pd3dImmediateContext->VSSetConstantBuffers(0, 1, m_CBBakedObject.GetAddressOf());
+		m_pd3dImmediateContext->PSSetShader(m_pBakedPixelShader.Get(), nullptr, 0);
+		m_pd3dImmediateContext->DrawIndexed((UINT)m_BakedIndices.size(), 0, 0);
+	}
+	else
+	{
+		m_pd3dImmediateContext->IASetVertexBuffers(0, 1, m_pVertexBuffer.GetAddressOf(), &stride, &offset);
+		m_pd3dImmediateContext->IASetIndexBuffer(m_pIndexBuffer.Get(), DXGI_FORMAT_R16_UINT, 0);
+		m_pd3dImmediateContext->VSSetConstantBuffers(0, 1, m_CBPerObject.GetAddressOf());
+		m_pd3dImmediateContext->PSSetShader(m_pPixelShader.Get(), nullptr, 0);
+		m_pd3dImmediateContext->DrawIndexed(m_IndexCount, 0, 0);
+	}
 
 	HR(m_pSwapChain->Present(0, 0));
 }
@@ -111,6 +232,8 @@ bool GameApp::InitEffect()
 	// 创建像素着色器
 	HR(CreateShaderFromFile(L"HLSL\\Light_PS.cso", L"HLSL\\Light_PS.hlsl", "PS", "ps_5_0", blob.ReleaseAndGetAddressOf()));
 	HR(m_pd3dDevice->CreatePixelShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, m_pPixelShader.GetAddressOf()));
+	HR(CreateShaderFromFile(L"HLSL\\Baked_PS.cso", L"HLSL\\Baked_PS.hlsl", "PS", "ps_5_0", blob.ReleaseAndGetAddressOf()));
+	HR(m_pd3dDevice->CreatePixelShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, m_pBakedPixelShader.GetAddressOf()));
 
 	return true;
 }
@@ -125,18 +248,14 @@ bool GameApp::InitResource()
 
 
 	// ******************
-	// 设置常量缓冲区描述
+	// 新建常量缓冲区，不使用初始数据
 	//
-	D3D11_BUFFER_DESC cbd;
-	ZeroMemory(&cbd, sizeof(cbd));
-	cbd.Usage = D3D11_USAGE_DYNAMIC;
-	cbd.ByteWidth = sizeof(VSConstantBuffer);
-	cbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	cbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	// 新建用于VS和PS的常量缓冲区
-	HR(m_pd3dDevice->CreateBuffer(&cbd, nullptr, m_pConstantBuffers[0].GetAddressOf()));
-	cbd.ByteWidth = sizeof(PSConstantBuffer);
-	HR(m_pd3dDevice->CreateBuffer(&cbd, nullptr, m_pConstantBuffers[1].GetAddressOf()));
+	HR(m_CBPerObject.Create(m_pd3dDevice.Get()));
+	HR(m_CBPerFrame.Create(m_pd3dDevice.Get()));
+	HR(m_CBPerMaterial.Create(m_pd3dDevice.Get()));
+	HR(m_CBLightClusters.Create(m_pd3dDevice.Get()));
+	HR(m_CBBakedObject.Create(m_pd3dDevice.Get()));
+	HR(m_CBAmbientProbes.Create(m_pd3dDevice.Get()));
 
 	// ******************
 	// 初始化默认光照
@@ -162,30 +281,37 @@ bool GameApp::InitResource()
 	m_SpotLight.att = XMFLOAT3(1.0f, 0.0f, 0.0f);
 	m_SpotLight.spot = 36.0f;
 	m_SpotLight.range = 10000.0f;
-	// 初始化用于VS的常量缓冲区的值
-	m_VSConstantBuffer.world = XMMatrixIdentity();			
-	m_VSConstantBuffer.view = XMMatrixTranspose(XMMatrixLookAtLH(
-		XMVectorSet(0.0f, 0.0f, -5.0f, 0.0f),
-		XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f),
-		XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)
-	));
-	m_VSConstantBuffer.proj = XMMatrixTranspose(XMMatrixPerspectiveFovLH(XM_PIDIV2, AspectRatio(), 1.0f, 1000.0f));
-	m_VSConstantBuffer.worldInvTranspose = XMMatrixIdentity();
-	
-	// 初始化用于PS的常量缓冲区的值
-	m_PSConstantBuffer.material.ambient = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
-	m_PSConstantBuffer.material.diffuse = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	m_PSConstantBuffer.material.specular = XMFLOAT4(0.5f, 0.5f, 0.5f, 5.0f);
+	// 初始化每个物体的常量缓冲区的值
+	m_CBPerObject.data.world = XMMatrixIdentity();			
+	m_CBPerObject.data.worldInvTranspose = XMMatrixIdentity();
+
+	// 初始化每帧的常量缓冲区的值
+	// 摄像机位于(0, 0, -5)看向原点，观察矩阵、投影矩阵和观察位置在第一次更新时由摄像机写入
+	m_Camera.SetLens(XM_PIDIV2, AspectRatio(), 1.0f, 1000.0f);
+	m_Camera.SetOrbit(XMFLOAT3(0.0f, 0.0f, 0.0f), 5.0f, 0.0f, 0.0f);
 	// 使用默认平行光
-	m_PSConstantBuffer.dirLight = m_DirLight;
-	// 注意不要忘记设置此处的观察位置，否则高亮部分会有问题
-	m_PSConstantBuffer.eyePos = XMFLOAT4(0.0f, 0.0f, -5.0f, 0.0f);
+	m_CBPerFrame.data.dirLight = m_DirLight;
+
+	// 初始化材质
+	m_CBPerMaterial.data.material.ambient = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
+	m_CBPerMaterial.data.material.diffuse = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	m_CBPerMaterial.data.material.specular = XMFLOAT4(0.5f, 0.5f, 0.5f, 5.0f);
+
+	// 材质不变，只需上传一次
+	HR(m_CBPerObject.Upload(m_pd3dImmediateContext.Get()));
+	HR(m_CBPerMaterial.Upload(m_pd3dImmediateContext.Get()));
+
+	// 烘焙场景使用同样的材质
+	if (!InitBakedScene())
+		return false;
 
-	// 更新PS常量缓冲区资源
-	D3D11_MAPPED_SUBRESOURCE mappedData;
-	HR(m_pd3dImmediateContext->Map(m_pConstantBuffers[1].Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData));
-	memcpy_s(mappedData.pData, sizeof(PSConstantBuffer), &m_VSConstantBuffer, sizeof(PSConstantBuffer));
-	m_pd3dImmediateContext->Unmap(m_pConstantBuffers[1].Get(), 0);
+	// 多光源默认关闭，先按空的光源表分簇，使b3和t0~t3始终有效
+	UpdateManyLights();
+	UpdateLightClusters();
+
+	// 探针默认关闭，同样先上传一次，使b5和t4始终有效
+	m_AmbientProbes.SetGrid(XMFLOAT3(-6.0f, -3.0f, -6.0f), XMFLOAT3(6.0f, 4.0f, 6.0f), 7, 5, 7);
+	UpdateAmbientProbes();
 
 	// ******************
 	// 初始化光栅化状态
@@ -207,20 +333,32 @@ bool GameApp::InitResource()
 	m_pd3dImmediateContext->IASetInputLayout(m_pVertexLayout.Get());
 	// 将着色器绑定到渲染管线
 	m_pd3dImmediateContext->VSSetShader(m_pVertexShader.Get(), nullptr, 0);
-	// VS常量缓冲区对应HLSL寄存于b0的常量缓冲区
-	m_pd3dImmediateContext->VSSetConstantBuffers(0, 1, m_pConstantBuffers[0].GetAddressOf());
-	// PS常量缓冲区对应HLSL寄存于b1的常量缓冲区
-	m_pd3dImmediateContext->PSSetConstantBuffers(1, 1, m_pConstantBuffers[1].GetAddressOf());
+	// 每个物体的常量缓冲区对应HLSL寄存于b0的常量缓冲区，只有VS使用
+	m_pd3dImmediateContext->VSSetConstantBuffers(0, 1, m_CBPerObject.GetAddressOf());
+	// 每帧的常量缓冲区对应b1，VS和PS都使用
+	m_pd3dImmediateContext->VSSetConstantBuffers(1, 1, m_CBPerFrame.GetAddressOf());
+	m_pd3dImmediateContext->PSSetConstantBuffers(1, 1, m_CBPerFrame.GetAddressOf());
+	// 材质的常量缓冲区对应b2，只有PS使用
+	m_pd3dImmediateContext->PSSetConstantBuffers(2, 1, m_CBPerMaterial.GetAddressOf());
+	// 分簇常量对应b3，光源数组和簇索引表对应t0~t3，在UpdateLightClusters中绑定
+	m_pd3dImmediateContext->PSSetConstantBuffers(3, 1, m_CBLightClusters.GetAddressOf());
+	// 探针网格常量对应b5，探针系数对应t4，在UpdateAmbientProbes中绑定
+	m_pd3dImmediateContext->PSSetConstantBuffers(5, 1, m_CBAmbientProbes.GetAddressOf());
 	m_pd3dImmediateContext->PSSetShader(m_pPixelShader.Get(), nullptr, 0);
 
 	// ******************
 	// 设置调试对象名
 	//
 	D3D11SetDebugObjectName(m_pVertexLayout.Get(), "VertexPosNormalTexLayout");
-	D3D11SetDebugObjectName(m_pConstantBuffers[0].Get(), "VSConstantBuffer");
-	D3D11SetDebugObjectName(m_pConstantBuffers[1].Get(), "PSConstantBuffer");
+	D3D11SetDebugObjectName(m_CBPerObject.Get(), "CBPerObject");
+	D3D11SetDebugObjectName(m_CBPerFrame.Get(), "CBPerFrame");
+	D3D11SetDebugObjectName(m_CBPerMaterial.Get(), "CBPerMaterial");
+	D3D11SetDebugObjectName(m_CBLightClusters.Get(), "CBLightClusters");
+	D3D11SetDebugObjectName(m_CBAmbientProbes.Get(), "CBAmbientProbes");
 	D3D11SetDebugObjectName(m_pVertexShader.Get(), "Light_VS");
 	D3D11SetDebugObjectName(m_pPixelShader.Get(), "Light_PS");
+	D3D11SetDebugObjectName(m_pBakedPixelShader.Get(), "Baked_PS");
+	D3D11SetDebugObjectName(m_CBBakedObject.Get(), "CBBakedObject");
 
 	return true;
 }
@@ -272,5 +410,277 @@ bool GameApp::ResetMesh(const Geometry::MeshData<VertexPosNormalColor>& meshData
 	D3D11SetDebugObjectName(m_pVertexBuffer.Get(), "VertexBuffer");
 	D3D11SetDebugObjectName(m_pIndexBuffer.Get(), "IndexBuffer");
 
+	m_MeshData = meshData;
+
 	return true;
 }
+
+void GameApp::RenderSoftwareFrame()
+{
+	// 绑定方式与InitResource中的GPU管线一一对应
+	m_SoftRasterizer.SetJobSystem(&m_Jobs);
+	m_SoftRasterizer.Resize((uint32_t)m_ClientWidth, (uint32_t)m_ClientHeight);
+	m_SoftRasterizer.ResetStats();
+	m_SoftRasterizer.ClearRenderTarget(reinterpret_cast<const float*>(&Colors::Black));
+	m_SoftRasterizer.ClearDepth(1.0f);
+
+	if (m_UseBakedLighting)
+	{
+		m_SoftRasterizer.IASetVertexBuffer(m_BakedVertices.data(), sizeof(VertexPosNormalColor), (uint32_t)m_BakedVertices.size());
+		m_SoftRasterizer.IASetIndexBuffer(m_BakedIndices.data());
+		m_SoftRasterizer.VSSetConstantBuffer(0, m_CBBakedObject.data);
+	}
+	else
+	{
+		m_SoftRasterizer.IASetVertexBuffer(m_MeshData.vertexVec.data(), sizeof(VertexPosNormalColor), (uint32_t)m_MeshData.vertexVec.size());
+		m_SoftRasterizer.IASetIndexBuffer(m_MeshData.indexVec.data());
+		m_SoftRasterizer.VSSetConstantBuffer(0, m_CBPerObject.data);
+	}
+	m_SoftRasterizer.VSSetShader(&SoftShaders::LightVS);
+	m_SoftRasterizer.VSSetConstantBuffer(1, m_CBPerFrame.data);
+	m_SoftRasterizer.PSSetConstantBuffer(1, m_CBPerFrame.data);
+	m_SoftRasterizer.PSSetConstantBuffer(2, m_CBPerMaterial.data);
+	SoftShaders::LightClusterBindings clusters;
+	clusters.constants = m_LightClusters.GetConstants();
+	clusters.pPointLights = m_ManyPointLights.data();
+	clusters.pSpotLights = m_ManySpotLights.data();
+	clusters.pClusterRanges = m_LightClusters.GetClusterRanges().data();
+	clusters.pLightIndices = m_LightClusters.GetLightIndices().data();
+	m_SoftRasterizer.PSSetConstantBuffer(3, clusters);
+	SoftShaders::AmbientProbeBindings probes;
+	probes.constants = m_CBAmbientProbes.data;
+	probes.pProbes = m_AmbientProbes.GetCoefficients().data();
+	m_SoftRasterizer.PSSetConstantBuffer(5, probes);
+	m_SoftRasterizer.PSSetShader(m_UseBakedLighting ? &SoftShaders::BakedPS : &SoftShaders::LightPS);
+
+	m_SoftRasterizer.DrawIndexed(m_UseBakedLighting ? (uint32_t)m_BakedIndices.size() : m_IndexCount, 0, 0);
+	m_SoftRasterizer.Flush();
+
+	std::vector<uint32_t> pixels;
+	m_SoftRasterizer.ReadColor(pixels);
+	bool saved = SavePng("SoftwareFrame.png", pixels, m_SoftRasterizer.GetWidth(), m_SoftRasterizer.GetHeight());
+
+	const SoftRenderStats& stats = m_SoftRasterizer.GetStats();
+	std::wostringstream outs;
+	outs.precision(3);
+	outs << L"    软件渲染" << (saved ? L"(SoftwareFrame.png)" : L"(保存失败)") << L": "
+		<< (stats.vertexSeconds + stats.rasterSeconds) * 1000.0 << L"ms "
+		<< stats.GetTrianglesPerSecond() / 1e6 << L"M三角形/s "
+		<< stats.GetPixelsPerSecond() / 1e6 << L"M像素/s";
+	m_StatusText = outs.str();
+	UpdateCaption();
+}
+
+void GameApp::UpdateManyLights()
+{
+	m_ManyPointLights.clear();
+	m_ManySpotLights.clear();
+	if (!m_UseManyLights)
+		return;
+
+	// 光源参数由CounterRng按编号生成，每帧只有旋转角度不同
+	CounterRng rng(45);
+	XMMATRIX R = XMMatrixRotationY(m_ManyLightsAngle);
+	// 点光分布在立方体周围的球壳上，环境光为0，否则几百个光源的环境光叠加后会过曝
+	m_ManyPointLights.resize(kManyPointLights);
+	for (uint32_t i = 0; i < kManyPointLights; ++i)
+	{
+		PointLight& L = m_ManyPointLights[i];
+		float radius = 1.3f + rng.Float(i, StreamPointPosition, 1) * 1.5f;
+		XMStoreFloat3(&L.position, XMVector3TransformNormal(RandomDirection(rng, i, StreamPointPosition) * radius, R));
+		XMVECTOR color = XMVectorSet(rng.Float(i, StreamPointColor, 0), rng.Float(i, StreamPointColor, 1), rng.Float(i, StreamPointColor, 2), 0.0f);
+		color = XMVectorSetW(color * 0.25f, 1.0f);
+		L.ambient = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+		XMStoreFloat4(&L.diffuse, color);
+		XMStoreFloat4(&L.specular, color);
+		L.att = XMFLOAT3(1.0f, 0.0f, 1.0f);
+		L.range = 1.0f + rng.Float(i, StreamPointPosition, 2);
+	}
+	// 聚光灯在更远处照向立方体附近的随机点
+	m_ManySpotLights.resize(kManySpotLights);
+	for (uint32_t i = 0; i < kManySpotLights; ++i)
+	{
+		SpotLight& L = m_ManySpotLights[i];
+		float radius = 4.0f + rng.Float(i, StreamSpotPosition, 1) * 2.0f;
+		XMVECTOR pos = XMVector3TransformNormal(RandomDirection(rng, i, StreamSpotPosition) * radius, R);
+		XMVECTOR target = XMVector3TransformNormal(RandomDirection(rng, i, StreamSpotTarget), R);
+		XMStoreFloat3(&L.position, pos);
+		XMStoreFloat3(&L.direction, XMVector3Normalize(target - pos));
+		float hue = rng.Float(i, StreamSpotShape, 0);
+		XMVECTOR color = XMVectorSet(0.5f + 0.5f * cosf(hue * XM_2PI), 0.5f + 0.5f * cosf((hue - 1.0f / 3.0f) * XM_2PI),
+			0.5f + 0.5f * cosf((hue - 2.0f / 3.0f) * XM_2PI), 0.0f);
+		color = XMVectorSetW(color * 0.6f, 1.0f);
+		L.ambient = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+		XMStoreFloat4(&L.diffuse, color);
+		XMStoreFloat4(&L.specular, color);
+		L.att = XMFLOAT3(1.0f, 0.0f, 0.02f);
+		L.spot = 16.0f + rng.Float(i, StreamSpotShape, 1) * 48.0f;
+		L.range = 10.0f;
+	}
+}
+
+void GameApp::UpdateLightClusters()
+{
+	m_LightClusters.Build(m_ManyPointLights.data(), (uint32_t)m_ManyPointLights.size(),
+		m_ManySpotLights.data(), (uint32_t)m_ManySpotLights.size(),
+		m_Camera.GetView(), m_Camera.GetProj(), m_Camera.GetNearZ(), m_Camera.GetFarZ(), &m_Jobs);
+
+	ID3D11DeviceContext* pContext = m_pd3dImmediateContext.Get();
+	const std::vector<LightClusterRange>& ranges = m_LightClusters.GetClusterRanges();
+	const std::vector<uint32_t>& indices = m_LightClusters.GetLightIndices();
+	HR(m_PointLightBuffer.Upload(m_pd3dDevice.Get(), pContext, m_ManyPointLights.data(), (uint32_t)m_ManyPointLights.size()));
+	HR(m_SpotLightBuffer.Upload(m_pd3dDevice.Get(), pContext, m_ManySpotLights.data(), (uint32_t)m_ManySpotLights.size()));
+	HR(m_ClusterRangeBuffer.Upload(m_pd3dDevice.Get(), pContext, ranges.data(), (uint32_t)ranges.size()));
+	HR(m_LightIndexBuffer.Upload(m_pd3dDevice.Get(), pContext, indices.data(), (uint32_t)indices.size()));
+	m_CBLightClusters.data = m_LightClusters.GetConstants();
+	HR(m_CBLightClusters.Upload(pContext));
+
+	// 缓冲区扩容后SRV会变化，每次都重新绑定
+	ID3D11ShaderResourceView* pSRVs[4] = { m_PointLightBuffer.GetSRV(), m_SpotLightBuffer.GetSRV(),
+		m_ClusterRangeBuffer.GetSRV(), m_LightIndexBuffer.GetSRV() };
+	pContext->PSSetShaderResources(0, 4, pSRVs);
+}
+
+bool GameApp::InitBakedScene()
+{
+	// 5x5个球排在立方体下方，每个球是一个网格，按包围盒判断是否受光源变化影响
+	const XMFLOAT4 colors[] = {
+		XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f),
+		XMFLOAT4(1.0f, 0.6f, 0.4f, 1.0f),
+		XMFLOAT4(0.4f, 0.8f, 1.0f, 1.0f)
+	};
+	m_LightBaker.Clear();
+	for (int z = 0; z < 5; ++z)
+	{
+		for (int x = 0; x < 5; ++x)
+		{
+			auto meshData = Geometry::CreateSphere<VertexPosNormalColor>(0.7f, 16, 16, colors[(x + z) % 3]);
+			m_LightBaker.AddMesh(meshData, XMMatrixTranslation(x * 2.0f - 4.0f, -1.5f, z * 2.0f - 4.0f), m_CBPerMaterial.data.material);
+		}
+	}
+
+	// 所有网格合并到一个顶点缓冲区和索引缓冲区中，一次绘制
+	m_BakedVertices.clear();
+	m_BakedIndices.clear();
+	m_BakedVertexOffsets.clear();
+	for (uint32_t m = 0; m < m_LightBaker.GetMeshCount(); ++m)
+	{
+		const Geometry::MeshData<VertexPosNormalColor>& mesh = m_LightBaker.GetBakedMesh(m);
+		UINT vertexOffset = (UINT)m_BakedVertices.size();
+		m_BakedVertexOffsets.push_back(vertexOffset);
+		m_BakedVertices.insert(m_BakedVertices.end(), mesh.vertexVec.begin(), mesh.vertexVec.end());
+		for (WORD index : mesh.indexVec)
+			m_BakedIndices.push_back((WORD)(index + vertexOffset));
+	}
+	assert(m_BakedVertices.size() <= 65536);
+
+	// 顶点颜色在光源变化时按网格用UpdateSubresource局部更新
+	D3D11_BUFFER_DESC vbd;
+	ZeroMemory(&vbd, sizeof(vbd));
+	vbd.Usage = D3D11_USAGE_DEFAULT;
+	vbd.ByteWidth = (UINT)m_BakedVertices.size() * sizeof(VertexPosNormalColor);
+	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	D3D11_SUBRESOURCE_DATA InitData;
+	ZeroMemory(&InitData, sizeof(InitData));
+	InitData.pSysMem = m_BakedVertices.data();
+	HR(m_pd3dDevice->CreateBuffer(&vbd, &InitData, m_pBakedVertexBuffer.ReleaseAndGetAddressOf()));
+
+	D3D11_BUFFER_DESC ibd;
+	ZeroMemory(&ibd, sizeof(ibd));
+	ibd.Usage = D3D11_USAGE_IMMUTABLE;
+	ibd.ByteWidth = (UINT)m_BakedIndices.size() * sizeof(WORD);
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	InitData.pSysMem = m_BakedIndices.data();
+	HR(m_pd3dDevice->CreateBuffer(&ibd, &InitData, m_pBakedIndexBuffer.ReleaseAndGetAddressOf()));
+
+	D3D11SetDebugObjectName(m_pBakedVertexBuffer.Get(), "BakedVertexBuffer");
+	D3D11SetDebugObjectName(m_pBakedIndexBuffer.Get(), "BakedIndexBuffer");
+
+	m_CBBakedObject.data.world = XMMatrixIdentity();
+	m_CBBakedObject.data.worldInvTranspose = XMMatrixIdentity();
+	HR(m_CBBakedObject.Upload(m_pd3dImmediateContext.Get()));
+	return true;
+}
+
+void GameApp::UpdateBakedLighting()
+{
+	// 与Light_PS使用同样的光源：b1中的三个光源加上多光源
+	std::vector<PointLight> pointLights(1, m_CBPerFrame.data.pointLight);
+	pointLights.insert(pointLights.end(), m_ManyPointLights.begin(), m_ManyPointLights.end());
+	std::vector<SpotLight> spotLights(1, m_CBPerFrame.data.spotLight);
+	spotLights.insert(spotLights.end(), m_ManySpotLights.begin(), m_ManySpotLights.end());
+	m_LightBaker.SetLights(&m_CBPerFrame.data.dirLight, 1, pointLights.data(), (uint32_t)pointLights.size(),
+		spotLights.data(), (uint32_t)spotLights.size());
+
+	uint32_t bakedMeshes = m_LightBaker.Bake(&m_Jobs);
+	if (bakedMeshes == 0)
+		return;
+
+	// 只上传重新烘焙的网格
+	for (uint32_t m = 0; m < m_LightBaker.GetMeshCount(); ++m)
+	{
+		if (!m_LightBaker.IsMeshUpdated(m))
+			continue;
+		const std::vector<VertexPosNormalColor>& vertices = m_LightBaker.GetBakedMesh(m).vertexVec;
+		UINT first = m_BakedVertexOffsets[m];
+		std::copy(vertices.begin(), vertices.end(), m_BakedVertices.begin() + first);
+
+		D3D11_BOX box = { first * (UINT)sizeof(VertexPosNormalColor), 0, 0,
+			(first + (UINT)vertices.size()) * (UINT)sizeof(VertexPosNormalColor), 1, 1 };
+		m_pd3dImmediateContext->UpdateSubresource(m_pBakedVertexBuffer.Get(), 0, &box, vertices.data(), 0, 0);
+	}
+
+	m_LastBakedMeshes = bakedMeshes;
+	m_LastBakeMicroseconds = m_LightBaker.GetBakeMicroseconds();
+	UpdateCaption();
+}
+
+void GameApp::UpdateAmbientProbes()
+{
+	// 与Light_PS使用同样的光源：b1中的三个光源加上多光源
+	if (m_UseAmbientProbes)
+	{
+		std::vector<PointLight> pointLights(1, m_CBPerFrame.data.pointLight);
+		pointLights.insert(pointLights.end(), m_ManyPointLights.begin(), m_ManyPointLights.end());
+		std::vector<SpotLight> spotLights(1, m_CBPerFrame.data.spotLight);
+		spotLights.insert(spotLights.end(), m_ManySpotLights.begin(), m_ManySpotLights.end());
+		m_AmbientProbes.Build(&m_CBPerFrame.data.dirLight, 1, pointLights.data(), (uint32_t)pointLights.size(),
+			spotLights.data(), (uint32_t)spotLights.size(), &m_Jobs);
+	}
+
+	ID3D11DeviceContext* pContext = m_pd3dImmediateContext.Get();
+	const std::vector<XMFLOAT4>& coefficients = m_AmbientProbes.GetCoefficients();
+	HR(m_AmbientProbeBuffer.Upload(m_pd3dDevice.Get(), pContext, coefficients.data(), (uint32_t)coefficients.size()));
+	m_CBAmbientProbes.data = m_AmbientProbes.GetConstants();
+	m_CBAmbientProbes.data.enabled = m_UseAmbientProbes ? 1 : 0;
+	HR(m_CBAmbientProbes.Upload(pContext));
+	pContext->PSSetShaderResources(4, 1, m_AmbientProbeBuffer.GetSRVAddressOf());
+}
+
+void GameApp::UpdateCaption()
+{
+	std::wostringstream outs;
+	outs.precision(3);
+	outs << L"Lighting";
+	if (m_UseManyLights)
+	{
+		outs << L"    多光源: " << m_ManyPointLights.size() << L"点光+" << m_ManySpotLights.size() << L"聚光灯"
+			<< L" 每簇平均" << m_LightClusters.GetAverageLightsPerCluster()
+			<< L" 最多" << m_LightClusters.GetMaxLightsInCluster();
+		if (m_LightClusters.GetOverflowCount())
+			outs << L" 溢出" << m_LightClusters.GetOverflowCount();
+		outs << L" 分簇" << m_LightClusters.GetBuildMicroseconds() << L"us";
+	}
+	if (m_UseBakedLighting)
+	{
+		outs << L"    烘焙: " << m_LastBakedMeshes << L"/" << m_LightBaker.GetMeshCount() << L"个网格 "
+			<< m_LastBakeMicroseconds << L"us";
+	}
+	if (m_UseAmbientProbes)
+	{
+		outs << L"    球谐探针: " << m_AmbientProbes.GetProbeCount() << L"个 "
+			<< m_AmbientProbes.GetBuildMicroseconds() << L"us";
+	}
+	outs << m_StatusText;
+	m_MainWndCaption = outs.str();
+}
@@ -4,29 +4,41 @@
 #include "d3dApp.h"
 #include "LightHelper.h"
 #include "Geometry.h"
+#include "ConstantBuffers.h"
+#include "Camera.h"
+#include "JobSystem.h"
+#include "SoftRasterizer.h"
+#include "LightClusters.h"
+#include "StructuredBuffers.h"
+#include "LightBaker.h"
+#include "AmbientProbes.h"
 
 class GameApp : public D3DApp
 {
 public:
 
-	struct VSConstantBuffer
+	// 常量缓冲区按更新频率拆分，对应HLSL中的b0、b1、b2
+	struct CBPerObject
 	{
 		DirectX::XMMATRIX world;
-		DirectX::XMMATRIX view;
-		DirectX::XMMATRIX proj;
 		DirectX::XMMATRIX worldInvTranspose;
-		
 	};
 
-	struct PSConstantBuffer
+	struct CBPerFrame
 	{
+		DirectX::XMMATRIX view;
+		DirectX::XMMATRIX proj;
 		DirectionalLight dirLight;
 		PointLight pointLight;
 		SpotLight spotLight;
-		Material material;
 		DirectX::XMFLOAT4 eyePos;
 	};
 
+	struct CBPerMaterial
+	{
+		Material material;
+	};
+
 
 
 public:
@@ -43,26 +55,75 @@ private:
 	bool InitEffect();
 	bool InitResource();
 	bool ResetMesh(const Geometry::MeshData<VertexPosNormalColor>& meshData);
+	// 用软件光栅化器按当前状态渲染一帧并保存为PNG
+	void RenderSoftwareFrame();
+	// 按当前角度生成环绕立方体的多光源
+	void UpdateManyLights();
+	// 重新分簇并上传光源数组、簇索引表和b3
+	void UpdateLightClusters();
+	// 创建烘焙模式的静止场景
+	bool InitBakedScene();
+	// 把当前光源交给烘焙器，重新烘焙受影响的网格并更新顶点缓冲区中对应的部分
+	void UpdateBakedLighting();
+	// 按当前光源重建球谐探针并上传探针系数和b5
+	void UpdateAmbientProbes();
+	void UpdateCaption();
 
 
 private:
 	ComPtr<ID3D11InputLayout> m_pVertexLayout;	    // 顶点输入布局
 	ComPtr<ID3D11Buffer> m_pVertexBuffer;			// 顶点缓冲区
 	ComPtr<ID3D11Buffer> m_pIndexBuffer;			// 索引缓冲区
-	ComPtr<ID3D11Buffer> m_pConstantBuffers[2];	    // 常量缓冲区
 	UINT m_IndexCount;							    // 绘制物体的索引数组大小
+	Geometry::MeshData<VertexPosNormalColor> m_MeshData;	// 网格的CPU副本，供软件光栅化使用
 
 	ComPtr<ID3D11VertexShader> m_pVertexShader;	    // 顶点着色器
 	ComPtr<ID3D11PixelShader> m_pPixelShader;		// 像素着色器
-	VSConstantBuffer m_VSConstantBuffer;			// 用于修改用于VS的GPU常量缓冲区的变量
-	PSConstantBuffer m_PSConstantBuffer;			// 用于修改用于PS的GPU常量缓冲区的变量
+	CBufferObject<CBPerObject> m_CBPerObject;		// 每个物体更新的常量缓冲区
+	CBufferObject<CBPerFrame> m_CBPerFrame;			// 摄像机或灯光变化时更新的常量缓冲区
+	CBufferObject<CBPerMaterial> m_CBPerMaterial;	// 材质变化时更新的常量缓冲区
 
 	DirectionalLight m_DirLight;					// 默认环境光
 	PointLight m_PointLight;						// 默认点光
 	SpotLight m_SpotLight;						    // 默认汇聚光
 
+	Camera m_Camera;								// 环绕立方体的摄像机，左键拖动旋转，滚轮缩放
+	uint32_t m_CameraVersion;						// 上次上传观察和投影矩阵时摄像机的版本
+
 	ComPtr<ID3D11RasterizerState> m_pRSWireframe;	// 光栅化状态: 线框模式
 	bool m_IsWireframeMode;							// 当前是否为线框模式
+
+	JobSystem m_Jobs;								// 软件光栅化和分簇的任务系统
+	SoftRasterizer m_SoftRasterizer;				// P键用CPU渲染当前画面
+	std::wstring m_StatusText;						// 标题栏中软件渲染的结果
+
+	bool m_UseManyLights;							// 4键切换多光源
+	float m_ManyLightsAngle;						// 多光源绕y轴旋转的角度
+	std::vector<PointLight> m_ManyPointLights;		// 多光源模式下的点光(世界空间)
+	std::vector<SpotLight> m_ManySpotLights;		// 多光源模式下的聚光灯(世界空间)
+	LightClusterGrid m_LightClusters;				// 光源的分簇结果
+	CBufferObject<LightClusterConstants> m_CBLightClusters;		// 分簇常量，对应b3
+	StructuredBufferObject<PointLight> m_PointLightBuffer;		// t0
+	StructuredBufferObject<SpotLight> m_SpotLightBuffer;		// t1
+	StructuredBufferObject<LightClusterRange> m_ClusterRangeBuffer;	// t2
+	StructuredBufferObject<uint32_t> m_LightIndexBuffer;		// t3
+
+	bool m_UseBakedLighting;						// B键切换烘焙光照的静止场景
+	StaticLightBaker m_LightBaker;					// 静止场景的逐顶点光照烘焙
+	std::vector<VertexPosNormalColor> m_BakedVertices;	// 所有网格烘焙后的顶点，顶点缓冲区的CPU副本
+	std::vector<WORD> m_BakedIndices;				// 所有网格的索引，已加上各网格的顶点偏移
+	std::vector<UINT> m_BakedVertexOffsets;			// 各网格在顶点缓冲区中的起始位置
+	ComPtr<ID3D11Buffer> m_pBakedVertexBuffer;
+	ComPtr<ID3D11Buffer> m_pBakedIndexBuffer;
+	ComPtr<ID3D11PixelShader> m_pBakedPixelShader;	// 只输出顶点颜色的像素着色器
+	CBufferObject<CBPerObject> m_CBBakedObject;		// 烘焙的顶点已在世界空间，世界矩阵为单位矩阵
+	uint32_t m_LastBakedMeshes;						// 最近一次烘焙的网格数
+	double m_LastBakeMicroseconds;					// 最近一次烘焙的耗时
+
+	bool m_UseAmbientProbes;						// H键切换球谐探针的环境光
+	AmbientProbeGrid m_AmbientProbes;				// 覆盖立方体和烘焙场景的探针网格
+	CBufferObject<AmbientProbeConstants> m_CBAmbientProbes;		// 探针网格常量，对应b5
+	StructuredBufferObject<DirectX::XMFLOAT4> m_AmbientProbeBuffer;	// t4
 	
 };
 
@@ -0,0 +1,7 @@
+#include "Light.hlsli"
+
+// ɫѾ決ɫУֱֵɫ
+float4 PS(VertexOut pIn) : SV_Target
+{
+    return pIn.Color;
+}
\ No newline at end of file
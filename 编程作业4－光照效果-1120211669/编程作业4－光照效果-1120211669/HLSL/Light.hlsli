@@ -1,24 +1,109 @@
 #include "LightHelper.hlsli"
 
-cbuffer VSConstantBuffer : register(b0)
+// Ƶʲ
+// ÿ
+cbuffer CBPerObject : register(b0)
 {
     matrix g_World; 
-    matrix g_View;  
-    matrix g_Proj;  
     matrix g_WorldInvTranspose;
 }
 
-cbuffer PSConstantBuffer : register(b1)
+// ÿ֡һ
+cbuffer CBPerFrame : register(b1)
 {
+    matrix g_View;  
+    matrix g_Proj;  
     DirectionalLight g_DirLight;
     PointLight g_PointLight;
     SpotLight g_SpotLight;
-    Material g_Material;
     float3 g_EyePosW;
     float g_Pad;
 }
 
+// лʱ
+cbuffer CBPerMaterial : register(b2)
+{
+    Material g_Material;
+}
+
+// ִعգÿ֡CPUԴ
+// ĻNDCȷֿ飬[g_ClusterNearZ, Զƽ]ڰֲ
+cbuffer CBLightClusters : register(b3)
+{
+    uint3 g_ClusterCount;
+    uint g_ClusterPad;
+    float g_ClusterNearZ;
+    float g_ClusterLogScale;    //  / ln(Զƽ / ƽ)
+    float2 g_ClusterProj;       // ͶӰ_11_22
+}
 
+// г̽룬AmbientProbes.hеAmbientProbeConstantsͬ
+cbuffer CBAmbientProbes : register(b5)
+{
+    float3 g_ProbeGridMin;
+    uint g_ProbeCountX;
+    float3 g_ProbeInvCellSize;
+    uint g_ProbeCountY;
+    uint g_ProbeCountZ;
+    uint g_ProbeEnabled;        // Ϊ0ʱʹøԴambient
+    uint2 g_ProbePad;
+}
+
+StructuredBuffer<PointLight> g_PointLights : register(t0);
+StructuredBuffer<SpotLight> g_SpotLights : register(t1);
+// ÿص(ʼλ,  | ۹ << 16)ʼλÿʼǵ±Ǿ۹±
+StructuredBuffer<uint2> g_ClusterLights : register(t2);
+StructuredBuffer<uint> g_LightIndices : register(t3);
+// ÿ̽9Ѿķնϵxyz˳
+StructuredBuffer<float4> g_AmbientProbes : register(t4);
+
+// ۲ռеĵڵĴأLightClusters.hеComputeClusterIndexͬ
+uint ComputeClusterIndex(float3 posV)
+{
+    float z = max(posV.z, g_ClusterNearZ);
+    float2 uv = posV.xy * g_ClusterProj / z * 0.5f + 0.5f;
+    float s = log(z / g_ClusterNearZ) * g_ClusterLogScale;
+    uint x = (uint) clamp(uv.x * g_ClusterCount.x, 0.0f, g_ClusterCount.x - 1.0f);
+    uint y = (uint) clamp(uv.y * g_ClusterCount.y, 0.0f, g_ClusterCount.y - 1.0f);
+    uint k = (uint) clamp(s, 0.0f, g_ClusterCount.z - 1.0f);
+    return (k * g_ClusterCount.y + y) * g_ClusterCount.x + x;
+}
+
+
+
+// firstϵʼ̽ڷnķնȣAmbientProbes.hеEvaluateAmbientProbeͬ
+float3 EvaluateAmbientProbe(uint first, float3 n)
+{
+    float3 e = g_AmbientProbes[first].rgb
+        + g_AmbientProbes[first + 1].rgb * n.y
+        + g_AmbientProbes[first + 2].rgb * n.z
+        + g_AmbientProbes[first + 3].rgb * n.x
+        + g_AmbientProbes[first + 4].rgb * (n.x * n.y)
+        + g_AmbientProbes[first + 5].rgb * (n.y * n.z)
+        + g_AmbientProbes[first + 6].rgb * (3.0f * n.z * n.z - 1.0f)
+        + g_AmbientProbes[first + 7].rgb * (n.x * n.z)
+        + g_AmbientProbes[first + 8].rgb * (n.x * n.x - n.y * n.y);
+    return max(e, 0.0f);
+}
+
+// ռеĵ̽ԲֵAmbientProbes.hеSampleAmbientProbesͬ
+float3 SampleAmbientProbes(float3 posW, float3 n)
+{
+    uint3 count = uint3(g_ProbeCountX, g_ProbeCountY, g_ProbeCountZ);
+    float3 g = clamp((posW - g_ProbeGridMin) * g_ProbeInvCellSize, 0.0f, count - 1.0f);
+    uint3 i0 = min((uint3) g, count - 2);
+    float3 t = g - i0;
+    float3 e = float3(0.0f, 0.0f, 0.0f);
+    [unroll]
+    for (uint corner = 0; corner < 8; ++corner)
+    {
+        uint3 offset = uint3(corner & 1, (corner >> 1) & 1, corner >> 2);
+        uint3 i = i0 + offset;
+        float3 w = lerp(1.0f - t, t, (float3) offset);
+        e += EvaluateAmbientProbe(((i.z * count.y + i.y) * count.x + i.x) * 9, n) * (w.x * w.y * w.z);
+    }
+    return e;
+}
 
 struct VertexIn
 {
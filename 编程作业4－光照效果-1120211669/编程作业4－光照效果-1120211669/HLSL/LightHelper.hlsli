@@ -1,179 +1,189 @@
+#ifndef LIGHTHELPER_HLSLI
+#define LIGHTHELPER_HLSLI
 
-// 
+// 光源和材质的结构体以及光照计算，HLSL与C++共用这一份代码：
+// Light.hlsli直接包含，C++通过LightHelper.h在HlslTypes.h之后包含，软件光栅化和烘焙与GPU的计算完全相同。
+// 这里只能使用两边都支持的写法：不用swizzle、out参数和标量到向量的隐式转换，分支属性和函数修饰分别用HLSL_FLATTEN和HLSL_INLINE。
+// 文件为UTF-8编码，C++以/utf-8编译
+
+#ifndef __cplusplus
+#define HLSL_FLATTEN [flatten]
+#define HLSL_INLINE inline
+#endif
+
+// 方向光
 struct DirectionalLight
 {
-    float4 Ambient;
-    float4 Diffuse;
-    float4 Specular;
-    float3 Direction;
-    float Pad;
+    float4 ambient;
+    float4 diffuse;
+    float4 specular;
+    float3 direction;
+    float pad; // 最后用一个浮点数填充使得该结构体大小满足16的倍数，便于我们以后在HLSL设置数组
 };
 
-// 
+// 点光
 struct PointLight
 {
-    float4 Ambient;
-    float4 Diffuse;
-    float4 Specular;
+    float4 ambient;
+    float4 diffuse;
+    float4 specular;
 
-    float3 Position;
-    float Range;
+    // 打包成4D向量: (position, range)
+    float3 position;
+    float range;
 
-    float3 Att;
-    float Pad;
+    // 打包成4D向量: (A0, A1, A2, pad)
+    float3 att;
+    float pad; // 最后用一个浮点数填充使得该结构体大小满足16的倍数，便于我们以后在HLSL设置数组
 };
 
-// ۹
+// 聚光灯
 struct SpotLight
 {
-    float4 Ambient;
-    float4 Diffuse;
-    float4 Specular;
+    float4 ambient;
+    float4 diffuse;
+    float4 specular;
 
-    float3 Position;
-    float Range;
+    // 打包成4D向量: (position, range)
+    float3 position;
+    float range;
 
-    float3 Direction;
-    float Spot;
+    // 打包成4D向量: (direction, spot)
+    float3 direction;
+    float spot;
 
-    float3 Att;
-    float Pad;
+    // 打包成4D向量: (att, pad)
+    float3 att;
+    float pad; // 最后用一个浮点数填充使得该结构体大小满足16的倍数，便于我们以后在HLSL设置数组
 };
 
-// 
+// 物体表面材质
 struct Material
 {
-    float4 Ambient;
-    float4 Diffuse;
-    float4 Specular; // w = SpecPower
+    float4 ambient;
+    float4 diffuse;
+    float4 specular; // w = 镜面反射强度
     float4 Reflect;
 };
 
+// 一个光源的环境光、漫反射光和镜面光
+struct LightTerms
+{
+    float4 ambient;
+    float4 diffuse;
+    float4 spec;
+};
 
-
-void ComputeDirectionalLight(Material mat, DirectionalLight L,
-	float3 normal, float3 toEye,
-	out float4 ambient,
-	out float4 diffuse,
-	out float4 spec)
+// 距离为d时的衰弱
+HLSL_INLINE float ComputeAttenuation(float3 att, float d)
 {
-	// ʼ
-    ambient = float4(0.0f, 0.0f, 0.0f, 0.0f);
-    diffuse = float4(0.0f, 0.0f, 0.0f, 0.0f);
-    spec = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    return 1.0f / dot(att, float3(1.0f, d, d * d));
+}
 
-	// ䷽෴
-    float3 lightVec = -L.Direction;
+// 汇聚因子，lightVec为从表面指向光源的单位向量
+HLSL_INLINE float ComputeSpotFactor(SpotLight L, float3 lightVec)
+{
+    return pow(max(dot(-lightVec, L.direction), 0.0f), L.spot);
+}
 
-	// ӻ
-    ambient = mat.Ambient * L.Ambient;
+// 环境光、漫反射和镜面反射部分，lightVec为从表面指向光源的单位向量
+HLSL_INLINE LightTerms ComputeLightTerms(Material mat, float4 lightAmbient, float4 lightDiffuse, float4 lightSpecular,
+    float3 lightVec, float3 normal, float3 toEye)
+{
+	// 初始化输出
+    LightTerms terms;
+    terms.ambient = mat.ambient * lightAmbient;
+    terms.diffuse = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    terms.spec = float4(0.0f, 0.0f, 0.0f, 0.0f);
 
-	// ;
     float diffuseFactor = dot(lightVec, normal);
 
-	// չ⶯̬֧
-	[flatten]
+	// 展开，避免动态分支
+	HLSL_FLATTEN
     if (diffuseFactor > 0.0f)
     {
         float3 v = reflect(-lightVec, normal);
-        float specFactor = pow(max(dot(v, toEye), 0.0f), mat.Specular.w);
+        float specFactor = pow(max(dot(v, toEye), 0.0f), mat.specular.w);
 
-        diffuse = diffuseFactor * mat.Diffuse * L.Diffuse;
-        spec = specFactor * mat.Specular * L.Specular;
+        terms.diffuse = diffuseFactor * mat.diffuse * lightDiffuse;
+        terms.spec = specFactor * mat.specular * lightSpecular;
     }
+    return terms;
 }
 
+HLSL_INLINE LightTerms ComputeDirectionalLight(Material mat, DirectionalLight L, float3 normal, float3 toEye)
+{
+	// 光向量与照射方向相反
+    float3 lightVec = -L.direction;
+
+	// 环境光、漫反射光和镜面光
+    return ComputeLightTerms(mat, L.ambient, L.diffuse, L.specular, lightVec, normal, toEye);
+}
 
-void ComputePointLight(Material mat, PointLight L, float3 pos, float3 normal, float3 toEye,
-	out float4 ambient, out float4 diffuse, out float4 spec)
+HLSL_INLINE LightTerms ComputePointLight(Material mat, PointLight L, float3 pos, float3 normal, float3 toEye)
 {
-	// ʼ
-    ambient = float4(0.0f, 0.0f, 0.0f, 0.0f);
-    diffuse = float4(0.0f, 0.0f, 0.0f, 0.0f);
-    spec = float4(0.0f, 0.0f, 0.0f, 0.0f);
+	// 初始化输出
+    LightTerms terms;
+    terms.ambient = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    terms.diffuse = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    terms.spec = float4(0.0f, 0.0f, 0.0f, 0.0f);
 
-	// ӱ浽Դ
-    float3 lightVec = L.Position - pos;
+	// 从表面到光源的向量
+    float3 lightVec = L.position - pos;
 
-	// 浽ߵľ
+	// 表面到光线的距离
     float d = length(lightVec);
 
-	// ƹⷶΧ
-    if (d > L.Range)
-        return;
+	// 灯光范围测试
+    if (d > L.range)
+        return terms;
 
-	// ׼
+	// 标准化光向量
     lightVec /= d;
 
-	// 
-    ambient = mat.Ambient * L.Ambient;
-
-	// ;
-    float diffuseFactor = dot(lightVec, normal);
-
-	// չԱ⶯̬֧
-	[flatten]
-    if (diffuseFactor > 0.0f)
-    {
-        float3 v = reflect(-lightVec, normal);
-        float specFactor = pow(max(dot(v, toEye), 0.0f), mat.Specular.w);
-
-        diffuse = diffuseFactor * mat.Diffuse * L.Diffuse;
-        spec = specFactor * mat.Specular * L.Specular;
-    }
+	// 环境光、漫反射和镜面计算
+    terms = ComputeLightTerms(mat, L.ambient, L.diffuse, L.specular, lightVec, normal, toEye);
 
-	// ˥
-    float att = 1.0f / dot(L.Att, float3(1.0f, d, d * d));
+	// 光的衰弱
+    float att = ComputeAttenuation(L.att, d);
 
-    diffuse *= att;
-    spec *= att;
+    terms.diffuse *= att;
+    terms.spec *= att;
+    return terms;
 }
 
-
-void ComputeSpotLight(Material mat, SpotLight L, float3 pos, float3 normal, float3 toEye,
-	out float4 ambient, out float4 diffuse, out float4 spec)
+HLSL_INLINE LightTerms ComputeSpotLight(Material mat, SpotLight L, float3 pos, float3 normal, float3 toEye)
 {
-	// ʼ
-    ambient = float4(0.0f, 0.0f, 0.0f, 0.0f);
-    diffuse = float4(0.0f, 0.0f, 0.0f, 0.0f);
-    spec = float4(0.0f, 0.0f, 0.0f, 0.0f);
+	// 初始化输出
+    LightTerms terms;
+    terms.ambient = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    terms.diffuse = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    terms.spec = float4(0.0f, 0.0f, 0.0f, 0.0f);
 
-	// // ӱ浽Դ
-    float3 lightVec = L.Position - pos;
+	// 从表面到光源的向量
+    float3 lightVec = L.position - pos;
 
-    // 浽Դľ
+    // 表面到光源的距离
     float d = length(lightVec);
 
-	// Χ
-    if (d > L.Range)
-        return;
+	// 范围测试
+    if (d > L.range)
+        return terms;
 
-	// ׼
+	// 标准化光向量
     lightVec /= d;
 
-	// 㻷ⲿ
-    ambient = mat.Ambient * L.Ambient;
+	// 计算环境光、漫反射光和镜面反射光部分
+    terms = ComputeLightTerms(mat, L.ambient, L.diffuse, L.specular, lightVec, normal, toEye);
 
+	// 计算汇聚因子和衰弱系数
+    float spot = ComputeSpotFactor(L, lightVec);
+    float att = spot * ComputeAttenuation(L.att, d);
 
-    // ;淴ⲿ
-    float diffuseFactor = dot(lightVec, normal);
-
-	// չԱ⶯̬֧
-	[flatten]
-    if (diffuseFactor > 0.0f)
-    {
-        float3 v = reflect(-lightVec, normal);
-        float specFactor = pow(max(dot(v, toEye), 0.0f), mat.Specular.w);
-
-        diffuse = diffuseFactor * mat.Diffuse * L.Diffuse;
-        spec = specFactor * mat.Specular * L.Specular;
-    }
-
-	// Ӻ˥ϵ
-    float spot = pow(max(dot(-lightVec, L.Direction), 0.0f), L.Spot);
-    float att = spot / dot(L.Att, float3(1.0f, d, d * d));
+    terms.ambient *= spot;
+    terms.diffuse *= att;
+    terms.spec *= att;
+    return terms;
+}
 
-    ambient *= spot;
-    diffuse *= att;
-    spec *= att;
-}
\ No newline at end of file
+#endif
@@ -9,29 +9,42 @@ float4 PS(VertexOut pIn) : SV_Target
     // ָ۾
     float3 toEyeW = normalize(g_EyePosW - pIn.PosW);
 
-    // ʼΪ0 
-    float4 ambient, diffuse, spec;
-    float4 A, D, S;
-    ambient = diffuse = spec = A = D = S = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    LightTerms D = ComputeDirectionalLight(g_Material, g_DirLight, pIn.NormalW, toEyeW);
+    LightTerms P = ComputePointLight(g_Material, g_PointLight, pIn.PosW, pIn.NormalW, toEyeW);
+    LightTerms S = ComputeSpotLight(g_Material, g_SpotLight, pIn.PosW, pIn.NormalW, toEyeW);
+    float4 ambient = D.ambient + P.ambient + S.ambient;
+    float4 diffuse = D.diffuse + P.diffuse + S.diffuse;
+    float4 spec = D.spec + P.spec + S.spec;
 
-    ComputeDirectionalLight(g_Material, g_DirLight, pIn.NormalW, toEyeW, A, D, S);
-    ambient += A;
-    diffuse += D;
-    spec += S;
+    // ֻڴеĵ;۹
+    float3 posV = mul(float4(pIn.PosW, 1.0f), g_View).xyz;
+    uint2 cluster = g_ClusterLights[ComputeClusterIndex(posV)];
+    uint pointCount = cluster.y & 0xffff;
+    uint spotCount = cluster.y >> 16;
+    [loop]
+    for (uint i = 0; i < pointCount; ++i)
+    {
+        LightTerms T = ComputePointLight(g_Material, g_PointLights[g_LightIndices[cluster.x + i]], pIn.PosW, pIn.NormalW, toEyeW);
+        ambient += T.ambient;
+        diffuse += T.diffuse;
+        spec += T.spec;
+    }
+    [loop]
+    for (uint j = 0; j < spotCount; ++j)
+    {
+        LightTerms T = ComputeSpotLight(g_Material, g_SpotLights[g_LightIndices[cluster.x + pointCount + j]], pIn.PosW, pIn.NormalW, toEyeW);
+        ambient += T.ambient;
+        diffuse += T.diffuse;
+        spec += T.spec;
+    }
 
-    ComputePointLight(g_Material, g_PointLight, pIn.PosW, pIn.NormalW, toEyeW, A, D, S);
-    ambient += A;
-    diffuse += D;
-    spec += S;
-
-    ComputeSpotLight(g_Material, g_SpotLight, pIn.PosW, pIn.NormalW, toEyeW, A, D, S);
-    ambient += A;
-    diffuse += D;
-    spec += S;
+    // г̽ʱֵ̽õĻԴambient
+    if (g_ProbeEnabled)
+        ambient = g_Material.ambient * float4(SampleAmbientProbes(pIn.PosW, pIn.NormalW), 0.0f);
 
     float4 litColor = pIn.Color * (ambient + diffuse) + spec;
 	
-    litColor.a = g_Material.Diffuse.a * pIn.Color.a;
+    litColor.a = g_Material.diffuse.w * pIn.Color.a;
 	
     return litColor;
 }
\ No newline at end of file
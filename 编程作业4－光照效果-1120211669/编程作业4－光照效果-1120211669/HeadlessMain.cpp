@@ -0,0 +1,397 @@
+// 离线渲染命令行程序：不需要GPU，用SoftRasterizer渲染各次作业的场景，
+// 与保存的基准图像逐帧比较，并把每帧的耗时写成JSON，作为正确性和性能的回归检查。
+//
+// HeadlessRender --scene forest --frames 30 --golden-dir golden [--update-golden] [--json timing.json]
+// HeadlessRender --shadow-bench [--grid 100]    只测量阴影贴图在各尺寸下的生成耗时
+//
+// golden目录中是各场景的基准图像，为了能快速回归只用小尺寸、少量帧和缩小的网格：
+//   HeadlessRender --scene <场景> --frames 4 --width 320 --height 240 --grid 12 --golden-dir golden
+// 场景为cube、forest、flyover、lighting、shadows、manylights，每个场景不到0.2秒。
+// 基准图像由x64的AVX2+FMA后端(g++ -mavx2 -mfma)生成，种子为0。其他数学后端的舍入不同，
+// 细小的树枝和立方体边缘会有几个像素翻转，用这些后端比较时加--max-diff 255，只按PSNR判断。
+// 修改了渲染结果后加--update-golden重新生成，并与代码一起提交
+//
+// 退出码：0为全部通过，1为有帧未通过，2为参数或文件错误
+#include "HeadlessScenes.h"
+#include "SoftRasterizer.h"
+#include "JobSystem.h"
+#include "PngImage.h"
+#include "ImageCompare.h"
+#include "ShadowMap.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Options
+	{
+		std::string scene = "cube";
+		uint32_t frames = 60;
+		uint32_t width = 800;
+		uint32_t height = 600;
+		uint32_t seed = 0;
+		uint32_t threads = 0;			// 0为硬件线程数
+		int gridN = 0;					// 0为对应作业中的值
+		std::string goldenDir;			// 为空则不比较
+		bool updateGolden = false;		// 用本次结果覆盖基准图像
+		std::string outDir;				// 为空则不保存本次结果
+		std::string jsonPath;			// 为空则不输出JSON
+		double minPsnr = 40.0;
+		uint32_t maxDiff = 8;
+		double maxFrameMs = 0.0;		// 单帧总耗时上限，0为不检查
+		bool shadowBench = false;		// 只运行BenchmarkShadowMap
+		bool help = false;				// 只打印用法
+	};
+
+	struct FrameResult
+	{
+		uint32_t frame;
+		double vertexMs;
+		double rasterMs;
+		double totalMs;
+		uint64_t draws;
+		uint64_t triangles;
+		uint64_t trianglesRasterized;
+		uint64_t pixels;
+		bool compared;
+		ImageDiff diff;
+		bool pass;
+	};
+
+	void PrintUsage(std::ostream& os)
+	{
+		os <<
+			"usage: HeadlessRender [options]\n"
+			"  --scene <name>       cube | forest | flyover | lighting | shadows | manylights\n"
+			"                       (default cube)\n"
+			"  --frames <n>         frame count (default 60, fixed step 1/60 s)\n"
+			"  --width <n>          (default 800)\n"
+			"  --height <n>         (default 600)\n"
+			"  --seed <n>           vertex colors and forest layout (default 0)\n"
+			"  --threads <n>        worker threads, 0 = hardware threads (default 0)\n"
+			"  --grid <n>           trees per row for forest/flyover, boxes per row for shadows,\n"
+			"                       spheres per row for manylights\n"
+			"  --golden-dir <dir>   compare against <dir>/<scene>_<frame>.png\n"
+			"  --update-golden      write the golden images instead of comparing\n"
+			"  --out-dir <dir>      also save every rendered frame\n"
+			"  --json <file>        write per-frame timing and comparison results\n"
+			"  --min-psnr <dB>      (default 40)\n"
+			"  --max-diff <n>       largest allowed channel difference (default 8)\n"
+			"  --max-frame-ms <ms>  fail frames slower than this, 0 = off (default 0)\n"
+			"  --shadow-bench       time shadow map generation at 512..4096 and exit\n"
+			"  -h, --help           print this message and exit\n";
+	}
+
+	bool ParseUInt(const char* str, uint32_t& value)
+	{
+		char* end = nullptr;
+		unsigned long v = std::strtoul(str, &end, 10);
+		if (end == str || *end != '\0' || v > UINT32_MAX)
+			return false;
+		value = (uint32_t)v;
+		return true;
+	}
+
+	bool ParseDouble(const char* str, double& value)
+	{
+		char* end = nullptr;
+		value = std::strtod(str, &end);
+		return end != str && *end == '\0';
+	}
+
+	// 需要带值的选项
+	bool TakesValue(const std::string& arg)
+	{
+		static const char* const kValueOptions[] =
+		{
+			"--scene", "--frames", "--width", "--height", "--seed", "--threads", "--grid",
+			"--golden-dir", "--out-dir", "--json", "--min-psnr", "--max-diff", "--max-frame-ms"
+		};
+		for (const char* option : kValueOptions)
+		{
+			if (arg == option)
+				return true;
+		}
+		return false;
+	}
+
+	bool ParseOptions(int argc, char* argv[], Options& opt)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string arg = argv[i];
+			if (arg == "--help" || arg == "-h")
+			{
+				opt.help = true;
+				return true;
+			}
+			if (arg == "--update-golden")
+			{
+				opt.updateGolden = true;
+				continue;
+			}
+			if (arg == "--shadow-bench")
+			{
+				opt.shadowBench = true;
+				continue;
+			}
+			if (!TakesValue(arg))
+			{
+				std::cerr << "unknown option " << arg << "\n";
+				return false;
+			}
+			if (i + 1 >= argc)
+			{
+				std::cerr << "missing value for " << arg << "\n";
+				return false;
+			}
+			const char* value = argv[++i];
+			uint32_t grid = 0;
+			bool ok = true;
+			if (arg == "--scene")
+				opt.scene = value;
+			else if (arg == "--frames")
+				ok = ParseUInt(value, opt.frames);
+			else if (arg == "--width")
+				ok = ParseUInt(value, opt.width) && opt.width > 0;
+			else if (arg == "--height")
+				ok = ParseUInt(value, opt.height) && opt.height > 0;
+			else if (arg == "--seed")
+				ok = ParseUInt(value, opt.seed);
+			else if (arg == "--threads")
+				ok = ParseUInt(value, opt.threads);
+			else if (arg == "--grid")
+			{
+				ok = ParseUInt(value, grid) && grid > 0 && grid <= 1000;
+				opt.gridN = (int)grid;
+			}
+			else if (arg == "--golden-dir")
+				opt.goldenDir = value;
+			else if (arg == "--out-dir")
+				opt.outDir = value;
+			else if (arg == "--json")
+				opt.jsonPath = value;
+			else if (arg == "--min-psnr")
+				ok = ParseDouble(value, opt.minPsnr);
+			else if (arg == "--max-diff")
+				ok = ParseUInt(value, opt.maxDiff);
+			else if (arg == "--max-frame-ms")
+				ok = ParseDouble(value, opt.maxFrameMs) && opt.maxFrameMs >= 0.0;
+			if (!ok)
+			{
+				std::cerr << "invalid value for " << arg << ": " << value << "\n";
+				return false;
+			}
+		}
+		if (opt.updateGolden && opt.goldenDir.empty())
+		{
+			std::cerr << "--update-golden requires --golden-dir\n";
+			return false;
+		}
+		return true;
+	}
+
+	std::string FramePath(const std::string& dir, const std::string& scene, uint32_t frame)
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "_%04u.png", frame);
+		return dir + "/" + scene + name;
+	}
+
+	// 转成JSON字符串字面量：引号、反斜杠和控制字符转义，其余字节(包括UTF-8)原样输出
+	std::string JsonString(const std::string& str)
+	{
+		std::string out = "\"";
+		for (char c : str)
+		{
+			switch (c)
+			{
+			case '"': out += "\\\""; break;
+			case '\\': out += "\\\\"; break;
+			case '\b': out += "\\b"; break;
+			case '\f': out += "\\f"; break;
+			case '\n': out += "\\n"; break;
+			case '\r': out += "\\r"; break;
+			case '\t': out += "\\t"; break;
+			default:
+				if ((unsigned char)c < 0x20)
+				{
+					char code[8];
+					std::snprintf(code, sizeof(code), "\\u%04x", (unsigned)(unsigned char)c);
+					out += code;
+				}
+				else
+					out += c;
+			}
+		}
+		return out + "\"";
+	}
+
+	// 完全相同时PSNR为ImageIdenticalPsnr，JSON中不会出现inf
+	void WriteJson(std::ostream& os, const Options& opt, uint32_t threadCount, const std::vector<FrameResult>& results, bool allPass)
+	{
+		os << "{\n";
+		os << "  \"scene\": " << JsonString(opt.scene) << ",\n";
+		if (!opt.goldenDir.empty())
+			os << "  \"goldenDir\": " << JsonString(opt.goldenDir) << ",\n";
+		if (!opt.outDir.empty())
+			os << "  \"outDir\": " << JsonString(opt.outDir) << ",\n";
+		os << "  \"width\": " << opt.width << ",\n";
+		os << "  \"height\": " << opt.height << ",\n";
+		os << "  \"seed\": " << opt.seed << ",\n";
+		os << "  \"threads\": " << threadCount << ",\n";
+		os << "  \"pass\": " << (allPass ? "true" : "false") << ",\n";
+		os << "  \"frames\": [\n";
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const FrameResult& r = results[i];
+			os << "    { \"frame\": " << r.frame
+				<< ", \"vertexMs\": " << r.vertexMs
+				<< ", \"rasterMs\": " << r.rasterMs
+				<< ", \"totalMs\": " << r.totalMs
+				<< ", \"draws\": " << r.draws
+				<< ", \"triangles\": " << r.triangles
+				<< ", \"trianglesRasterized\": " << r.trianglesRasterized
+				<< ", \"pixels\": " << r.pixels;
+			if (r.compared)
+			{
+				os << ", \"psnr\": " << r.diff.psnr
+					<< ", \"maxDiff\": " << r.diff.maxDiff
+					<< ", \"diffPixels\": " << r.diff.diffPixels;
+			}
+			os << ", \"pass\": " << (r.pass ? "true" : "false") << " }"
+				<< (i + 1 < results.size() ? ",\n" : "\n");
+		}
+		os << "  ]\n";
+		os << "}\n";
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options opt;
+	if (!ParseOptions(argc, argv, opt))
+	{
+		PrintUsage(std::cerr);
+		return 2;
+	}
+	if (opt.help)
+	{
+		PrintUsage(std::cout);
+		return 0;
+	}
+
+	JobSystem jobs(opt.threads);
+	if (opt.shadowBench)
+	{
+		uint32_t gridN = opt.gridN > 0 ? (uint32_t)opt.gridN : 100;
+		BenchmarkShadowMap(std::cout, { 512, 1024, 2048, 4096 }, gridN * gridN, &jobs);
+		return 0;
+	}
+	HeadlessSceneDesc desc = { opt.width, opt.height, opt.seed, opt.gridN, &jobs };
+	std::unique_ptr<HeadlessScene> scene = CreateHeadlessScene(opt.scene, desc);
+	if (!scene)
+	{
+		std::cerr << "unknown scene " << opt.scene << "\n";
+		PrintUsage(std::cerr);
+		return 2;
+	}
+
+	SoftRasterizer rasterizer;
+	rasterizer.SetJobSystem(&jobs);
+	rasterizer.Resize(opt.width, opt.height);
+
+	typedef std::chrono::steady_clock Clock;
+	std::vector<FrameResult> results;
+	std::vector<uint32_t> pixels, golden;
+	bool allPass = true;
+	for (uint32_t frame = 0; frame < opt.frames; ++frame)
+	{
+		rasterizer.ResetStats();
+		Clock::time_point start = Clock::now();
+		scene->Render(rasterizer, frame);
+		double totalMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		const SoftRenderStats& stats = rasterizer.GetStats();
+		FrameResult r = {};
+		r.frame = frame;
+		r.vertexMs = stats.vertexSeconds * 1000.0;
+		r.rasterMs = stats.rasterSeconds * 1000.0;
+		r.totalMs = totalMs;
+		r.draws = stats.drawCount;
+		r.triangles = stats.trianglesSubmitted;
+		r.trianglesRasterized = stats.trianglesRasterized;
+		r.pixels = stats.pixelsShaded;
+		r.pass = opt.maxFrameMs <= 0.0 || totalMs <= opt.maxFrameMs;
+
+		rasterizer.ReadColor(pixels);
+		if (!opt.outDir.empty() && !SavePng(FramePath(opt.outDir, opt.scene, frame).c_str(), pixels, opt.width, opt.height))
+		{
+			std::cerr << "cannot write " << FramePath(opt.outDir, opt.scene, frame) << "\n";
+			return 2;
+		}
+		if (!opt.goldenDir.empty())
+		{
+			std::string goldenPath = FramePath(opt.goldenDir, opt.scene, frame);
+			if (opt.updateGolden)
+			{
+				if (!SavePng(goldenPath.c_str(), pixels, opt.width, opt.height))
+				{
+					std::cerr << "cannot write " << goldenPath << "\n";
+					return 2;
+				}
+			}
+			else
+			{
+				// 缺少基准图像或尺寸不同都算作未通过
+				uint32_t goldenWidth = 0, goldenHeight = 0;
+				r.compared = true;
+				if (LoadPng(goldenPath.c_str(), golden, goldenWidth, goldenHeight) &&
+					goldenWidth == opt.width && goldenHeight == opt.height)
+				{
+					r.diff = CompareImages(pixels.data(), golden.data(), pixels.size());
+					r.pass = r.pass && r.diff.psnr >= opt.minPsnr && r.diff.maxDiff <= opt.maxDiff;
+				}
+				else
+				{
+					std::cerr << "missing or mismatched golden image " << goldenPath << "\n";
+					r.diff.maxDiff = 255;
+					r.diff.diffPixels = pixels.size();
+					r.pass = false;
+				}
+			}
+		}
+		allPass = allPass && r.pass;
+		results.push_back(r);
+
+		std::printf("%s frame %4u: %8.2f ms (vs %.2f, raster %.2f), %llu tris", opt.scene.c_str(), frame, r.totalMs,
+			r.vertexMs, r.rasterMs, (unsigned long long)r.triangles);
+		if (r.compared)
+			std::printf(", psnr %.2f dB, max diff %u", r.diff.psnr, r.diff.maxDiff);
+		std::string note = scene->GetFrameNote();
+		if (!note.empty())
+			std::printf(", %s", note.c_str());
+		std::printf("%s\n", r.pass ? "" : "  FAIL");
+	}
+
+	if (!opt.jsonPath.empty())
+	{
+		std::ofstream fout(opt.jsonPath);
+		if (!fout)
+		{
+			std::cerr << "cannot write " << opt.jsonPath << "\n";
+			return 2;
+		}
+		WriteJson(fout, opt, jobs.GetThreadCount(), results, allPass);
+	}
+
+	std::printf("%s: %u frames, %s\n", opt.scene.c_str(), opt.frames, allPass ? "PASS" : "FAIL");
+	return allPass ? 0 : 1;
+}
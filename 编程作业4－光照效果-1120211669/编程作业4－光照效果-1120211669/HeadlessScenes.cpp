@@ -0,0 +1,627 @@
+#include "HeadlessScenes.h"
+#include "SoftRasterizer.h"
+#include "SoftShaders.h"
+#include "Geometry.h"
+#include "Camera.h"
+#include "FrustumCulling.h"
+#include "ForestInstances.h"
+#include "AffineTransform.h"
+#include "CounterRng.h"
+#include "ShadowMap.h"
+#include "LightSelection.h"
+#include <cmath>
+#include <cfloat>
+#include <sstream>
+
+using namespace DirectX;
+
+namespace
+{
+	const float ClearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+	// 名字模型依赖GameApp中的顶点数据，这里统一用CreateBox生成的“磊”字代替，
+	// 顶点颜色按种子随机，与各次作业中随机上色的效果相同
+	Geometry::MeshData<VertexPosColor> CreateColoredMesh(float size, uint32_t seed)
+	{
+		auto meshData = Geometry::CreateBox<VertexPosColor>(size, size, size);
+		CounterRng rng(seed);
+		for (uint32_t i = 0; i < (uint32_t)meshData.vertexVec.size(); ++i)
+		{
+			uint32_t rand[4];
+			rng.Generate4(i, 0, 0, rand);
+			meshData.vertexVec[i].color = XMFLOAT4(CounterRng::ToFloat(rand[0]), CounterRng::ToFloat(rand[1]),
+				CounterRng::ToFloat(rand[2]), 1.0f);
+		}
+		return meshData;
+	}
+
+	void BeginFrame(SoftRasterizer& rasterizer)
+	{
+		rasterizer.ClearRenderTarget(ClearColor);
+		rasterizer.ClearDepth(1.0f);
+	}
+
+	float AspectRatio(const HeadlessSceneDesc& desc)
+	{
+		return (float)desc.width / (float)desc.height;
+	}
+
+	//
+	// 作业1：旋转的名字
+	//
+
+	class CubeScene : public HeadlessScene
+	{
+	public:
+		explicit CubeScene(const HeadlessSceneDesc& desc)
+			: m_MeshData(CreateColoredMesh(2.0f, desc.seed))
+		{
+			m_Camera.SetLens(XM_PIDIV2, AspectRatio(desc), 1.0f, 1000.0f);
+			m_Camera.LookAt(XMFLOAT3(0.0f, 0.0f, -5.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f));
+		}
+
+		void Render(SoftRasterizer& rasterizer, uint32_t frame) override
+		{
+			float t = frame * HeadlessFrameTime;
+			SoftShaders::CubeCBPerObject perObject;
+			SoftShaders::CubeCBPerFrame perFrame;
+			XMStoreFloat4x4(&perObject.world, XMMatrixTranspose(XMMatrixRotationX(0.6f * t) * XMMatrixRotationY(0.9f * t)));
+			XMStoreFloat4x4(&perFrame.view, XMMatrixTranspose(m_Camera.GetView()));
+			XMStoreFloat4x4(&perFrame.proj, XMMatrixTranspose(m_Camera.GetProj()));
+
+			BeginFrame(rasterizer);
+			rasterizer.IASetVertexBuffer(m_MeshData.vertexVec.data(), sizeof(VertexPosColor), (uint32_t)m_MeshData.vertexVec.size());
+			rasterizer.IASetIndexBuffer(m_MeshData.indexVec.data());
+			rasterizer.VSSetShader(&SoftShaders::CubeVS);
+			rasterizer.PSSetShader(&SoftShaders::CubePS);
+			rasterizer.VSSetConstantBuffer(0, perObject);
+			rasterizer.VSSetConstantBuffer(1, perFrame);
+			rasterizer.DrawIndexed((uint32_t)m_MeshData.indexVec.size(), 0, 0);
+			rasterizer.Flush();
+		}
+
+	private:
+		Geometry::MeshData<VertexPosColor> m_MeshData;
+		Camera m_Camera;
+	};
+
+	//
+	// 作业2、3：字符森林和林中飞翔，每个实例一次DrawIndexed，先做视锥体剔除
+	//
+
+	class ForestScene : public HeadlessScene
+	{
+	public:
+		// [In]angleSpeed	树的旋转角速度，与对应作业的UpdateScene一致
+		ForestScene(const HeadlessSceneDesc& desc, int gridN, float angleSpeed)
+			: m_MeshData(CreateColoredMesh(2.5f, desc.seed)),
+			m_Forest(gridN, desc.seed),
+			m_pJobs(desc.pJobs),
+			m_AngleSpeed(angleSpeed)
+		{
+			// 局部包围球取包围盒中心，半径为到最远顶点的距离
+			XMVECTOR vMin = XMVectorReplicate(FLT_MAX), vMax = XMVectorReplicate(-FLT_MAX);
+			for (const VertexPosColor& v : m_MeshData.vertexVec)
+			{
+				XMVECTOR pos = XMLoadFloat3(&v.pos);
+				vMin = XMVectorMin(vMin, pos);
+				vMax = XMVectorMax(vMax, pos);
+			}
+			XMVECTOR center = (vMin + vMax) * 0.5f;
+			float radius = 0.0f;
+			for (const VertexPosColor& v : m_MeshData.vertexVec)
+				radius = std::fmax(radius, XMVectorGetX(XMVector3Length(XMLoadFloat3(&v.pos) - center)));
+			XMFLOAT3 localCenter;
+			XMStoreFloat3(&localCenter, center);
+			m_Forest.SetLocalBounds(localCenter, radius);
+
+			m_Camera.SetLens(XM_PIDIV2, AspectRatio(desc), 1.0f, 1000.0f);
+		}
+
+		void Render(SoftRasterizer& rasterizer, uint32_t frame) override
+		{
+			float t = frame * HeadlessFrameTime;
+			UpdateCamera(m_Camera, t);
+			m_Forest.Build(m_AngleSpeed * t, m_pJobs);
+
+			const ForestInstances::BoundingSpheres& spheres = m_Forest.GetBoundingSpheres();
+			m_Culler.Cull(FrustumCuller::ExtractPlanes(m_Camera.GetViewProj()), spheres.centerX.data(), spheres.centerY.data(),
+				spheres.centerZ.data(), spheres.radius.data(), m_Forest.GetInstanceCount());
+
+			SoftShaders::CubeCBPerFrame perFrame;
+			XMStoreFloat4x4(&perFrame.view, XMMatrixTranspose(m_Camera.GetView()));
+			XMStoreFloat4x4(&perFrame.proj, XMMatrixTranspose(m_Camera.GetProj()));
+
+			BeginFrame(rasterizer);
+			rasterizer.IASetVertexBuffer(m_MeshData.vertexVec.data(), sizeof(VertexPosColor), (uint32_t)m_MeshData.vertexVec.size());
+			rasterizer.IASetIndexBuffer(m_MeshData.indexVec.data());
+			rasterizer.VSSetShader(&SoftShaders::CubeVS);
+			rasterizer.PSSetShader(&SoftShaders::CubePS);
+			rasterizer.VSSetConstantBuffer(1, perFrame);
+			// 顶点着色在DrawIndexed中立即完成，每个物体的常量可以直接覆盖
+			const std::vector<ForestInstances::InstanceData>& instances = m_Forest.GetInstances();
+			SoftShaders::CubeCBPerObject perObject;
+			rasterizer.VSSetConstantBuffer(0, perObject);
+			for (uint32_t index : m_Culler.GetVisibleIndices())
+			{
+				perObject.world = instances[index].world;
+				rasterizer.DrawIndexed((uint32_t)m_MeshData.indexVec.size(), 0, 0);
+			}
+			rasterizer.Flush();
+		}
+
+	protected:
+		virtual void UpdateCamera(Camera& camera, float t) = 0;
+
+	private:
+		Geometry::MeshData<VertexPosColor> m_MeshData;
+		ForestInstances m_Forest;
+		FrustumCuller m_Culler;
+		Camera m_Camera;
+		JobSystem* m_pJobs;
+		float m_AngleSpeed;
+	};
+
+	// 作业2：固定在森林斜上方俯视
+	class CharacterForestScene : public ForestScene
+	{
+	public:
+		explicit CharacterForestScene(const HeadlessSceneDesc& desc)
+			: ForestScene(desc, desc.gridN > 0 ? desc.gridN : 70, 0.5f) {}
+
+	protected:
+		void UpdateCamera(Camera& camera, float) override
+		{
+			camera.LookAt(XMFLOAT3(-30.0f, 30.0f, -25.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f));
+		}
+	};
+
+	// 作业3：从初始位置向前飞入森林，同时左右摆动、逐渐压低高度
+	class FlyoverScene : public ForestScene
+	{
+	public:
+		explicit FlyoverScene(const HeadlessSceneDesc& desc)
+			: ForestScene(desc, desc.gridN > 0 ? desc.gridN : 80, 1.5f) {}
+
+	protected:
+		void UpdateCamera(Camera& camera, float t) override
+		{
+			float sway = std::sin(0.5f * t);
+			float dive = 1.0f - std::cos(0.25f * t);
+			camera.SetFirstPerson(XMFLOAT3(30.0f * sway, 60.0f - 25.0f * dive, -100.0f + 20.0f * t),
+				XMFLOAT3(0.7f - 0.3f * dive, 0.3f * sway, 0.0f));
+		}
+	};
+
+	//
+	// 作业4：光照效果，三种灯光轮流点亮
+	//
+
+	class LightingScene : public HeadlessScene
+	{
+	public:
+		explicit LightingScene(const HeadlessSceneDesc& desc)
+			: m_MeshData(Geometry::CreateBox<VertexPosNormalColor>()),
+			m_DirLight(),
+			m_PointLight(),
+			m_SpotLight(),
+			m_PerMaterial()
+		{
+			// 与GameApp::InitResource中的灯光和材质相同
+			m_DirLight.ambient = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+			m_DirLight.diffuse = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
+			m_DirLight.specular = XMFLOAT4(9.0f, 0.2f, 0.2f, 1.0f);
+			m_DirLight.direction = XMFLOAT3(-0.577f, -0.577f, 0.577f);
+
+			m_PointLight.position = XMFLOAT3(0.0f, 0.0f, -10.0f);
+			m_PointLight.ambient = XMFLOAT4(0.3f, 0.3f, 0.3f, 1.0f);
+			m_PointLight.diffuse = XMFLOAT4(0.7f, 0.7f, 0.7f, 1.0f);
+			m_PointLight.specular = XMFLOAT4(0.2f, 9.0f, 0.2f, 1.0f);
+			m_PointLight.att = XMFLOAT3(0.0f, 0.1f, 0.0f);
+			m_PointLight.range = 25.0f;
+
+			m_SpotLight.position = XMFLOAT3(0.0f, 0.0f, -5.0f);
+			m_SpotLight.direction = XMFLOAT3(0.0f, 0.0f, 1.0f);
+			m_SpotLight.ambient = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+			m_SpotLight.diffuse = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+			m_SpotLight.specular = XMFLOAT4(0.2f, 0.2f, 9.0f, 1.0f);
+			m_SpotLight.att = XMFLOAT3(1.0f, 0.0f, 0.0f);
+			m_SpotLight.spot = 36.0f;
+			m_SpotLight.range = 10000.0f;
+
+			m_PerMaterial.material.ambient = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
+			m_PerMaterial.material.diffuse = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+			m_PerMaterial.material.specular = XMFLOAT4(0.5f, 0.5f, 0.5f, 5.0f);
+
+			m_Camera.SetLens(XM_PIDIV2, AspectRatio(desc), 1.0f, 1000.0f);
+		}
+
+		void Render(SoftRasterizer& rasterizer, uint32_t frame) override
+		{
+			float t = frame * HeadlessFrameTime;
+			// 与GameApp::UpdateScene相同的旋转，摄像机绕物体缓慢环绕
+			AffineTransform W = AffineComposeSRT(XMFLOAT3(1.0f, 1.0f, 1.0f), 0.6f * t, 0.9f * t, XMFLOAT3(0.0f, 0.0f, 0.0f));
+			SoftShaders::LightCBPerObject perObject;
+			XMStoreFloat4x4(&perObject.world, AffineToMatrixTransposed(W));
+			XMStoreFloat4x4(&perObject.worldInvTranspose, AffineToMatrixTransposed(AffineInverseTransposeUniform(W)));
+
+			m_Camera.SetOrbit(XMFLOAT3(0.0f, 0.0f, 0.0f), 5.0f, 0.3f, 0.5f * t);
+			SoftShaders::LightCBPerFrame perFrame;
+			XMStoreFloat4x4(&perFrame.view, XMMatrixTranspose(m_Camera.GetView()));
+			XMStoreFloat4x4(&perFrame.proj, XMMatrixTranspose(m_Camera.GetProj()));
+			const XMFLOAT3& eyePos = m_Camera.GetPosition();
+			perFrame.eyePos = XMFLOAT4(eyePos.x, eyePos.y, eyePos.z, 0.0f);
+			// 依次使用方向光、点光和聚光灯，相邻3帧即可覆盖全部光照代码
+			perFrame.dirLight = frame % 3 == 0 ? m_DirLight : DirectionalLight();
+			perFrame.pointLight = frame % 3 == 1 ? m_PointLight : PointLight();
+			perFrame.spotLight = frame % 3 == 2 ? m_SpotLight : SpotLight();
+
+			BeginFrame(rasterizer);
+			rasterizer.IASetVertexBuffer(m_MeshData.vertexVec.data(), sizeof(VertexPosNormalColor), (uint32_t)m_MeshData.vertexVec.size());
+			rasterizer.IASetIndexBuffer(m_MeshData.indexVec.data());
+			rasterizer.VSSetShader(&SoftShaders::LightVS);
+			rasterizer.PSSetShader(&SoftShaders::LightPS);
+			rasterizer.VSSetConstantBuffer(0, perObject);
+			rasterizer.VSSetConstantBuffer(1, perFrame);
+			rasterizer.PSSetConstantBuffer(1, perFrame);
+			rasterizer.PSSetConstantBuffer(2, m_PerMaterial);
+			rasterizer.DrawIndexed((uint32_t)m_MeshData.indexVec.size(), 0, 0);
+			rasterizer.Flush();
+		}
+
+	private:
+		Geometry::MeshData<VertexPosNormalColor> m_MeshData;
+		Camera m_Camera;
+		DirectionalLight m_DirLight;
+		PointLight m_PointLight;
+		SpotLight m_SpotLight;
+		SoftShaders::LightCBPerMaterial m_PerMaterial;
+	};
+
+	//
+	// 作业4的灯光加上CPU阴影贴图：地面上gridN x gridN个高度随机的四棱柱，
+	// 方向光绕竖直轴旋转，聚光灯从正上方照向地面，每帧先渲染两张阴影贴图再着色
+	//
+
+	class ShadowScene : public HeadlessScene
+	{
+	public:
+		explicit ShadowScene(const HeadlessSceneDesc& desc)
+			: m_BoxData(Geometry::CreateCylinder<VertexPosNormalColor>(0.6f, 1.0f, 4, XMFLOAT4(0.9f, 0.8f, 0.6f, 1.0f))),
+			m_DirLight(),
+			m_SpotLight(),
+			m_PerMaterial(),
+			m_SceneRadius()
+		{
+			uint32_t gridN = desc.gridN > 0 ? (uint32_t)desc.gridN : 100;
+			const float spacing = 1.5f;
+			float half = 0.5f * spacing * (gridN - 1);
+			m_SceneRadius = half * 1.5f + 4.0f;
+			m_GroundData = Geometry::CreatePlane<VertexPosNormalColor>(XMFLOAT3(0.0f, 0.0f, 0.0f),
+				XMFLOAT2(2.0f * half + 4.0f, 2.0f * half + 4.0f), XMFLOAT2(1.0f, 1.0f), XMFLOAT4(0.7f, 0.7f, 0.7f, 1.0f));
+			AffineStoreTransposed(&m_GroundObject.world, AffineIdentity());
+			AffineStoreTransposed(&m_GroundObject.worldInvTranspose, AffineIdentity());
+
+			// 世界矩阵不随时间变化，只计算一次
+			CounterRng rng(desc.seed);
+			m_BoxObjects.resize(gridN * gridN);
+			for (uint32_t i = 0; i < gridN * gridN; ++i)
+			{
+				float height = 0.5f + 3.0f * rng.Float(i, 0);
+				AffineTransform W = AffineComposeSRT(XMFLOAT3(1.0f, height, 1.0f), 0.0f, 0.0f,
+					XMFLOAT3(spacing * (i % gridN) - half, 0.5f * height, spacing * (i / gridN) - half));
+				AffineStoreTransposed(&m_BoxObjects[i].world, W);
+				AffineStoreTransposed(&m_BoxObjects[i].worldInvTranspose, AffineInverseTranspose(W));
+			}
+			for (const VertexPosNormalColor& v : m_BoxData.vertexVec)
+				m_BoxPositions.push_back(v.pos);
+
+			m_DirLight.ambient = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+			m_DirLight.diffuse = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
+			m_DirLight.specular = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+
+			m_SpotLight.position = XMFLOAT3(0.0f, 30.0f, 0.0f);
+			m_SpotLight.direction = XMFLOAT3(0.0f, -1.0f, 0.0f);
+			m_SpotLight.ambient = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+			m_SpotLight.diffuse = XMFLOAT4(1.0f, 0.9f, 0.6f, 1.0f);
+			m_SpotLight.specular = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+			m_SpotLight.att = XMFLOAT3(1.0f, 0.0f, 0.0f);
+			m_SpotLight.spot = 8.0f;
+			m_SpotLight.range = 60.0f;
+
+			m_PerMaterial.material.ambient = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
+			m_PerMaterial.material.diffuse = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+			m_PerMaterial.material.specular = XMFLOAT4(0.1f, 0.1f, 0.1f, 16.0f);
+
+			m_DirShadow.SetJobSystem(desc.pJobs);
+			m_DirShadow.Resize(2048);
+			m_SpotShadow.SetJobSystem(desc.pJobs);
+			m_SpotShadow.Resize(1024);
+			m_Shadows.pDirShadow = &m_DirShadow;
+			m_Shadows.pSpotShadow = &m_SpotShadow;
+
+			m_Camera.SetLens(XM_PIDIV2, AspectRatio(desc), 1.0f, 1000.0f);
+		}
+
+		void Render(SoftRasterizer& rasterizer, uint32_t frame) override
+		{
+			float t = frame * HeadlessFrameTime;
+			// 方向光保持45度仰角绕竖直轴旋转，阴影随之转动
+			float yaw = 0.3f * t;
+			m_DirLight.direction = XMFLOAT3(0.7071f * std::cos(yaw), -0.7071f, 0.7071f * std::sin(yaw));
+
+			uint32_t instanceCount = (uint32_t)m_BoxObjects.size();
+			m_DirShadow.Begin(ShadowMap::BuildDirectionalViewProj(m_DirLight, XMVectorZero(), m_SceneRadius));
+			m_DirShadow.DrawInstanced(m_BoxPositions.data(), (uint32_t)m_BoxPositions.size(), m_BoxData.indexVec.data(),
+				(uint32_t)m_BoxData.indexVec.size(), &m_BoxObjects[0].world, sizeof(SoftShaders::LightCBPerObject), instanceCount);
+			m_DirShadow.End();
+			m_SpotShadow.Begin(ShadowMap::BuildSpotViewProj(m_SpotLight, 1.0f));
+			m_SpotShadow.DrawInstanced(m_BoxPositions.data(), (uint32_t)m_BoxPositions.size(), m_BoxData.indexVec.data(),
+				(uint32_t)m_BoxData.indexVec.size(), &m_BoxObjects[0].world, sizeof(SoftShaders::LightCBPerObject), instanceCount);
+			m_SpotShadow.End();
+
+			m_Camera.SetOrbit(XMFLOAT3(0.0f, 0.0f, 0.0f), 40.0f, 0.6f, 0.2f * t);
+			SoftShaders::LightCBPerFrame perFrame;
+			XMStoreFloat4x4(&perFrame.view, XMMatrixTranspose(m_Camera.GetView()));
+			XMStoreFloat4x4(&perFrame.proj, XMMatrixTranspose(m_Camera.GetProj()));
+			const XMFLOAT3& eyePos = m_Camera.GetPosition();
+			perFrame.eyePos = XMFLOAT4(eyePos.x, eyePos.y, eyePos.z, 0.0f);
+			perFrame.dirLight = m_DirLight;
+			perFrame.pointLight = PointLight();
+			perFrame.spotLight = m_SpotLight;
+
+			BeginFrame(rasterizer);
+			rasterizer.VSSetShader(&SoftShaders::LightVS);
+			rasterizer.PSSetShader(&SoftShaders::LightPS);
+			rasterizer.VSSetConstantBuffer(1, perFrame);
+			rasterizer.PSSetConstantBuffer(1, perFrame);
+			rasterizer.PSSetConstantBuffer(2, m_PerMaterial);
+			rasterizer.PSSetConstantBuffer(4, m_Shadows);
+
+			rasterizer.IASetVertexBuffer(m_GroundData.vertexVec.data(), sizeof(VertexPosNormalColor), (uint32_t)m_GroundData.vertexVec.size());
+			rasterizer.IASetIndexBuffer(m_GroundData.indexVec.data());
+			rasterizer.VSSetConstantBuffer(0, m_GroundObject);
+			rasterizer.DrawIndexed((uint32_t)m_GroundData.indexVec.size(), 0, 0);
+
+			rasterizer.IASetVertexBuffer(m_BoxData.vertexVec.data(), sizeof(VertexPosNormalColor), (uint32_t)m_BoxData.vertexVec.size());
+			rasterizer.IASetIndexBuffer(m_BoxData.indexVec.data());
+			for (const SoftShaders::LightCBPerObject& perObject : m_BoxObjects)
+			{
+				rasterizer.VSSetConstantBuffer(0, perObject);
+				rasterizer.DrawIndexed((uint32_t)m_BoxData.indexVec.size(), 0, 0);
+			}
+			rasterizer.Flush();
+		}
+
+	private:
+		Geometry::MeshData<VertexPosNormalColor> m_BoxData;
+		Geometry::MeshData<VertexPosNormalColor> m_GroundData;
+		std::vector<XMFLOAT3> m_BoxPositions;					// 阴影贴图只需要位置
+		std::vector<SoftShaders::LightCBPerObject> m_BoxObjects;
+		SoftShaders::LightCBPerObject m_GroundObject;
+		Camera m_Camera;
+		DirectionalLight m_DirLight;
+		SpotLight m_SpotLight;
+		SoftShaders::LightCBPerMaterial m_PerMaterial;
+		ShadowMap m_DirShadow;
+		ShadowMap m_SpotShadow;
+		SoftShaders::LightShadowBindings m_Shadows;
+		float m_SceneRadius;
+	};
+
+	//
+	// 数百个点光和聚光灯照亮gridN x gridN个球和地砖，每次绘制只计算ObjectLightSelector为该物体选出的K个光源，
+	// 环境光由AmbientProbeGrid按全部光源和天空投影到球谐探针后插值得到
+	//
+
+	class ManyLightsScene : public HeadlessScene
+	{
+	public:
+		static const uint32_t kPointLights = 512;
+		static const uint32_t kSpotLights = 64;
+		static const uint32_t kMaxLightsPerObject = 8;
+
+		explicit ManyLightsScene(const HeadlessSceneDesc& desc)
+			: m_SphereData(Geometry::CreateSphere<VertexPosNormalColor>(0.45f, 12, 12)),
+			m_TileData(Geometry::CreatePlane<VertexPosNormalColor>(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT2(1.5f, 1.5f),
+				XMFLOAT2(1.0f, 1.0f), XMFLOAT4(0.6f, 0.6f, 0.6f, 1.0f))),
+			m_Rng(desc.seed),
+			m_PerMaterial(),
+			m_HalfSize()
+		{
+			m_GridN = desc.gridN > 0 ? (uint32_t)desc.gridN : 24;
+			const float spacing = 1.5f;
+			m_HalfSize = 0.5f * spacing * m_GridN;
+
+			// 前一半物体是球，后一半是球下方的地砖，包围球都在初始化时算好
+			uint32_t cellCount = m_GridN * m_GridN;
+			m_Objects.resize(2 * cellCount);
+			m_CenterX.resize(2 * cellCount);
+			m_CenterY.resize(2 * cellCount);
+			m_CenterZ.resize(2 * cellCount);
+			m_Radius.resize(2 * cellCount);
+			for (uint32_t i = 0; i < cellCount; ++i)
+			{
+				float x = spacing * (i % m_GridN + 0.5f) - m_HalfSize;
+				float z = spacing * (i / m_GridN + 0.5f) - m_HalfSize;
+				for (uint32_t k = 0; k < 2; ++k)
+				{
+					uint32_t object = i + k * cellCount;
+					float y = k == 0 ? 0.45f : 0.0f;
+					AffineTransform W = AffineComposeSRT(XMFLOAT3(1.0f, 1.0f, 1.0f), 0.0f, 0.0f, XMFLOAT3(x, y, z));
+					AffineStoreTransposed(&m_Objects[object].world, W);
+					AffineStoreTransposed(&m_Objects[object].worldInvTranspose, AffineInverseTransposeUniform(W));
+					m_CenterX[object] = x;
+					m_CenterY[object] = y;
+					m_CenterZ[object] = z;
+					m_Radius[object] = k == 0 ? 0.45f : 0.75f * 1.41421356f;
+				}
+			}
+
+			m_DirLight.ambient = XMFLOAT4(0.05f, 0.05f, 0.05f, 1.0f);
+			m_DirLight.diffuse = XMFLOAT4(0.1f, 0.1f, 0.1f, 1.0f);
+			m_DirLight.specular = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+			m_DirLight.direction = XMFLOAT3(-0.577f, -0.577f, 0.577f);
+
+			m_PerMaterial.material.ambient = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
+			m_PerMaterial.material.diffuse = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+			m_PerMaterial.material.specular = XMFLOAT4(0.3f, 0.3f, 0.3f, 16.0f);
+
+			m_Selector.SetMaxLightsPerObject(kMaxLightsPerObject);
+			// 环境光由探针给出，不受每个物体只保留K个光源的影响，每两格一个探针
+			uint32_t probesPerRow = m_GridN / 2 + 1;
+			m_AmbientProbes.SetGrid(XMFLOAT3(-m_HalfSize, 0.0f, -m_HalfSize), XMFLOAT3(m_HalfSize, 2.0f, m_HalfSize), probesPerRow, 3, probesPerRow);
+			m_AmbientProbes.SetSky(XMFLOAT3(0.10f, 0.12f, 0.18f), XMFLOAT3(0.08f, 0.08f, 0.08f), XMFLOAT3(0.03f, 0.025f, 0.02f));
+			m_pJobs = desc.pJobs;
+			m_Camera.SetLens(XM_PIDIV2, AspectRatio(desc), 1.0f, 1000.0f);
+		}
+
+		void Render(SoftRasterizer& rasterizer, uint32_t frame) override
+		{
+			float t = frame * HeadlessFrameTime;
+			UpdateLights(t);
+			uint32_t objectCount = (uint32_t)m_Objects.size();
+			m_Selector.Select(m_CenterX.data(), m_CenterY.data(), m_CenterZ.data(), m_Radius.data(), objectCount,
+				m_PointLights.data(), kPointLights, m_SpotLights.data(), kSpotLights, m_pJobs);
+			m_AmbientProbes.Build(&m_DirLight, 1, m_PointLights.data(), kPointLights, m_SpotLights.data(), kSpotLights, m_pJobs);
+
+			m_Camera.SetOrbit(XMFLOAT3(0.0f, 0.0f, 0.0f), 0.8f * m_HalfSize + 4.0f, 0.7f, 0.2f * t);
+			SoftShaders::LightCBPerFrame perFrame;
+			XMStoreFloat4x4(&perFrame.view, XMMatrixTranspose(m_Camera.GetView()));
+			XMStoreFloat4x4(&perFrame.proj, XMMatrixTranspose(m_Camera.GetProj()));
+			const XMFLOAT3& eyePos = m_Camera.GetPosition();
+			perFrame.eyePos = XMFLOAT4(eyePos.x, eyePos.y, eyePos.z, 0.0f);
+			perFrame.dirLight = m_DirLight;
+			perFrame.pointLight = PointLight();
+			perFrame.spotLight = SpotLight();
+
+			BeginFrame(rasterizer);
+			rasterizer.VSSetShader(&SoftShaders::LightVS);
+			rasterizer.PSSetShader(&SoftShaders::LightListPS);
+			rasterizer.VSSetConstantBuffer(1, perFrame);
+			rasterizer.PSSetConstantBuffer(1, perFrame);
+			rasterizer.PSSetConstantBuffer(2, m_PerMaterial);
+			SoftShaders::AmbientProbeBindings probes;
+			probes.constants = m_AmbientProbes.GetConstants();
+			probes.pProbes = m_AmbientProbes.GetCoefficients().data();
+			rasterizer.PSSetConstantBuffer(5, probes);
+
+			// 光源表在Flush之前保持不变，每次绘制只换b0和b3中的区间
+			SoftShaders::ObjectLightBindings objectLights;
+			objectLights.pPointLights = m_PointLights.data();
+			objectLights.pSpotLights = m_SpotLights.data();
+			objectLights.pLightIndices = m_Selector.GetLightIndices().data();
+			const std::vector<LightClusterRange>& ranges = m_Selector.GetObjectRanges();
+			uint32_t cellCount = objectCount / 2;
+			for (uint32_t k = 0; k < 2; ++k)
+			{
+				const Geometry::MeshData<VertexPosNormalColor>& mesh = k == 0 ? m_SphereData : m_TileData;
+				rasterizer.IASetVertexBuffer(mesh.vertexVec.data(), sizeof(VertexPosNormalColor), (uint32_t)mesh.vertexVec.size());
+				rasterizer.IASetIndexBuffer(mesh.indexVec.data());
+				for (uint32_t object = k * cellCount; object < (k + 1) * cellCount; ++object)
+				{
+					objectLights.range = ranges[object];
+					rasterizer.VSSetConstantBuffer(0, m_Objects[object]);
+					rasterizer.PSSetConstantBuffer(3, objectLights);
+					rasterizer.DrawIndexed((uint32_t)mesh.indexVec.size(), 0, 0);
+				}
+			}
+			rasterizer.Flush();
+		}
+
+		std::string GetFrameNote() const override
+		{
+			std::ostringstream outs;
+			outs.precision(3);
+			outs << "lights/object " << m_Selector.GetAverageLightsPerObject()
+				<< " of " << m_Selector.GetAverageCandidatesPerObject()
+				<< " (K " << m_Selector.GetMaxLightsPerObject() << ", truncated " << m_Selector.GetTruncatedObjectCount()
+				<< "/" << m_Objects.size() << "), select " << m_Selector.GetSelectMicroseconds() / 1000.0 << " ms"
+				<< ", " << m_AmbientProbes.GetProbeCount() << " SH probes " << m_AmbientProbes.GetBuildMicroseconds() / 1000.0 << " ms";
+			return outs.str();
+		}
+
+	private:
+		// 点光在地面上方沿各自的圆周运动，聚光灯从高处照向缓慢移动的目标点
+		void UpdateLights(float t)
+		{
+			m_PointLights.resize(kPointLights);
+			for (uint32_t i = 0; i < kPointLights; ++i)
+			{
+				PointLight& L = m_PointLights[i];
+				float cx = (2.0f * m_Rng.Float(i, 0, 0) - 1.0f) * m_HalfSize;
+				float cz = (2.0f * m_Rng.Float(i, 0, 1) - 1.0f) * m_HalfSize;
+				float orbit = 0.5f + 1.5f * m_Rng.Float(i, 0, 2);
+				float angle = m_Rng.Float(i, 0, 3) * XM_2PI + t * (0.5f + m_Rng.Float(i, 0, 4));
+				L.position = XMFLOAT3(cx + orbit * std::cos(angle), 0.3f + 1.2f * m_Rng.Float(i, 1, 0), cz + orbit * std::sin(angle));
+				XMFLOAT4 color(m_Rng.Float(i, 2, 0), m_Rng.Float(i, 2, 1), m_Rng.Float(i, 2, 2), 1.0f);
+				L.ambient = XMFLOAT4(0.04f * color.x, 0.04f * color.y, 0.04f * color.z, 1.0f);
+				L.diffuse = color;
+				L.specular = color;
+				L.att = XMFLOAT3(1.0f, 0.0f, 1.0f);
+				L.range = 1.5f + 1.0f * m_Rng.Float(i, 1, 1);
+			}
+			m_SpotLights.resize(kSpotLights);
+			for (uint32_t i = 0; i < kSpotLights; ++i)
+			{
+				SpotLight& L = m_SpotLights[i];
+				uint32_t id = kPointLights + i;
+				XMVECTOR pos = XMVectorSet((2.0f * m_Rng.Float(id, 0, 0) - 1.0f) * m_HalfSize, 6.0f,
+					(2.0f * m_Rng.Float(id, 0, 1) - 1.0f) * m_HalfSize, 0.0f);
+				float angle = m_Rng.Float(id, 0, 2) * XM_2PI + 0.3f * t;
+				XMVECTOR target = pos + XMVectorSet(2.0f * std::cos(angle), -6.0f, 2.0f * std::sin(angle), 0.0f);
+				XMStoreFloat3(&L.position, pos);
+				XMStoreFloat3(&L.direction, XMVector3Normalize(target - pos));
+				L.ambient = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+				L.diffuse = XMFLOAT4(0.8f, 0.8f, 0.7f, 1.0f);
+				L.specular = XMFLOAT4(0.8f, 0.8f, 0.7f, 1.0f);
+				L.att = XMFLOAT3(1.0f, 0.0f, 0.01f);
+				L.spot = 32.0f + 64.0f * m_Rng.Float(id, 1, 0);
+				L.range = 12.0f;
+			}
+		}
+
+	private:
+		Geometry::MeshData<VertexPosNormalColor> m_SphereData;
+		Geometry::MeshData<VertexPosNormalColor> m_TileData;
+		CounterRng m_Rng;
+		uint32_t m_GridN;
+		std::vector<SoftShaders::LightCBPerObject> m_Objects;
+		std::vector<float> m_CenterX;				// 各物体的世界空间包围球
+		std::vector<float> m_CenterY;
+		std::vector<float> m_CenterZ;
+		std::vector<float> m_Radius;
+		std::vector<PointLight> m_PointLights;
+		std::vector<SpotLight> m_SpotLights;
+		ObjectLightSelector m_Selector;
+		AmbientProbeGrid m_AmbientProbes;
+		JobSystem* m_pJobs;
+		Camera m_Camera;
+		DirectionalLight m_DirLight;
+		SoftShaders::LightCBPerMaterial m_PerMaterial;
+		float m_HalfSize;
+	};
+}
+
+const std::vector<std::string>& GetHeadlessSceneNames()
+{
+	static const std::vector<std::string> names = { "cube", "forest", "flyover", "lighting", "shadows", "manylights" };
+	return names;
+}
+
+std::unique_ptr<HeadlessScene> CreateHeadlessScene(const std::string& name, const HeadlessSceneDesc& desc)
+{
+	if (name == "cube")
+		return std::unique_ptr<HeadlessScene>(new CubeScene(desc));
+	if (name == "forest")
+		return std::unique_ptr<HeadlessScene>(new CharacterForestScene(desc));
+	if (name == "flyover")
+		return std::unique_ptr<HeadlessScene>(new FlyoverScene(desc));
+	if (name == "lighting")
+		return std::unique_ptr<HeadlessScene>(new LightingScene(desc));
+	if (name == "shadows")
+		return std::unique_ptr<HeadlessScene>(new ShadowScene(desc));
+	if (name == "manylights")
+		return std::unique_ptr<HeadlessScene>(new ManyLightsScene(desc));
+	return nullptr;
+}
@@ -0,0 +1,43 @@
+#ifndef HEADLESSSCENES_H
+#define HEADLESSSCENES_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class JobSystem;
+class SoftRasterizer;
+
+const float HeadlessFrameTime = 1.0f / 60.0f;	// 离线渲染的固定时间步长
+
+struct HeadlessSceneDesc
+{
+	uint32_t width;
+	uint32_t height;
+	uint32_t seed;		// 顶点颜色和森林布局的随机数种子
+	int gridN;			// 森林每行的树数，为0则使用对应作业中的值
+	JobSystem* pJobs;	// 森林实例的并行生成，可以为空
+};
+
+// 不依赖D3D设备、只通过SoftRasterizer绘制的场景，对应各次作业的画面。
+// 第frame帧的状态只由frame * HeadlessFrameTime决定(摄像机路径、动画都是时间的函数)，
+// 与之前渲染过哪些帧无关，同样的参数总是得到同样的图像
+class HeadlessScene
+{
+public:
+	virtual ~HeadlessScene() = default;
+
+	// 清空渲染目标并绘制第frame帧，返回前已经Flush
+	virtual void Render(SoftRasterizer& rasterizer, uint32_t frame) = 0;
+	// 上一次Render的场景统计，附加在每帧的输出之后，为空则不输出
+	virtual std::string GetFrameNote() const { return std::string(); }
+};
+
+// 可用的场景名：cube(旋转的名字)、forest(字符森林)、flyover(林中飞翔)、lighting(光照效果)、shadows(阴影贴图)、
+// manylights(逐物体选择光源和球谐环境光)
+const std::vector<std::string>& GetHeadlessSceneNames();
+// 名字无效时返回空
+std::unique_ptr<HeadlessScene> CreateHeadlessScene(const std::string& name, const HeadlessSceneDesc& desc);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef HLSLTYPES_H
+#define HLSLTYPES_H
+
+#include <cmath>
+#include <cstddef>
+#include "PortableMath.h"
+
+// HLSL基本类型和内建函数的C++版本，使HLSL目录下与C++共用的.hlsli(如LightHelper.hlsli)可以直接被C++包含。
+// float3/float4继承XMFLOAT3/XMFLOAT4，不增加成员，内存布局相同，可以直接传给XMLoadFloat4等函数。
+// 只提供共用代码用到的部分，运算都是逐分量的，与HLSL的语义相同
+
+struct float3 : DirectX::XMFLOAT3
+{
+	float3() = default;
+	float3(float _x, float _y, float _z) : XMFLOAT3(_x, _y, _z) {}
+	float3(const DirectX::XMFLOAT3& v) : XMFLOAT3(v) {}
+};
+
+struct float4 : DirectX::XMFLOAT4
+{
+	float4() = default;
+	float4(float _x, float _y, float _z, float _w) : XMFLOAT4(_x, _y, _z, _w) {}
+	float4(const DirectX::XMFLOAT4& v) : XMFLOAT4(v) {}
+};
+
+inline float3 operator-(const float3& a) { return float3(-a.x, -a.y, -a.z); }
+inline float3 operator+(const float3& a, const float3& b) { return float3(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline float3 operator-(const float3& a, const float3& b) { return float3(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline float3 operator*(const float3& a, float s) { return float3(a.x * s, a.y * s, a.z * s); }
+inline float3 operator*(float s, const float3& a) { return a * s; }
+inline float3 operator/(const float3& a, float s) { return float3(a.x / s, a.y / s, a.z / s); }
+inline float3& operator/=(float3& a, float s) { return a = a / s; }
+
+inline float4 operator+(const float4& a, const float4& b) { return float4(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w); }
+inline float4 operator*(const float4& a, const float4& b) { return float4(a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w); }
+inline float4 operator*(const float4& a, float s) { return float4(a.x * s, a.y * s, a.z * s, a.w * s); }
+inline float4 operator*(float s, const float4& a) { return a * s; }
+inline float4& operator+=(float4& a, const float4& b) { return a = a + b; }
+inline float4& operator*=(float4& a, float s) { return a = a * s; }
+
+inline float dot(const float3& a, const float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline float length(const float3& v) { return std::sqrt(dot(v, v)); }
+inline float3 normalize(const float3& v) { return v / length(v); }
+// i为入射方向，n为单位法线
+inline float3 reflect(const float3& i, const float3& n) { return i - 2.0f * dot(i, n) * n; }
+// 名字加括号，避免被windows.h中的max宏展开
+inline float (max)(float a, float b) { return a > b ? a : b; }
+using std::pow;
+
+// C++中没有对应的分支属性
+#define HLSL_FLATTEN
+// HLSL的函数总是内联的。C++中结构体参数按值传递，不内联时每次调用都要复制光源和材质，因此强制内联
+#if defined(_MSC_VER)
+#define HLSL_INLINE __forceinline
+#else
+#define HLSL_INLINE inline __attribute__((always_inline))
+#endif
+
+// HLSL的常量缓冲区打包规则：成员不能跨越16字节的边界，结构体数组的元素按16字节对齐。
+// 与cbuffer或StructuredBuffer共用的C++结构体用这两个宏检查布局
+#define HLSL_CHECK_PACKING(S, member) \
+	static_assert(offsetof(S, member) % 16 == 0 || offsetof(S, member) % 16 + sizeof(S::member) <= 16, \
+		#S "::" #member " straddles a 16-byte boundary")
+#define HLSL_CHECK_SIZE(S) \
+	static_assert(sizeof(S) % 16 == 0, "sizeof(" #S ") is not a multiple of 16 bytes")
+
+#endif
@@ -0,0 +1,127 @@
+#include "ImageCompare.h"
+#include <cmath>
+#include <cstdlib>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define COMPARE_USE_AVX2 1
+#define COMPARE_USE_SSE2 0
+#elif defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define COMPARE_USE_AVX2 0
+#define COMPARE_USE_SSE2 1
+#else
+#define COMPARE_USE_AVX2 0
+#define COMPARE_USE_SSE2 0
+#endif
+
+namespace
+{
+	// 32位累加器每次最多加4个255^2，累加4096次后转入64位的和，不会溢出
+	const size_t kFlushInterval = 4096;
+
+	// movemask结果中为1的位数，即相同的像素数
+	inline uint32_t CountBits(uint32_t mask)
+	{
+		uint32_t count = 0;
+		for (; mask; mask &= mask - 1)
+			++count;
+		return count;
+	}
+
+	// 逐字节比较，用于SIMD处理不完的尾部
+	void CompareScalar(const uint32_t* pA, const uint32_t* pB, size_t count, uint64_t& sumSq, uint32_t& maxDiff, uint64_t& diffPixels)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			uint32_t a = pA[i], b = pB[i];
+			if (a == b)
+				continue;
+			++diffPixels;
+			for (int shift = 0; shift < 32; shift += 8)
+			{
+				uint32_t d = (uint32_t)std::abs((int)((a >> shift) & 0xFF) - (int)((b >> shift) & 0xFF));
+				sumSq += d * d;
+				if (d > maxDiff)
+					maxDiff = d;
+			}
+		}
+	}
+}
+
+ImageDiff CompareImages(const uint32_t* pA, const uint32_t* pB, size_t pixelCount)
+{
+	uint64_t sumSq = 0, diffPixels = 0;
+	uint32_t maxDiff = 0;
+	size_t i = 0;
+
+#if COMPARE_USE_AVX2
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i maxAcc = zero;
+	while (i + 8 <= pixelCount)
+	{
+		__m256i sumAcc = zero;
+		size_t end = i + kFlushInterval * 8 < pixelCount ? i + kFlushInterval * 8 : pixelCount;
+		for (; i + 8 <= end; i += 8)
+		{
+			__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pA + i));
+			__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pB + i));
+			// 无符号饱和减法两个方向取或即为差的绝对值
+			__m256i d = _mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a));
+			maxAcc = _mm256_max_epu8(maxAcc, d);
+			__m256i lo = _mm256_unpacklo_epi8(d, zero);
+			__m256i hi = _mm256_unpackhi_epi8(d, zero);
+			sumAcc = _mm256_add_epi32(sumAcc, _mm256_add_epi32(_mm256_madd_epi16(lo, lo), _mm256_madd_epi16(hi, hi)));
+			// 像素内任一字节不为0即为不同的像素
+			__m256i same = _mm256_cmpeq_epi32(d, zero);
+			diffPixels += 8 - CountBits((uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(same)));
+		}
+		alignas(32) uint32_t sums[8];
+		_mm256_store_si256(reinterpret_cast<__m256i*>(sums), sumAcc);
+		for (int k = 0; k < 8; ++k)
+			sumSq += sums[k];
+	}
+	alignas(32) uint8_t maxBytes[32];
+	_mm256_store_si256(reinterpret_cast<__m256i*>(maxBytes), maxAcc);
+	for (int k = 0; k < 32; ++k)
+		maxDiff = maxBytes[k] > maxDiff ? maxBytes[k] : maxDiff;
+#elif COMPARE_USE_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	__m128i maxAcc = zero;
+	while (i + 4 <= pixelCount)
+	{
+		__m128i sumAcc = zero;
+		size_t end = i + kFlushInterval * 4 < pixelCount ? i + kFlushInterval * 4 : pixelCount;
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pA + i));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pB + i));
+			__m128i d = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+			maxAcc = _mm_max_epu8(maxAcc, d);
+			__m128i lo = _mm_unpacklo_epi8(d, zero);
+			__m128i hi = _mm_unpackhi_epi8(d, zero);
+			sumAcc = _mm_add_epi32(sumAcc, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+			diffPixels += 4 - CountBits((uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(d, zero))));
+		}
+		alignas(16) uint32_t sums[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(sums), sumAcc);
+		for (int k = 0; k < 4; ++k)
+			sumSq += sums[k];
+	}
+	alignas(16) uint8_t maxBytes[16];
+	_mm_store_si128(reinterpret_cast<__m128i*>(maxBytes), maxAcc);
+	for (int k = 0; k < 16; ++k)
+		maxDiff = maxBytes[k] > maxDiff ? maxBytes[k] : maxDiff;
+#endif
+
+	CompareScalar(pA + i, pB + i, pixelCount - i, sumSq, maxDiff, diffPixels);
+
+	ImageDiff diff;
+	diff.mse = pixelCount ? (double)sumSq / ((double)pixelCount * 4.0) : 0.0;
+	diff.psnr = diff.mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / diff.mse) : ImageIdenticalPsnr;
+	if (diff.psnr > ImageIdenticalPsnr)
+		diff.psnr = ImageIdenticalPsnr;
+	diff.maxDiff = maxDiff;
+	diff.diffPixels = diffPixels;
+	return diff;
+}
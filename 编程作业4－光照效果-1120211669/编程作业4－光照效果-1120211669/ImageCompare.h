@@ -0,0 +1,21 @@
+#ifndef IMAGECOMPARE_H
+#define IMAGECOMPARE_H
+
+#include <cstdint>
+#include <cstddef>
+
+// 两幅RGBA8图像逐字节比较的结果，四个通道都参与
+struct ImageDiff
+{
+	double mse;					// 均方误差
+	double psnr;				// 峰值信噪比(dB)，完全相同时记为ImageIdenticalPsnr
+	uint32_t maxDiff;			// 单个通道的最大差值
+	uint64_t diffPixels;		// 至少有一个通道不同的像素数
+};
+
+const double ImageIdenticalPsnr = 100.0;
+
+// 用SIMD累加差值的平方和与最大差值：AVX2一次处理8个像素，SSE2一次4个，其余平台逐字节计算
+ImageDiff CompareImages(const uint32_t* pA, const uint32_t* pB, size_t pixelCount);
+
+#endif
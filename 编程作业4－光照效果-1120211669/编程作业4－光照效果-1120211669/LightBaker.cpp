@@ -0,0 +1,294 @@
+#include "LightBaker.h"
+#include "LightBatch.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// 各分量在Mesh::streams中的序号
+	enum VertexStream : uint32_t
+	{
+		StreamPosX, StreamPosY, StreamPosZ,
+		StreamNormalX, StreamNormalY, StreamNormalZ,
+		StreamColorR, StreamColorG, StreamColorB, StreamColorA,
+		StreamCount
+	};
+
+	bool SphereIntersectsBox(const XMFLOAT3& center, float radius, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+	{
+		// 包围盒上离球心最近的点
+		float dx = center.x - std::min(std::max(center.x, boxMin.x), boxMax.x);
+		float dy = center.y - std::min(std::max(center.y, boxMin.y), boxMax.y);
+		float dz = center.z - std::min(std::max(center.z, boxMin.z), boxMax.z);
+		return dx * dx + dy * dy + dz * dz <= radius * radius;
+	}
+}
+
+StaticLightBaker::StaticLightBaker()
+	: m_Specular(false),
+	m_EyePosW(),
+	m_BakedVertexCount(0),
+	m_BakeMicroseconds(0.0)
+{
+}
+
+uint32_t XM_CALLCONV StaticLightBaker::AddMesh(const Geometry::MeshData<VertexPosNormalColor>& meshData, FXMMATRIX world, const Material& material)
+{
+	XMMATRIX W = world;
+	// 法线用逆转置矩阵变换，每个网格只算一次
+	XMMATRIX normalMat = XMMatrixTranspose(XMMatrixInverse(nullptr, W));
+
+	Mesh mesh;
+	mesh.baked = meshData;
+	mesh.material = material;
+	mesh.dirty = true;
+	mesh.updated = false;
+
+	uint32_t count = (uint32_t)meshData.vertexVec.size();
+	mesh.streams.resize((size_t)count * StreamCount);
+	XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		VertexPosNormalColor& v = mesh.baked.vertexVec[i];
+		XMVECTOR posW = XMVector3Transform(XMLoadFloat3(&v.pos), W);
+		XMVECTOR normalW = XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&v.normal), normalMat));
+		XMStoreFloat3(&v.pos, posW);
+		XMStoreFloat3(&v.normal, normalW);
+		boundsMin = XMVectorMin(boundsMin, posW);
+		boundsMax = XMVectorMax(boundsMax, posW);
+
+		float* s = mesh.streams.data() + i;
+		s[StreamPosX * count] = v.pos.x;
+		s[StreamPosY * count] = v.pos.y;
+		s[StreamPosZ * count] = v.pos.z;
+		s[StreamNormalX * count] = v.normal.x;
+		s[StreamNormalY * count] = v.normal.y;
+		s[StreamNormalZ * count] = v.normal.z;
+		s[StreamColorR * count] = v.color.x;
+		s[StreamColorG * count] = v.color.y;
+		s[StreamColorB * count] = v.color.z;
+		s[StreamColorA * count] = v.color.w;
+	}
+	XMStoreFloat3(&mesh.boundsMin, boundsMin);
+	XMStoreFloat3(&mesh.boundsMax, boundsMax);
+
+	m_Meshes.push_back(std::move(mesh));
+	return (uint32_t)m_Meshes.size() - 1;
+}
+
+void StaticLightBaker::Clear()
+{
+	m_Meshes.clear();
+	m_Chunks.clear();
+	m_BakedVertexCount = 0;
+}
+
+void StaticLightBaker::SetMaterial(uint32_t mesh, const Material& material)
+{
+	Mesh& m = m_Meshes[mesh];
+	if (memcmp(&m.material, &material, sizeof(Material)) != 0)
+	{
+		m.material = material;
+		m.dirty = true;
+	}
+}
+
+void StaticLightBaker::SetSpecular(bool enable, const XMFLOAT3& eyePosW)
+{
+	// 不烘焙镜面反射时观察点不影响结果
+	bool eyeChanged = eyePosW.x != m_EyePosW.x || eyePosW.y != m_EyePosW.y || eyePosW.z != m_EyePosW.z;
+	if (enable != m_Specular || (enable && eyeChanged))
+		MarkAllDirty();
+	m_Specular = enable;
+	m_EyePosW = eyePosW;
+}
+
+void StaticLightBaker::SetLights(const DirectionalLight* pDirLights, uint32_t dirCount,
+	const PointLight* pPointLights, uint32_t pointCount, const SpotLight* pSpotLights, uint32_t spotCount)
+{
+	// 光源结构体的填充字段都是显式的pad，可以整体比较
+	if (dirCount != m_DirLights.size() || (dirCount && memcmp(pDirLights, m_DirLights.data(), sizeof(DirectionalLight) * dirCount) != 0))
+		MarkAllDirty();
+	m_DirLights.assign(pDirLights, pDirLights + dirCount);
+
+	// 按编号比较，变化前后的范围都要重新烘焙，增加或删除的光源也一样
+	uint32_t oldCount = (uint32_t)m_PointLights.size();
+	for (uint32_t i = 0; i < std::max(pointCount, oldCount); ++i)
+	{
+		if (i < oldCount && i < pointCount && memcmp(&m_PointLights[i], &pPointLights[i], sizeof(PointLight)) == 0)
+			continue;
+		if (i < oldCount)
+			MarkSphere(m_PointLights[i].position, m_PointLights[i].range);
+		if (i < pointCount)
+			MarkSphere(pPointLights[i].position, pPointLights[i].range);
+	}
+	m_PointLights.assign(pPointLights, pPointLights + pointCount);
+
+	oldCount = (uint32_t)m_SpotLights.size();
+	for (uint32_t i = 0; i < std::max(spotCount, oldCount); ++i)
+	{
+		if (i < oldCount && i < spotCount && memcmp(&m_SpotLights[i], &pSpotLights[i], sizeof(SpotLight)) == 0)
+			continue;
+		if (i < oldCount)
+			MarkSphere(m_SpotLights[i].position, m_SpotLights[i].range);
+		if (i < spotCount)
+			MarkSphere(pSpotLights[i].position, pSpotLights[i].range);
+	}
+	m_SpotLights.assign(pSpotLights, pSpotLights + spotCount);
+}
+
+void StaticLightBaker::MarkAllDirty()
+{
+	for (Mesh& mesh : m_Meshes)
+		mesh.dirty = true;
+}
+
+void StaticLightBaker::MarkSphere(const XMFLOAT3& center, float radius)
+{
+	for (Mesh& mesh : m_Meshes)
+	{
+		if (!mesh.dirty && SphereIntersectsBox(center, radius, mesh.boundsMin, mesh.boundsMax))
+			mesh.dirty = true;
+	}
+}
+
+uint32_t StaticLightBaker::Bake(JobSystem* jobs)
+{
+	Clock::time_point start = Clock::now();
+
+	// 收集需要烘焙的网格，每个网格只计算范围与其包围盒相交的光源，再按顶点切块
+	m_Chunks.clear();
+	m_BakedVertexCount = 0;
+	uint32_t bakedMeshes = 0;
+	for (uint32_t m = 0; m < (uint32_t)m_Meshes.size(); ++m)
+	{
+		Mesh& mesh = m_Meshes[m];
+		mesh.updated = mesh.dirty;
+		if (!mesh.dirty)
+			continue;
+		mesh.dirty = false;
+		++bakedMeshes;
+
+		mesh.pointLights.clear();
+		for (uint32_t i = 0; i < (uint32_t)m_PointLights.size(); ++i)
+		{
+			if (SphereIntersectsBox(m_PointLights[i].position, m_PointLights[i].range, mesh.boundsMin, mesh.boundsMax))
+				mesh.pointLights.push_back(i);
+		}
+		mesh.spotLights.clear();
+		for (uint32_t i = 0; i < (uint32_t)m_SpotLights.size(); ++i)
+		{
+			if (SphereIntersectsBox(m_SpotLights[i].position, m_SpotLights[i].range, mesh.boundsMin, mesh.boundsMax))
+				mesh.spotLights.push_back(i);
+		}
+
+		uint32_t count = (uint32_t)mesh.baked.vertexVec.size();
+		m_BakedVertexCount += count;
+		for (uint32_t begin = 0; begin < count; begin += kChunkSize)
+		{
+			Chunk chunk = { m, begin, std::min(begin + kChunkSize, count) };
+			m_Chunks.push_back(chunk);
+		}
+	}
+
+	// 每块只写自己的顶点
+	JobSystem::RangeFunc func = [this](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+			BakeChunk(m_Chunks[i]);
+	};
+	if (jobs && m_Chunks.size() > 1)
+		jobs->ParallelFor((uint32_t)m_Chunks.size(), 1, func);
+	else
+		func(0, (uint32_t)m_Chunks.size());
+
+	m_BakeMicroseconds = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+	return bakedMeshes;
+}
+
+void StaticLightBaker::BakeChunk(const Chunk& chunk)
+{
+	Mesh& mesh = m_Meshes[chunk.mesh];
+	uint32_t vertexCount = (uint32_t)mesh.baked.vertexVec.size();
+	uint32_t count = chunk.end - chunk.begin;
+	const float* pStreams = mesh.streams.data() + chunk.begin;
+	const float* s[StreamCount];
+	for (uint32_t k = 0; k < StreamCount; ++k)
+		s[k] = pStreams + (size_t)k * vertexCount;
+
+	// 指向观察点的向量只影响镜面反射，不烘焙镜面反射时用法线代替
+	LightSamplesSoA samples = { s[StreamPosX], s[StreamPosY], s[StreamPosZ],
+		s[StreamNormalX], s[StreamNormalY], s[StreamNormalZ],
+		s[StreamNormalX], s[StreamNormalY], s[StreamNormalZ] };
+	float toEye[3][kChunkSize];
+	if (m_Specular)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			float x = m_EyePosW.x - s[StreamPosX][i];
+			float y = m_EyePosW.y - s[StreamPosY][i];
+			float z = m_EyePosW.z - s[StreamPosZ][i];
+			float invLength = 1.0f / std::sqrt(x * x + y * y + z * z);
+			toEye[0][i] = x * invLength;
+			toEye[1][i] = y * invLength;
+			toEye[2][i] = z * invLength;
+		}
+		samples.toEyeX = toEye[0];
+		samples.toEyeY = toEye[1];
+		samples.toEyeZ = toEye[2];
+	}
+
+	float terms[12][kChunkSize] = {};
+	LightTermsSoA T = { { terms[0], terms[1], terms[2], terms[3] },
+		{ terms[4], terms[5], terms[6], terms[7] },
+		{ terms[8], terms[9], terms[10], terms[11] } };
+	for (const DirectionalLight& L : m_DirLights)
+		ComputeDirectionalLightBatch(mesh.material, L, samples, count, T);
+	for (uint32_t i : mesh.pointLights)
+		ComputePointLightBatch(mesh.material, m_PointLights[i], samples, count, T);
+	for (uint32_t i : mesh.spotLights)
+		ComputeSpotLightBatch(mesh.material, m_SpotLights[i], samples, count, T);
+	if (!m_Specular)
+		memset(terms[8], 0, sizeof(float) * kChunkSize * 4);
+
+	float out[4][kChunkSize];
+	const float* const color[4] = { s[StreamColorR], s[StreamColorG], s[StreamColorB], s[StreamColorA] };
+	float* const pOut[4] = { out[0], out[1], out[2], out[3] };
+	CombineLightTermsBatch(mesh.material, color, T, count, pOut);
+	for (uint32_t i = 0; i < count; ++i)
+		mesh.baked.vertexVec[chunk.begin + i].color = XMFLOAT4(out[0][i], out[1][i], out[2][i], out[3][i]);
+}
+
+uint32_t StaticLightBaker::GetMeshCount() const
+{
+	return (uint32_t)m_Meshes.size();
+}
+
+const Geometry::MeshData<VertexPosNormalColor>& StaticLightBaker::GetBakedMesh(uint32_t mesh) const
+{
+	return m_Meshes[mesh].baked;
+}
+
+bool StaticLightBaker::IsMeshUpdated(uint32_t mesh) const
+{
+	return m_Meshes[mesh].updated;
+}
+
+uint32_t StaticLightBaker::GetBakedVertexCount() const
+{
+	return m_BakedVertexCount;
+}
+
+double StaticLightBaker::GetBakeMicroseconds() const
+{
+	return m_BakeMicroseconds;
+}
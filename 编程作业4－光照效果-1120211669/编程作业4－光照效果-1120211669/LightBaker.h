@@ -0,0 +1,87 @@
+#ifndef LIGHTBAKER_H
+#define LIGHTBAKER_H
+
+#include <vector>
+#include <cstdint>
+#include "Geometry.h"
+#include "LightHelper.h"
+
+class JobSystem;
+
+// 静止网格的逐顶点光照烘焙。
+// 按LightHelper.hlsli的光照模型在CPU上计算每个顶点的颜色，写入网格的Color，运行时只需要输出顶点颜色。
+// 顶点在加入时变换到世界空间，烘焙结果可以直接用单位世界矩阵绘制。
+// SetLights与上一次的光源逐个比较，只有包围盒与变化的光源范围(变化前后都算)相交的网格才重新烘焙，
+// 方向光、材质或镜面反射设置变化时对应的网格全部重新烘焙
+class StaticLightBaker
+{
+public:
+	StaticLightBaker();
+
+	// 加入一个静止的网格，返回编号。Color作为顶点的基色，烘焙结果替换它
+	// [In]world	未转置的世界矩阵
+	uint32_t XM_CALLCONV AddMesh(const Geometry::MeshData<VertexPosNormalColor>& meshData, DirectX::FXMMATRIX world, const Material& material);
+	void Clear();
+
+	void SetMaterial(uint32_t mesh, const Material& material);
+	// 镜面反射与观察点有关，默认不烘焙；开启后按给定的观察点计算
+	void SetSpecular(bool enable, const DirectX::XMFLOAT3& eyePosW);
+	// 设置烘焙使用的光源，受影响的网格标记为需要重新烘焙
+	void SetLights(const DirectionalLight* pDirLights, uint32_t dirCount,
+		const PointLight* pPointLights, uint32_t pointCount, const SpotLight* pSpotLights, uint32_t spotCount);
+	void MarkAllDirty();
+
+	// 重新烘焙标记的网格，返回烘焙的网格数
+	// [In]jobs	不为空则按顶点分块并行
+	uint32_t Bake(JobSystem* jobs = nullptr);
+
+	uint32_t GetMeshCount() const;
+	const Geometry::MeshData<VertexPosNormalColor>& GetBakedMesh(uint32_t mesh) const;
+	bool IsMeshUpdated(uint32_t mesh) const;	// 上一次Bake是否重新烘焙了该网格
+	uint32_t GetBakedVertexCount() const;		// 上一次Bake烘焙的顶点数
+	double GetBakeMicroseconds() const;
+
+private:
+	// 每块最多的顶点数，各分量的临时数组放在栈上
+	static const uint32_t kChunkSize = 256;
+
+	struct Mesh
+	{
+		Geometry::MeshData<VertexPosNormalColor> baked;	// 世界空间的顶点和烘焙后的颜色
+		std::vector<float> streams;		// 世界空间的位置xyz、单位法线xyz和基色rgba，各vertexCount个
+		Material material;
+		DirectX::XMFLOAT3 boundsMin;
+		DirectX::XMFLOAT3 boundsMax;
+		bool dirty;
+		bool updated;
+		std::vector<uint32_t> pointLights;	// 烘焙时与包围盒相交的光源
+		std::vector<uint32_t> spotLights;
+	};
+
+	// 一次并行任务处理的顶点范围
+	struct Chunk
+	{
+		uint32_t mesh;
+		uint32_t begin;
+		uint32_t end;
+	};
+
+	// 与球相交的网格标记为需要重新烘焙
+	void MarkSphere(const DirectX::XMFLOAT3& center, float radius);
+	void BakeChunk(const Chunk& chunk);
+
+private:
+	std::vector<Mesh> m_Meshes;
+	std::vector<Chunk> m_Chunks;
+
+	std::vector<DirectionalLight> m_DirLights;
+	std::vector<PointLight> m_PointLights;
+	std::vector<SpotLight> m_SpotLights;
+	bool m_Specular;
+	DirectX::XMFLOAT3 m_EyePosW;
+
+	uint32_t m_BakedVertexCount;
+	double m_BakeMicroseconds;
+};
+
+#endif
@@ -0,0 +1,330 @@
+#include "LightBatch.h"
+#include <cmath>
+
+#if LIGHTBATCH_USE_AVX2
+#include <immintrin.h>
+#endif
+
+inline namespace LIGHTBATCH_NAMESPACE
+{
+
+namespace
+{
+#if LIGHTBATCH_USE_AVX2
+
+	// 材质与光源颜色的逐分量乘积，对一批采样点都相同
+	struct LightColors
+	{
+		float ambient[4];
+		float diffuse[4];
+		float spec[4];
+	};
+
+	LightColors MakeLightColors(const Material& mat, const DirectX::XMFLOAT4& ambient,
+		const DirectX::XMFLOAT4& diffuse, const DirectX::XMFLOAT4& specular)
+	{
+		LightColors colors;
+		const float* pMatA = &mat.ambient.x;
+		const float* pMatD = &mat.diffuse.x;
+		const float* pMatS = &mat.specular.x;
+		for (int c = 0; c < 4; ++c)
+		{
+			colors.ambient[c] = pMatA[c] * (&ambient.x)[c];
+			colors.diffuse[c] = pMatD[c] * (&diffuse.x)[c];
+			colors.spec[c] = pMatS[c] * (&specular.x)[c];
+		}
+		return colors;
+	}
+
+	__m256i TailMask(uint32_t n)
+	{
+		return _mm256_cmpgt_epi32(_mm256_set1_epi32((int)n), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+	}
+
+	__m256 Load(const float* p, uint32_t n, __m256i mask)
+	{
+		return n >= 8 ? _mm256_loadu_ps(p) : _mm256_maskload_ps(p, mask);
+	}
+
+	void Accumulate(float* p, uint32_t n, __m256i mask, __m256 v)
+	{
+		if (n >= 8)
+			_mm256_storeu_ps(p, _mm256_add_ps(_mm256_loadu_ps(p), v));
+		else
+			_mm256_maskstore_ps(p, mask, _mm256_add_ps(_mm256_maskload_ps(p, mask), v));
+	}
+
+	__m256 Dot3(__m256 ax, __m256 ay, __m256 az, __m256 bx, __m256 by, __m256 bz)
+	{
+		return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, bx), _mm256_mul_ps(ay, by)), _mm256_mul_ps(az, bz));
+	}
+
+	// 自然对数，x > 0。把x分解为m * 2^e，m在[sqrt(0.5), sqrt(2))内，再用多项式计算ln(m)
+	__m256 Log(__m256 x)
+	{
+		const __m256 one = _mm256_set1_ps(1.0f);
+		x = _mm256_max_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32(0x00800000)));	// 最小的规格化数
+		__m256i exponent = _mm256_sub_epi32(_mm256_srli_epi32(_mm256_castps_si256(x), 23), _mm256_set1_epi32(0x7f));
+		x = _mm256_or_ps(_mm256_and_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32(0x007fffff))), _mm256_set1_ps(0.5f));
+		__m256 e = _mm256_add_ps(_mm256_cvtepi32_ps(exponent), one);
+
+		// 此时x在[0.5, 1)内，小于sqrt(0.5)时翻倍使其落在[sqrt(0.5), sqrt(2))
+		__m256 small = _mm256_cmp_ps(x, _mm256_set1_ps(0.707106781186547524f), _CMP_LT_OQ);
+		e = _mm256_sub_ps(e, _mm256_and_ps(one, small));
+		x = _mm256_add_ps(_mm256_sub_ps(x, one), _mm256_and_ps(x, small));
+
+		__m256 z = _mm256_mul_ps(x, x);
+		__m256 y = _mm256_set1_ps(7.0376836292e-2f);
+		y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(-1.1514610310e-1f));
+		y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(1.1676998740e-1f));
+		y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(-1.2420140846e-1f));
+		y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(1.4249322787e-1f));
+		y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(-1.6668057665e-1f));
+		y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(2.0000714765e-1f));
+		y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(-2.4999993993e-1f));
+		y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(3.3333331174e-1f));
+		y = _mm256_mul_ps(_mm256_mul_ps(y, x), z);
+
+		// ln(2)拆成两部分相加以保留精度
+		y = _mm256_add_ps(y, _mm256_mul_ps(e, _mm256_set1_ps(-2.12194440e-4f)));
+		y = _mm256_sub_ps(y, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+		x = _mm256_add_ps(x, y);
+		return _mm256_add_ps(x, _mm256_mul_ps(e, _mm256_set1_ps(0.693359375f)));
+	}
+
+	// e^x，x = n * ln(2) + r，|r| <= ln(2) / 2，e^r用多项式计算，2^n直接构造指数位
+	__m256 Exp(__m256 x)
+	{
+		const __m256 one = _mm256_set1_ps(1.0f);
+		x = _mm256_min_ps(x, _mm256_set1_ps(88.3762626647949f));
+		x = _mm256_max_ps(x, _mm256_set1_ps(-87.3365447504f));
+
+		__m256 n = _mm256_floor_ps(_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504088896341f)), _mm256_set1_ps(0.5f)));
+		x = _mm256_sub_ps(x, _mm256_mul_ps(n, _mm256_set1_ps(0.693359375f)));
+		x = _mm256_sub_ps(x, _mm256_mul_ps(n, _mm256_set1_ps(-2.12194440e-4f)));
+
+		__m256 z = _mm256_mul_ps(x, x);
+		__m256 y = _mm256_set1_ps(1.9875691500e-4f);
+		y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(1.3981999507e-3f));
+		y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(8.3334519073e-3f));
+		y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(4.1665795894e-2f));
+		y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(1.6666665459e-1f));
+		y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(5.0000001201e-1f));
+		y = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(y, z), x), one);
+
+		__m256i pow2n = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvttps_epi32(n), _mm256_set1_epi32(0x7f)), 23);
+		return _mm256_mul_ps(y, _mm256_castsi256_ps(pow2n));
+	}
+
+	// x >= 0时的pow(x, p)，与std::pow一样pow(x, 0) = 1、pow(0, p > 0) = 0
+	__m256 Pow(__m256 x, float p)
+	{
+		if (p == 0.0f)
+			return _mm256_set1_ps(1.0f);
+		__m256 positive = _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GT_OQ);
+		return _mm256_and_ps(Exp(_mm256_mul_ps(Log(x), _mm256_set1_ps(p))), positive);
+	}
+
+	// 一次8个采样点的公共部分，对应HLSL中[flatten]的分支：
+	// diffuseFactor = dot(lightVec, normal)，大于0时specFactor = pow(max(dot(reflect(-lightVec, normal), toEye), 0), power)，
+	// 再按ambientScale、diffuseScale(已包含衰减和diffuseFactor为正的条件)累加到结果中
+	struct LightVec8
+	{
+		__m256 x, y, z;
+	};
+
+	void AccumulateTerms8(const LightColors& colors, float power, const LightSamplesSoA& s, uint32_t i, uint32_t n, __m256i mask,
+		const LightVec8& l, __m256 ambientScale, __m256 attenuation, const LightTermsSoA& terms)
+	{
+		__m256 nx = Load(s.normalX + i, n, mask), ny = Load(s.normalY + i, n, mask), nz = Load(s.normalZ + i, n, mask);
+		__m256 ex = Load(s.toEyeX + i, n, mask), ey = Load(s.toEyeY + i, n, mask), ez = Load(s.toEyeZ + i, n, mask);
+
+		__m256 diffuseFactor = Dot3(l.x, l.y, l.z, nx, ny, nz);
+		__m256 lit = _mm256_cmp_ps(diffuseFactor, _mm256_setzero_ps(), _CMP_GT_OQ);
+		// reflect(-lightVec, normal) = 2 * dot(lightVec, normal) * normal - lightVec
+		__m256 twoDF = _mm256_add_ps(diffuseFactor, diffuseFactor);
+		__m256 vx = _mm256_sub_ps(_mm256_mul_ps(twoDF, nx), l.x);
+		__m256 vy = _mm256_sub_ps(_mm256_mul_ps(twoDF, ny), l.y);
+		__m256 vz = _mm256_sub_ps(_mm256_mul_ps(twoDF, nz), l.z);
+		__m256 specFactor = Pow(_mm256_max_ps(Dot3(vx, vy, vz, ex, ey, ez), _mm256_setzero_ps()), power);
+
+		__m256 diffuseScale = _mm256_and_ps(_mm256_mul_ps(diffuseFactor, attenuation), lit);
+		__m256 specScale = _mm256_and_ps(_mm256_mul_ps(specFactor, attenuation), lit);
+		for (int c = 0; c < 4; ++c)
+		{
+			Accumulate(terms.ambient[c] + i, n, mask, _mm256_mul_ps(_mm256_set1_ps(colors.ambient[c]), ambientScale));
+			Accumulate(terms.diffuse[c] + i, n, mask, _mm256_mul_ps(_mm256_set1_ps(colors.diffuse[c]), diffuseScale));
+			Accumulate(terms.spec[c] + i, n, mask, _mm256_mul_ps(_mm256_set1_ps(colors.spec[c]), specScale));
+		}
+	}
+
+	// 点光和聚光灯：从采样点指向光源的单位向量、距离和是否在范围内
+	void LightVectors8(const DirectX::XMFLOAT3& position, float range, const LightSamplesSoA& s, uint32_t i, uint32_t n, __m256i mask,
+		LightVec8& l, __m256& d, __m256& inRange)
+	{
+		l.x = _mm256_sub_ps(_mm256_set1_ps(position.x), Load(s.posX + i, n, mask));
+		l.y = _mm256_sub_ps(_mm256_set1_ps(position.y), Load(s.posY + i, n, mask));
+		l.z = _mm256_sub_ps(_mm256_set1_ps(position.z), Load(s.posZ + i, n, mask));
+		d = _mm256_sqrt_ps(Dot3(l.x, l.y, l.z, l.x, l.y, l.z));
+		inRange = _mm256_cmp_ps(d, _mm256_set1_ps(range), _CMP_LE_OQ);
+		__m256 invD = _mm256_div_ps(_mm256_set1_ps(1.0f), d);
+		l.x = _mm256_mul_ps(l.x, invD);
+		l.y = _mm256_mul_ps(l.y, invD);
+		l.z = _mm256_mul_ps(l.z, invD);
+	}
+
+	// 1 / dot(att, (1, d, d * d))
+	__m256 Attenuation8(const DirectX::XMFLOAT3& att, __m256 d)
+	{
+		__m256 denom = _mm256_add_ps(_mm256_set1_ps(att.x),
+			_mm256_mul_ps(d, _mm256_add_ps(_mm256_set1_ps(att.y), _mm256_mul_ps(d, _mm256_set1_ps(att.z)))));
+		return _mm256_div_ps(_mm256_set1_ps(1.0f), denom);
+	}
+
+#else
+
+	// 逐个采样点调用LightHelper.hlsli中与HLSL共用的光照函数，结果累加到对应的位置
+	float3 LoadSample(const float* pX, const float* pY, const float* pZ, uint32_t i)
+	{
+		return float3(pX[i], pY[i], pZ[i]);
+	}
+
+	void AccumulateTerms(const LightTerms& t, const LightTermsSoA& terms, uint32_t i)
+	{
+		const float* pAmbient = &t.ambient.x;
+		const float* pDiffuse = &t.diffuse.x;
+		const float* pSpec = &t.spec.x;
+		for (int c = 0; c < 4; ++c)
+		{
+			terms.ambient[c][i] += pAmbient[c];
+			terms.diffuse[c][i] += pDiffuse[c];
+			terms.spec[c][i] += pSpec[c];
+		}
+	}
+
+#endif
+}
+
+void ComputeDirectionalLightBatch(const Material& mat, const DirectionalLight& L,
+	const LightSamplesSoA& samples, uint32_t count, const LightTermsSoA& terms)
+{
+#if LIGHTBATCH_USE_AVX2
+	LightColors colors = MakeLightColors(mat, L.ambient, L.diffuse, L.specular);
+	float power = mat.specular.w;
+	LightVec8 l = { _mm256_set1_ps(-L.direction.x), _mm256_set1_ps(-L.direction.y), _mm256_set1_ps(-L.direction.z) };
+	const __m256 one = _mm256_set1_ps(1.0f);
+	for (uint32_t i = 0; i < count; i += 8)
+	{
+		uint32_t n = count - i;
+		__m256i mask = TailMask(n);
+		AccumulateTerms8(colors, power, samples, i, n, mask, l, one, one, terms);
+	}
+#else
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		LightTerms t = ComputeDirectionalLight(mat, L, LoadSample(samples.normalX, samples.normalY, samples.normalZ, i),
+			LoadSample(samples.toEyeX, samples.toEyeY, samples.toEyeZ, i));
+		AccumulateTerms(t, terms, i);
+	}
+#endif
+}
+
+void ComputePointLightBatch(const Material& mat, const PointLight& L,
+	const LightSamplesSoA& samples, uint32_t count, const LightTermsSoA& terms)
+{
+#if LIGHTBATCH_USE_AVX2
+	LightColors colors = MakeLightColors(mat, L.ambient, L.diffuse, L.specular);
+	float power = mat.specular.w;
+	for (uint32_t i = 0; i < count; i += 8)
+	{
+		uint32_t n = count - i;
+		__m256i mask = TailMask(n);
+		LightVec8 l;
+		__m256 d, inRange;
+		LightVectors8(L.position, L.range, samples, i, n, mask, l, d, inRange);
+		// 超出范围的采样点三项都为0
+		__m256 ambientScale = _mm256_and_ps(_mm256_set1_ps(1.0f), inRange);
+		__m256 attenuation = _mm256_and_ps(Attenuation8(L.att, d), inRange);
+		AccumulateTerms8(colors, power, samples, i, n, mask, l, ambientScale, attenuation, terms);
+	}
+#else
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		LightTerms t = ComputePointLight(mat, L, LoadSample(samples.posX, samples.posY, samples.posZ, i),
+			LoadSample(samples.normalX, samples.normalY, samples.normalZ, i), LoadSample(samples.toEyeX, samples.toEyeY, samples.toEyeZ, i));
+		AccumulateTerms(t, terms, i);
+	}
+#endif
+}
+
+void ComputeSpotLightBatch(const Material& mat, const SpotLight& L,
+	const LightSamplesSoA& samples, uint32_t count, const LightTermsSoA& terms)
+{
+#if LIGHTBATCH_USE_AVX2
+	LightColors colors = MakeLightColors(mat, L.ambient, L.diffuse, L.specular);
+	float power = mat.specular.w;
+	const __m256 dirX = _mm256_set1_ps(L.direction.x), dirY = _mm256_set1_ps(L.direction.y), dirZ = _mm256_set1_ps(L.direction.z);
+	for (uint32_t i = 0; i < count; i += 8)
+	{
+		uint32_t n = count - i;
+		__m256i mask = TailMask(n);
+		LightVec8 l;
+		__m256 d, inRange;
+		LightVectors8(L.position, L.range, samples, i, n, mask, l, d, inRange);
+		// spot = pow(max(dot(-lightVec, direction), 0), L.spot)，环境光乘以spot，漫反射和镜面反射乘以spot / 衰减
+		__m256 spot = Pow(_mm256_max_ps(_mm256_sub_ps(_mm256_setzero_ps(), Dot3(l.x, l.y, l.z, dirX, dirY, dirZ)), _mm256_setzero_ps()), L.spot);
+		spot = _mm256_and_ps(spot, inRange);
+		__m256 attenuation = _mm256_mul_ps(spot, Attenuation8(L.att, d));
+		AccumulateTerms8(colors, power, samples, i, n, mask, l, spot, attenuation, terms);
+	}
+#else
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		LightTerms t = ComputeSpotLight(mat, L, LoadSample(samples.posX, samples.posY, samples.posZ, i),
+			LoadSample(samples.normalX, samples.normalY, samples.normalZ, i), LoadSample(samples.toEyeX, samples.toEyeY, samples.toEyeZ, i));
+		AccumulateTerms(t, terms, i);
+	}
+#endif
+}
+
+void CombineLightTermsBatch(const Material& mat, const float* const color[4], const LightTermsSoA& terms,
+	uint32_t count, float* const out[4])
+{
+	// 各分量互不依赖，编译器可以自动向量化
+	for (int c = 0; c < 3; ++c)
+	{
+		const float* pColor = color[c];
+		const float* pAmbient = terms.ambient[c];
+		const float* pDiffuse = terms.diffuse[c];
+		const float* pSpec = terms.spec[c];
+		float* pOut = out[c];
+		for (uint32_t i = 0; i < count; ++i)
+			pOut[i] = pColor[i] * (pAmbient[i] + pDiffuse[i]) + pSpec[i];
+	}
+	for (uint32_t i = 0; i < count; ++i)
+		out[3][i] = mat.diffuse.w * color[3][i];
+}
+
+const char* GetLightBatchBackendName()
+{
+#if LIGHTBATCH_USE_AVX2
+	return "AVX2";
+#else
+	return "Scalar";
+#endif
+}
+
+}	// inline namespace LIGHTBATCH_NAMESPACE
+
+#if LIGHTBATCH_USE_AVX2
+void GetLightBatchAVX2(LightBatchBackend& backend)
+#else
+void GetLightBatchScalar(LightBatchBackend& backend)
+#endif
+{
+	backend.name = GetLightBatchBackendName();
+	backend.available = true;
+	backend.directional = &ComputeDirectionalLightBatch;
+	backend.point = &ComputePointLightBatch;
+	backend.spot = &ComputeSpotLightBatch;
+}
@@ -0,0 +1,82 @@
+#ifndef LIGHTBATCH_H
+#define LIGHTBATCH_H
+
+#include <cstdint>
+#include "LightHelper.h"
+
+// LightHelper.hlsli中三种光源的C++批量版本，一次计算一批采样点(顶点或像素)。
+// 采样点的各分量分开存放(SoA)，AVX2下一次计算8个，否则逐个调用LightHelper.hlsli中与HLSL共用的光照函数。
+// 公式与HLSL相同，包括超出范围时环境光也为0、聚光灯的环境光乘以聚光因子；
+// AVX2下pow用多项式近似的log2/exp2计算，与标量版本的相对误差在1e-5以内。
+// 与PortableMath.h一样，两种实现放在不同的内联命名空间中，定义LIGHTBATCH_FORCE_SCALAR时强制使用标量实现，
+// 以不同选项编译的翻译单元可以链接到同一个程序里对照
+
+#if defined(__AVX2__) && !defined(LIGHTBATCH_FORCE_SCALAR)
+#define LIGHTBATCH_USE_AVX2 1
+#define LIGHTBATCH_NAMESPACE LightBatchAVX2
+#else
+#define LIGHTBATCH_USE_AVX2 0
+#define LIGHTBATCH_NAMESPACE LightBatchScalar
+#endif
+
+// 一批采样点，法线和指向观察点的向量需要已经归一化。
+// 方向光不需要位置，posX/posY/posZ可以为空
+struct LightSamplesSoA
+{
+	const float* posX;
+	const float* posY;
+	const float* posZ;
+	const float* normalX;
+	const float* normalY;
+	const float* normalZ;
+	const float* toEyeX;
+	const float* toEyeY;
+	const float* toEyeZ;
+};
+
+// 三项光照结果的RGBA分量，计算结果累加到原来的值上，多个光源可以依次累加到同一组数组中
+struct LightTermsSoA
+{
+	float* ambient[4];
+	float* diffuse[4];
+	float* spec[4];
+};
+
+inline namespace LIGHTBATCH_NAMESPACE
+{
+
+// 数组长度不要求是8的倍数，最后不足8个的部分用掩码读写
+void ComputeDirectionalLightBatch(const Material& mat, const DirectionalLight& L,
+	const LightSamplesSoA& samples, uint32_t count, const LightTermsSoA& terms);
+void ComputePointLightBatch(const Material& mat, const PointLight& L,
+	const LightSamplesSoA& samples, uint32_t count, const LightTermsSoA& terms);
+void ComputeSpotLightBatch(const Material& mat, const SpotLight& L,
+	const LightSamplesSoA& samples, uint32_t count, const LightTermsSoA& terms);
+
+// 与Light_PS相同的组合：litColor = color * (ambient + diffuse) + spec，alpha = mat.diffuse.w * color.a
+// [In]color	各采样点的顶点颜色RGBA
+// [Out]out		结果RGBA，可以与color相同
+void CombineLightTermsBatch(const Material& mat, const float* const color[4], const LightTermsSoA& terms,
+	uint32_t count, float* const out[4]);
+
+// 编译时选择的实现："AVX2"或"Scalar"
+const char* GetLightBatchBackendName();
+
+}	// inline namespace LIGHTBATCH_NAMESPACE
+
+// 一种实现的三个批量光照函数，单元测试用它在同一个程序中比较标量和AVX2的结果
+struct LightBatchBackend
+{
+	const char* name;
+	bool available;
+	void (*directional)(const Material&, const DirectionalLight&, const LightSamplesSoA&, uint32_t, const LightTermsSoA&);
+	void (*point)(const Material&, const PointLight&, const LightSamplesSoA&, uint32_t, const LightTermsSoA&);
+	void (*spot)(const Material&, const SpotLight&, const LightSamplesSoA&, uint32_t, const LightTermsSoA&);
+};
+
+// 由对应实现的翻译单元提供。LightBatchScalar.cpp和LightBatchAVX2.cpp各编译一份LightBatch.cpp，
+// AVX2版本需要以AVX2和FMA编译，运行前还要检查CPU是否支持
+void GetLightBatchScalar(LightBatchBackend& backend);
+void GetLightBatchAVX2(LightBatchBackend& backend);
+
+#endif
@@ -0,0 +1,18 @@
+// AVX2实现。此文件需要单独以AVX2和FMA编译(MSVC为/arch:AVX2，GCC/Clang为-mavx2 -mfma)，
+// 运行前由调用方检查CPU是否支持
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+
+#include "LightBatch.cpp"
+
+#else
+
+#include "LightBatch.h"
+
+void GetLightBatchAVX2(LightBatchBackend& backend)
+{
+	backend = LightBatchBackend();
+	backend.name = "AVX2";
+	backend.available = false;
+}
+
+#endif
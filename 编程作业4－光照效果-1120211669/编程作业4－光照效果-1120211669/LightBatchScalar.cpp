@@ -0,0 +1,3 @@
+// 标量实现，作为AVX2实现的参考结果。单元测试编译此文件和LightBatchAVX2.cpp来代替LightBatch.cpp
+#define LIGHTBATCH_FORCE_SCALAR
+#include "LightBatch.cpp"
@@ -0,0 +1,334 @@
+#include "LightClusters.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+
+using namespace DirectX;
+
+const float LightClusterGrid::kSpotCutoff = 1.0f / 256.0f;
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// 在[c - r, c + r] x [z - r, z + r]上c / z的最小值和最大值，z - r > 0，包含了球的投影
+	float MinRatio(float c, float z, float r)
+	{
+		float a = c - r;
+		return a / (a >= 0.0f ? z + r : z - r);
+	}
+
+	float MaxRatio(float c, float z, float r)
+	{
+		float b = c + r;
+		return b / (b >= 0.0f ? z - r : z + r);
+	}
+
+	// NDC范围[ndc0, ndc1]覆盖的块，完全在屏幕外时lo > hi
+	void NdcToTiles(float ndc0, float ndc1, uint32_t count, int32_t& lo, int32_t& hi)
+	{
+		if (ndc1 < -1.0f || ndc0 > 1.0f)
+		{
+			lo = 1;
+			hi = 0;
+			return;
+		}
+		float t0 = (std::max(ndc0, -1.0f) * 0.5f + 0.5f) * count;
+		float t1 = (std::min(ndc1, 1.0f) * 0.5f + 0.5f) * count;
+		lo = std::min((int32_t)t0, (int32_t)count - 1);
+		hi = std::min((int32_t)t1, (int32_t)count - 1);
+	}
+}
+
+LightClusterGrid::LightClusterGrid()
+	: m_Constants(),
+	m_FarZ(0.0f),
+	m_MaxLightsPerCluster(128),
+	m_MaxLightsInCluster(0),
+	m_AverageLights(0.0f),
+	m_OverflowCount(0),
+	m_BuildMicroseconds(0.0)
+{
+	SetGrid(16, 9, 24);
+}
+
+void LightClusterGrid::SetGrid(uint32_t countX, uint32_t countY, uint32_t countZ)
+{
+	m_Constants.countX = std::max(countX, 1u);
+	m_Constants.countY = std::max(countY, 1u);
+	m_Constants.countZ = std::max(countZ, 1u);
+	m_FarZ = 0.0f;		// 下次Build时重新计算包围盒
+	m_Ranges.assign(GetClusterCount(), LightClusterRange());
+}
+
+void LightClusterGrid::SetMaxLightsPerCluster(uint32_t count)
+{
+	// 每种光源的数目存放在16位中
+	m_MaxLightsPerCluster = std::min(std::max(count, 1u), 0xffffu);
+}
+
+void XM_CALLCONV LightClusterGrid::Build(const PointLight* pPointLights, uint32_t pointCount, const SpotLight* pSpotLights, uint32_t spotCount,
+	FXMMATRIX view, CXMMATRIX proj, float nearZ, float farZ, JobSystem* jobs)
+{
+	Clock::time_point start = Clock::now();
+
+	XMFLOAT4X4 P;
+	XMStoreFloat4x4(&P, proj);
+	if (nearZ != m_Constants.nearZ || farZ != m_FarZ || P._11 != m_Constants.projX || P._22 != m_Constants.projY)
+		UpdateClusterBounds(nearZ, farZ, P._11, P._22);
+
+	// 光源变换到观察空间并求出可能覆盖的簇范围
+	XMMATRIX viewMat = view;
+	m_PointLights.resize(pointCount);
+	for (uint32_t i = 0; i < pointCount; ++i)
+	{
+		const PointLight& L = pPointLights[i];
+		ViewLight& light = m_PointLights[i];
+		light.cosAngle = -1.0f;
+		light.sinAngle = 0.0f;
+		light.range = L.range;
+		SetupLight(light, XMVector3Transform(XMLoadFloat3(&L.position), viewMat), L.range);
+	}
+
+	m_SpotLights.resize(spotCount);
+	for (uint32_t i = 0; i < spotCount; ++i)
+	{
+		const SpotLight& L = pSpotLights[i];
+		ViewLight& light = m_SpotLights[i];
+		XMVECTOR posV = XMVector3Transform(XMLoadFloat3(&L.position), viewMat);
+		XMVECTOR dirV = XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&L.direction), viewMat));
+		XMFLOAT3 pos, dir;
+		XMStoreFloat3(&pos, posV);
+		XMStoreFloat3(&dir, dirV);
+		light.posX = pos.x; light.posY = pos.y; light.posZ = pos.z;
+		light.dirX = dir.x; light.dirY = dir.y; light.dirZ = dir.z;
+		light.range = L.range;
+
+		// spot为0时在各个方向上都一样，按点光处理
+		light.cosAngle = L.spot > 0.0f ? std::pow(kSpotCutoff, 1.0f / L.spot) : -1.0f;
+		light.sinAngle = std::sqrt(std::max(1.0f - light.cosAngle * light.cosAngle, 0.0f));
+		if (light.cosAngle <= 0.0f)
+			SetupLight(light, posV, L.range);
+		else if (light.cosAngle < 0.70710678f)
+			// 半角大于45度时，包围球以底面圆心为球心
+			SetupLight(light, XMVectorAdd(posV, XMVectorScale(dirV, light.cosAngle * L.range)), light.sinAngle * L.range);
+		else
+			// 否则以到顶点和底面边缘等距的点为球心
+			SetupLight(light, XMVectorAdd(posV, XMVectorScale(dirV, 0.5f * L.range / light.cosAngle)), 0.5f * L.range / light.cosAngle);
+	}
+
+	// 按深度层分配，每层只写自己的簇
+	uint32_t clusterCount = GetClusterCount();
+	m_ClusterLights.resize((size_t)clusterCount * m_MaxLightsPerCluster);
+	m_PointCounts.resize(clusterCount);
+	m_SpotCounts.resize(clusterCount);
+	m_SliceOverflow.assign(m_Constants.countZ, 0);
+	JobSystem::RangeFunc func = [this](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t slice = begin; slice < end; ++slice)
+			AssignSlice(slice);
+	};
+	if (jobs)
+		jobs->ParallelFor(m_Constants.countZ, 1, func);
+	else
+		func(0, m_Constants.countZ);
+
+	// 把各簇的光源紧密排列
+	m_Ranges.resize(clusterCount);
+	m_LightIndices.clear();
+	m_MaxLightsInCluster = 0;
+	uint32_t litClusters = 0;
+	for (uint32_t c = 0; c < clusterCount; ++c)
+	{
+		uint32_t n = m_PointCounts[c] + m_SpotCounts[c];
+		m_Ranges[c].offset = (uint32_t)m_LightIndices.size();
+		m_Ranges[c].counts = m_PointCounts[c] | (m_SpotCounts[c] << 16);
+		const uint32_t* pLights = m_ClusterLights.data() + (size_t)c * m_MaxLightsPerCluster;
+		m_LightIndices.insert(m_LightIndices.end(), pLights, pLights + n);
+		m_MaxLightsInCluster = std::max(m_MaxLightsInCluster, n);
+		litClusters += n ? 1 : 0;
+	}
+	m_AverageLights = litClusters ? (float)m_LightIndices.size() / litClusters : 0.0f;
+	m_OverflowCount = 0;
+	for (uint32_t n : m_SliceOverflow)
+		m_OverflowCount += n;
+
+	m_BuildMicroseconds = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+void LightClusterGrid::UpdateClusterBounds(float nearZ, float farZ, float projX, float projY)
+{
+	m_Constants.nearZ = nearZ;
+	m_Constants.logScale = m_Constants.countZ / std::log(farZ / nearZ);
+	m_Constants.projX = projX;
+	m_Constants.projY = projY;
+	m_FarZ = farZ;
+
+	const LightClusterConstants& c = m_Constants;
+	m_Bounds.resize(GetClusterCount());
+	for (uint32_t z = 0; z < c.countZ; ++z)
+	{
+		// 稍微扩大一点，避免着色时的浮点误差使像素落在簇外
+		float z0 = nearZ * std::pow(farZ / nearZ, (float)z / c.countZ) * 0.9999f;
+		float z1 = nearZ * std::pow(farZ / nearZ, (float)(z + 1) / c.countZ) * 1.0001f;
+		for (uint32_t y = 0; y < c.countY; ++y)
+		{
+			float ndcY0 = 2.0f * y / c.countY - 1.0f, ndcY1 = 2.0f * (y + 1) / c.countY - 1.0f;
+			for (uint32_t x = 0; x < c.countX; ++x)
+			{
+				float ndcX0 = 2.0f * x / c.countX - 1.0f, ndcX1 = 2.0f * (x + 1) / c.countX - 1.0f;
+				// 簇的四条侧边都经过摄像机，x、y的极值在近处或远处取得
+				ClusterBounds& b = m_Bounds[(z * c.countY + y) * c.countX + x];
+				b.minX = std::min(ndcX0 * z0, ndcX0 * z1) / projX;
+				b.maxX = std::max(ndcX1 * z0, ndcX1 * z1) / projX;
+				b.minY = std::min(ndcY0 * z0, ndcY0 * z1) / projY;
+				b.maxY = std::max(ndcY1 * z0, ndcY1 * z1) / projY;
+				b.minZ = z0;
+				b.maxZ = z1;
+			}
+		}
+	}
+}
+
+void XM_CALLCONV LightClusterGrid::SetupLight(ViewLight& light, FXMVECTOR centerV, float radius) const
+{
+	const LightClusterConstants& c = m_Constants;
+	XMFLOAT3 center;
+	XMStoreFloat3(&center, centerV);
+	light.x = center.x;
+	light.y = center.y;
+	light.z = center.z;
+	light.radius = radius;
+	light.minX = light.minY = light.minZ = 1;
+	light.maxX = light.maxY = light.maxZ = 0;
+
+	// 在近平面之前或远平面之后的不覆盖任何簇
+	float zNear = center.z - radius, zFar = center.z + radius;
+	if (zFar < c.nearZ || zNear > m_FarZ)
+		return;
+	auto sliceOf = [&c](float z)
+	{
+		float s = std::log(std::max(z, c.nearZ) / c.nearZ) * c.logScale;
+		return (int32_t)std::min(std::max(s, 0.0f), (float)(c.countZ - 1));
+	};
+
+	int32_t minX = 0, maxX = (int32_t)c.countX - 1;
+	int32_t minY = 0, maxY = (int32_t)c.countY - 1;
+	// 包围球与摄像机所在的平面相交时无法得到有效的投影，取整个屏幕
+	if (zNear > 0.0f)
+	{
+		NdcToTiles(c.projX * MinRatio(center.x, center.z, radius), c.projX * MaxRatio(center.x, center.z, radius), c.countX, minX, maxX);
+		NdcToTiles(c.projY * MinRatio(center.y, center.z, radius), c.projY * MaxRatio(center.y, center.z, radius), c.countY, minY, maxY);
+		if (minX > maxX || minY > maxY)
+			return;
+	}
+	light.minX = minX;
+	light.maxX = maxX;
+	light.minY = minY;
+	light.maxY = maxY;
+	light.minZ = sliceOf(zNear);
+	light.maxZ = sliceOf(zFar);
+}
+
+void LightClusterGrid::AssignSlice(uint32_t slice)
+{
+	const LightClusterConstants& c = m_Constants;
+	uint32_t first = slice * c.countY * c.countX;
+	uint32_t last = first + c.countY * c.countX;
+	std::fill(m_PointCounts.begin() + first, m_PointCounts.begin() + last, 0);
+	std::fill(m_SpotCounts.begin() + first, m_SpotCounts.begin() + last, 0);
+	uint32_t overflow = 0;
+
+	// 包围球与簇的包围盒相交
+	auto sphereHitsBox = [](const ClusterBounds& b, float x, float y, float z, float r)
+	{
+		float dx = std::max(std::max(b.minX - x, x - b.maxX), 0.0f);
+		float dy = std::max(std::max(b.minY - y, y - b.maxY), 0.0f);
+		float dz = std::max(std::max(b.minZ - z, z - b.maxZ), 0.0f);
+		return dx * dx + dy * dy + dz * dz <= r * r;
+	};
+
+	for (uint32_t pass = 0; pass < 2; ++pass)
+	{
+		const std::vector<ViewLight>& lights = pass == 0 ? m_PointLights : m_SpotLights;
+		std::vector<uint32_t>& counts = pass == 0 ? m_PointCounts : m_SpotCounts;
+		for (uint32_t i = 0; i < (uint32_t)lights.size(); ++i)
+		{
+			const ViewLight& L = lights[i];
+			if ((int32_t)slice < L.minZ || (int32_t)slice > L.maxZ)
+				continue;
+			for (int32_t y = L.minY; y <= L.maxY; ++y)
+			{
+				for (int32_t x = L.minX; x <= L.maxX; ++x)
+				{
+					uint32_t cluster = first + (uint32_t)y * c.countX + (uint32_t)x;
+					const ClusterBounds& b = m_Bounds[cluster];
+					if (!sphereHitsBox(b, L.x, L.y, L.z, L.radius))
+						continue;
+					if (pass == 1 && L.cosAngle > 0.0f)
+					{
+						// 簇的包围球与锥体：在锥体前方、后方或张角之外的都不相交
+						float cx = 0.5f * (b.minX + b.maxX), cy = 0.5f * (b.minY + b.maxY), cz = 0.5f * (b.minZ + b.maxZ);
+						float hx = 0.5f * (b.maxX - b.minX), hy = 0.5f * (b.maxY - b.minY), hz = 0.5f * (b.maxZ - b.minZ);
+						float r = std::sqrt(hx * hx + hy * hy + hz * hz);
+						float vx = cx - L.posX, vy = cy - L.posY, vz = cz - L.posZ;
+						float lenSq = vx * vx + vy * vy + vz * vz;
+						float v1 = vx * L.dirX + vy * L.dirY + vz * L.dirZ;
+						float distToCone = L.cosAngle * std::sqrt(std::max(lenSq - v1 * v1, 0.0f)) - v1 * L.sinAngle;
+						if (distToCone > r || v1 > r + L.range || v1 < -r)
+							continue;
+					}
+					uint32_t n = m_PointCounts[cluster] + m_SpotCounts[cluster];
+					if (n >= m_MaxLightsPerCluster)
+					{
+						++overflow;
+						continue;
+					}
+					m_ClusterLights[(size_t)cluster * m_MaxLightsPerCluster + n] = i;
+					++counts[cluster];
+				}
+			}
+		}
+	}
+	m_SliceOverflow[slice] = overflow;
+}
+
+const LightClusterConstants& LightClusterGrid::GetConstants() const
+{
+	return m_Constants;
+}
+
+const std::vector<LightClusterRange>& LightClusterGrid::GetClusterRanges() const
+{
+	return m_Ranges;
+}
+
+const std::vector<uint32_t>& LightClusterGrid::GetLightIndices() const
+{
+	return m_LightIndices;
+}
+
+uint32_t LightClusterGrid::GetClusterCount() const
+{
+	return m_Constants.countX * m_Constants.countY * m_Constants.countZ;
+}
+
+uint32_t LightClusterGrid::GetMaxLightsInCluster() const
+{
+	return m_MaxLightsInCluster;
+}
+
+float LightClusterGrid::GetAverageLightsPerCluster() const
+{
+	return m_AverageLights;
+}
+
+uint32_t LightClusterGrid::GetOverflowCount() const
+{
+	return m_OverflowCount;
+}
+
+double LightClusterGrid::GetBuildMicroseconds() const
+{
+	return m_BuildMicroseconds;
+}
@@ -0,0 +1,126 @@
+#ifndef LIGHTCLUSTERS_H
+#define LIGHTCLUSTERS_H
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include "LightHelper.h"
+
+class JobSystem;
+
+// 分簇光照的常量，对应HLSL中的CBLightClusters(b3)。
+// 屏幕按NDC均匀分成countX x countY块，深度在[nearZ, farZ]内按对数分成countZ层，
+// 第k层为nearZ * (farZ / nearZ)^(k / countZ)到nearZ * (farZ / nearZ)^((k + 1) / countZ)
+struct LightClusterConstants
+{
+	uint32_t countX;
+	uint32_t countY;
+	uint32_t countZ;
+	uint32_t pad;
+	float nearZ;
+	float logScale;		// countZ / ln(farZ / nearZ)
+	float projX;		// 投影矩阵的_11、_22，观察空间坐标到NDC的缩放
+	float projY;
+};
+HLSL_CHECK_SIZE(LightClusterConstants);
+
+// 每个簇在索引表中的区间，对应HLSL中的uint2：
+// 从offset开始依次是pointCount个点光下标和spotCount个聚光灯下标，counts = pointCount | spotCount << 16
+struct LightClusterRange
+{
+	uint32_t offset;
+	uint32_t counts;
+};
+
+// 观察空间中的点所在的簇，与Light.hlsli中的ComputeClusterIndex相同
+inline uint32_t ComputeClusterIndex(const LightClusterConstants& c, float viewX, float viewY, float viewZ)
+{
+	float invZ = 1.0f / std::fmax(viewZ, c.nearZ);
+	float u = (viewX * c.projX * invZ) * 0.5f + 0.5f;
+	float v = (viewY * c.projY * invZ) * 0.5f + 0.5f;
+	float s = std::log(std::fmax(viewZ, c.nearZ) / c.nearZ) * c.logScale;
+	uint32_t x = (uint32_t)std::fmin(std::fmax(u * c.countX, 0.0f), (float)(c.countX - 1));
+	uint32_t y = (uint32_t)std::fmin(std::fmax(v * c.countY, 0.0f), (float)(c.countY - 1));
+	uint32_t z = (uint32_t)std::fmin(std::fmax(s, 0.0f), (float)(c.countZ - 1));
+	return (z * c.countY + y) * c.countX + x;
+}
+
+// CPU上的分簇光源分配。每帧根据摄像机把点光和聚光灯分配到观察空间的簇(froxel)中，
+// 着色时只计算像素所在簇中的光源。
+// 点光用range球与簇的包围盒相交测试；聚光灯的锥体取聚光因子降到kSpotCutoff的角度，
+// 先用锥体的包围球确定簇的范围，再逐簇做锥体与簇包围球的相交测试。
+// 按深度层并行，每层只写自己的簇，结果与线程数无关
+class LightClusterGrid
+{
+public:
+	// 聚光因子pow(cos, spot)低于该值的部分不计入锥体
+	static const float kSpotCutoff;
+
+	LightClusterGrid();
+
+	void SetGrid(uint32_t countX, uint32_t countY, uint32_t countZ);
+	// 每个簇最多记录的光源数，超出的部分丢弃并计入GetOverflowCount
+	void SetMaxLightsPerCluster(uint32_t count);
+
+	// 光源为世界空间，view、proj为未转置的矩阵
+	// [In]jobs	不为空则按深度层在工作线程中分配
+	void XM_CALLCONV Build(const PointLight* pPointLights, uint32_t pointCount, const SpotLight* pSpotLights, uint32_t spotCount,
+		DirectX::FXMMATRIX view, DirectX::CXMMATRIX proj, float nearZ, float farZ, JobSystem* jobs = nullptr);
+
+	const LightClusterConstants& GetConstants() const;
+	const std::vector<LightClusterRange>& GetClusterRanges() const;
+	const std::vector<uint32_t>& GetLightIndices() const;
+
+	uint32_t GetClusterCount() const;
+	uint32_t GetMaxLightsInCluster() const;		// 上一次Build中单个簇的最多光源数
+	float GetAverageLightsPerCluster() const;	// 上一次Build中有光源的簇平均的光源数
+	uint32_t GetOverflowCount() const;			// 上一次Build中因簇已满而丢弃的次数
+	double GetBuildMicroseconds() const;
+
+private:
+	// 观察空间中的光源
+	struct ViewLight
+	{
+		float x, y, z;			// 点光为位置，聚光灯为包围球球心
+		float radius;			// 包围球半径
+		float posX, posY, posZ;	// 聚光灯的位置
+		float dirX, dirY, dirZ;	// 聚光灯的方向
+		float range;
+		float cosAngle, sinAngle;	// 聚光灯锥体的半角，cosAngle <= 0时按球处理
+		int32_t minX, maxX, minY, maxY, minZ, maxZ;	// 可能覆盖的簇范围(含)
+	};
+
+	// 簇在观察空间中的包围盒
+	struct ClusterBounds
+	{
+		float minX, minY, minZ;
+		float maxX, maxY, maxZ;
+	};
+
+	void UpdateClusterBounds(float nearZ, float farZ, float projX, float projY);
+	void XM_CALLCONV SetupLight(ViewLight& light, DirectX::FXMVECTOR centerV, float radius) const;
+	void AssignSlice(uint32_t slice);
+
+private:
+	LightClusterConstants m_Constants;
+	float m_FarZ;
+	uint32_t m_MaxLightsPerCluster;
+	std::vector<ClusterBounds> m_Bounds;
+
+	std::vector<ViewLight> m_PointLights;
+	std::vector<ViewLight> m_SpotLights;
+	std::vector<uint32_t> m_ClusterLights;		// 每个簇固定容量的光源下标
+	std::vector<uint32_t> m_PointCounts;		// 每个簇的点光数
+	std::vector<uint32_t> m_SpotCounts;			// 每个簇的聚光灯数
+	std::vector<uint32_t> m_SliceOverflow;		// 每层丢弃的次数
+
+	std::vector<LightClusterRange> m_Ranges;
+	std::vector<uint32_t> m_LightIndices;
+
+	uint32_t m_MaxLightsInCluster;
+	float m_AverageLights;
+	uint32_t m_OverflowCount;
+	double m_BuildMicroseconds;
+};
+
+#endif
@@ -0,0 +1,211 @@
+#include "LightSelection.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+
+using namespace DirectX;
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// 候选的排序键：高32位为贡献(非负浮点数的位模式与大小顺序一致)，低32位为光源下标，聚光灯置最高位
+	const uint32_t kSpotFlag = 0x80000000u;
+
+	uint64_t MakeCandidate(float score, uint32_t key)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &score, sizeof(bits));
+		return (uint64_t)bits << 32 | key;
+	}
+
+	float Luminance(const XMFLOAT4& a, const XMFLOAT4& d, const XMFLOAT4& s)
+	{
+		return 0.299f * (a.x + d.x + s.x) + 0.587f * (a.y + d.y + s.y) + 0.114f * (a.z + d.z + s.z);
+	}
+}
+
+ObjectLightSelector::ObjectLightSelector()
+	: m_MaxLightsPerObject(8),
+	m_AverageLights(0.0f),
+	m_AverageCandidates(0.0f),
+	m_TruncatedObjects(0),
+	m_SelectMicroseconds(0.0)
+{
+}
+
+void ObjectLightSelector::SetMaxLightsPerObject(uint32_t count)
+{
+	// 每种光源的数目存放在16位中
+	m_MaxLightsPerObject = std::min(std::max(count, 1u), 0xffffu);
+}
+
+uint32_t ObjectLightSelector::GetMaxLightsPerObject() const
+{
+	return m_MaxLightsPerObject;
+}
+
+void ObjectLightSelector::Select(const float* pCenterX, const float* pCenterY, const float* pCenterZ, const float* pRadius, uint32_t objectCount,
+	const PointLight* pPointLights, uint32_t pointCount, const SpotLight* pSpotLights, uint32_t spotCount, JobSystem* jobs)
+{
+	Clock::time_point start = Clock::now();
+
+	m_PointLights.resize(pointCount);
+	for (uint32_t i = 0; i < pointCount; ++i)
+	{
+		const PointLight& L = pPointLights[i];
+		LightBounds& light = m_PointLights[i];
+		light.x = L.position.x; light.y = L.position.y; light.z = L.position.z;
+		light.range = L.range;
+		light.intensity = Luminance(L.ambient, L.diffuse, L.specular);
+		light.att0 = L.att.x; light.att1 = L.att.y; light.att2 = L.att.z;
+		light.dirX = light.dirY = light.dirZ = 0.0f;
+		light.spot = 0.0f;
+	}
+	m_SpotLights.resize(spotCount);
+	for (uint32_t i = 0; i < spotCount; ++i)
+	{
+		const SpotLight& L = pSpotLights[i];
+		LightBounds& light = m_SpotLights[i];
+		XMFLOAT3 dir;
+		XMStoreFloat3(&dir, XMVector3Normalize(XMLoadFloat3(&L.direction)));
+		light.x = L.position.x; light.y = L.position.y; light.z = L.position.z;
+		light.range = L.range;
+		light.intensity = Luminance(L.ambient, L.diffuse, L.specular);
+		light.att0 = L.att.x; light.att1 = L.att.y; light.att2 = L.att.z;
+		light.dirX = dir.x; light.dirY = dir.y; light.dirZ = dir.z;
+		light.spot = L.spot;
+	}
+
+	// 每个物体只写自己的槽位
+	m_ObjectLights.resize((size_t)objectCount * m_MaxLightsPerObject);
+	m_PointCounts.resize(objectCount);
+	m_SpotCounts.resize(objectCount);
+	m_CandidateCounts.resize(objectCount);
+	ObjectSpheres spheres = { pCenterX, pCenterY, pCenterZ, pRadius };
+	JobSystem::RangeFunc func = [this, &spheres](uint32_t begin, uint32_t end)
+	{
+		std::vector<uint64_t> candidates;
+		candidates.reserve(m_PointLights.size() + m_SpotLights.size());
+		for (uint32_t object = begin; object < end; ++object)
+			SelectObject(object, spheres, candidates);
+	};
+	if (jobs)
+		jobs->ParallelFor(objectCount, 64, func);
+	else
+		func(0, objectCount);
+
+	// 把各物体的光源紧密排列
+	m_Ranges.resize(objectCount);
+	m_LightIndices.clear();
+	uint64_t candidateTotal = 0;
+	m_TruncatedObjects = 0;
+	for (uint32_t object = 0; object < objectCount; ++object)
+	{
+		uint32_t n = m_PointCounts[object] + m_SpotCounts[object];
+		m_Ranges[object].offset = (uint32_t)m_LightIndices.size();
+		m_Ranges[object].counts = m_PointCounts[object] | (m_SpotCounts[object] << 16);
+		const uint32_t* pLights = m_ObjectLights.data() + (size_t)object * m_MaxLightsPerObject;
+		m_LightIndices.insert(m_LightIndices.end(), pLights, pLights + n);
+		candidateTotal += m_CandidateCounts[object];
+		m_TruncatedObjects += m_CandidateCounts[object] > n ? 1 : 0;
+	}
+	m_AverageLights = objectCount ? (float)m_LightIndices.size() / objectCount : 0.0f;
+	m_AverageCandidates = objectCount ? (float)candidateTotal / objectCount : 0.0f;
+
+	m_SelectMicroseconds = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+void ObjectLightSelector::SelectObject(uint32_t object, const ObjectSpheres& spheres, std::vector<uint64_t>& candidates)
+{
+	float cx = spheres.pCenterX[object], cy = spheres.pCenterY[object], cz = spheres.pCenterZ[object];
+	float r = spheres.pRadius[object];
+	candidates.clear();
+
+	for (uint32_t pass = 0; pass < 2; ++pass)
+	{
+		const std::vector<LightBounds>& lights = pass == 0 ? m_PointLights : m_SpotLights;
+		for (uint32_t i = 0; i < (uint32_t)lights.size(); ++i)
+		{
+			const LightBounds& L = lights[i];
+			float vx = cx - L.x, vy = cy - L.y, vz = cz - L.z;
+			float d = std::sqrt(vx * vx + vy * vy + vz * vz);
+			// 包围球内离光源最近的点仍在range之外
+			float nearest = std::max(d - r, 0.0f);
+			if (nearest > L.range)
+				continue;
+			float score = L.intensity / std::max(L.att0 + L.att1 * nearest + L.att2 * nearest * nearest, 1e-6f);
+
+			// 光轴与球心方向的夹角减去包围球的半张角，得到球内最大的聚光因子
+			if (pass == 1 && L.spot > 0.0f && d > r)
+			{
+				float cosTheta = (vx * L.dirX + vy * L.dirY + vz * L.dirZ) / d;
+				float sinAlpha = r / d;
+				float cosAlpha = std::sqrt(1.0f - sinAlpha * sinAlpha);
+				if (cosTheta < cosAlpha)
+				{
+					float sinTheta = std::sqrt(std::max(1.0f - cosTheta * cosTheta, 0.0f));
+					float spotFactor = std::pow(std::max(cosTheta * cosAlpha + sinTheta * sinAlpha, 0.0f), L.spot);
+					// 与分簇时相同的锥体范围
+					if (spotFactor < LightClusterGrid::kSpotCutoff)
+						continue;
+					score *= spotFactor;
+				}
+			}
+			if (score > 0.0f)
+				candidates.push_back(MakeCandidate(score, pass == 0 ? i : i | kSpotFlag));
+		}
+	}
+
+	// 只保留贡献最大的K个，贡献相同时按排序键的大小，结果是确定的
+	uint32_t k = m_MaxLightsPerObject;
+	m_CandidateCounts[object] = (uint32_t)candidates.size();
+	if (candidates.size() > k)
+		std::nth_element(candidates.begin(), candidates.begin() + k, candidates.end(), std::greater<uint64_t>());
+	uint32_t count = std::min((uint32_t)candidates.size(), k);
+
+	// 按下标排序，点光没有标记位，排在聚光灯之前
+	uint32_t* pLights = m_ObjectLights.data() + (size_t)object * k;
+	for (uint32_t i = 0; i < count; ++i)
+		pLights[i] = (uint32_t)candidates[i];
+	std::sort(pLights, pLights + count);
+	uint32_t pointCount = 0;
+	while (pointCount < count && !(pLights[pointCount] & kSpotFlag))
+		++pointCount;
+	for (uint32_t i = pointCount; i < count; ++i)
+		pLights[i] &= ~kSpotFlag;
+	m_PointCounts[object] = pointCount;
+	m_SpotCounts[object] = count - pointCount;
+}
+
+const std::vector<LightClusterRange>& ObjectLightSelector::GetObjectRanges() const
+{
+	return m_Ranges;
+}
+
+const std::vector<uint32_t>& ObjectLightSelector::GetLightIndices() const
+{
+	return m_LightIndices;
+}
+
+float ObjectLightSelector::GetAverageLightsPerObject() const
+{
+	return m_AverageLights;
+}
+
+float ObjectLightSelector::GetAverageCandidatesPerObject() const
+{
+	return m_AverageCandidates;
+}
+
+uint32_t ObjectLightSelector::GetTruncatedObjectCount() const
+{
+	return m_TruncatedObjects;
+}
+
+double ObjectLightSelector::GetSelectMicroseconds() const
+{
+	return m_SelectMicroseconds;
+}
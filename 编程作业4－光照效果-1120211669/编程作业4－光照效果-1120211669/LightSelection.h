@@ -0,0 +1,80 @@
+#ifndef LIGHTSELECTION_H
+#define LIGHTSELECTION_H
+
+#include <vector>
+#include <cstdint>
+#include "LightHelper.h"
+#include "LightClusters.h"
+
+class JobSystem;
+
+// 逐物体的光源选择。光源很多时，每次绘制只计算对该物体影响最大的K个点光和聚光灯。
+// 候选为range球(聚光灯还要求锥体)与物体包围球相交的光源，按包围球内能得到的最大贡献
+// 亮度 * 聚光因子 / (att.x + att.y * d + att.z * d^2)排序，d取包围球到光源的最近距离，
+// 聚光因子取包围球张角内最接近光轴的方向。
+// 结果与LightClusterGrid的格式相同：每个物体一个LightClusterRange，索引表中先点光后聚光灯。
+// 按物体并行，每个物体只写自己的槽位，结果与线程数无关
+class ObjectLightSelector
+{
+public:
+	ObjectLightSelector();
+
+	// 每个物体最多保留的光源数K，点光和聚光灯合计
+	void SetMaxLightsPerObject(uint32_t count);
+	uint32_t GetMaxLightsPerObject() const;
+
+	// 物体的包围球与光源都在世界空间中，包围球按分量分开存放
+	// [In]jobs	不为空则按物体在工作线程中选择
+	void Select(const float* pCenterX, const float* pCenterY, const float* pCenterZ, const float* pRadius, uint32_t objectCount,
+		const PointLight* pPointLights, uint32_t pointCount, const SpotLight* pSpotLights, uint32_t spotCount, JobSystem* jobs = nullptr);
+
+	const std::vector<LightClusterRange>& GetObjectRanges() const;
+	const std::vector<uint32_t>& GetLightIndices() const;
+
+	float GetAverageLightsPerObject() const;		// 上一次Select中每个物体平均选中的光源数
+	float GetAverageCandidatesPerObject() const;	// 上一次Select中每个物体平均与包围球相交的光源数
+	uint32_t GetTruncatedObjectCount() const;		// 候选超过K、丢弃了部分光源的物体数
+	double GetSelectMicroseconds() const;
+
+private:
+	// 选择时用到的光源参数
+	struct LightBounds
+	{
+		float x, y, z;
+		float range;
+		float intensity;		// ambient + diffuse + specular的亮度
+		float att0, att1, att2;
+		float dirX, dirY, dirZ;	// 聚光灯的方向
+		float spot;				// 聚光灯的指数，点光为0
+	};
+
+	struct ObjectSpheres
+	{
+		const float* pCenterX;
+		const float* pCenterY;
+		const float* pCenterZ;
+		const float* pRadius;
+	};
+
+	void SelectObject(uint32_t object, const ObjectSpheres& spheres, std::vector<uint64_t>& candidates);
+
+private:
+	uint32_t m_MaxLightsPerObject;
+	std::vector<LightBounds> m_PointLights;
+	std::vector<LightBounds> m_SpotLights;
+
+	std::vector<uint32_t> m_ObjectLights;		// 每个物体K个槽位
+	std::vector<uint32_t> m_PointCounts;
+	std::vector<uint32_t> m_SpotCounts;
+	std::vector<uint32_t> m_CandidateCounts;
+
+	std::vector<LightClusterRange> m_Ranges;
+	std::vector<uint32_t> m_LightIndices;
+
+	float m_AverageLights;
+	float m_AverageCandidates;
+	uint32_t m_TruncatedObjects;
+	double m_SelectMicroseconds;
+};
+
+#endif
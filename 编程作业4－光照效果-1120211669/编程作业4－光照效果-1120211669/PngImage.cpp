@@ -0,0 +1,603 @@
+#include "PngImage.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+	const uint16_t s_LengthBase[29] = {
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+	};
+	const uint8_t s_LengthExtra[29] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+	};
+	const uint16_t s_DistBase[30] = {
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+	};
+	const uint8_t s_DistExtra[30] = {
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+	};
+
+	const uint32_t kWindowSize = 32768;
+	const uint32_t kMinMatch = 3;
+	const uint32_t kMaxMatch = 258;
+	const uint32_t kHashBits = 15;
+	const uint32_t kMaxChain = 32;		// 每个位置最多比较的候选数
+
+	// deflate的位流，低位在前
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(std::vector<uint8_t>& out) : m_Out(out), m_Bits(0), m_Count(0) {}
+
+		void Write(uint32_t bits, uint32_t count)
+		{
+			m_Bits |= bits << m_Count;
+			m_Count += count;
+			while (m_Count >= 8)
+			{
+				m_Out.push_back((uint8_t)m_Bits);
+				m_Bits >>= 8;
+				m_Count -= 8;
+			}
+		}
+
+		// 哈夫曼码按高位在前写出
+		void WriteCode(uint32_t code, uint32_t length)
+		{
+			uint32_t reversed = 0;
+			for (uint32_t i = 0; i < length; ++i)
+				reversed |= ((code >> i) & 1) << (length - 1 - i);
+			Write(reversed, length);
+		}
+
+		void Flush()
+		{
+			if (m_Count > 0)
+				m_Out.push_back((uint8_t)m_Bits);
+			m_Bits = 0;
+			m_Count = 0;
+		}
+
+	private:
+		std::vector<uint8_t>& m_Out;
+		uint32_t m_Bits;
+		uint32_t m_Count;
+	};
+
+	// 固定哈夫曼编码的字面量/长度符号
+	void WriteLiteralLength(BitWriter& bw, uint32_t symbol)
+	{
+		if (symbol < 144)
+			bw.WriteCode(0x30 + symbol, 8);
+		else if (symbol < 256)
+			bw.WriteCode(0x190 + symbol - 144, 9);
+		else if (symbol < 280)
+			bw.WriteCode(symbol - 256, 7);
+		else
+			bw.WriteCode(0xC0 + symbol - 280, 8);
+	}
+
+	void WriteMatch(BitWriter& bw, uint32_t length, uint32_t distance)
+	{
+		uint32_t lc = 28;
+		while (s_LengthBase[lc] > length)
+			--lc;
+		WriteLiteralLength(bw, 257 + lc);
+		bw.Write(length - s_LengthBase[lc], s_LengthExtra[lc]);
+
+		uint32_t dc = 29;
+		while (s_DistBase[dc] > distance)
+			--dc;
+		bw.WriteCode(dc, 5);
+		bw.Write(distance - s_DistBase[dc], s_DistExtra[dc]);
+	}
+
+	uint32_t Hash3(const uint8_t* p)
+	{
+		uint32_t v = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+		return (v * 2654435761u) >> (32 - kHashBits);
+	}
+
+	// 单个固定哈夫曼块的zlib数据流
+	void ZlibCompress(const std::vector<uint8_t>& data, std::vector<uint8_t>& out)
+	{
+		out.push_back(0x78);
+		out.push_back(0x01);
+
+		BitWriter bw(out);
+		bw.Write(1, 1);		// BFINAL
+		bw.Write(1, 2);		// BTYPE = 01，固定哈夫曼
+
+		const uint32_t size = (uint32_t)data.size();
+		std::vector<int32_t> head((size_t)1 << kHashBits, -1);
+		std::vector<int32_t> prev(size, -1);
+		auto insert = [&](uint32_t pos)
+		{
+			if (pos + kMinMatch <= size)
+			{
+				uint32_t h = Hash3(&data[pos]);
+				prev[pos] = head[h];
+				head[h] = (int32_t)pos;
+			}
+		};
+
+		uint32_t pos = 0;
+		while (pos < size)
+		{
+			uint32_t bestLength = 0, bestDistance = 0;
+			if (pos + kMinMatch <= size)
+			{
+				uint32_t maxLength = size - pos < kMaxMatch ? size - pos : kMaxMatch;
+				int32_t candidate = head[Hash3(&data[pos])];
+				for (uint32_t chain = 0; candidate >= 0 && chain < kMaxChain; ++chain, candidate = prev[candidate])
+				{
+					uint32_t distance = pos - (uint32_t)candidate;
+					if (distance > kWindowSize)
+						break;
+					uint32_t length = 0;
+					while (length < maxLength && data[candidate + length] == data[pos + length])
+						++length;
+					if (length > bestLength)
+					{
+						bestLength = length;
+						bestDistance = distance;
+						if (length == maxLength)
+							break;
+					}
+				}
+			}
+
+			if (bestLength >= kMinMatch)
+			{
+				WriteMatch(bw, bestLength, bestDistance);
+				for (uint32_t i = 0; i < bestLength; ++i)
+					insert(pos + i);
+				pos += bestLength;
+			}
+			else
+			{
+				WriteLiteralLength(bw, data[pos]);
+				insert(pos);
+				++pos;
+			}
+		}
+		WriteLiteralLength(bw, 256);	// 块结束
+		bw.Flush();
+
+		uint32_t a = 1, b = 0;
+		for (uint8_t v : data)
+		{
+			a = (a + v) % 65521;
+			b = (b + a) % 65521;
+		}
+		uint32_t adler = (b << 16) | a;
+		for (int shift = 24; shift >= 0; shift -= 8)
+			out.push_back((uint8_t)(adler >> shift));
+	}
+
+	struct CrcTable
+	{
+		uint32_t entries[256];
+
+		CrcTable()
+		{
+			for (uint32_t n = 0; n < 256; ++n)
+			{
+				uint32_t c = n;
+				for (int k = 0; k < 8; ++k)
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				entries[n] = c;
+			}
+		}
+	};
+
+	uint32_t Crc32(const uint8_t* p, size_t size, uint32_t crc = 0)
+	{
+		static const CrcTable table;	// 局部静态变量的初始化是线程安全的
+		crc = ~crc;
+		for (size_t i = 0; i < size; ++i)
+			crc = table.entries[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	// deflate解码的位流，低位在前。读到末尾之后返回0并记录溢出
+	class BitReader
+	{
+	public:
+		BitReader(const uint8_t* p, size_t size) : m_p(p), m_Size(size), m_Pos(0), m_Bits(0), m_Count(0), m_Overrun(false) {}
+
+		uint32_t Read(uint32_t count)
+		{
+			while (m_Count < count)
+			{
+				uint32_t byte = 0;
+				if (m_Pos < m_Size)
+					byte = m_p[m_Pos++];
+				else
+					m_Overrun = true;
+				m_Bits |= byte << m_Count;
+				m_Count += 8;
+			}
+			uint32_t value = m_Bits & ((1u << count) - 1);
+			m_Bits >>= count;
+			m_Count -= count;
+			return value;
+		}
+
+		// 存储块从字节边界开始
+		void AlignToByte()
+		{
+			m_Bits = 0;
+			m_Count = 0;
+		}
+
+		bool ReadBytes(std::vector<uint8_t>& out, size_t count)
+		{
+			if (m_Pos + count > m_Size)
+				return false;
+			out.insert(out.end(), m_p + m_Pos, m_p + m_Pos + count);
+			m_Pos += count;
+			return true;
+		}
+
+		bool Overrun() const { return m_Overrun; }
+
+	private:
+		const uint8_t* m_p;
+		size_t m_Size;
+		size_t m_Pos;
+		uint32_t m_Bits;
+		uint32_t m_Count;
+		bool m_Overrun;
+	};
+
+	// 范式哈夫曼码表：各码长的码字个数和按码字排序的符号
+	struct Huffman
+	{
+		uint16_t counts[16];
+		uint16_t symbols[288];
+
+		bool Build(const uint8_t* lengths, uint32_t count)
+		{
+			uint16_t offsets[16];
+			std::fill(counts, counts + 16, (uint16_t)0);
+			for (uint32_t i = 0; i < count; ++i)
+				++counts[lengths[i]];
+			counts[0] = 0;
+			// 码字不能超额
+			int left = 1;
+			for (int len = 1; len < 16; ++len)
+			{
+				left = (left << 1) - counts[len];
+				if (left < 0)
+					return false;
+			}
+			offsets[1] = 0;
+			for (int len = 1; len < 15; ++len)
+				offsets[len + 1] = offsets[len] + counts[len];
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				if (lengths[i])
+					symbols[offsets[lengths[i]]++] = (uint16_t)i;
+			}
+			return true;
+		}
+
+		// 逐位比较，码字高位在前
+		int Decode(BitReader& br) const
+		{
+			int code = 0, first = 0, index = 0;
+			for (int len = 1; len < 16; ++len)
+			{
+				code |= (int)br.Read(1);
+				int count = counts[len];
+				if (code - first < count)
+					return symbols[index + code - first];
+				index += count;
+				first = (first + count) << 1;
+				code <<= 1;
+			}
+			return -1;
+		}
+	};
+
+	bool InflateBlock(BitReader& br, const Huffman& litLen, const Huffman& dist, std::vector<uint8_t>& out)
+	{
+		for (;;)
+		{
+			int symbol = litLen.Decode(br);
+			if (symbol < 0 || br.Overrun())
+				return false;
+			if (symbol < 256)
+			{
+				out.push_back((uint8_t)symbol);
+				continue;
+			}
+			if (symbol == 256)
+				return true;
+			symbol -= 257;
+			if (symbol >= 29)
+				return false;
+			uint32_t length = s_LengthBase[symbol] + br.Read(s_LengthExtra[symbol]);
+			int distSymbol = dist.Decode(br);
+			if (distSymbol < 0 || distSymbol >= 30)
+				return false;
+			uint32_t distance = s_DistBase[distSymbol] + br.Read(s_DistExtra[distSymbol]);
+			if (distance > out.size())
+				return false;
+			// 距离可能小于长度，逐字节复制
+			size_t from = out.size() - distance;
+			for (uint32_t i = 0; i < length; ++i)
+				out.push_back(out[from + i]);
+		}
+	}
+
+	bool ZlibDecompress(const std::vector<uint8_t>& data, std::vector<uint8_t>& out)
+	{
+		if (data.size() < 6 || (data[0] & 0x0F) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20))
+			return false;
+		BitReader br(data.data() + 2, data.size() - 2);
+
+		Huffman fixedLitLen, fixedDist;
+		uint8_t lengths[320];
+		std::fill(lengths, lengths + 144, (uint8_t)8);
+		std::fill(lengths + 144, lengths + 256, (uint8_t)9);
+		std::fill(lengths + 256, lengths + 280, (uint8_t)7);
+		std::fill(lengths + 280, lengths + 288, (uint8_t)8);
+		fixedLitLen.Build(lengths, 288);
+		std::fill(lengths, lengths + 30, (uint8_t)5);
+		fixedDist.Build(lengths, 30);
+
+		bool last = false;
+		while (!last)
+		{
+			last = br.Read(1) != 0;
+			uint32_t type = br.Read(2);
+			if (type == 0)
+			{
+				br.AlignToByte();
+				uint32_t len = br.Read(16);
+				uint32_t nlen = br.Read(16);
+				if ((len ^ 0xFFFF) != nlen || !br.ReadBytes(out, len))
+					return false;
+			}
+			else if (type == 1)
+			{
+				if (!InflateBlock(br, fixedLitLen, fixedDist, out))
+					return false;
+			}
+			else if (type == 2)
+			{
+				// 动态哈夫曼：先读码长的码表，再用它解出字面量/长度和距离的码长
+				static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+				uint32_t litCount = br.Read(5) + 257;
+				uint32_t distCount = br.Read(5) + 1;
+				uint32_t codeCount = br.Read(4) + 4;
+				if (litCount > 286 || distCount > 30)
+					return false;
+				std::fill(lengths, lengths + 19, (uint8_t)0);
+				for (uint32_t i = 0; i < codeCount; ++i)
+					lengths[order[i]] = (uint8_t)br.Read(3);
+				Huffman lenCode;
+				if (!lenCode.Build(lengths, 19))
+					return false;
+
+				uint32_t index = 0;
+				while (index < litCount + distCount)
+				{
+					int symbol = lenCode.Decode(br);
+					if (symbol < 0 || br.Overrun())
+						return false;
+					if (symbol < 16)
+					{
+						lengths[index++] = (uint8_t)symbol;
+						continue;
+					}
+					uint8_t value = 0;
+					uint32_t repeat;
+					if (symbol == 16)
+					{
+						if (index == 0)
+							return false;
+						value = lengths[index - 1];
+						repeat = 3 + br.Read(2);
+					}
+					else if (symbol == 17)
+						repeat = 3 + br.Read(3);
+					else
+						repeat = 11 + br.Read(7);
+					if (index + repeat > litCount + distCount)
+						return false;
+					std::fill(lengths + index, lengths + index + repeat, value);
+					index += repeat;
+				}
+				Huffman litLen, dist;
+				if (!litLen.Build(lengths, litCount) || !dist.Build(lengths + litCount, distCount) ||
+					!InflateBlock(br, litLen, dist, out))
+					return false;
+			}
+			else
+			{
+				return false;
+			}
+			if (br.Overrun())
+				return false;
+		}
+		return true;
+	}
+
+	uint32_t ReadBigEndian(const uint8_t* p)
+	{
+		return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+	}
+
+	uint8_t Paeth(int a, int b, int c)
+	{
+		int p = a + b - c;
+		int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+		if (pa <= pb && pa <= pc)
+			return (uint8_t)a;
+		return (uint8_t)(pb <= pc ? b : c);
+	}
+
+	void WriteChunk(std::ofstream& fout, const char type[4], const std::vector<uint8_t>& data)
+	{
+		uint8_t header[8];
+		uint32_t size = (uint32_t)data.size();
+		for (int i = 0; i < 4; ++i)
+		{
+			header[i] = (uint8_t)(size >> (24 - 8 * i));
+			header[4 + i] = (uint8_t)type[i];
+		}
+		uint32_t crc = Crc32(header + 4, 4);
+		if (!data.empty())
+			crc = Crc32(data.data(), data.size(), crc);
+		uint8_t footer[4];
+		for (int i = 0; i < 4; ++i)
+			footer[i] = (uint8_t)(crc >> (24 - 8 * i));
+
+		fout.write(reinterpret_cast<const char*>(header), 8);
+		if (!data.empty())
+			fout.write(reinterpret_cast<const char*>(data.data()), data.size());
+		fout.write(reinterpret_cast<const char*>(footer), 4);
+	}
+}
+
+bool SavePng(const char* fileName, const std::vector<uint32_t>& pixels, uint32_t width, uint32_t height)
+{
+	if (width == 0 || height == 0 || pixels.size() < (size_t)width * height)
+		return false;
+	std::ofstream fout(fileName, std::ios::binary);
+	if (!fout)
+		return false;
+
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+	fout.write(reinterpret_cast<const char*>(signature), 8);
+
+	// 8位RGBA，不隔行
+	std::vector<uint8_t> ihdr(13, 0);
+	for (int i = 0; i < 4; ++i)
+	{
+		ihdr[i] = (uint8_t)(width >> (24 - 8 * i));
+		ihdr[4 + i] = (uint8_t)(height >> (24 - 8 * i));
+	}
+	ihdr[8] = 8;
+	ihdr[9] = 6;
+	WriteChunk(fout, "IHDR", ihdr);
+
+	// 每行前加一个过滤类型字节(0，不过滤)，纯色区域由LZ77按4字节的距离匹配
+	std::vector<uint8_t> raw;
+	raw.reserve((size_t)(width * 4 + 1) * height);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		raw.push_back(0);
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			uint32_t c = pixels[(size_t)y * width + x];
+			raw.push_back((uint8_t)c);
+			raw.push_back((uint8_t)(c >> 8));
+			raw.push_back((uint8_t)(c >> 16));
+			raw.push_back((uint8_t)(c >> 24));
+		}
+	}
+	std::vector<uint8_t> idat;
+	ZlibCompress(raw, idat);
+	WriteChunk(fout, "IDAT", idat);
+	WriteChunk(fout, "IEND", std::vector<uint8_t>());
+	return (bool)fout;
+}
+
+bool LoadPng(const char* fileName, std::vector<uint32_t>& pixels, uint32_t& width, uint32_t& height)
+{
+	std::ifstream fin(fileName, std::ios::binary);
+	if (!fin)
+		return false;
+	std::vector<uint8_t> file((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+	if (file.size() < 8 || !std::equal(signature, signature + 8, file.begin()))
+		return false;
+
+	// 依次读取各个块，IDAT可能有多个，拼接后再解压
+	std::vector<uint8_t> idat;
+	uint32_t channels = 0;
+	width = height = 0;
+	size_t pos = 8;
+	while (pos + 12 <= file.size())
+	{
+		uint32_t size = ReadBigEndian(&file[pos]);
+		if (size > file.size() - pos - 12)
+			return false;
+		const uint8_t* type = &file[pos + 4];
+		const uint8_t* data = &file[pos + 8];
+		if (Crc32(type, size + 4) != ReadBigEndian(data + size))
+			return false;
+		if (std::equal(type, type + 4, "IHDR"))
+		{
+			if (size != 13)
+				return false;
+			width = ReadBigEndian(data);
+			height = ReadBigEndian(data + 4);
+			// 8位深度，颜色类型2(RGB)或6(RGBA)，标准压缩和过滤，不隔行
+			if (data[8] != 8 || (data[9] != 2 && data[9] != 6) || data[10] != 0 || data[11] != 0 || data[12] != 0)
+				return false;
+			channels = data[9] == 6 ? 4 : 3;
+		}
+		else if (std::equal(type, type + 4, "IDAT"))
+		{
+			idat.insert(idat.end(), data, data + size);
+		}
+		else if (std::equal(type, type + 4, "IEND"))
+		{
+			break;
+		}
+		pos += size + 12;
+	}
+	if (channels == 0 || width == 0 || height == 0)
+		return false;
+
+	std::vector<uint8_t> raw;
+	const size_t stride = (size_t)width * channels;
+	raw.reserve((stride + 1) * height);
+	if (!ZlibDecompress(idat, raw) || raw.size() < (stride + 1) * height)
+		return false;
+
+	// 逐行反过滤，left/up/upLeft为同一通道在左侧、上方和左上方的字节
+	std::vector<uint8_t> prev(stride, 0), cur(stride);
+	pixels.resize((size_t)width * height);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		const uint8_t* pRow = &raw[y * (stride + 1)];
+		uint8_t filter = pRow[0];
+		if (filter > 4)
+			return false;
+		for (size_t i = 0; i < stride; ++i)
+		{
+			int left = i >= channels ? cur[i - channels] : 0;
+			int up = prev[i];
+			int upLeft = i >= channels ? prev[i - channels] : 0;
+			int predictor = 0;
+			switch (filter)
+			{
+			case 1: predictor = left; break;
+			case 2: predictor = up; break;
+			case 3: predictor = (left + up) / 2; break;
+			case 4: predictor = Paeth(left, up, upLeft); break;
+			}
+			cur[i] = (uint8_t)(pRow[1 + i] + predictor);
+		}
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			const uint8_t* p = &cur[(size_t)x * channels];
+			uint32_t alpha = channels == 4 ? p[3] : 0xFF;
+			pixels[(size_t)y * width + x] = p[0] | (p[1] << 8) | (p[2] << 16) | (alpha << 24);
+		}
+		prev.swap(cur);
+	}
+	return true;
+}
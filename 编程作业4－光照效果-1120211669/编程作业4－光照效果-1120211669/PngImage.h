@@ -0,0 +1,14 @@
+#ifndef PNGIMAGE_H
+#define PNGIMAGE_H
+
+#include <cstdint>
+#include <vector>
+
+// 把按行存放的RGBA8(R在最低字节，与DXGI_FORMAT_R8G8B8A8_UNORM一致)保存为PNG。
+// 压缩只用固定哈夫曼编码加简单的LZ77匹配，大片纯色的渲染结果能压缩到很小
+bool SavePng(const char* fileName, const std::vector<uint32_t>& pixels, uint32_t width, uint32_t height);
+// 读取8位RGB或RGBA、不隔行的PNG，支持全部过滤类型和三种deflate块，结果与SavePng的输入格式相同。
+// 其余格式(调色板、16位、隔行等)返回false
+bool LoadPng(const char* fileName, std::vector<uint32_t>& pixels, uint32_t& width, uint32_t& height);
+
+#endif
@@ -0,0 +1,471 @@
+#include "ShadowMap.h"
+#include "JobSystem.h"
+#include "SoftSimd.h"
+#include "Geometry.h"
+#include "CounterRng.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace DirectX;
+using namespace SoftSimd;
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	double SecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	// 与LightClusterGrid::kSpotCutoff相同，聚光因子低于该值的部分不在阴影贴图中
+	const float kSpotCutoff = 1.0f / 256.0f;
+}
+
+ShadowMap::ShadowMap()
+	: m_Size(0),
+	m_Pitch(0),
+	m_Tiles(0),
+	m_pJobs(nullptr),
+	m_DepthBias(0.0005f),
+	m_SlopeScaledBias(1.5f),
+	m_ViewProj(),
+	m_Stats()
+{
+}
+
+void ShadowMap::Resize(uint32_t size)
+{
+	if (size == m_Size)
+		return;
+	m_Size = size;
+	m_Pitch = (size + 7) & ~7u;
+	m_Tiles = (size + kTileSize - 1) / kTileSize;
+	m_Depth.assign((size_t)m_Pitch * size, 1.0f);
+	for (Group& group : m_Groups)
+		group.bins.assign((size_t)m_Tiles * m_Tiles, std::vector<uint32_t>());
+}
+
+void ShadowMap::SetJobSystem(JobSystem* pJobs)
+{
+	m_pJobs = pJobs;
+}
+
+void ShadowMap::SetDepthBias(float bias, float slopeScaledBias)
+{
+	m_DepthBias = bias;
+	m_SlopeScaledBias = slopeScaledBias;
+}
+
+void XM_CALLCONV ShadowMap::Begin(FXMMATRIX lightViewProj)
+{
+	XMStoreFloat4x4(&m_ViewProj, lightViewProj);
+
+	// 每个线程两个任务，实例分布不均时可以互相窃取
+	uint32_t groupCount = m_pJobs ? m_pJobs->GetThreadCount() * 2 : 1;
+	if (groupCount != m_Groups.size())
+	{
+		m_Groups.resize(groupCount);
+		for (Group& group : m_Groups)
+			group.bins.assign((size_t)m_Tiles * m_Tiles, std::vector<uint32_t>());
+	}
+	for (Group& group : m_Groups)
+	{
+		group.triangles.clear();
+		group.trianglesRasterized = 0;
+	}
+}
+
+void ShadowMap::DrawInstanced(const XMFLOAT3* pPositions, uint32_t vertexCount, const uint16_t* pIndices, uint32_t indexCount,
+	const XMFLOAT4X4* pWorlds, uint32_t worldStride, uint32_t instanceCount)
+{
+	if (m_Groups.empty() || m_Size == 0 || indexCount < 3)
+		return;
+	Clock::time_point start = Clock::now();
+
+	XMMATRIX viewProj = XMLoadFloat4x4(&m_ViewProj);
+	uint32_t groupCount = (uint32_t)m_Groups.size();
+	uint32_t triangleCount = indexCount / 3;
+	auto transformGroups = [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t g = begin; g < end; ++g)
+		{
+			// 每个任务处理连续的一段实例，三角形和分块列表只写入自己的Group
+			Group& group = m_Groups[g];
+			uint32_t first = (uint32_t)((uint64_t)instanceCount * g / groupCount);
+			uint32_t last = (uint32_t)((uint64_t)instanceCount * (g + 1) / groupCount);
+			group.clipPositions.resize(vertexCount);
+			for (uint32_t i = first; i < last; ++i)
+			{
+				const XMFLOAT4X4& world = *reinterpret_cast<const XMFLOAT4X4*>(reinterpret_cast<const char*>(pWorlds) + (size_t)i * worldStride);
+				XMMATRIX WVP = XMMatrixTranspose(XMLoadFloat4x4(&world)) * viewProj;
+				for (uint32_t v = 0; v < vertexCount; ++v)
+					XMStoreFloat4(&group.clipPositions[v], XMVector3Transform(XMLoadFloat3(&pPositions[v]), WVP));
+
+				for (uint32_t t = 0; t < triangleCount; ++t)
+				{
+					const XMFLOAT4* pVerts[3];
+					uint32_t outside = 0x3F;	// 三个顶点都在同一个裁剪平面外侧时直接剔除
+					bool needClip = false;
+					for (uint32_t k = 0; k < 3; ++k)
+					{
+						const XMFLOAT4& p = group.clipPositions[pIndices[t * 3 + k]];
+						pVerts[k] = &p;
+						uint32_t code = (p.x < -p.w ? 1u : 0u) | (p.x > p.w ? 2u : 0u) | (p.y < -p.w ? 4u : 0u) |
+							(p.y > p.w ? 8u : 0u) | (p.z < 0.0f ? 16u : 0u) | (p.z > p.w ? 32u : 0u);
+						outside &= code;
+						needClip = needClip || (code & 16u);
+					}
+					if (outside)
+						continue;
+					if (needClip)
+						ClipTriangle(group, pVerts);
+					else
+						SetupTriangle(group, pVerts);
+				}
+			}
+		}
+	};
+	if (m_pJobs && groupCount > 1)
+		m_pJobs->ParallelFor(groupCount, 1, transformGroups);
+	else
+		transformGroups(0, groupCount);
+
+	m_Stats.instances += instanceCount;
+	m_Stats.trianglesSubmitted += (uint64_t)triangleCount * instanceCount;
+	m_Stats.transformSeconds += SecondsSince(start);
+}
+
+void ShadowMap::End()
+{
+	if (m_Groups.empty() || m_Size == 0)
+		return;
+	Clock::time_point start = Clock::now();
+
+	// 清空深度也在各分块中进行
+	uint32_t tileCount = m_Tiles * m_Tiles;
+	auto rasterRange = [this](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t tile = begin; tile < end; ++tile)
+			RasterizeTile(tile);
+	};
+	if (m_pJobs)
+		m_pJobs->ParallelFor(tileCount, 1, rasterRange);
+	else
+		rasterRange(0, tileCount);
+
+	for (Group& group : m_Groups)
+	{
+		m_Stats.trianglesRasterized += group.trianglesRasterized;
+		group.trianglesRasterized = 0;
+		group.triangles.clear();
+	}
+	m_Stats.rasterSeconds += SecondsSince(start);
+}
+
+float XM_CALLCONV ShadowMap::SampleVisibility(FXMVECTOR posW) const
+{
+	if (m_Size == 0)
+		return 1.0f;
+	XMFLOAT4 p;
+	XMStoreFloat4(&p, XMVector3Transform(posW, XMLoadFloat4x4(&m_ViewProj)));
+	if (p.w <= 0.0f)
+		return 1.0f;
+	float invW = 1.0f / p.w;
+	float ndcX = p.x * invW, ndcY = p.y * invW, depth = p.z * invW;
+	if (ndcX < -1.0f || ndcX > 1.0f || ndcY < -1.0f || ndcY > 1.0f || depth > 1.0f)
+		return 1.0f;
+
+	// 纹理坐标按纹素中心对齐，与D3D的采样位置一致
+	float u = (ndcX * 0.5f + 0.5f) * m_Size - 0.5f;
+	float v = (-ndcY * 0.5f + 0.5f) * m_Size - 0.5f;
+	int32_t last = (int32_t)m_Size - 1;
+	auto texel = [&](int32_t x, int32_t y)
+	{
+		x = std::min(std::max(x, 0), last);
+		y = std::min(std::max(y, 0), last);
+		return depth <= m_Depth[(size_t)y * m_Pitch + x] ? 1.0f : 0.0f;
+	};
+
+	// 3x3个偏移一个纹素的位置，每个位置比较相邻的4个纹素再双线性插值
+	float lit = 0.0f;
+	for (int32_t dy = -1; dy <= 1; ++dy)
+	{
+		for (int32_t dx = -1; dx <= 1; ++dx)
+		{
+			float fx = std::floor(u + dx), fy = std::floor(v + dy);
+			float tx = u + dx - fx, ty = v + dy - fy;
+			int32_t x = (int32_t)fx, y = (int32_t)fy;
+			float top = texel(x, y) + (texel(x + 1, y) - texel(x, y)) * tx;
+			float bottom = texel(x, y + 1) + (texel(x + 1, y + 1) - texel(x, y + 1)) * tx;
+			lit += top + (bottom - top) * ty;
+		}
+	}
+	return lit * (1.0f / 9.0f);
+}
+
+uint32_t ShadowMap::GetSize() const
+{
+	return m_Size;
+}
+
+XMMATRIX XM_CALLCONV ShadowMap::GetViewProj() const
+{
+	return XMLoadFloat4x4(&m_ViewProj);
+}
+
+void ShadowMap::ReadDepth(std::vector<float>& depth) const
+{
+	depth.resize((size_t)m_Size * m_Size);
+	for (uint32_t y = 0; y < m_Size; ++y)
+		std::copy_n(&m_Depth[(size_t)y * m_Pitch], m_Size, &depth[(size_t)y * m_Size]);
+}
+
+const ShadowMapStats& ShadowMap::GetStats() const
+{
+	return m_Stats;
+}
+
+void ShadowMap::ResetStats()
+{
+	m_Stats = ShadowMapStats();
+}
+
+XMMATRIX XM_CALLCONV ShadowMap::BuildDirectionalViewProj(const DirectionalLight& light, FXMVECTOR center, float radius)
+{
+	// 光源放在球外，球正好位于[radius, 3 * radius]的深度范围内
+	XMVECTOR dir = XMVector3Normalize(XMLoadFloat3(&light.direction));
+	XMVECTOR up = std::fabs(XMVectorGetY(dir)) > 0.99f ? XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	XMMATRIX view = XMMatrixLookToLH(center - dir * (2.0f * radius), dir, up);
+	return view * XMMatrixOrthographicLH(2.0f * radius, 2.0f * radius, radius, 3.0f * radius);
+}
+
+XMMATRIX XM_CALLCONV ShadowMap::BuildSpotViewProj(const SpotLight& light, float nearZ)
+{
+	// 半角限制在60度以内，更宽的聚光灯只有中间部分有阴影
+	float cosAngle = light.spot > 0.0f ? std::pow(kSpotCutoff, 1.0f / light.spot) : 0.0f;
+	float halfAngle = std::min(std::max(std::acos(cosAngle), 0.01f), XM_PI / 3.0f);
+	XMVECTOR dir = XMVector3Normalize(XMLoadFloat3(&light.direction));
+	XMVECTOR up = std::fabs(XMVectorGetY(dir)) > 0.99f ? XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	XMMATRIX view = XMMatrixLookToLH(XMLoadFloat3(&light.position), dir, up);
+	return view * XMMatrixPerspectiveFovLH(2.0f * halfAngle, 1.0f, nearZ, std::max(light.range, 2.0f * nearZ));
+}
+
+void ShadowMap::ClipTriangle(Group& group, const XMFLOAT4* pVerts[3]) const
+{
+	// Sutherland-Hodgman，只裁剪近平面z >= 0，其余平面由包围盒处理，远平面外的深度不会小于清空值
+	XMFLOAT4 poly[4];
+	uint32_t count = 0;
+	for (uint32_t k = 0; k < 3; ++k)
+	{
+		const XMFLOAT4& a = *pVerts[k];
+		const XMFLOAT4& b = *pVerts[(k + 1) % 3];
+		bool aInside = a.z >= 0.0f;
+		bool bInside = b.z >= 0.0f;
+		if (aInside)
+			poly[count++] = a;
+		if (aInside != bInside)
+		{
+			float t = a.z / (a.z - b.z);
+			XMVECTOR posA = XMLoadFloat4(&a);
+			XMStoreFloat4(&poly[count], posA + (XMLoadFloat4(&b) - posA) * t);
+			poly[count++].z = 0.0f;
+		}
+	}
+	for (uint32_t k = 2; k < count; ++k)
+	{
+		const XMFLOAT4* pTri[3] = { &poly[0], &poly[k - 1], &poly[k] };
+		SetupTriangle(group, pTri);
+	}
+}
+
+void ShadowMap::SetupTriangle(Group& group, const XMFLOAT4* pVerts[3]) const
+{
+	float sx[3], sy[3], sz[3];
+	for (uint32_t k = 0; k < 3; ++k)
+	{
+		const XMFLOAT4& p = *pVerts[k];
+		if (p.w <= 0.0f)
+			return;
+		float invW = 1.0f / p.w;
+		sx[k] = (p.x * invW * 0.5f + 0.5f) * m_Size;
+		sy[k] = (-p.y * invW * 0.5f + 0.5f) * m_Size;
+		sz[k] = p.z * invW;
+	}
+
+	// 与SoftRasterizer相同的边函数，第i条边从顶点i+1到顶点i+2
+	double A[3], B[3], C[3];
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		uint32_t a = (i + 1) % 3, b = (i + 2) % 3;
+		A[i] = (double)sy[b] - sy[a];
+		B[i] = (double)sx[a] - sx[b];
+		C[i] = -A[i] * sx[a] - B[i] * sy[a];
+	}
+	double area = A[0] * sx[0] + B[0] * sy[0] + C[0];
+	if (area == 0.0)
+		return;
+	double sign = area < 0.0 ? -1.0 : 1.0;
+
+	TriangleSetup tri;
+	float minX = std::min(std::min(sx[0], sx[1]), sx[2]);
+	float maxX = std::max(std::max(sx[0], sx[1]), sx[2]);
+	float minY = std::min(std::min(sy[0], sy[1]), sy[2]);
+	float maxY = std::max(std::max(sy[0], sy[1]), sy[2]);
+	float size = (float)m_Size;
+	auto clampToInt = [](float f, float lo, float hi) { return (int32_t)std::min(std::max(f, lo), hi); };
+	tri.minX = clampToInt(std::floor(minX - 0.5f), 0.0f, size);
+	tri.minY = clampToInt(std::floor(minY - 0.5f), 0.0f, size);
+	tri.maxX = clampToInt(std::ceil(maxX - 0.5f), -1.0f, size - 1.0f);
+	tri.maxY = clampToInt(std::ceil(maxY - 0.5f), -1.0f, size - 1.0f);
+	if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+		return;
+
+	tri.topLeftMask = 0;
+	double invArea = 1.0 / (area * sign);
+	double dzdx = 0.0, dzdy = 0.0;
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		tri.edgeA[i] = (float)(A[i] * sign);
+		tri.edgeB[i] = (float)(B[i] * sign);
+		tri.edgeC[i] = C[i] * sign;
+		if (tri.edgeA[i] > 0.0f || (tri.edgeA[i] == 0.0f && tri.edgeB[i] > 0.0f))
+			tri.topLeftMask |= 1u << i;
+		dzdx += A[i] * sign * invArea * sz[i];
+		dzdy += B[i] * sign * invArea * sz[i];
+	}
+	// 三个边函数之和恒为面积，每个顶点的深度加上同样的偏移即为整个平面加上偏移
+	double bias = m_DepthBias + m_SlopeScaledBias * std::max(std::fabs(dzdx), std::fabs(dzdy));
+	for (uint32_t i = 0; i < 3; ++i)
+		tri.z[i] = (float)((sz[i] + bias) * invArea);
+
+	uint32_t index = (uint32_t)group.triangles.size();
+	group.triangles.push_back(tri);
+	++group.trianglesRasterized;
+	for (uint32_t ty = tri.minY / kTileSize; ty <= tri.maxY / kTileSize; ++ty)
+	{
+		for (uint32_t tx = tri.minX / kTileSize; tx <= tri.maxX / kTileSize; ++tx)
+			group.bins[ty * m_Tiles + tx].push_back(index);
+	}
+}
+
+void ShadowMap::RasterizeTile(uint32_t tile)
+{
+	const int32_t tileX0 = (int32_t)(tile % m_Tiles * kTileSize);
+	const int32_t tileY0 = (int32_t)(tile / m_Tiles * kTileSize);
+	const int32_t tileX1 = std::min(tileX0 + (int32_t)kTileSize, (int32_t)m_Size) - 1;
+	const int32_t tileY1 = std::min(tileY0 + (int32_t)kTileSize, (int32_t)m_Size) - 1;
+	for (int32_t y = tileY0; y <= tileY1; ++y)
+		std::fill_n(&m_Depth[(size_t)y * m_Pitch + tileX0], tileX1 - tileX0 + 1, 1.0f);
+
+	const VFloat laneIndex = VLaneIndex();
+	const VFloat zero = VSplat(0.0f);
+	const VFloat xLimit = VSplat((float)tileX1 + 1.0f);
+	for (Group& group : m_Groups)
+	{
+		std::vector<uint32_t>& bin = group.bins[tile];
+		for (uint32_t triIndex : bin)
+		{
+			const TriangleSetup& tri = group.triangles[triIndex];
+			int32_t xBegin = std::max(tri.minX, tileX0) & ~(int32_t)(kLanes - 1);
+			int32_t xEnd = std::min(tri.maxX, tileX1);
+			int32_t yBegin = std::max(tri.minY, tileY0);
+			int32_t yEnd = std::min(tri.maxY, tileY1);
+
+			const VFloat stepX[3] = {
+				VMul(laneIndex, VSplat(tri.edgeA[0])),
+				VMul(laneIndex, VSplat(tri.edgeA[1])),
+				VMul(laneIndex, VSplat(tri.edgeA[2]))
+			};
+			const VFloat z0 = VSplat(tri.z[0]);
+			const VFloat z1 = VSplat(tri.z[1]);
+			const VFloat z2 = VSplat(tri.z[2]);
+
+			for (int32_t y = yBegin; y <= yEnd; ++y)
+			{
+				float* pDepthRow = &m_Depth[(size_t)y * m_Pitch];
+				double py = y + 0.5;
+				for (int32_t x = xBegin; x <= xEnd; x += kLanes)
+				{
+					double px = x + 0.5;
+					VFloat e[3];
+					VBool inside = VCmpLt(VAdd(VSplat((float)x), laneIndex), xLimit);
+					for (uint32_t i = 0; i < 3; ++i)
+					{
+						e[i] = VAdd(VSplat((float)(tri.edgeA[i] * px + tri.edgeB[i] * py + tri.edgeC[i])), stepX[i]);
+						inside = VAnd(inside, (tri.topLeftMask >> i) & 1 ? VCmpGe(e[i], zero) : VCmpGt(e[i], zero));
+					}
+					if (VMask(inside) == 0)
+						continue;
+
+					VFloat depth = VAdd(VAdd(VMul(e[0], z0), VMul(e[1], z1)), VMul(e[2], z2));
+					VFloat oldDepth = VLoad(pDepthRow + x);
+					inside = VAnd(inside, VCmpLt(depth, oldDepth));
+					if (VMask(inside) != 0)
+						VStore(pDepthRow + x, VSelect(inside, depth, oldDepth));
+				}
+			}
+		}
+		bin.clear();
+	}
+}
+
+void BenchmarkShadowMap(std::ostream& os, const std::vector<uint32_t>& sizes, uint32_t instanceCount, JobSystem* pJobs)
+{
+	// 四棱柱排成正方形网格，高度随机，与HeadlessRender的shadows场景相同的布局。
+	// CreateBox生成的是“磊”字模型，每个有912个三角形，这里用更接近普通场景物体的低多边形网格
+	auto box = Geometry::CreateCylinder<VertexPosNormalColor>(0.6f, 1.0f, 4);
+	std::vector<XMFLOAT3> positions;
+	for (const VertexPosNormalColor& v : box.vertexVec)
+		positions.push_back(v.pos);
+
+	uint32_t gridN = std::max(1u, (uint32_t)std::ceil(std::sqrt((double)instanceCount)));
+	float spacing = 1.5f;
+	float half = 0.5f * spacing * (gridN - 1);
+	CounterRng rng;
+	std::vector<XMFLOAT4X4> worlds(instanceCount);
+	for (uint32_t i = 0; i < instanceCount; ++i)
+	{
+		float height = 0.5f + 3.0f * rng.Float(i, 0);
+		XMMATRIX W = XMMatrixScaling(1.0f, height, 1.0f) *
+			XMMatrixTranslation(spacing * (i % gridN) - half, 0.5f * height, spacing * (i / gridN) - half);
+		XMStoreFloat4x4(&worlds[i], XMMatrixTranspose(W));
+	}
+
+	DirectionalLight light = DirectionalLight();
+	light.direction = XMFLOAT3(-0.577f, -0.577f, 0.577f);
+	XMMATRIX viewProj = ShadowMap::BuildDirectionalViewProj(light, XMVectorZero(), half * 1.5f + 4.0f);
+
+	os << "shadow map  instances " << instanceCount << "  triangles " << (uint64_t)instanceCount * (box.indexVec.size() / 3)
+		<< "  threads " << (pJobs ? pJobs->GetThreadCount() : 1) << "\n";
+	os << "size\tms/map\ttransform ms\traster ms\tMtriangles/s\n";
+	for (uint32_t size : sizes)
+	{
+		ShadowMap shadowMap;
+		shadowMap.SetJobSystem(pJobs);
+		shadowMap.Resize(size);
+
+		// 先渲染一次分配好内存，再取多次中最短的时间
+		double bestMs = 1e30;
+		ShadowMapStats best = ShadowMapStats();
+		for (int r = 0; r < 6; ++r)
+		{
+			shadowMap.ResetStats();
+			shadowMap.Begin(viewProj);
+			shadowMap.DrawInstanced(positions.data(), (uint32_t)positions.size(), box.indexVec.data(), (uint32_t)box.indexVec.size(),
+				worlds.data(), sizeof(XMFLOAT4X4), instanceCount);
+			shadowMap.End();
+			const ShadowMapStats& stats = shadowMap.GetStats();
+			double ms = (stats.transformSeconds + stats.rasterSeconds) * 1000.0;
+			if (r > 0 && ms < bestMs)
+			{
+				bestMs = ms;
+				best = stats;
+			}
+		}
+		os << size << "\t" << bestMs << "\t" << best.transformSeconds * 1000.0 << "\t" << best.rasterSeconds * 1000.0 << "\t"
+			<< best.trianglesSubmitted / (bestMs * 1000.0) << "\n";
+	}
+	os << "\n";
+}
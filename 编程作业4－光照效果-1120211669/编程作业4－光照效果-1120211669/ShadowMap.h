@@ -0,0 +1,112 @@
+#ifndef SHADOWMAP_H
+#define SHADOWMAP_H
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "PortableMath.h"
+#include "LightHelper.h"
+
+class JobSystem;
+
+struct ShadowMapStats
+{
+	uint64_t instances;					// DrawInstanced提交的实例
+	uint64_t trianglesSubmitted;
+	uint64_t trianglesRasterized;		// 经过视锥体外剔除和近平面裁剪后送入分块的三角形
+	double transformSeconds;			// 顶点变换、裁剪和分块
+	double rasterSeconds;				// 各分块的光栅化
+};
+
+// 从光源视角渲染的CPU阴影贴图，只写深度。
+// 顶点只需要位置，每个实例一个世界矩阵；DrawInstanced按实例切分并行变换，每个任务分到自己的分块列表中，
+// End时各分块并行光栅化。深度测试为LESS，只取最小值，结果与提交顺序和线程数无关。
+// 不做背面剔除，自阴影的走样由光栅化时按三角形的深度斜率加上的偏移(同D3D11的SlopeScaledDepthBias)解决。
+// SampleVisibility用3x3个双线性比较采样做PCF，与HLSL中SampleCmpLevelZero配合线性比较过滤器相同
+class ShadowMap
+{
+public:
+	ShadowMap();
+
+	ShadowMap(const ShadowMap&) = delete;
+	ShadowMap& operator=(const ShadowMap&) = delete;
+
+	// 贴图为size x size
+	void Resize(uint32_t size);
+	// 为空则在调用线程中执行
+	void SetJobSystem(JobSystem* pJobs);
+	// 写入的深度加上bias + slopeScaledBias * max(|dz/dx|, |dz/dy|)
+	void SetDepthBias(float bias, float slopeScaledBias);
+
+	// 清空并设置光源的观察投影矩阵(未转置)
+	void XM_CALLCONV Begin(DirectX::FXMMATRIX lightViewProj);
+	// 变换并分块instanceCount个实例，数组只在调用期间使用
+	// [In]pPositions	只有位置的顶点流
+	// [In]pWorlds		第i个实例的世界矩阵位于(const char*)pWorlds + i * worldStride，
+	//					与常量缓冲区的约定相同，存放的是转置后的矩阵
+	void DrawInstanced(const DirectX::XMFLOAT3* pPositions, uint32_t vertexCount, const uint16_t* pIndices, uint32_t indexCount,
+		const DirectX::XMFLOAT4X4* pWorlds, uint32_t worldStride, uint32_t instanceCount);
+	// 光栅化所有已提交的三角形
+	void End();
+
+	// 世界空间中的点被照亮的比例，超出贴图或远平面的部分视为照亮
+	float XM_CALLCONV SampleVisibility(DirectX::FXMVECTOR posW) const;
+
+	uint32_t GetSize() const;
+	DirectX::XMMATRIX XM_CALLCONV GetViewProj() const;
+	// 按行紧密排列的深度
+	void ReadDepth(std::vector<float>& depth) const;
+
+	const ShadowMapStats& GetStats() const;
+	void ResetStats();
+
+	// 方向光的正交投影，覆盖以center为球心、radius为半径的球
+	static DirectX::XMMATRIX XM_CALLCONV BuildDirectionalViewProj(const DirectionalLight& light, DirectX::FXMVECTOR center, float radius);
+	// 聚光灯的透视投影，视角取聚光因子降到1/256的锥角，远平面为range
+	static DirectX::XMMATRIX XM_CALLCONV BuildSpotViewProj(const SpotLight& light, float nearZ);
+
+private:
+	static const uint32_t kTileSize = 64;
+
+	// 深度为屏幕空间的平面z = Σ edge_i * z_i，z_i已经除以面积并加上了偏移
+	struct TriangleSetup
+	{
+		float edgeA[3];
+		float edgeB[3];
+		double edgeC[3];
+		float z[3];
+		int32_t minX, minY, maxX, maxY;	// 裁剪到贴图内的包围盒(含)
+		uint32_t topLeftMask;				// 第i位表示第i条边是左边或上边
+	};
+
+	// DrawInstanced中一个任务的结果，分块时只写自己的列表
+	struct Group
+	{
+		std::vector<TriangleSetup> triangles;
+		std::vector<std::vector<uint32_t>> bins;		// 每个分块中的三角形
+		std::vector<DirectX::XMFLOAT4> clipPositions;	// 当前实例的顶点变换结果
+		uint64_t trianglesRasterized;
+	};
+
+	// 近平面裁剪后得到的多边形拆成三角形送入SetupTriangle
+	void ClipTriangle(Group& group, const DirectX::XMFLOAT4* pVerts[3]) const;
+	void SetupTriangle(Group& group, const DirectX::XMFLOAT4* pVerts[3]) const;
+	void RasterizeTile(uint32_t tile);
+
+private:
+	uint32_t m_Size;
+	uint32_t m_Pitch;						// 每行的像素数，补齐为8的倍数
+	uint32_t m_Tiles;						// 每行的分块数
+	std::vector<float> m_Depth;
+	JobSystem* m_pJobs;
+	float m_DepthBias;
+	float m_SlopeScaledBias;
+	DirectX::XMFLOAT4X4 m_ViewProj;
+	std::vector<Group> m_Groups;
+	ShadowMapStats m_Stats;
+};
+
+// 在不同贴图尺寸下测量instanceCount个四棱柱的阴影贴图生成耗时，结果写入os
+void BenchmarkShadowMap(std::ostream& os, const std::vector<uint32_t>& sizes, uint32_t instanceCount, JobSystem* pJobs);
+
+#endif
@@ -0,0 +1,519 @@
+#include "SoftRasterizer.h"
+#include "JobSystem.h"
+#include "SoftSimd.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+using namespace SoftSimd;
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	double SecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	// 与DXGI_FORMAT_R8G8B8A8_UNORM相同：先截断到[0, 1]，再四舍五入
+	uint32_t PackColor(const XMFLOAT4& c)
+	{
+		auto toByte = [](float f)
+		{
+			f = f < 0.0f ? 0.0f : (f > 1.0f ? 1.0f : f);
+			return (uint32_t)(f * 255.0f + 0.5f);
+		};
+		return toByte(c.x) | (toByte(c.y) << 8) | (toByte(c.z) << 16) | (toByte(c.w) << 24);
+	}
+
+	// 对齐到16字节的常量副本所需的XMFLOAT4个数
+	uint32_t ConstantSlots(uint32_t byteWidth)
+	{
+		return (byteWidth + sizeof(XMFLOAT4) - 1) / sizeof(XMFLOAT4);
+	}
+}
+
+double SoftRenderStats::GetTrianglesPerSecond() const
+{
+	double seconds = vertexSeconds + rasterSeconds;
+	return seconds > 0.0 ? trianglesSubmitted / seconds : 0.0;
+}
+
+double SoftRenderStats::GetPixelsPerSecond() const
+{
+	return rasterSeconds > 0.0 ? pixelsShaded / rasterSeconds : 0.0;
+}
+
+SoftRasterizer::SoftRasterizer()
+	: m_Width(0),
+	m_Height(0),
+	m_Pitch(0),
+	m_TilesX(0),
+	m_TilesY(0),
+	m_pJobs(nullptr),
+	m_pVertices(nullptr),
+	m_VertexStride(0),
+	m_VertexCount(0),
+	m_pIndices16(nullptr),
+	m_pIndices32(nullptr),
+	m_pVS(nullptr),
+	m_pPS(nullptr),
+	m_VSConstants(),
+	m_PSConstants(),
+	m_PSConstantSizes(),
+	m_CullMode(SoftCull_Back),
+	m_Stats()
+{
+}
+
+void SoftRasterizer::Resize(uint32_t width, uint32_t height)
+{
+	m_Width = width;
+	m_Height = height;
+	m_Pitch = (width + 7) & ~7u;
+	m_TilesX = (width + kTileSize - 1) / kTileSize;
+	m_TilesY = (height + kTileSize - 1) / kTileSize;
+	m_Color.assign((size_t)m_Pitch * height, 0);
+	m_Depth.assign((size_t)m_Pitch * height, 1.0f);
+	m_TileBins.assign((size_t)m_TilesX * m_TilesY, std::vector<uint32_t>());
+	m_Triangles.clear();
+	m_RasterVertices.clear();
+	m_Draws.clear();
+	m_Constants.clear();
+}
+
+void SoftRasterizer::SetJobSystem(JobSystem* pJobs)
+{
+	m_pJobs = pJobs;
+}
+
+void SoftRasterizer::ClearRenderTarget(const float color[4])
+{
+	std::fill(m_Color.begin(), m_Color.end(), PackColor(XMFLOAT4(color[0], color[1], color[2], color[3])));
+}
+
+void SoftRasterizer::ClearDepth(float depth)
+{
+	std::fill(m_Depth.begin(), m_Depth.end(), depth);
+}
+
+void SoftRasterizer::IASetVertexBuffer(const void* pVertices, uint32_t stride, uint32_t vertexCount)
+{
+	m_pVertices = static_cast<const uint8_t*>(pVertices);
+	m_VertexStride = stride;
+	m_VertexCount = vertexCount;
+}
+
+void SoftRasterizer::IASetIndexBuffer(const uint16_t* pIndices)
+{
+	m_pIndices16 = pIndices;
+	m_pIndices32 = nullptr;
+}
+
+void SoftRasterizer::IASetIndexBuffer(const uint32_t* pIndices)
+{
+	m_pIndices16 = nullptr;
+	m_pIndices32 = pIndices;
+}
+
+void SoftRasterizer::VSSetShader(const SoftVertexShader* pShader)
+{
+	m_pVS = pShader;
+}
+
+void SoftRasterizer::PSSetShader(const SoftPixelShader* pShader)
+{
+	m_pPS = pShader;
+}
+
+void SoftRasterizer::VSSetConstantBuffer(uint32_t slot, const void* pData, uint32_t byteWidth)
+{
+	(void)byteWidth;
+	if (slot < SoftMaxConstantBuffers)
+		m_VSConstants.slots[slot] = pData;
+}
+
+void SoftRasterizer::PSSetConstantBuffer(uint32_t slot, const void* pData, uint32_t byteWidth)
+{
+	if (slot < SoftMaxConstantBuffers)
+	{
+		m_PSConstants[slot] = pData;
+		m_PSConstantSizes[slot] = pData ? byteWidth : 0;
+	}
+}
+
+void SoftRasterizer::RSSetCullMode(SoftCullMode mode)
+{
+	m_CullMode = mode;
+}
+
+void SoftRasterizer::DrawIndexed(uint32_t indexCount, uint32_t startIndexLocation, int32_t baseVertexLocation)
+{
+	if (!m_pVS || !m_pPS || !m_pVertices || (!m_pIndices16 && !m_pIndices32) || m_TileBins.empty())
+		return;
+	// 大量绘制(如整片森林)时先光栅化已提交的部分，限制等待Flush的数据量，结果不变
+	if (m_Triangles.size() >= kMaxPendingTriangles)
+		Flush();
+	Clock::time_point start = Clock::now();
+
+	auto fetchIndex = [this, baseVertexLocation](uint32_t i)
+	{
+		int32_t index = (int32_t)(m_pIndices16 ? m_pIndices16[i] : m_pIndices32[i]) + baseVertexLocation;
+		return (uint32_t)index;
+	};
+
+	// 只对索引引用到的范围做顶点着色
+	uint32_t minIndex = UINT32_MAX, maxIndex = 0;
+	for (uint32_t i = 0; i < indexCount; ++i)
+	{
+		uint32_t index = fetchIndex(startIndexLocation + i);
+		minIndex = std::min(minIndex, index);
+		maxIndex = std::max(maxIndex, index);
+	}
+	if (indexCount < 3 || maxIndex >= m_VertexCount)
+		return;
+
+	uint32_t shadeCount = maxIndex - minIndex + 1;
+	m_ShadedVertices.resize(shadeCount);
+	const SoftVSFunc vs = m_pVS->func;
+	auto shadeRange = [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+			vs(m_pVertices + (size_t)(minIndex + i) * m_VertexStride, m_VSConstants, m_ShadedVertices[i]);
+	};
+	if (m_pJobs && shadeCount >= 4096)
+		m_pJobs->ParallelFor(shadeCount, 1024, shadeRange);
+	else
+		shadeRange(0, shadeCount);
+
+	RecordDraw();
+
+	// 裁剪、三角形设置和分块按提交顺序串行进行，保证分块内三角形的顺序确定
+	uint32_t varyingCount = std::min(m_pVS->varyingCount, SoftMaxVaryings);
+	uint32_t triangleCount = indexCount / 3;
+	for (uint32_t t = 0; t < triangleCount; ++t)
+	{
+		const SoftVertexOut* pVerts[3];
+		uint32_t outside = 0x3F;	// 三个顶点都在同一个裁剪平面外侧时直接剔除
+		bool needClip = false;
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			pVerts[k] = &m_ShadedVertices[fetchIndex(startIndexLocation + t * 3 + k) - minIndex];
+			const XMFLOAT4& p = pVerts[k]->posH;
+			uint32_t code = (p.x < -p.w ? 1u : 0u) | (p.x > p.w ? 2u : 0u) | (p.y < -p.w ? 4u : 0u) |
+				(p.y > p.w ? 8u : 0u) | (p.z < 0.0f ? 16u : 0u) | (p.z > p.w ? 32u : 0u);
+			outside &= code;
+			needClip = needClip || (code & 16u);
+		}
+		if (outside)
+			continue;
+		if (needClip)
+			ClipTriangle(pVerts, varyingCount);
+		else
+			SetupTriangle(pVerts, varyingCount);
+	}
+
+	++m_Stats.drawCount;
+	m_Stats.trianglesSubmitted += triangleCount;
+	m_Stats.vertexSeconds += SecondsSince(start);
+}
+
+void SoftRasterizer::Flush()
+{
+	if (m_Triangles.empty())
+		return;
+	Clock::time_point start = Clock::now();
+
+	// 常量副本在所有绘制提交后才不再移动，此时才能取指针
+	std::vector<SoftConstantBuffers> drawConstants(m_Draws.size());
+	for (size_t d = 0; d < m_Draws.size(); ++d)
+	{
+		for (uint32_t s = 0; s < SoftMaxConstantBuffers; ++s)
+		{
+			int32_t offset = m_Draws[d].constantOffsets[s];
+			drawConstants[d].slots[s] = offset >= 0 ? &m_Constants[offset] : nullptr;
+		}
+	}
+
+	uint32_t tileCount = m_TilesX * m_TilesY;
+	std::vector<uint64_t> tilePixels(tileCount, 0);
+	auto rasterRange = [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t tile = begin; tile < end; ++tile)
+			tilePixels[tile] = RasterizeTile(tile, drawConstants.data());
+	};
+	if (m_pJobs)
+		m_pJobs->ParallelFor(tileCount, 1, rasterRange);
+	else
+		rasterRange(0, tileCount);
+
+	for (uint32_t tile = 0; tile < tileCount; ++tile)
+	{
+		m_Stats.pixelsShaded += tilePixels[tile];
+		m_TileBins[tile].clear();
+	}
+	m_Stats.trianglesRasterized += m_Triangles.size();
+	m_Triangles.clear();
+	m_RasterVertices.clear();
+	m_Draws.clear();
+	m_Constants.clear();
+	m_Stats.rasterSeconds += SecondsSince(start);
+}
+
+uint32_t SoftRasterizer::GetWidth() const
+{
+	return m_Width;
+}
+
+uint32_t SoftRasterizer::GetHeight() const
+{
+	return m_Height;
+}
+
+void SoftRasterizer::ReadColor(std::vector<uint32_t>& pixels) const
+{
+	pixels.resize((size_t)m_Width * m_Height);
+	for (uint32_t y = 0; y < m_Height; ++y)
+		std::copy_n(&m_Color[(size_t)y * m_Pitch], m_Width, &pixels[(size_t)y * m_Width]);
+}
+
+void SoftRasterizer::ReadDepth(std::vector<float>& depth) const
+{
+	depth.resize((size_t)m_Width * m_Height);
+	for (uint32_t y = 0; y < m_Height; ++y)
+		std::copy_n(&m_Depth[(size_t)y * m_Pitch], m_Width, &depth[(size_t)y * m_Width]);
+}
+
+const SoftRenderStats& SoftRasterizer::GetStats() const
+{
+	return m_Stats;
+}
+
+void SoftRasterizer::ResetStats()
+{
+	m_Stats = SoftRenderStats();
+}
+
+void SoftRasterizer::RecordDraw()
+{
+	DrawRecord record;
+	record.ps = m_pPS->func;
+	record.varyingCount = std::min(m_pVS->varyingCount, SoftMaxVaryings);
+	const DrawRecord* pLast = m_Draws.empty() ? nullptr : &m_Draws.back();
+	for (uint32_t s = 0; s < SoftMaxConstantBuffers; ++s)
+	{
+		uint32_t size = m_PSConstantSizes[s];
+		record.constantSizes[s] = size;
+		record.constantOffsets[s] = -1;
+		if (!m_PSConstants[s])
+			continue;
+		// 大多数绘制之间只有每个物体的常量变化，其余槽位与上一次相同
+		if (pLast && pLast->constantOffsets[s] >= 0 && pLast->constantSizes[s] == size &&
+			memcmp(&m_Constants[pLast->constantOffsets[s]], m_PSConstants[s], size) == 0)
+		{
+			record.constantOffsets[s] = pLast->constantOffsets[s];
+			continue;
+		}
+		size_t offset = m_Constants.size();
+		m_Constants.resize(offset + ConstantSlots(size));
+		memcpy(&m_Constants[offset], m_PSConstants[s], size);
+		record.constantOffsets[s] = (int32_t)offset;
+	}
+	m_Draws.push_back(record);
+}
+
+void SoftRasterizer::ClipTriangle(const SoftVertexOut* pVerts[3], uint32_t varyingCount)
+{
+	// Sutherland-Hodgman，只裁剪近平面z >= 0，其余平面由包围盒和深度范围测试处理
+	SoftVertexOut poly[4];
+	uint32_t count = 0;
+	for (uint32_t k = 0; k < 3; ++k)
+	{
+		const SoftVertexOut& a = *pVerts[k];
+		const SoftVertexOut& b = *pVerts[(k + 1) % 3];
+		bool aInside = a.posH.z >= 0.0f;
+		bool bInside = b.posH.z >= 0.0f;
+		if (aInside)
+			poly[count++] = a;
+		if (aInside != bInside)
+		{
+			float t = a.posH.z / (a.posH.z - b.posH.z);
+			SoftVertexOut& v = poly[count++];
+			XMVECTOR posA = XMLoadFloat4(&a.posH);
+			XMStoreFloat4(&v.posH, posA + (XMLoadFloat4(&b.posH) - posA) * t);
+			v.posH.z = 0.0f;
+			for (uint32_t i = 0; i < varyingCount; ++i)
+				v.varyings[i] = a.varyings[i] + (b.varyings[i] - a.varyings[i]) * t;
+		}
+	}
+	for (uint32_t k = 2; k < count; ++k)
+	{
+		const SoftVertexOut* pTri[3] = { &poly[0], &poly[k - 1], &poly[k] };
+		SetupTriangle(pTri, varyingCount);
+	}
+}
+
+void SoftRasterizer::SetupTriangle(const SoftVertexOut* pVerts[3], uint32_t varyingCount)
+{
+	RasterVertex rv[3];
+	for (uint32_t k = 0; k < 3; ++k)
+	{
+		const XMFLOAT4& p = pVerts[k]->posH;
+		if (p.w <= 0.0f)
+			return;
+		float invW = 1.0f / p.w;
+		rv[k].x = (p.x * invW * 0.5f + 0.5f) * m_Width;
+		rv[k].y = (-p.y * invW * 0.5f + 0.5f) * m_Height;
+		rv[k].z = p.z * invW;
+		rv[k].invW = invW;
+		for (uint32_t i = 0; i < varyingCount; ++i)
+			rv[k].varyings[i] = pVerts[k]->varyings[i] * invW;
+	}
+
+	// 第i条边从顶点i+1到顶点i+2，在double下计算避免细长三角形的面积误差
+	TriangleSetup tri;
+	double A[3], B[3], C[3];
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		const RasterVertex& a = rv[(i + 1) % 3];
+		const RasterVertex& b = rv[(i + 2) % 3];
+		A[i] = (double)b.y - a.y;
+		B[i] = (double)a.x - b.x;
+		C[i] = -A[i] * a.x - B[i] * a.y;
+	}
+	double area = A[0] * rv[0].x + B[0] * rv[0].y + C[0];
+	// y轴朝下的屏幕上顺时针的三角形面积为负，为正面
+	if (area == 0.0 || (m_CullMode == SoftCull_Back && area > 0.0) || (m_CullMode == SoftCull_Front && area < 0.0))
+		return;
+	double sign = area < 0.0 ? -1.0 : 1.0;
+
+	float minX = std::min(std::min(rv[0].x, rv[1].x), rv[2].x);
+	float maxX = std::max(std::max(rv[0].x, rv[1].x), rv[2].x);
+	float minY = std::min(std::min(rv[0].y, rv[1].y), rv[2].y);
+	float maxY = std::max(std::max(rv[0].y, rv[1].y), rv[2].y);
+	// 像素中心在(x + 0.5, y + 0.5)，先限制在视口附近再转为整数，避免溢出
+	auto clampToInt = [](float f, float lo, float hi) { return (int32_t)std::min(std::max(f, lo), hi); };
+	tri.minX = clampToInt(std::floor(minX - 0.5f), 0.0f, (float)m_Width);
+	tri.minY = clampToInt(std::floor(minY - 0.5f), 0.0f, (float)m_Height);
+	tri.maxX = clampToInt(std::ceil(maxX - 0.5f), -1.0f, (float)m_Width - 1.0f);
+	tri.maxY = clampToInt(std::ceil(maxY - 0.5f), -1.0f, (float)m_Height - 1.0f);
+	if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+		return;
+
+	tri.topLeftMask = 0;
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		tri.edgeA[i] = (float)(A[i] * sign);
+		tri.edgeB[i] = (float)(B[i] * sign);
+		tri.edgeC[i] = C[i] * sign;
+		// 内部在右侧的为左边，内部在下方的水平边为上边
+		if (tri.edgeA[i] > 0.0f || (tri.edgeA[i] == 0.0f && tri.edgeB[i] > 0.0f))
+			tri.topLeftMask |= 1u << i;
+	}
+	tri.invArea = (float)(1.0 / (area * sign));
+	tri.firstVertex = (uint32_t)m_RasterVertices.size();
+	tri.draw = (uint32_t)m_Draws.size() - 1;
+	m_RasterVertices.insert(m_RasterVertices.end(), rv, rv + 3);
+
+	uint32_t index = (uint32_t)m_Triangles.size();
+	m_Triangles.push_back(tri);
+	for (uint32_t ty = tri.minY / kTileSize; ty <= tri.maxY / kTileSize; ++ty)
+	{
+		for (uint32_t tx = tri.minX / kTileSize; tx <= tri.maxX / kTileSize; ++tx)
+			m_TileBins[ty * m_TilesX + tx].push_back(index);
+	}
+}
+
+uint64_t SoftRasterizer::RasterizeTile(uint32_t tile, const SoftConstantBuffers* pDrawConstants)
+{
+	const std::vector<uint32_t>& bin = m_TileBins[tile];
+	if (bin.empty())
+		return 0;
+
+	const int32_t tileX0 = (int32_t)(tile % m_TilesX * kTileSize);
+	const int32_t tileY0 = (int32_t)(tile / m_TilesX * kTileSize);
+	const int32_t tileX1 = std::min(tileX0 + (int32_t)kTileSize, (int32_t)m_Width) - 1;
+	const int32_t tileY1 = std::min(tileY0 + (int32_t)kTileSize, (int32_t)m_Height) - 1;
+	const VFloat laneIndex = VLaneIndex();
+	const VFloat zero = VSplat(0.0f);
+	const VFloat one = VSplat(1.0f);
+	// 宽度不是kLanes倍数时，最后一组中超出窗口的像素不参与
+	const VFloat xLimit = VSplat((float)tileX1 + 1.0f);
+
+	uint64_t pixelsShaded = 0;
+	alignas(32) float e0Lanes[kLanes], e1Lanes[kLanes], e2Lanes[kLanes];
+	float varyings[SoftMaxVaryings];
+
+	for (uint32_t triIndex : bin)
+	{
+		const TriangleSetup& tri = m_Triangles[triIndex];
+		const RasterVertex* v = &m_RasterVertices[tri.firstVertex];
+		const DrawRecord& draw = m_Draws[tri.draw];
+		const SoftConstantBuffers& constants = pDrawConstants[tri.draw];
+		const uint32_t varyingCount = draw.varyingCount;
+
+		int32_t xBegin = std::max(tri.minX, tileX0) & ~(int32_t)(kLanes - 1);
+		int32_t xEnd = std::min(tri.maxX, tileX1);
+		int32_t yBegin = std::max(tri.minY, tileY0);
+		int32_t yEnd = std::min(tri.maxY, tileY1);
+
+		const VFloat stepX[3] = {
+			VMul(laneIndex, VSplat(tri.edgeA[0])),
+			VMul(laneIndex, VSplat(tri.edgeA[1])),
+			VMul(laneIndex, VSplat(tri.edgeA[2]))
+		};
+		const VFloat z0 = VSplat(v[0].z * tri.invArea);
+		const VFloat z1 = VSplat(v[1].z * tri.invArea);
+		const VFloat z2 = VSplat(v[2].z * tri.invArea);
+
+		for (int32_t y = yBegin; y <= yEnd; ++y)
+		{
+			float* pDepthRow = &m_Depth[(size_t)y * m_Pitch];
+			uint32_t* pColorRow = &m_Color[(size_t)y * m_Pitch];
+			double py = y + 0.5;
+			for (int32_t x = xBegin; x <= xEnd; x += kLanes)
+			{
+				double px = x + 0.5;
+				VFloat e[3];
+				VBool inside = VCmpLt(VAdd(VSplat((float)x), laneIndex), xLimit);
+				for (uint32_t i = 0; i < 3; ++i)
+				{
+					e[i] = VAdd(VSplat((float)(tri.edgeA[i] * px + tri.edgeB[i] * py + tri.edgeC[i])), stepX[i]);
+					// 左上规则：边上的像素只属于左边和上边
+					inside = VAnd(inside, (tri.topLeftMask >> i) & 1 ? VCmpGe(e[i], zero) : VCmpGt(e[i], zero));
+				}
+				if (VMask(inside) == 0)
+					continue;
+
+				VFloat depth = VAdd(VAdd(VMul(e[0], z0), VMul(e[1], z1)), VMul(e[2], z2));
+				VFloat oldDepth = VLoad(pDepthRow + x);
+				inside = VAnd(inside, VCmpLt(depth, oldDepth));
+				inside = VAnd(inside, VAnd(VCmpGe(depth, zero), VCmpLe(depth, one)));
+				int mask = VMask(inside);
+				if (mask == 0)
+					continue;
+				VStore(pDepthRow + x, VSelect(inside, depth, oldDepth));
+
+				VStore(e0Lanes, e[0]);
+				VStore(e1Lanes, e[1]);
+				VStore(e2Lanes, e[2]);
+				for (uint32_t lane = 0; mask != 0; ++lane, mask >>= 1)
+				{
+					if (!(mask & 1))
+						continue;
+					// 透视校正插值：分量和1/w都在屏幕空间线性插值，再相除
+					float b0 = e0Lanes[lane], b1 = e1Lanes[lane], b2 = e2Lanes[lane];
+					float w = 1.0f / (b0 * v[0].invW + b1 * v[1].invW + b2 * v[2].invW);
+					for (uint32_t i = 0; i < varyingCount; ++i)
+						varyings[i] = (b0 * v[0].varyings[i] + b1 * v[1].varyings[i] + b2 * v[2].varyings[i]) * w;
+					pColorRow[x + lane] = PackColor(draw.ps(varyings, constants));
+					++pixelsShaded;
+				}
+			}
+		}
+	}
+	return pixelsShaded;
+}
@@ -0,0 +1,186 @@
+#ifndef SOFTRASTERIZER_H
+#define SOFTRASTERIZER_H
+
+#include <cstdint>
+#include <vector>
+#include "PortableMath.h"
+
+class JobSystem;
+
+const uint32_t SoftMaxVaryings = 12;			// 顶点着色器输出中需要插值的float个数上限
+const uint32_t SoftMaxConstantBuffers = 6;		// 常量缓冲区槽位数，b0~b3和b5对应HLSL，b4只在CPU端使用
+
+// 顶点着色器的输出：裁剪空间位置和需要插值的分量
+struct SoftVertexOut
+{
+	DirectX::XMFLOAT4 posH;
+	float varyings[SoftMaxVaryings];
+};
+
+// 各槽位绑定的常量缓冲区，数据布局与HLSL的cbuffer相同(矩阵为转置后的)
+struct SoftConstantBuffers
+{
+	const void* slots[SoftMaxConstantBuffers];
+};
+
+// 着色器为普通函数，对应HLSL中的VS和PS
+typedef void (*SoftVSFunc)(const void* pVertex, const SoftConstantBuffers& cb, SoftVertexOut& vOut);
+typedef DirectX::XMFLOAT4 (*SoftPSFunc)(const float* pVaryings, const SoftConstantBuffers& cb);
+
+struct SoftVertexShader
+{
+	SoftVSFunc func;
+	uint32_t varyingCount;		// 实际使用的插值分量数
+};
+
+struct SoftPixelShader
+{
+	SoftPSFunc func;
+};
+
+// 与D3D11_CULL_MODE对应，正面为屏幕上顺时针的三角形(FrontCounterClockwise = false)
+enum SoftCullMode
+{
+	SoftCull_None,
+	SoftCull_Front,
+	SoftCull_Back
+};
+
+struct SoftRenderStats
+{
+	uint64_t drawCount;
+	uint64_t trianglesSubmitted;		// DrawIndexed提交的三角形
+	uint64_t trianglesRasterized;		// 经过裁剪和背面剔除后送入分块的三角形
+	uint64_t pixelsShaded;				// 通过深度测试并执行了像素着色器的像素
+	double vertexSeconds;				// 顶点着色、裁剪和分块
+	double rasterSeconds;				// 各分块的光栅化和像素着色
+
+	double GetTrianglesPerSecond() const;	// 按总耗时计
+	double GetPixelsPerSecond() const;		// 按光栅化耗时计
+};
+
+// 基于分块的软件光栅化器，接口仿照GameApp使用的ID3D11DeviceContext：
+// 绑定顶点/索引缓冲区、常量缓冲区和着色器后调用DrawIndexed。
+// DrawIndexed立即执行顶点着色、近平面裁剪、背面剔除，并把三角形按包围盒分到64x64的屏幕分块中；
+// Flush时各分块并行光栅化，分块内按提交顺序处理三角形，结果与单线程相同。
+// 光栅化时一次用SIMD计算一行中8个(AVX)或4个(SSE)像素的边函数和深度，深度测试为LESS，
+// 覆盖规则为左上规则。像素着色器使用的常量缓冲区在DrawIndexed时复制，之后可以修改
+class SoftRasterizer
+{
+public:
+	SoftRasterizer();
+
+	SoftRasterizer(const SoftRasterizer&) = delete;
+	SoftRasterizer& operator=(const SoftRasterizer&) = delete;
+
+	void Resize(uint32_t width, uint32_t height);
+	// 为空则在调用线程中执行
+	void SetJobSystem(JobSystem* pJobs);
+
+	void ClearRenderTarget(const float color[4]);
+	void ClearDepth(float depth);
+
+	// 缓冲区只保存指针，DrawIndexed返回前需要保持有效
+	void IASetVertexBuffer(const void* pVertices, uint32_t stride, uint32_t vertexCount);
+	void IASetIndexBuffer(const uint16_t* pIndices);
+	void IASetIndexBuffer(const uint32_t* pIndices);
+	void VSSetShader(const SoftVertexShader* pShader);
+	void PSSetShader(const SoftPixelShader* pShader);
+	void VSSetConstantBuffer(uint32_t slot, const void* pData, uint32_t byteWidth);
+	void PSSetConstantBuffer(uint32_t slot, const void* pData, uint32_t byteWidth);
+	void RSSetCullMode(SoftCullMode mode);
+
+	template<class T>
+	void VSSetConstantBuffer(uint32_t slot, const T& data) { VSSetConstantBuffer(slot, &data, sizeof(T)); }
+	template<class T>
+	void PSSetConstantBuffer(uint32_t slot, const T& data) { PSSetConstantBuffer(slot, &data, sizeof(T)); }
+
+	void DrawIndexed(uint32_t indexCount, uint32_t startIndexLocation, int32_t baseVertexLocation);
+	// 光栅化所有已提交的三角形
+	void Flush();
+
+	uint32_t GetWidth() const;
+	uint32_t GetHeight() const;
+	// 按行紧密排列的RGBA8，R在最低字节
+	void ReadColor(std::vector<uint32_t>& pixels) const;
+	void ReadDepth(std::vector<float>& depth) const;
+
+	const SoftRenderStats& GetStats() const;
+	void ResetStats();
+
+private:
+	static const uint32_t kTileSize = 64;
+	static const uint32_t kMaxPendingTriangles = 1u << 18;	// 超过后DrawIndexed先自动Flush
+
+	// 光栅化用的顶点：屏幕坐标、深度、1/w和预先乘以1/w的插值分量
+	struct RasterVertex
+	{
+		float x, y, z, invW;
+		float varyings[SoftMaxVaryings];
+	};
+
+	// 边函数E(x, y) = A * x + B * y + C在三角形内部为正，第i条边与第i个顶点相对，
+	// E_i / (E_0 + E_1 + E_2)即为第i个顶点的重心坐标。C用double保存，近平面附近的大坐标也不会丢失精度
+	struct TriangleSetup
+	{
+		float edgeA[3];
+		float edgeB[3];
+		double edgeC[3];
+		float invArea;
+		int32_t minX, minY, maxX, maxY;	// 裁剪到视口内的包围盒(含)
+		uint32_t firstVertex;				// m_RasterVertices中的3个顶点
+		uint32_t draw;
+		uint32_t topLeftMask;				// 第i位表示第i条边是左边或上边
+	};
+
+	struct DrawRecord
+	{
+		SoftPSFunc ps;
+		uint32_t varyingCount;
+		int32_t constantOffsets[SoftMaxConstantBuffers];	// 在m_Constants中的偏移(以16字节为单位)，-1为未绑定
+		uint32_t constantSizes[SoftMaxConstantBuffers];
+	};
+
+	// 复制当前的像素着色器常量，与上一次绘制相同的部分直接复用
+	void RecordDraw();
+	// 近平面裁剪后得到的多边形拆成三角形送入SetupTriangle
+	void ClipTriangle(const SoftVertexOut* pVerts[3], uint32_t varyingCount);
+	// 透视除法、视口变换、背面剔除，然后分块
+	void SetupTriangle(const SoftVertexOut* pVerts[3], uint32_t varyingCount);
+	uint64_t RasterizeTile(uint32_t tile, const SoftConstantBuffers* pDrawConstants);
+
+private:
+	uint32_t m_Width;
+	uint32_t m_Height;
+	uint32_t m_Pitch;						// 每行的像素数，补齐为8的倍数
+	uint32_t m_TilesX;
+	uint32_t m_TilesY;
+	std::vector<uint32_t> m_Color;
+	std::vector<float> m_Depth;
+	JobSystem* m_pJobs;
+
+	// 当前绑定的状态
+	const uint8_t* m_pVertices;
+	uint32_t m_VertexStride;
+	uint32_t m_VertexCount;
+	const uint16_t* m_pIndices16;
+	const uint32_t* m_pIndices32;
+	const SoftVertexShader* m_pVS;
+	const SoftPixelShader* m_pPS;
+	SoftConstantBuffers m_VSConstants;
+	const void* m_PSConstants[SoftMaxConstantBuffers];
+	uint32_t m_PSConstantSizes[SoftMaxConstantBuffers];
+	SoftCullMode m_CullMode;
+
+	// 本帧已提交、等待Flush的数据
+	std::vector<SoftVertexOut> m_ShadedVertices;			// 当前绘制的顶点着色结果
+	std::vector<RasterVertex> m_RasterVertices;
+	std::vector<TriangleSetup> m_Triangles;
+	std::vector<std::vector<uint32_t>> m_TileBins;			// 每个分块中的三角形
+	std::vector<DrawRecord> m_Draws;
+	std::vector<DirectX::XMFLOAT4> m_Constants;				// 像素着色器常量的副本，按16字节对齐存放
+
+	SoftRenderStats m_Stats;
+};
+
+#endif
@@ -0,0 +1,210 @@
+#include "SoftShaders.h"
+#include "Vertex.h"
+#include "ShadowMap.h"
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// 常量缓冲区中的矩阵是转置后的，读出时转置回来，之后按行向量右乘
+	XMMATRIX XM_CALLCONV LoadConstantMatrix(const XMFLOAT4X4& m)
+	{
+		return XMMatrixTranspose(XMLoadFloat4x4(&m));
+	}
+
+	template<class T>
+	const T& GetConstants(const SoftConstantBuffers& cb, uint32_t slot)
+	{
+		return *static_cast<const T*>(cb.slots[slot]);
+	}
+
+	// 世界矩阵和观察矩阵都是仿射变换，w保持为1，可以直接用XMVector3Transform串起来
+	XMVECTOR XM_CALLCONV TransformToClip(FXMVECTOR posL, const XMFLOAT4X4& world, const XMFLOAT4X4& view, const XMFLOAT4X4& proj)
+	{
+		XMVECTOR posW = XMVector3Transform(posL, LoadConstantMatrix(world));
+		XMVECTOR posV = XMVector3Transform(posW, LoadConstantMatrix(view));
+		return XMVector3Transform(posV, LoadConstantMatrix(proj));
+	}
+
+	void StoreVaryings(float* pDest, FXMVECTOR v, uint32_t count)
+	{
+		XMFLOAT4 f;
+		XMStoreFloat4(&f, v);
+		const float* pSrc = &f.x;
+		for (uint32_t i = 0; i < count; ++i)
+			pDest[i] = pSrc[i];
+	}
+
+	XMVECTOR LoadVaryings3(const float* pSrc)
+	{
+		return XMVectorSet(pSrc[0], pSrc[1], pSrc[2], 0.0f);
+	}
+
+	XMVECTOR LoadVaryings4(const float* pSrc)
+	{
+		return XMVectorSet(pSrc[0], pSrc[1], pSrc[2], pSrc[3]);
+	}
+
+	//
+	// Cube_VS/Cube_PS
+	//
+
+	void CubeVSFunc(const void* pVertex, const SoftConstantBuffers& cb, SoftVertexOut& vOut)
+	{
+		const VertexPosColor& vIn = *static_cast<const VertexPosColor*>(pVertex);
+		const SoftShaders::CubeCBPerObject& perObject = GetConstants<SoftShaders::CubeCBPerObject>(cb, 0);
+		const SoftShaders::CubeCBPerFrame& perFrame = GetConstants<SoftShaders::CubeCBPerFrame>(cb, 1);
+		XMStoreFloat4(&vOut.posH, TransformToClip(XMLoadFloat3(&vIn.pos), perObject.world, perFrame.view, perFrame.proj));
+		StoreVaryings(vOut.varyings, XMLoadFloat4(&vIn.color), 4);
+	}
+
+	XMFLOAT4 CubePSFunc(const float* pVaryings, const SoftConstantBuffers&)
+	{
+		return XMFLOAT4(pVaryings[0], pVaryings[1], pVaryings[2], pVaryings[3]);
+	}
+
+	//
+	// Light_VS/Light_PS，插值分量依次为PosW(3)、NormalW(3)、Color(4)
+	//
+
+	void LightVSFunc(const void* pVertex, const SoftConstantBuffers& cb, SoftVertexOut& vOut)
+	{
+		const VertexPosNormalColor& vIn = *static_cast<const VertexPosNormalColor*>(pVertex);
+		const SoftShaders::LightCBPerObject& perObject = GetConstants<SoftShaders::LightCBPerObject>(cb, 0);
+		const SoftShaders::LightCBPerFrame& perFrame = GetConstants<SoftShaders::LightCBPerFrame>(cb, 1);
+
+		XMVECTOR posW = XMVector3Transform(XMLoadFloat3(&vIn.pos), LoadConstantMatrix(perObject.world));
+		XMMATRIX viewProj = LoadConstantMatrix(perFrame.view) * LoadConstantMatrix(perFrame.proj);
+		XMStoreFloat4(&vOut.posH, XMVector3Transform(posW, viewProj));
+		StoreVaryings(vOut.varyings, posW, 3);
+		StoreVaryings(vOut.varyings + 3, XMVector3TransformNormal(XMLoadFloat3(&vIn.normal), LoadConstantMatrix(perObject.worldInvTranspose)), 3);
+		StoreVaryings(vOut.varyings + 6, XMLoadFloat4(&vIn.color), 4);
+	}
+
+	// ObjectLights为false时b3为LightClusterBindings，为true时为ObjectLightBindings
+	template<bool ObjectLights>
+	XMFLOAT4 LightPSImpl(const float* pVaryings, const SoftConstantBuffers& cb)
+	{
+		const SoftShaders::LightCBPerFrame& perFrame = GetConstants<SoftShaders::LightCBPerFrame>(cb, 1);
+		const Material& mat = GetConstants<SoftShaders::LightCBPerMaterial>(cb, 2).material;
+
+		XMVECTOR posW = LoadVaryings3(pVaryings);
+		XMVECTOR normalW = XMVector3Normalize(LoadVaryings3(pVaryings + 3));
+		XMVECTOR color = LoadVaryings4(pVaryings + 6);
+		XMVECTOR toEyeW = XMVector3Normalize(XMLoadFloat4(&perFrame.eyePos) - posW);
+
+		// 光照计算与HLSL共用LightHelper.hlsli中的函数
+		float3 pos, normal, toEye;
+		XMStoreFloat3(&pos, posW);
+		XMStoreFloat3(&normal, normalW);
+		XMStoreFloat3(&toEye, toEyeW);
+		LightTerms D = ComputeDirectionalLight(mat, perFrame.dirLight, normal, toEye);
+		LightTerms P = ComputePointLight(mat, perFrame.pointLight, pos, normal, toEye);
+		LightTerms S = ComputeSpotLight(mat, perFrame.spotLight, pos, normal, toEye);
+
+		// 阴影只遮挡直接光照，环境光不变
+		if (cb.slots[4])
+		{
+			const SoftShaders::LightShadowBindings& shadows = GetConstants<SoftShaders::LightShadowBindings>(cb, 4);
+			if (shadows.pDirShadow)
+			{
+				float visibility = shadows.pDirShadow->SampleVisibility(posW);
+				D.diffuse *= visibility;
+				D.spec *= visibility;
+			}
+			if (shadows.pSpotShadow)
+			{
+				float visibility = shadows.pSpotShadow->SampleVisibility(posW);
+				S.diffuse *= visibility;
+				S.spec *= visibility;
+			}
+		}
+
+		float4 ambient = D.ambient + P.ambient + S.ambient;
+		float4 diffuse = D.diffuse + P.diffuse + S.diffuse;
+		float4 spec = D.spec + P.spec + S.spec;
+
+		// 像素所在簇或当前物体的点光和聚光灯
+		if (cb.slots[3])
+		{
+			const PointLight* pPointLights;
+			const SpotLight* pSpotLights;
+			const uint32_t* pIndices;
+			LightClusterRange range;
+			if (ObjectLights)
+			{
+				const SoftShaders::ObjectLightBindings& objectLights = GetConstants<SoftShaders::ObjectLightBindings>(cb, 3);
+				pPointLights = objectLights.pPointLights;
+				pSpotLights = objectLights.pSpotLights;
+				pIndices = objectLights.pLightIndices;
+				range = objectLights.range;
+			}
+			else
+			{
+				const SoftShaders::LightClusterBindings& clusters = GetConstants<SoftShaders::LightClusterBindings>(cb, 3);
+				XMFLOAT3 posV;
+				XMStoreFloat3(&posV, XMVector3Transform(posW, LoadConstantMatrix(perFrame.view)));
+				pPointLights = clusters.pPointLights;
+				pSpotLights = clusters.pSpotLights;
+				pIndices = clusters.pLightIndices;
+				range = clusters.pClusterRanges[ComputeClusterIndex(clusters.constants, posV.x, posV.y, posV.z)];
+			}
+			uint32_t pointCount = range.counts & 0xffff, spotCount = range.counts >> 16;
+			pIndices += range.offset;
+			for (uint32_t i = 0; i < pointCount; ++i)
+			{
+				LightTerms T = ComputePointLight(mat, pPointLights[pIndices[i]], pos, normal, toEye);
+				ambient += T.ambient;
+				diffuse += T.diffuse;
+				spec += T.spec;
+			}
+			for (uint32_t i = 0; i < spotCount; ++i)
+			{
+				LightTerms T = ComputeSpotLight(mat, pSpotLights[pIndices[pointCount + i]], pos, normal, toEye);
+				ambient += T.ambient;
+				diffuse += T.diffuse;
+				spec += T.spec;
+			}
+		}
+
+		// 启用球谐探针时由探针插值得到的环境光代替各光源的ambient
+		if (cb.slots[5])
+		{
+			const SoftShaders::AmbientProbeBindings& probes = GetConstants<SoftShaders::AmbientProbeBindings>(cb, 5);
+			if (probes.constants.enabled)
+				XMStoreFloat4(&ambient, XMLoadFloat4(&mat.ambient) * SampleAmbientProbes(probes.constants, probes.pProbes, posW, normalW));
+		}
+
+		XMFLOAT4 litColor;
+		XMStoreFloat4(&litColor, color * (XMLoadFloat4(&ambient) + XMLoadFloat4(&diffuse)) + XMLoadFloat4(&spec));
+		litColor.w = mat.diffuse.w * pVaryings[9];
+		return litColor;
+	}
+
+	XMFLOAT4 LightPSFunc(const float* pVaryings, const SoftConstantBuffers& cb)
+	{
+		return LightPSImpl<false>(pVaryings, cb);
+	}
+
+	XMFLOAT4 LightListPSFunc(const float* pVaryings, const SoftConstantBuffers& cb)
+	{
+		return LightPSImpl<true>(pVaryings, cb);
+	}
+
+	// Baked_PS，与Light_VS配合，插值分量相同，只输出Color
+	XMFLOAT4 BakedPSFunc(const float* pVaryings, const SoftConstantBuffers&)
+	{
+		return XMFLOAT4(pVaryings[6], pVaryings[7], pVaryings[8], pVaryings[9]);
+	}
+}
+
+namespace SoftShaders
+{
+	const SoftVertexShader CubeVS = { CubeVSFunc, 4 };
+	const SoftPixelShader CubePS = { CubePSFunc };
+	const SoftVertexShader LightVS = { LightVSFunc, 10 };
+	const SoftPixelShader LightPS = { LightPSFunc };
+	const SoftPixelShader LightListPS = { LightListPSFunc };
+	const SoftPixelShader BakedPS = { BakedPSFunc };
+}
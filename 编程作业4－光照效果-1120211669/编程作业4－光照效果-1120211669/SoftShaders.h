@@ -0,0 +1,103 @@
+#ifndef SOFTSHADERS_H
+#define SOFTSHADERS_H
+
+#include "SoftRasterizer.h"
+#include "LightHelper.h"
+#include "LightClusters.h"
+#include "AmbientProbes.h"
+
+class ShadowMap;
+
+// HLSL着色器的C++版本，供SoftRasterizer使用。
+// 常量缓冲区的布局与HLSL中的cbuffer一致，矩阵和上传到GPU时一样存放转置后的结果，
+// 因此GameApp中CBufferObject的data可以直接绑定
+namespace SoftShaders
+{
+	// Cube.hlsli
+	struct CubeCBPerObject
+	{
+		DirectX::XMFLOAT4X4 world;
+	};
+
+	struct CubeCBPerFrame
+	{
+		DirectX::XMFLOAT4X4 view;
+		DirectX::XMFLOAT4X4 proj;
+	};
+
+	// Light.hlsli
+	struct LightCBPerObject
+	{
+		DirectX::XMFLOAT4X4 world;
+		DirectX::XMFLOAT4X4 worldInvTranspose;
+	};
+
+	struct LightCBPerFrame
+	{
+		DirectX::XMFLOAT4X4 view;
+		DirectX::XMFLOAT4X4 proj;
+		DirectionalLight dirLight;
+		PointLight pointLight;
+		SpotLight spotLight;
+		DirectX::XMFLOAT4 eyePos;
+	};
+	HLSL_CHECK_SIZE(LightCBPerFrame);
+	HLSL_CHECK_PACKING(LightCBPerFrame, eyePos);
+
+	struct LightCBPerMaterial
+	{
+		Material material;
+	};
+
+	// b3的CBLightClusters以及t0~t3的光源数组和簇索引表，GPU上是结构化缓冲区，这里直接指向CPU端的数组，Flush之前数组需要保持有效
+	struct LightClusterBindings
+	{
+		LightClusterConstants constants;
+		const PointLight* pPointLights;
+		const SpotLight* pSpotLights;
+		const LightClusterRange* pClusterRanges;
+		const uint32_t* pLightIndices;
+	};
+
+	// LightListPS的b3：当前物体的光源表，通常来自ObjectLightSelector，每次绘制前重新绑定。
+	// range.offset为pLightIndices中的起始位置，其后依次为点光和聚光灯的下标
+	struct ObjectLightBindings
+	{
+		const PointLight* pPointLights;
+		const SpotLight* pSpotLights;
+		const uint32_t* pLightIndices;
+		LightClusterRange range;
+	};
+
+	// b4的阴影贴图，只有CPU端的LightPS使用，为空的光源不计算阴影。Flush之前阴影贴图需要保持有效
+	struct LightShadowBindings
+	{
+		const ShadowMap* pDirShadow;		// b1中的方向光
+		const ShadowMap* pSpotShadow;		// b1中的聚光灯
+	};
+
+	// b5的CBAmbientProbes以及t4的探针系数，与LightClusterBindings一样直接指向CPU端的数组
+	struct AmbientProbeBindings
+	{
+		AmbientProbeConstants constants;
+		const DirectX::XMFLOAT4* pProbes;
+	};
+
+	// Cube_VS/Cube_PS，顶点为VertexPosColor，b0为CubeCBPerObject，b1为CubeCBPerFrame
+	extern const SoftVertexShader CubeVS;
+	extern const SoftPixelShader CubePS;
+
+	// Light_VS/Light_PS，顶点为VertexPosNormalColor，
+	// b0为LightCBPerObject，b1为LightCBPerFrame，b2为LightCBPerMaterial，
+	// b3为LightClusterBindings，为空时只计算b1中的三个光源；b4为LightShadowBindings，为空时没有阴影；
+	// b5为AmbientProbeBindings，为空或未启用时环境光为各光源ambient之和
+	extern const SoftVertexShader LightVS;
+	extern const SoftPixelShader LightPS;
+	// 只在CPU端使用的Light_PS，b3换成ObjectLightBindings，按绘制时给定的光源表代替分簇
+	extern const SoftPixelShader LightListPS;
+
+	// Baked_PS，配合LightVS使用，直接输出烘焙在顶点颜色中的光照
+	extern const SoftPixelShader BakedPS;
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef SOFTSIMD_H
+#define SOFTSIMD_H
+
+// SoftRasterizer和ShadowMap光栅化时共用的SIMD封装，一次处理一行中连续的kLanes个像素，
+// AmbientProbeGrid投影球谐系数时一次处理kLanes个光源。
+// 编译时开启AVX则一次8个，否则用SSE一次4个，都不可用时逐个计算
+
+#include <cstdint>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SOFT_USE_AVX 1
+#define SOFT_USE_SSE 0
+#elif defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define SOFT_USE_AVX 0
+#define SOFT_USE_SSE 1
+#else
+#define SOFT_USE_AVX 0
+#define SOFT_USE_SSE 0
+#endif
+
+namespace SoftSimd
+{
+#if SOFT_USE_AVX
+	const uint32_t kLanes = 8;
+	typedef __m256 VFloat;
+	typedef __m256 VBool;
+	inline VFloat VSplat(float f) { return _mm256_set1_ps(f); }
+	inline VFloat VLaneIndex() { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+	inline VFloat VLoad(const float* p) { return _mm256_loadu_ps(p); }
+	inline void VStore(float* p, VFloat v) { _mm256_storeu_ps(p, v); }
+	inline VFloat VAdd(VFloat a, VFloat b) { return _mm256_add_ps(a, b); }
+	inline VFloat VMul(VFloat a, VFloat b) { return _mm256_mul_ps(a, b); }
+	inline VFloat VSub(VFloat a, VFloat b) { return _mm256_sub_ps(a, b); }
+	inline VFloat VDiv(VFloat a, VFloat b) { return _mm256_div_ps(a, b); }
+	inline VFloat VMax(VFloat a, VFloat b) { return _mm256_max_ps(a, b); }
+	inline VFloat VSqrt(VFloat a) { return _mm256_sqrt_ps(a); }
+	inline VBool VCmpGe(VFloat a, VFloat b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+	inline VBool VCmpGt(VFloat a, VFloat b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	inline VBool VCmpLt(VFloat a, VFloat b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	inline VBool VCmpLe(VFloat a, VFloat b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+	inline VBool VAnd(VBool a, VBool b) { return _mm256_and_ps(a, b); }
+	inline VFloat VSelect(VBool mask, VFloat a, VFloat b) { return _mm256_blendv_ps(b, a, mask); }
+	inline int VMask(VBool mask) { return _mm256_movemask_ps(mask); }
+#elif SOFT_USE_SSE
+	const uint32_t kLanes = 4;
+	typedef __m128 VFloat;
+	typedef __m128 VBool;
+	inline VFloat VSplat(float f) { return _mm_set1_ps(f); }
+	inline VFloat VLaneIndex() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+	inline VFloat VLoad(const float* p) { return _mm_loadu_ps(p); }
+	inline void VStore(float* p, VFloat v) { _mm_storeu_ps(p, v); }
+	inline VFloat VAdd(VFloat a, VFloat b) { return _mm_add_ps(a, b); }
+	inline VFloat VMul(VFloat a, VFloat b) { return _mm_mul_ps(a, b); }
+	inline VFloat VSub(VFloat a, VFloat b) { return _mm_sub_ps(a, b); }
+	inline VFloat VDiv(VFloat a, VFloat b) { return _mm_div_ps(a, b); }
+	inline VFloat VMax(VFloat a, VFloat b) { return _mm_max_ps(a, b); }
+	inline VFloat VSqrt(VFloat a) { return _mm_sqrt_ps(a); }
+	inline VBool VCmpGe(VFloat a, VFloat b) { return _mm_cmpge_ps(a, b); }
+	inline VBool VCmpGt(VFloat a, VFloat b) { return _mm_cmpgt_ps(a, b); }
+	inline VBool VCmpLt(VFloat a, VFloat b) { return _mm_cmplt_ps(a, b); }
+	inline VBool VCmpLe(VFloat a, VFloat b) { return _mm_cmple_ps(a, b); }
+	inline VBool VAnd(VBool a, VBool b) { return _mm_and_ps(a, b); }
+	inline VFloat VSelect(VBool mask, VFloat a, VFloat b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+	inline int VMask(VBool mask) { return _mm_movemask_ps(mask); }
+#else
+	const uint32_t kLanes = 4;
+	struct VFloat { float f[4]; };
+	struct VBool { bool b[4]; };
+	inline VFloat VSplat(float f) { VFloat r = { { f, f, f, f } }; return r; }
+	inline VFloat VLaneIndex() { VFloat r = { { 0.0f, 1.0f, 2.0f, 3.0f } }; return r; }
+	inline VFloat VLoad(const float* p) { VFloat r = { { p[0], p[1], p[2], p[3] } }; return r; }
+	inline void VStore(float* p, VFloat v) { for (int i = 0; i < 4; ++i) p[i] = v.f[i]; }
+	inline VFloat VAdd(VFloat a, VFloat b) { for (int i = 0; i < 4; ++i) a.f[i] += b.f[i]; return a; }
+	inline VFloat VMul(VFloat a, VFloat b) { for (int i = 0; i < 4; ++i) a.f[i] *= b.f[i]; return a; }
+	inline VFloat VSub(VFloat a, VFloat b) { for (int i = 0; i < 4; ++i) a.f[i] -= b.f[i]; return a; }
+	inline VFloat VDiv(VFloat a, VFloat b) { for (int i = 0; i < 4; ++i) a.f[i] /= b.f[i]; return a; }
+	inline VFloat VMax(VFloat a, VFloat b) { for (int i = 0; i < 4; ++i) a.f[i] = a.f[i] > b.f[i] ? a.f[i] : b.f[i]; return a; }
+	inline VFloat VSqrt(VFloat a) { for (int i = 0; i < 4; ++i) a.f[i] = std::sqrt(a.f[i]); return a; }
+	inline VBool VCmpGe(VFloat a, VFloat b) { VBool r; for (int i = 0; i < 4; ++i) r.b[i] = a.f[i] >= b.f[i]; return r; }
+	inline VBool VCmpGt(VFloat a, VFloat b) { VBool r; for (int i = 0; i < 4; ++i) r.b[i] = a.f[i] > b.f[i]; return r; }
+	inline VBool VCmpLt(VFloat a, VFloat b) { VBool r; for (int i = 0; i < 4; ++i) r.b[i] = a.f[i] < b.f[i]; return r; }
+	inline VBool VCmpLe(VFloat a, VFloat b) { VBool r; for (int i = 0; i < 4; ++i) r.b[i] = a.f[i] <= b.f[i]; return r; }
+	inline VBool VAnd(VBool a, VBool b) { for (int i = 0; i < 4; ++i) a.b[i] = a.b[i] && b.b[i]; return a; }
+	inline VFloat VSelect(VBool mask, VFloat a, VFloat b) { for (int i = 0; i < 4; ++i) if (!mask.b[i]) a.f[i] = b.f[i]; return a; }
+	inline int VMask(VBool mask) { int m = 0; for (int i = 0; i < 4; ++i) m |= (mask.b[i] ? 1 : 0) << i; return m; }
+#endif
+}
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef STRUCTUREDBUFFERS_H
+#define STRUCTUREDBUFFERS_H
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <cstdint>
+#include <cstring>
+
+// 着色器只读的动态结构化缓冲区及其SRV，对应HLSL中的StructuredBuffer<T>。
+// 每次Upload整体替换内容，元素数超过容量时按两倍重新创建，此时SRV会变化，需要重新绑定
+template<class T>
+class StructuredBufferObject
+{
+	static_assert(sizeof(T) % 4 == 0, "Structured buffer stride must be a multiple of 4 bytes");
+
+public:
+	StructuredBufferObject() : m_Capacity(0) {}
+
+	// 写入count个元素，count为0时也保留至少一个元素的缓冲区，使SRV始终有效
+	// [Out]pRecreated	不为空时返回是否重新创建了缓冲区
+	template<class Device, class Context>
+	HRESULT Upload(Device* pDevice, Context* pContext, const T* pData, uint32_t count, bool* pRecreated = nullptr)
+	{
+		bool recreate = count > m_Capacity || !m_pBuffer;
+		if (recreate)
+		{
+			uint32_t capacity = m_Capacity ? m_Capacity : 1;
+			while (capacity < count)
+				capacity *= 2;
+			HRESULT hr = Create(pDevice, capacity);
+			if (FAILED(hr))
+				return hr;
+		}
+		if (pRecreated)
+			*pRecreated = recreate;
+		if (count == 0)
+			return S_OK;
+
+		D3D11_MAPPED_SUBRESOURCE mappedData;
+		HRESULT hr = pContext->Map(m_pBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
+		if (FAILED(hr))
+			return hr;
+		memcpy_s(mappedData.pData, sizeof(T) * m_Capacity, pData, sizeof(T) * count);
+		pContext->Unmap(m_pBuffer.Get(), 0);
+		return S_OK;
+	}
+
+	uint32_t GetCapacity() const { return m_Capacity; }
+	ID3D11Buffer* Get() const { return m_pBuffer.Get(); }
+	ID3D11ShaderResourceView* GetSRV() const { return m_pSRV.Get(); }
+	ID3D11ShaderResourceView* const* GetSRVAddressOf() const { return m_pSRV.GetAddressOf(); }
+
+private:
+	template<class Device>
+	HRESULT Create(Device* pDevice, uint32_t capacity)
+	{
+		D3D11_BUFFER_DESC bd;
+		ZeroMemory(&bd, sizeof(bd));
+		bd.Usage = D3D11_USAGE_DYNAMIC;
+		bd.ByteWidth = sizeof(T) * capacity;
+		bd.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		bd.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		bd.StructureByteStride = sizeof(T);
+		HRESULT hr = pDevice->CreateBuffer(&bd, nullptr, m_pBuffer.ReleaseAndGetAddressOf());
+		if (FAILED(hr))
+			return hr;
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+		ZeroMemory(&srvDesc, sizeof(srvDesc));
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		srvDesc.Buffer.FirstElement = 0;
+		srvDesc.Buffer.NumElements = capacity;
+		hr = pDevice->CreateShaderResourceView(m_pBuffer.Get(), &srvDesc, m_pSRV.ReleaseAndGetAddressOf());
+		if (FAILED(hr))
+			return hr;
+		m_Capacity = capacity;
+		return S_OK;
+	}
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_pBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_pSRV;
+	uint32_t m_Capacity;
+};
+
+#endif
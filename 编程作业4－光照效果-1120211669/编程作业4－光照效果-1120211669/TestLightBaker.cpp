@@ -0,0 +1,257 @@
+#include "UnitTest.h"
+#include "LightBaker.h"
+#include "JobSystem.h"
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	// 沿x轴每隔10个单位放一个半径为1的球，包围盒互不重叠
+	const uint32_t kMeshCount = 4;
+	const float kSpacing = 10.0f;
+
+	Material MakeMaterial()
+	{
+		Material mat;
+		mat.ambient = float4(0.5f, 0.5f, 0.5f, 1.0f);
+		mat.diffuse = float4(0.8f, 0.8f, 0.8f, 1.0f);
+		mat.specular = float4(0.5f, 0.5f, 0.5f, 16.0f);
+		mat.Reflect = float4(0.0f, 0.0f, 0.0f, 0.0f);
+		return mat;
+	}
+
+	// 每个网格超过一块(kChunkSize = 256)的顶点，并行烘焙时会拆成多块
+	void AddMeshes(StaticLightBaker& baker)
+	{
+		Geometry::MeshData<VertexPosNormalColor> sphere = Geometry::CreateSphere<VertexPosNormalColor>(1.0f, 20, 20);
+		for (uint32_t m = 0; m < kMeshCount; ++m)
+			baker.AddMesh(sphere, XMMatrixTranslation(m * kSpacing, 0.0f, 0.0f), MakeMaterial());
+	}
+
+	struct LightSet
+	{
+		DirectionalLight dir;
+		std::vector<PointLight> points;
+		std::vector<SpotLight> spots;
+
+		void Apply(StaticLightBaker& baker) const
+		{
+			baker.SetLights(&dir, 1, points.data(), (uint32_t)points.size(), spots.data(), (uint32_t)spots.size());
+		}
+	};
+
+	PointLight MakePointLight(float x, float range)
+	{
+		PointLight L;
+		L.ambient = float4(0.1f, 0.1f, 0.1f, 1.0f);
+		L.diffuse = float4(1.0f, 0.8f, 0.6f, 1.0f);
+		L.specular = float4(0.5f, 0.5f, 0.5f, 1.0f);
+		L.position = float3(x, 2.0f, 0.0f);
+		L.range = range;
+		L.att = float3(0.0f, 0.5f, 0.0f);
+		L.pad = 0.0f;
+		return L;
+	}
+
+	// 初始光源：点光0只照到网格0，点光1只照到网格2，聚光灯只照到网格3
+	LightSet MakeLights()
+	{
+		LightSet lights;
+		lights.dir.ambient = float4(0.2f, 0.2f, 0.2f, 1.0f);
+		lights.dir.diffuse = float4(0.5f, 0.5f, 0.5f, 1.0f);
+		lights.dir.specular = float4(0.2f, 0.2f, 0.2f, 1.0f);
+		lights.dir.direction = normalize(float3(0.3f, -1.0f, 0.2f));
+		lights.dir.pad = 0.0f;
+		lights.points.push_back(MakePointLight(0.0f, 3.0f));
+		lights.points.push_back(MakePointLight(2.0f * kSpacing, 3.0f));
+
+		SpotLight spot;
+		spot.ambient = float4(0.0f, 0.0f, 0.0f, 1.0f);
+		spot.diffuse = float4(1.0f, 1.0f, 1.0f, 1.0f);
+		spot.specular = float4(1.0f, 1.0f, 1.0f, 1.0f);
+		spot.position = float3(3.0f * kSpacing, 4.0f, 0.0f);
+		spot.range = 6.0f;
+		spot.direction = float3(0.0f, -1.0f, 0.0f);
+		spot.spot = 4.0f;
+		spot.att = float3(1.0f, 0.0f, 0.0f);
+		spot.pad = 0.0f;
+		lights.spots.push_back(spot);
+		return lights;
+	}
+
+	// 各网格在上一次Bake中是否重新烘焙，按位表示
+	uint32_t UpdatedMask(const StaticLightBaker& baker)
+	{
+		uint32_t mask = 0;
+		for (uint32_t m = 0; m < baker.GetMeshCount(); ++m)
+		{
+			if (baker.IsMeshUpdated(m))
+				mask |= 1u << m;
+		}
+		return mask;
+	}
+
+	bool SameColors(const StaticLightBaker& a, uint32_t meshA, const StaticLightBaker& b, uint32_t meshB)
+	{
+		const std::vector<VertexPosNormalColor>& va = a.GetBakedMesh(meshA).vertexVec;
+		const std::vector<VertexPosNormalColor>& vb = b.GetBakedMesh(meshB).vertexVec;
+		if (va.size() != vb.size())
+			return false;
+		for (size_t i = 0; i < va.size(); ++i)
+		{
+			if (std::memcmp(&va[i].color, &vb[i].color, sizeof(XMFLOAT4)) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	// 增量烘焙的结果必须与用同样的光源从头烘焙完全相同
+	bool MatchesFullBake(const StaticLightBaker& baker, const LightSet& lights)
+	{
+		StaticLightBaker full;
+		AddMeshes(full);
+		lights.Apply(full);
+		full.Bake();
+		for (uint32_t m = 0; m < kMeshCount; ++m)
+		{
+			if (!SameColors(baker, m, full, m))
+				return false;
+		}
+		return true;
+	}
+}
+
+TEST_CASE(LightBaker_UnchangedLightsBakeNothing)
+{
+	StaticLightBaker baker;
+	AddMeshes(baker);
+	CHECK_EQ(baker.GetMeshCount(), kMeshCount);
+	LightSet lights = MakeLights();
+	lights.Apply(baker);
+	CHECK_EQ(baker.Bake(), kMeshCount);
+	CHECK_EQ(UpdatedMask(baker), 0xfu);
+
+	// 再次设置相同的光源不需要重新烘焙
+	lights.Apply(baker);
+	CHECK_EQ(baker.Bake(), 0u);
+	CHECK_EQ(UpdatedMask(baker), 0u);
+	CHECK_EQ(baker.GetBakedVertexCount(), 0u);
+}
+
+TEST_CASE(LightBaker_MovedLightRebakesOldAndNewRange)
+{
+	StaticLightBaker baker;
+	AddMeshes(baker);
+	LightSet lights = MakeLights();
+	lights.Apply(baker);
+	baker.Bake();
+
+	StaticLightBaker before;
+	AddMeshes(before);
+	lights.Apply(before);
+	before.Bake();
+
+	// 点光0从网格0移到网格1：变化前后的范围都要重新烘焙
+	lights.points[0].position.x = kSpacing;
+	lights.Apply(baker);
+	CHECK_EQ(baker.Bake(), 2u);
+	CHECK_EQ(UpdatedMask(baker), 0x3u);
+	CHECK(MatchesFullBake(baker, lights));
+	// 没有重新烘焙的网格保持原来的结果
+	CHECK(SameColors(baker, 2, before, 2));
+	CHECK(SameColors(baker, 3, before, 3));
+	CHECK(!SameColors(baker, 0, before, 0));
+
+	// 只改变颜色，范围不变
+	lights.spots[0].diffuse = float4(0.2f, 0.4f, 1.0f, 1.0f);
+	lights.Apply(baker);
+	CHECK_EQ(baker.Bake(), 1u);
+	CHECK_EQ(UpdatedMask(baker), 0x8u);
+	CHECK(MatchesFullBake(baker, lights));
+
+	// 点光1移向网格3并扩大范围，同时照到网格2和网格3
+	lights.points[1].position.x = 2.2f * kSpacing;
+	lights.points[1].range = kSpacing;
+	lights.Apply(baker);
+	CHECK_EQ(baker.Bake(), 2u);
+	CHECK_EQ(UpdatedMask(baker), 0xcu);
+	CHECK(MatchesFullBake(baker, lights));
+}
+
+TEST_CASE(LightBaker_AddedAndRemovedLights)
+{
+	StaticLightBaker baker;
+	AddMeshes(baker);
+	LightSet lights = MakeLights();
+	lights.Apply(baker);
+	baker.Bake();
+
+	// 删除点光1，原来照到的网格2重新烘焙
+	lights.points.pop_back();
+	lights.Apply(baker);
+	CHECK_EQ(baker.Bake(), 1u);
+	CHECK_EQ(UpdatedMask(baker), 0x4u);
+	CHECK(MatchesFullBake(baker, lights));
+
+	// 增加一个与所有包围盒都不相交的点光
+	lights.points.push_back(MakePointLight(5.0f, 2.0f));
+	lights.Apply(baker);
+	CHECK_EQ(baker.Bake(), 0u);
+	CHECK(MatchesFullBake(baker, lights));
+
+	// 只有范围的边缘照到网格1
+	lights.points.push_back(MakePointLight(kSpacing + 3.0f, 2.5f));
+	lights.points.back().position.y = 0.0f;
+	lights.Apply(baker);
+	CHECK_EQ(baker.Bake(), 1u);
+	CHECK_EQ(UpdatedMask(baker), 0x2u);
+	CHECK(MatchesFullBake(baker, lights));
+}
+
+TEST_CASE(LightBaker_GlobalChangesRebakeAll)
+{
+	StaticLightBaker baker;
+	AddMeshes(baker);
+	LightSet lights = MakeLights();
+	lights.Apply(baker);
+	baker.Bake();
+
+	// 方向光照到所有网格
+	lights.dir.diffuse = float4(0.6f, 0.5f, 0.4f, 1.0f);
+	lights.Apply(baker);
+	CHECK_EQ(baker.Bake(), kMeshCount);
+	CHECK(MatchesFullBake(baker, lights));
+
+	// 材质只影响自己的网格
+	Material mat = MakeMaterial();
+	mat.diffuse = float4(0.2f, 0.9f, 0.2f, 1.0f);
+	baker.SetMaterial(1, mat);
+	CHECK_EQ(baker.Bake(), 1u);
+	CHECK_EQ(UpdatedMask(baker), 0x2u);
+	baker.SetMaterial(1, mat);
+	CHECK_EQ(baker.Bake(), 0u);
+
+	// 开启镜面反射后全部重新烘焙，观察点不变时不再烘焙
+	baker.SetSpecular(true, XMFLOAT3(0.0f, 5.0f, -10.0f));
+	CHECK_EQ(baker.Bake(), kMeshCount);
+	baker.SetSpecular(true, XMFLOAT3(0.0f, 5.0f, -10.0f));
+	CHECK_EQ(baker.Bake(), 0u);
+}
+
+TEST_CASE(LightBaker_ParallelBakeMatchesSerial)
+{
+	LightSet lights = MakeLights();
+	StaticLightBaker serial, parallel;
+	AddMeshes(serial);
+	AddMeshes(parallel);
+	lights.Apply(serial);
+	lights.Apply(parallel);
+	JobSystem jobs(4);
+	CHECK_EQ(serial.Bake(), kMeshCount);
+	CHECK_EQ(parallel.Bake(&jobs), kMeshCount);
+	CHECK_EQ(parallel.GetBakedVertexCount(), serial.GetBakedVertexCount());
+	CHECK(parallel.GetBakedVertexCount() > 256 * kMeshCount);
+	for (uint32_t m = 0; m < kMeshCount; ++m)
+		CHECK(SameColors(parallel, m, serial, m));
+}
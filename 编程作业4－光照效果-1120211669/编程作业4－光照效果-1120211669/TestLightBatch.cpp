@@ -0,0 +1,320 @@
+#include "UnitTest.h"
+#include "LightBatch.h"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	// 与MathBenchmark.cpp相同：AVX2和FMA指令可用，并且操作系统会保存YMM寄存器
+	bool CpuSupportsAVX2()
+	{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+		__cpuid(info, 1);
+		bool fma = (info[2] & (1 << 12)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		if (!fma || !osxsave || !avx || (_xgetbv(0) & 6) != 6)
+			return false;
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+		return false;
+#endif
+	}
+
+	// 包含不是8的倍数的长度，覆盖AVX2的掩码读写
+	const uint32_t kCounts[] = { 1, 7, 8, 9, 100, 253 };
+	const uint32_t kMaxCount = 253;
+
+	// 标量实现逐个调用共用的光照函数，只多了累加；AVX2实现的pow为多项式近似，误差见LightBatch.h
+	const double kScalarTolerance = 1e-6;
+	const double kAVX2Tolerance = 1e-5;
+
+	// 随机采样点：位置在光源周围的立方体中，一部分超出光源范围；法线和指向观察点的向量为单位向量
+	struct SampleSet
+	{
+		std::vector<float> data[9];
+
+		explicit SampleSet(uint32_t seed)
+		{
+			std::mt19937 rng(seed);
+			std::uniform_real_distribution<float> pos(-6.0f, 6.0f);
+			std::uniform_real_distribution<float> dir(-1.0f, 1.0f);
+			for (std::vector<float>& v : data)
+				v.resize(kMaxCount);
+			for (uint32_t i = 0; i < kMaxCount; ++i)
+			{
+				for (int c = 0; c < 3; ++c)
+					data[c][i] = pos(rng);
+				for (int k = 3; k < 9; k += 3)
+				{
+					float3 v(dir(rng), dir(rng), dir(rng) + 0.1f);
+					v = normalize(v);
+					data[k][i] = v.x;
+					data[k + 1][i] = v.y;
+					data[k + 2][i] = v.z;
+				}
+			}
+		}
+
+		LightSamplesSoA Get() const
+		{
+			LightSamplesSoA s = {
+				data[0].data(), data[1].data(), data[2].data(),
+				data[3].data(), data[4].data(), data[5].data(),
+				data[6].data(), data[7].data(), data[8].data()
+			};
+			return s;
+		}
+
+		float3 Pos(uint32_t i) const { return float3(data[0][i], data[1][i], data[2][i]); }
+		float3 Normal(uint32_t i) const { return float3(data[3][i], data[4][i], data[5][i]); }
+		float3 ToEye(uint32_t i) const { return float3(data[6][i], data[7][i], data[8][i]); }
+	};
+
+	// 三项光照结果，初始值不为0以检查结果是累加的。末尾多留8个哨兵检查不会越界写入
+	struct TermBuffers
+	{
+		static const uint32_t kGuard = 8;
+		std::vector<float> data[12];
+
+		TermBuffers()
+		{
+			for (int k = 0; k < 12; ++k)
+				data[k].assign(kMaxCount + kGuard, 0.125f * (float)(k % 4 + 1));
+		}
+
+		LightTermsSoA Get()
+		{
+			LightTermsSoA t;
+			for (int c = 0; c < 4; ++c)
+			{
+				t.ambient[c] = data[c].data();
+				t.diffuse[c] = data[4 + c].data();
+				t.spec[c] = data[8 + c].data();
+			}
+			return t;
+		}
+
+		void Add(uint32_t i, const LightTerms& terms)
+		{
+			const float4* parts[3] = { &terms.ambient, &terms.diffuse, &terms.spec };
+			for (int k = 0; k < 12; ++k)
+				data[k][i] += (&parts[k / 4]->x)[k % 4];
+		}
+	};
+
+	// 前count个元素的最大误差，大于1的值按相对误差计算；哨兵必须保持原值
+	double MaxError(const TermBuffers& a, const TermBuffers& b, uint32_t count)
+	{
+		double maxError = 0.0;
+		for (int k = 0; k < 12; ++k)
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				double ref = b.data[k][i];
+				double err = std::fabs((double)a.data[k][i] - ref) / std::max(1.0, std::fabs(ref));
+				maxError = std::max(maxError, err);
+			}
+			for (uint32_t i = count; i < count + TermBuffers::kGuard; ++i)
+			{
+				if (a.data[k][i] != b.data[k][i])
+					maxError = 1e30;
+			}
+		}
+		return maxError;
+	}
+
+	Material MakeMaterial()
+	{
+		Material mat;
+		mat.ambient = float4(0.5f, 0.45f, 0.4f, 1.0f);
+		mat.diffuse = float4(0.9f, 0.8f, 0.7f, 1.0f);
+		mat.specular = float4(0.6f, 0.6f, 0.6f, 16.0f);
+		mat.Reflect = float4(0.0f, 0.0f, 0.0f, 0.0f);
+		return mat;
+	}
+
+	DirectionalLight MakeDirectionalLight()
+	{
+		DirectionalLight L;
+		L.ambient = float4(0.2f, 0.2f, 0.25f, 1.0f);
+		L.diffuse = float4(0.8f, 0.75f, 0.7f, 1.0f);
+		L.specular = float4(0.5f, 0.5f, 0.5f, 1.0f);
+		L.direction = normalize(float3(0.577f, -0.577f, 0.4f));
+		L.pad = 0.0f;
+		return L;
+	}
+
+	PointLight MakePointLight()
+	{
+		PointLight L;
+		L.ambient = float4(0.1f, 0.1f, 0.1f, 1.0f);
+		L.diffuse = float4(1.0f, 0.9f, 0.6f, 1.0f);
+		L.specular = float4(0.7f, 0.7f, 0.7f, 1.0f);
+		L.position = float3(0.5f, 1.0f, -0.5f);
+		L.range = 7.0f;
+		L.att = float3(0.0f, 0.3f, 0.05f);
+		L.pad = 0.0f;
+		return L;
+	}
+
+	SpotLight MakeSpotLight()
+	{
+		SpotLight L;
+		L.ambient = float4(0.05f, 0.05f, 0.05f, 1.0f);
+		L.diffuse = float4(1.0f, 1.0f, 1.0f, 1.0f);
+		L.specular = float4(1.0f, 1.0f, 1.0f, 1.0f);
+		L.position = float3(0.0f, 5.0f, 0.0f);
+		L.range = 9.0f;
+		L.direction = normalize(float3(0.1f, -1.0f, 0.2f));
+		L.spot = 8.0f;
+		L.att = float3(1.0f, 0.0f, 0.02f);
+		L.pad = 0.0f;
+		return L;
+	}
+
+	// 直接调用LightHelper.hlsli中的函数得到的参考结果
+	void ReferenceDirectional(const Material& mat, const DirectionalLight& L, const SampleSet& s, uint32_t count, TermBuffers& out)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+			out.Add(i, ComputeDirectionalLight(mat, L, s.Normal(i), s.ToEye(i)));
+	}
+
+	void ReferencePoint(const Material& mat, const PointLight& L, const SampleSet& s, uint32_t count, TermBuffers& out)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+			out.Add(i, ComputePointLight(mat, L, s.Pos(i), s.Normal(i), s.ToEye(i)));
+	}
+
+	void ReferenceSpot(const Material& mat, const SpotLight& L, const SampleSet& s, uint32_t count, TermBuffers& out)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+			out.Add(i, ComputeSpotLight(mat, L, s.Pos(i), s.Normal(i), s.ToEye(i)));
+	}
+
+	// 一种实现的三种光源与参考结果的最大误差
+	double MaxBackendError(const LightBatchBackend& backend, uint32_t count)
+	{
+		SampleSet samples(count);
+		LightSamplesSoA soa = samples.Get();
+		Material mat = MakeMaterial();
+		double maxError = 0.0;
+
+		// 方向光不读取位置
+		DirectionalLight dirLight = MakeDirectionalLight();
+		TermBuffers dirRef, dirOut;
+		ReferenceDirectional(mat, dirLight, samples, count, dirRef);
+		LightSamplesSoA noPos = soa;
+		noPos.posX = noPos.posY = noPos.posZ = nullptr;
+		backend.directional(mat, dirLight, noPos, count, dirOut.Get());
+		maxError = std::max(maxError, MaxError(dirOut, dirRef, count));
+
+		PointLight pointLight = MakePointLight();
+		TermBuffers pointRef, pointOut;
+		ReferencePoint(mat, pointLight, samples, count, pointRef);
+		backend.point(mat, pointLight, soa, count, pointOut.Get());
+		maxError = std::max(maxError, MaxError(pointOut, pointRef, count));
+
+		SpotLight spotLight = MakeSpotLight();
+		TermBuffers spotRef, spotOut;
+		ReferenceSpot(mat, spotLight, samples, count, spotRef);
+		backend.spot(mat, spotLight, soa, count, spotOut.Get());
+		maxError = std::max(maxError, MaxError(spotOut, spotRef, count));
+		return maxError;
+	}
+
+	bool GetAVX2Backend(LightBatchBackend& backend)
+	{
+		GetLightBatchAVX2(backend);
+		if (!backend.available)
+			std::cout << "  AVX2 backend not compiled with AVX2/FMA, skipped\n";
+		else if (!CpuSupportsAVX2())
+			std::cout << "  CPU lacks AVX2/FMA, skipped\n";
+		return backend.available && CpuSupportsAVX2();
+	}
+}
+
+TEST_CASE(LightBatch_ScalarMatchesLightHelper)
+{
+	LightBatchBackend scalar;
+	GetLightBatchScalar(scalar);
+	CHECK(scalar.available);
+	CHECK(std::string(scalar.name) == "Scalar");
+	for (uint32_t count : kCounts)
+		CHECK_NEAR(MaxBackendError(scalar, count), 0.0, kScalarTolerance);
+}
+
+TEST_CASE(LightBatch_AVX2MatchesLightHelper)
+{
+	LightBatchBackend avx2;
+	if (!GetAVX2Backend(avx2))
+		return;
+	CHECK(std::string(avx2.name) == "AVX2");
+	for (uint32_t count : kCounts)
+		CHECK_NEAR(MaxBackendError(avx2, count), 0.0, kAVX2Tolerance);
+}
+
+TEST_CASE(LightBatch_AVX2MatchesScalar)
+{
+	LightBatchBackend scalar, avx2;
+	GetLightBatchScalar(scalar);
+	if (!GetAVX2Backend(avx2))
+		return;
+
+	// 两种实现依次累加三种光源，与烘焙时的用法相同
+	SampleSet samples(7);
+	LightSamplesSoA soa = samples.Get();
+	Material mat = MakeMaterial();
+	DirectionalLight dirLight = MakeDirectionalLight();
+	PointLight pointLight = MakePointLight();
+	SpotLight spotLight = MakeSpotLight();
+	for (uint32_t count : kCounts)
+	{
+		TermBuffers scalarOut, avx2Out;
+		scalar.directional(mat, dirLight, soa, count, scalarOut.Get());
+		scalar.point(mat, pointLight, soa, count, scalarOut.Get());
+		scalar.spot(mat, spotLight, soa, count, scalarOut.Get());
+		avx2.directional(mat, dirLight, soa, count, avx2Out.Get());
+		avx2.point(mat, pointLight, soa, count, avx2Out.Get());
+		avx2.spot(mat, spotLight, soa, count, avx2Out.Get());
+		CHECK_NEAR(MaxError(avx2Out, scalarOut, count), 0.0, kAVX2Tolerance);
+	}
+}
+
+TEST_CASE(LightBatch_OutOfRangeAddsNothing)
+{
+	// 超出范围时三项都为0，包括环境光
+	SampleSet samples(11);
+	LightSamplesSoA soa = samples.Get();
+	Material mat = MakeMaterial();
+	PointLight pointLight = MakePointLight();
+	pointLight.position = float3(100.0f, 0.0f, 0.0f);
+	SpotLight spotLight = MakeSpotLight();
+	spotLight.position = float3(0.0f, -100.0f, 0.0f);
+
+	LightBatchBackend backends[2];
+	GetLightBatchScalar(backends[0]);
+	bool hasAVX2 = GetAVX2Backend(backends[1]);
+	for (int b = 0; b < (hasAVX2 ? 2 : 1); ++b)
+	{
+		TermBuffers initial, out;
+		backends[b].point(mat, pointLight, soa, kMaxCount, out.Get());
+		backends[b].spot(mat, spotLight, soa, kMaxCount, out.Get());
+		CHECK_EQ(MaxError(out, initial, kMaxCount), 0.0);
+	}
+}
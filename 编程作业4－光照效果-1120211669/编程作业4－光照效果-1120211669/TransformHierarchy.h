@@ -0,0 +1,60 @@
+#ifndef TRANSFORMHIERARCHY_H
+#define TRANSFORMHIERARCHY_H
+
+#include <vector>
+#include <cstdint>
+#include "PortableMath.h"
+#include "AffineTransform.h"
+
+class JobSystem;
+
+// 数组存放的变换层次。每个节点保存父节点下标、局部变换和世界变换(3x4仿射变换)，
+// world = local * parentWorld。节点必须按深度从小到大添加，保证父节点总在子节点之前，
+// 这样按数组顺序更新即为拓扑顺序，同一深度的节点可以并行更新
+class TransformHierarchy
+{
+public:
+	static const uint32_t kNoParent = 0xffffffffu;
+
+public:
+	TransformHierarchy();
+
+	void Clear();
+	void Reserve(uint32_t nodeCount);
+	// 添加节点，返回节点下标。新节点的深度不能小于当前最后一个节点的深度
+	uint32_t AddNode(uint32_t parent, const AffineTransform& local);
+
+	// 修改局部变换并标记为脏，不同节点可以在不同线程中同时设置
+	void SetLocal(uint32_t node, const AffineTransform& local);
+
+	// 只重新计算脏节点及其子树的世界矩阵
+	// [In]jobs	不为空则每一层内并行更新
+	void Update(JobSystem* jobs = nullptr);
+
+	uint32_t GetNodeCount() const;
+	const AffineTransform& GetWorld(uint32_t node) const;
+	// 上一次Update中该节点的世界矩阵是否发生变化
+	bool WasUpdated(uint32_t node) const;
+	// 上一次Update中的矩阵乘法次数
+	uint64_t GetMultiplyCount() const;
+
+private:
+	// 更新[begin, end)范围内的节点，返回矩阵乘法次数
+	uint64_t UpdateRange(uint32_t begin, uint32_t end);
+
+private:
+	enum NodeFlag
+	{
+		NodeFlag_Dirty = 1,		// 局部变换被修改过
+		NodeFlag_Updated = 2	// 上一次Update中世界矩阵发生了变化
+	};
+
+	std::vector<uint32_t> m_Parent;					// 父节点下标
+	std::vector<AffineTransform> m_Local;			// 局部变换
+	std::vector<AffineTransform> m_World;			// 世界变换
+	std::vector<uint8_t> m_Flags;					// NodeFlag的组合
+	std::vector<uint32_t> m_LevelStart;				// 每一层的起始下标
+	uint64_t m_MultiplyCount;						// 上一次Update中的矩阵乘法次数
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef UNITTEST_H
+#define UNITTEST_H
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// 最小的单元测试框架，不依赖第三方库，Windows和Linux上都能编译。
+// TEST_CASE定义的测试在静态初始化时注册，由UnitTestMain.cpp按注册顺序运行。
+// CHECK系列宏失败时打印文件、行号和表达式，当前测试继续执行，测试结束后计为失败
+namespace UnitTest
+{
+	typedef void (*TestFunc)();
+
+	struct TestCase
+	{
+		const char* name;
+		TestFunc func;
+	};
+
+	inline std::vector<TestCase>& GetTests()
+	{
+		static std::vector<TestCase> tests;
+		return tests;
+	}
+
+	// 当前测试中未通过的检查数，每个测试开始前清零
+	inline int& GetFailureCount()
+	{
+		static int count = 0;
+		return count;
+	}
+
+	struct Registrar
+	{
+		Registrar(const char* name, TestFunc func)
+		{
+			TestCase test = { name, func };
+			GetTests().push_back(test);
+		}
+	};
+
+	inline void ReportFailure(const char* file, int line, const char* expr)
+	{
+		std::cout << "  " << file << "(" << line << "): CHECK(" << expr << ") failed\n";
+		++GetFailureCount();
+	}
+
+	template <class A, class B>
+	void CheckEqual(const char* file, int line, const char* exprA, const char* exprB, const A& a, const B& b)
+	{
+		if (a == b)
+			return;
+		std::cout << "  " << file << "(" << line << "): CHECK_EQ(" << exprA << ", " << exprB << ") failed: "
+			<< a << " != " << b << "\n";
+		++GetFailureCount();
+	}
+
+	inline void CheckNear(const char* file, int line, const char* exprA, const char* exprB, double a, double b, double tolerance)
+	{
+		if (std::fabs(a - b) <= tolerance)
+			return;
+		std::cout << "  " << file << "(" << line << "): CHECK_NEAR(" << exprA << ", " << exprB << ") failed: "
+			<< a << " vs " << b << ", tolerance " << tolerance << "\n";
+		++GetFailureCount();
+	}
+}
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static UnitTest::Registrar name##_Registrar(#name, name); \
+	static void name()
+
+#define CHECK(expr) \
+	((expr) ? (void)0 : UnitTest::ReportFailure(__FILE__, __LINE__, #expr))
+
+#define CHECK_EQ(a, b) \
+	UnitTest::CheckEqual(__FILE__, __LINE__, #a, #b, (a), (b))
+
+#define CHECK_NEAR(a, b, tolerance) \
+	UnitTest::CheckNear(__FILE__, __LINE__, #a, #b, (a), (b), (tolerance))
+
+#endif
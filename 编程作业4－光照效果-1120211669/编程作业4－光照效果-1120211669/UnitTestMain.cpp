@@ -0,0 +1,31 @@
+// 单元测试命令行程序：运行各Test*.cpp中的TEST_CASE，不需要GPU和D3D设备。
+//
+// UnitTests [name...]    只运行名字中包含任一参数的测试
+//
+// Linux上可以直接编译：g++ -std=c++14 -O2 -I. UnitTestMain.cpp Test*.cpp <被测模块的.cpp> -pthread
+// 退出码：0为全部通过，1为有测试未通过
+#include "UnitTest.h"
+#include <cstring>
+#include <iostream>
+
+int main(int argc, char* argv[])
+{
+	int run = 0, failed = 0;
+	for (const UnitTest::TestCase& test : UnitTest::GetTests())
+	{
+		bool selected = argc < 2;
+		for (int i = 1; i < argc && !selected; ++i)
+			selected = std::strstr(test.name, argv[i]) != nullptr;
+		if (!selected)
+			continue;
+
+		UnitTest::GetFailureCount() = 0;
+		test.func();
+		bool pass = UnitTest::GetFailureCount() == 0;
+		std::cout << (pass ? "[ PASS ] " : "[ FAIL ] ") << test.name << "\n";
+		++run;
+		failed += pass ? 0 : 1;
+	}
+	std::cout << run - failed << "/" << run << " tests passed\n";
+	return failed ? 1 : 0;
+}
@@ -9,8 +9,12 @@
 #ifndef VERTEX_H
 #define VERTEX_H
 
+#ifdef _WIN32
 #include <d3d11_1.h>
-#include <DirectXMath.h>
+#else
+#include "PlatformTypes.h"
+#endif
+#include "PortableMath.h"
 
 struct VertexPos
 {